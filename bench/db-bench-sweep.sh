@@ -0,0 +1,84 @@
+#!/bin/sh
+#
+# Runs LevelDB's db_bench once for each value of the options that size
+# level-0 and the levels above it, and prints one CSV line per run:
+#
+#   option,value,fill micros/op,fill MB/s,fill P99 micros,
+#   read micros/op,read P99 micros
+#
+# What to look for:
+#
+# * level0_file_num_compaction_trigger: higher values batch more level-0
+#   files into each compaction, so random fills get faster, but reads
+#   merge more level-0 files and get slower.
+# * level0_slowdown_writes_trigger / level0_stop_writes_trigger: higher
+#   values trade fewer write stalls (lower fill P99) for more level-0
+#   files while compactions catch up (higher read latency).
+#
+#   The database raises the slowdown trigger to at least the compaction
+#   trigger, and the stop trigger to at least the slowdown trigger.  So
+#   that each row changes a single knob, the level-0 rows hold the
+#   triggers they do not sweep at values above every swept one: the
+#   compaction trigger sweep runs with slowdown 32 and stop 48, the
+#   slowdown sweep with stop 48, and the stop sweep with slowdown 4.
+# * max_mem_compaction_level: pushing new tables further down saves
+#   level 0=>1 compactions on fills of non-overlapping keys; 0 keeps
+#   every new table in level-0.
+# * max_bytes_for_level_base / max_bytes_for_level_multiplier: larger
+#   levels mean fewer, larger compactions (faster fills, longer stalls);
+#   a smaller multiplier means more levels and more write amplification
+#   but less space taken by overwritten data.
+#
+# Build db_bench first with:
+#
+#   make -C deps/leveldb/leveldb-1.20 out-static/db_bench
+#
+# Environment: DB_BENCH (path to db_bench), DB (database directory),
+# NUM (number of keys, default 1000000).
+
+DB_BENCH=${DB_BENCH:-deps/leveldb/leveldb-1.20/out-static/db_bench}
+DB=${DB:-/tmp/db-bench-sweep}
+NUM=${NUM:-1000000}
+
+# run option value [fixed db_bench flags...]
+run () {
+  option=$1
+  value=$2
+  shift 2
+  "$DB_BENCH" --db="$DB" --num="$NUM" --histogram=1 \
+    --benchmarks=fillrandom,readrandom "$@" "--$option=$value" 2>/dev/null |
+    awk -v option="$option" -v value="$value" '
+    /^(fillrandom|readrandom) +:/ {
+      bench = $1
+      micros[bench] = $3
+      if ($6 == "MB/s") mbs[bench] = $5
+    }
+    /^\[/ {
+      # "[ left, right ) count percentage% cumulative% ###"
+      cumulative = $7 + 0
+      if (!(bench in p99) && cumulative >= 99) {
+        p99[bench] = $3 + 0
+      }
+    }
+    END {
+      printf "%s,%s,%s,%s,%s,%s,%s\n", option, value,
+          micros["fillrandom"], mbs["fillrandom"], p99["fillrandom"],
+          micros["readrandom"], p99["readrandom"]
+    }'
+}
+
+echo "option,value,fill micros/op,fill MB/s,fill P99 micros,read micros/op,read P99 micros"
+
+for v in 2 4 8 16; do
+  run level0_file_num_compaction_trigger $v \
+    --level0_slowdown_writes_trigger=32 --level0_stop_writes_trigger=48
+done
+for v in 4 8 16 32; do
+  run level0_slowdown_writes_trigger $v --level0_stop_writes_trigger=48
+done
+for v in 8 12 24 48; do
+  run level0_stop_writes_trigger $v --level0_slowdown_writes_trigger=4
+done
+for v in 0 1 2 3; do run max_mem_compaction_level $v; done
+for v in 2097152 10485760 41943040; do run max_bytes_for_level_base $v; done
+for v in 4 8 10 16; do run max_bytes_for_level_multiplier $v; done
@@ -70,7 +70,11 @@
             "src/batch.cc"
           , "src/database.cc"
           , "src/iterator.cc"
+          , "src/key_locks.cc"
+          , "src/keyspace.cc"
           , "src/leveldown.cc"
+          , "src/transaction.cc"
+          , "src/write_buffer.cc"
         ]
     }]
 }
@@ -1,20 +1,34 @@
 const util                 = require('util')
     , AbstractChainedBatch = require('abstract-nosql').AbstractChainedBatch
+    , Iterator             = require('./iterator')
 
 
-function ChainedBatch (db) {
+// keyspace: the keyspace of the keys of the batch, see keyspace.js
+function ChainedBatch (db, keyspace) {
   AbstractChainedBatch.call(this, db)
-  this.binding = db.binding.batchSync()
+  this.binding  = db.binding.batchSync()
+  this.keyspace = keyspace
+}
+
+
+ChainedBatch.prototype._options = function (options) {
+  if (this.keyspace == null) return options
+  var result = {}
+  if (options && typeof options == 'object') {
+    for (var k in options) result[k] = options[k]
+  }
+  result.keyspace = this.keyspace
+  return result
 }
 
 
 ChainedBatch.prototype._put = function (key, value) {
-  this.binding.put(key, value)
+  this.binding.put(key, value, this._options())
 }
 
 
 ChainedBatch.prototype._del = function (key) {
-  this.binding.del(key)
+  this.binding.del(key, this._options())
 }
 
 
@@ -27,6 +41,18 @@ ChainedBatch.prototype._writeSync = function (options) {
   return this.binding.writeSync()
 }
 
+
+// read the key as if the batch was written
+ChainedBatch.prototype.getSync = function (key, options) {
+  return this.binding.getSync(key, this._options(options))
+}
+
+
+// iterate over the database with the pending operations applied
+ChainedBatch.prototype.iterator = function (options) {
+  return new Iterator(this._db, this._options(options), this)
+}
+
 util.inherits(ChainedBatch, AbstractChainedBatch)
 
 
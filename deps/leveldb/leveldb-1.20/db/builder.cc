@@ -19,7 +19,8 @@ Status BuildTable(const std::string& dbname,
                   const Options& options,
                   TableCache* table_cache,
                   Iterator* iter,
-                  FileMetaData* meta) {
+                  FileMetaData* meta,
+                  ThreadPool* compression_pool) {
   Status s;
   meta->file_size = 0;
   iter->SeekToFirst();
@@ -32,13 +33,17 @@ Status BuildTable(const std::string& dbname,
       return s;
     }
 
-    TableBuilder* builder = new TableBuilder(options, file);
+    TableBuilder* builder = new TableBuilder(options, file, compression_pool);
     meta->smallest.DecodeFrom(iter->key());
     for (; iter->Valid(); iter->Next()) {
       Slice key = iter->key();
       meta->largest.DecodeFrom(key);
+      if (ExtractValueType(key) == kTypeDeletion) {
+        meta->num_deletions++;
+      }
       builder->Add(key, iter->value());
     }
+    meta->num_entries = builder->NumEntries();
 
     // Finish and check for builder errors
     if (s.ok()) {
@@ -13,6 +13,7 @@ struct Options;
 struct FileMetaData;
 
 class Env;
+class ThreadPool;
 class Iterator;
 class TableCache;
 class VersionEdit;
@@ -21,13 +22,15 @@ class VersionEdit;
 // will be named according to meta->number.  On success, the rest of
 // *meta will be filled with metadata about the generated table.
 // If no data is present in *iter, meta->file_size will be set to
-// zero, and no Table file will be produced.
+// zero, and no Table file will be produced.  If compression_pool is
+// non-NULL, the blocks are compressed on its threads (see TableBuilder).
 extern Status BuildTable(const std::string& dbname,
                          Env* env,
                          const Options& options,
                          TableCache* table_cache,
                          Iterator* iter,
-                         FileMetaData* meta);
+                         FileMetaData* meta,
+                         ThreadPool* compression_pool);
 
 }  // namespace leveldb
 
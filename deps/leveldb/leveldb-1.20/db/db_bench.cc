@@ -10,6 +10,7 @@
 #include "leveldb/cache.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
+#include "leveldb/rate_limiter.h"
 #include "leveldb/write_batch.h"
 #include "port/port.h"
 #include "util/crc32c.h"
@@ -25,6 +26,8 @@
 //      overwrite     -- overwrite N values in random key order in async mode
 //      fillsync      -- write N/100 values in random key order in sync mode
 //      fill100K      -- write N/1000 100K values in random order in async mode
+//      fillconcurrent -- write N values in random key order in async mode,
+//                        split across --write_threads threads
 //      deleteseq     -- delete N keys in sequential order
 //      deleterandom  -- delete N keys in random order
 //      readseq       -- read N times sequentially
@@ -35,6 +38,8 @@
 //      seekrandom    -- N random seeks
 //      open          -- cost of opening a DB
 //      crc32c        -- repeated crc32c of 4K of data
+//      filterbuild   -- build the filters of N keys, --filter_keys per filter
+//      filterprobe   -- probe the filters of filterbuild with N missing keys
 //      acquireload   -- load N*1000 times
 //   Meta operations:
 //      compact     -- Compact the entire DB
@@ -70,6 +75,9 @@ static int FLAGS_reads = -1;
 // Number of concurrent threads to run.
 static int FLAGS_threads = 1;
 
+// Number of concurrent writer threads used by fillconcurrent.
+static int FLAGS_write_threads = 4;
+
 // Size of each value
 static int FLAGS_value_size = 100;
 
@@ -84,10 +92,54 @@ static bool FLAGS_histogram = false;
 // (initialized to default value by "main")
 static int FLAGS_write_buffer_size = 0;
 
+// Number of write buffers that may be held in memory at the same time
+// (initialized to default value by "main")
+static int FLAGS_max_write_buffer_number = 0;
+
+// Number of compactions that may run concurrently
+// (initialized to default value by "main")
+static int FLAGS_max_background_compactions = 0;
+
+// Number of threads a single compaction may be split into
+// (initialized to default value by "main")
+static int FLAGS_max_subcompactions = 0;
+
+// Number of threads compressing the blocks of each table being built
+// (initialized to default value by "main")
+static int FLAGS_compression_threads = 0;
+
 // Number of bytes written to each file.
 // (initialized to default value by "main")
 static int FLAGS_max_file_size = 0;
 
+// Number of level-0 files that triggers a compaction, slows down writes
+// and stops writes, and maximum level of compacted memtables
+// (initialized to default value by "main")
+static int FLAGS_level0_file_num_compaction_trigger = 0;
+static int FLAGS_level0_slowdown_writes_trigger = 0;
+static int FLAGS_level0_stop_writes_trigger = 0;
+static int FLAGS_max_mem_compaction_level = 0;
+
+// Size of level-1 and ratio between the sizes of successive levels
+// (initialized to default value by "main")
+static int FLAGS_max_bytes_for_level_base = 0;
+static int FLAGS_max_bytes_for_level_multiplier = 0;
+
+// If true, derive level size targets from the size of the bottom level
+static bool FLAGS_level_compaction_dynamic_level_bytes = false;
+
+// Merge similarly sized level-0 runs (tiered) instead of leveled compaction
+static bool FLAGS_tiered_compaction = false;
+
+// Size ratio and maximum number of runs of tiered compaction
+// (initialized to default value by "main")
+static int FLAGS_tiered_size_ratio = 0;
+static int FLAGS_tiered_max_runs = 0;
+
+// Compact table files in which at least this percentage of the entries
+// are deletion markers (0 disables it)
+static int FLAGS_tombstone_compaction_percent = 0;
+
 // Approximate size of user data packed per block (before compression.
 // (initialized to default value by "main")
 static int FLAGS_block_size = 0;
@@ -103,14 +155,39 @@ static int FLAGS_open_files = 0;
 // Negative means use default settings.
 static int FLAGS_bloom_bits = -1;
 
+// Filter built with --bloom_bits bits per key: "bloom", "blocked_bloom"
+// or "xor".
+static const char* FLAGS_filter_policy = "bloom";
+
+// If true, build one filter per table instead of one per 2KB of data.
+static bool FLAGS_full_table_filter = false;
+
+// Keys per filter of the filterbuild benchmark.  Filters per 2KB of data
+// hold a few tens of keys, filters per table many thousands.
+static int FLAGS_filter_keys = 10000;
+
 // If true, do not destroy the existing database.  If you set this
 // flag and also specify a benchmark that wants a fresh database, that
 // benchmark will fail.
 static bool FLAGS_use_existing_db = false;
 
+// Bytes per second that compactions may read and write.
+// Zero means no limit.
+static int FLAGS_compaction_rate_limit = 0;
+
+// If true, the compaction rate limit is lowered while reads are slow.
+static bool FLAGS_adaptive_rate_limit = false;
+
 // If true, reuse existing log/MANIFEST files when re-opening a database.
 static bool FLAGS_reuse_logs = false;
 
+// If true, overlap log writes with memtable inserts of concurrent writers.
+static bool FLAGS_pipelined_write = false;
+
+// If true, the writers of a group insert their batches into the memtable
+// in parallel.
+static bool FLAGS_concurrent_memtable_write = false;
+
 // Use the db with the following name.
 static const char* FLAGS_db = NULL;
 
@@ -314,10 +391,22 @@ struct ThreadState {
 
 }  // namespace
 
+static const FilterPolicy* NewBenchmarkFilterPolicy() {
+  if (FLAGS_bloom_bits < 0) {
+    return NULL;
+  } else if (strcmp(FLAGS_filter_policy, "blocked_bloom") == 0) {
+    return NewBlockedBloomFilterPolicy(FLAGS_bloom_bits);
+  } else if (strcmp(FLAGS_filter_policy, "xor") == 0) {
+    return NewXorFilterPolicy(FLAGS_bloom_bits);
+  }
+  return NewBloomFilterPolicy(FLAGS_bloom_bits);
+}
+
 class Benchmark {
  private:
   Cache* cache_;
   const FilterPolicy* filter_policy_;
+  RateLimiter* rate_limiter_;
   DB* db_;
   int num_;
   int value_size_;
@@ -325,6 +414,7 @@ class Benchmark {
   WriteOptions write_options_;
   int reads_;
   int heap_counter_;
+  std::vector<std::string> filters_;  // Built by filterbuild
 
   void PrintHeader() {
     const int kKeySize = 16;
@@ -403,9 +493,11 @@ class Benchmark {
  public:
   Benchmark()
   : cache_(FLAGS_cache_size >= 0 ? NewLRUCache(FLAGS_cache_size) : NULL),
-    filter_policy_(FLAGS_bloom_bits >= 0
-                   ? NewBloomFilterPolicy(FLAGS_bloom_bits)
-                   : NULL),
+    filter_policy_(NewBenchmarkFilterPolicy()),
+    rate_limiter_(FLAGS_compaction_rate_limit > 0
+                  ? NewRateLimiter(g_env, FLAGS_compaction_rate_limit,
+                                   FLAGS_adaptive_rate_limit)
+                  : NULL),
     db_(NULL),
     num_(FLAGS_num),
     value_size_(FLAGS_value_size),
@@ -428,6 +520,7 @@ class Benchmark {
     delete db_;
     delete cache_;
     delete filter_policy_;
+    delete rate_limiter_;
   }
 
   void Run() {
@@ -484,6 +577,11 @@ class Benchmark {
         num_ /= 1000;
         value_size_ = 100 * 1000;
         method = &Benchmark::WriteRandom;
+      } else if (name == Slice("fillconcurrent")) {
+        fresh_db = true;
+        num_threads = FLAGS_write_threads;
+        num_ /= num_threads;
+        method = &Benchmark::WriteRandom;
       } else if (name == Slice("readseq")) {
         method = &Benchmark::ReadSequential;
       } else if (name == Slice("readreverse")) {
@@ -510,6 +608,10 @@ class Benchmark {
         method = &Benchmark::Compact;
       } else if (name == Slice("crc32c")) {
         method = &Benchmark::Crc32c;
+      } else if (name == Slice("filterbuild")) {
+        method = &Benchmark::FilterBuild;
+      } else if (name == Slice("filterprobe")) {
+        method = &Benchmark::FilterProbe;
       } else if (name == Slice("acquireload")) {
         method = &Benchmark::AcquireLoad;
       } else if (name == Slice("snappycomp")) {
@@ -643,6 +745,69 @@ class Benchmark {
     thread->stats.AddMessage(label);
   }
 
+  // Fills *keys with n 16-byte keys starting at "first"
+  static void FilterKeys(int first, int n, std::string* keys) {
+    char key[100];
+    keys->clear();
+    for (int i = 0; i < n; i++) {
+      snprintf(key, sizeof(key), "%016d", first + i);
+      keys->append(key, 16);
+    }
+  }
+
+  void FilterBuild(ThreadState* thread) {
+    if (filter_policy_ == NULL) {
+      thread->stats.AddMessage("(needs --bloom_bits)");
+      return;
+    }
+    const int kKeysPerFilter = std::max(FLAGS_filter_keys, 1);
+    std::string keys;
+    FilterKeys(0, num_, &keys);
+    std::vector<Slice> slices;
+    for (int i = 0; i < num_; i++) {
+      slices.push_back(Slice(keys.data() + 16 * i, 16));
+    }
+    filters_.clear();
+    thread->stats.Start();  // Do not count the key generation
+    int64_t bytes = 0;
+    for (int i = 0; i < num_; i += kKeysPerFilter) {
+      const int n = std::min(kKeysPerFilter, num_ - i);
+      filters_.push_back(std::string());
+      filter_policy_->CreateFilter(&slices[i], n, &filters_.back());
+      bytes += filters_.back().size();
+      for (int j = 0; j < n; j++) {
+        thread->stats.FinishedSingleOp();
+      }
+    }
+    char msg[100];
+    snprintf(msg, sizeof(msg), "(%.2f bits per key)",
+             bytes * 8.0 / std::max(num_, 1));
+    thread->stats.AddMessage(msg);
+  }
+
+  void FilterProbe(ThreadState* thread) {
+    if (filters_.empty()) {
+      thread->stats.AddMessage("(needs filterbuild)");
+      return;
+    }
+    std::string keys;
+    FilterKeys(num_, reads_, &keys);
+    thread->stats.Start();  // Do not count the key generation
+    int found = 0;
+    for (int i = 0; i < reads_; i++) {
+      const std::string& filter = filters_[i % filters_.size()];
+      if (filter_policy_->KeyMayMatch(Slice(keys.data() + 16 * i, 16),
+                                      filter)) {
+        found++;
+      }
+      thread->stats.FinishedSingleOp();
+    }
+    char msg[100];
+    snprintf(msg, sizeof(msg), "(%.2f%% false positives)",
+             found * 100.0 / std::max(reads_, 1));
+    thread->stats.AddMessage(msg);
+  }
+
   void AcquireLoad(ThreadState* thread) {
     int dummy;
     port::AtomicPointer ap(&dummy);
@@ -713,11 +878,36 @@ class Benchmark {
     options.create_if_missing = !FLAGS_use_existing_db;
     options.block_cache = cache_;
     options.write_buffer_size = FLAGS_write_buffer_size;
+    options.max_write_buffer_number = FLAGS_max_write_buffer_number;
+    options.max_background_compactions = FLAGS_max_background_compactions;
+    options.max_subcompactions = FLAGS_max_subcompactions;
+    options.compression_threads = FLAGS_compression_threads;
     options.max_file_size = FLAGS_max_file_size;
+    options.level0_file_num_compaction_trigger =
+        FLAGS_level0_file_num_compaction_trigger;
+    options.level0_slowdown_writes_trigger =
+        FLAGS_level0_slowdown_writes_trigger;
+    options.level0_stop_writes_trigger = FLAGS_level0_stop_writes_trigger;
+    options.max_mem_compaction_level = FLAGS_max_mem_compaction_level;
+    options.max_bytes_for_level_base = FLAGS_max_bytes_for_level_base;
+    options.max_bytes_for_level_multiplier =
+        FLAGS_max_bytes_for_level_multiplier;
+    options.level_compaction_dynamic_level_bytes =
+        FLAGS_level_compaction_dynamic_level_bytes;
+    options.compaction_style = FLAGS_tiered_compaction
+        ? leveldb::kTieredCompaction
+        : leveldb::kLevelCompaction;
+    options.tiered_size_ratio = FLAGS_tiered_size_ratio;
+    options.tiered_max_runs = FLAGS_tiered_max_runs;
+    options.tombstone_compaction_percent = FLAGS_tombstone_compaction_percent;
     options.block_size = FLAGS_block_size;
     options.max_open_files = FLAGS_open_files;
     options.filter_policy = filter_policy_;
+    options.full_table_filter = FLAGS_full_table_filter;
+    options.rate_limiter = rate_limiter_;
     options.reuse_logs = FLAGS_reuse_logs;
+    options.enable_pipelined_write = FLAGS_pipelined_write;
+    options.allow_concurrent_memtable_write = FLAGS_concurrent_memtable_write;
     Status s = DB::Open(options, FLAGS_db, &db_);
     if (!s.ok()) {
       fprintf(stderr, "open error: %s\n", s.ToString().c_str());
@@ -955,7 +1145,26 @@ class Benchmark {
 
 int main(int argc, char** argv) {
   FLAGS_write_buffer_size = leveldb::Options().write_buffer_size;
+  FLAGS_max_write_buffer_number = leveldb::Options().max_write_buffer_number;
+  FLAGS_max_background_compactions =
+      leveldb::Options().max_background_compactions;
+  FLAGS_max_subcompactions = leveldb::Options().max_subcompactions;
+  FLAGS_compression_threads = leveldb::Options().compression_threads;
   FLAGS_max_file_size = leveldb::Options().max_file_size;
+  FLAGS_level0_file_num_compaction_trigger =
+      leveldb::Options().level0_file_num_compaction_trigger;
+  FLAGS_level0_slowdown_writes_trigger =
+      leveldb::Options().level0_slowdown_writes_trigger;
+  FLAGS_level0_stop_writes_trigger =
+      leveldb::Options().level0_stop_writes_trigger;
+  FLAGS_max_mem_compaction_level =
+      leveldb::Options().max_mem_compaction_level;
+  FLAGS_max_bytes_for_level_base =
+      leveldb::Options().max_bytes_for_level_base;
+  FLAGS_max_bytes_for_level_multiplier =
+      leveldb::Options().max_bytes_for_level_multiplier;
+  FLAGS_tiered_size_ratio = leveldb::Options().tiered_size_ratio;
+  FLAGS_tiered_max_runs = leveldb::Options().tiered_max_runs;
   FLAGS_block_size = leveldb::Options().block_size;
   FLAGS_open_files = leveldb::Options().max_open_files;
   std::string default_db_path;
@@ -977,26 +1186,91 @@ int main(int argc, char** argv) {
     } else if (sscanf(argv[i], "--reuse_logs=%d%c", &n, &junk) == 1 &&
                (n == 0 || n == 1)) {
       FLAGS_reuse_logs = n;
+    } else if (sscanf(argv[i], "--pipelined_write=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_pipelined_write = n;
+    } else if (sscanf(argv[i], "--concurrent_memtable_write=%d%c",
+                      &n, &junk) == 1 && (n == 0 || n == 1)) {
+      FLAGS_concurrent_memtable_write = n;
+    } else if (sscanf(argv[i], "--compaction_rate_limit=%d%c",
+                      &n, &junk) == 1) {
+      FLAGS_compaction_rate_limit = n;
+    } else if (sscanf(argv[i], "--adaptive_rate_limit=%d%c",
+                      &n, &junk) == 1 && (n == 0 || n == 1)) {
+      FLAGS_adaptive_rate_limit = n;
     } else if (sscanf(argv[i], "--num=%d%c", &n, &junk) == 1) {
       FLAGS_num = n;
     } else if (sscanf(argv[i], "--reads=%d%c", &n, &junk) == 1) {
       FLAGS_reads = n;
     } else if (sscanf(argv[i], "--threads=%d%c", &n, &junk) == 1) {
       FLAGS_threads = n;
+    } else if (sscanf(argv[i], "--write_threads=%d%c", &n, &junk) == 1 &&
+               n > 0) {
+      FLAGS_write_threads = n;
     } else if (sscanf(argv[i], "--value_size=%d%c", &n, &junk) == 1) {
       FLAGS_value_size = n;
     } else if (sscanf(argv[i], "--write_buffer_size=%d%c", &n, &junk) == 1) {
       FLAGS_write_buffer_size = n;
+    } else if (sscanf(argv[i], "--max_write_buffer_number=%d%c",
+                      &n, &junk) == 1) {
+      FLAGS_max_write_buffer_number = n;
+    } else if (sscanf(argv[i], "--max_background_compactions=%d%c",
+                      &n, &junk) == 1) {
+      FLAGS_max_background_compactions = n;
+    } else if (sscanf(argv[i], "--max_subcompactions=%d%c",
+                      &n, &junk) == 1) {
+      FLAGS_max_subcompactions = n;
+    } else if (sscanf(argv[i], "--compression_threads=%d%c",
+                      &n, &junk) == 1) {
+      FLAGS_compression_threads = n;
     } else if (sscanf(argv[i], "--max_file_size=%d%c", &n, &junk) == 1) {
       FLAGS_max_file_size = n;
+    } else if (sscanf(argv[i], "--level0_file_num_compaction_trigger=%d%c",
+                      &n, &junk) == 1) {
+      FLAGS_level0_file_num_compaction_trigger = n;
+    } else if (sscanf(argv[i], "--level0_slowdown_writes_trigger=%d%c",
+                      &n, &junk) == 1) {
+      FLAGS_level0_slowdown_writes_trigger = n;
+    } else if (sscanf(argv[i], "--level0_stop_writes_trigger=%d%c",
+                      &n, &junk) == 1) {
+      FLAGS_level0_stop_writes_trigger = n;
+    } else if (sscanf(argv[i], "--max_mem_compaction_level=%d%c",
+                      &n, &junk) == 1) {
+      FLAGS_max_mem_compaction_level = n;
+    } else if (sscanf(argv[i], "--max_bytes_for_level_base=%d%c",
+                      &n, &junk) == 1) {
+      FLAGS_max_bytes_for_level_base = n;
+    } else if (sscanf(argv[i], "--max_bytes_for_level_multiplier=%d%c",
+                      &n, &junk) == 1) {
+      FLAGS_max_bytes_for_level_multiplier = n;
+    } else if (sscanf(argv[i], "--level_compaction_dynamic_level_bytes=%d%c",
+                      &n, &junk) == 1 && (n == 0 || n == 1)) {
+      FLAGS_level_compaction_dynamic_level_bytes = n;
+    } else if (sscanf(argv[i], "--tiered_compaction=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_tiered_compaction = n;
+    } else if (sscanf(argv[i], "--tiered_size_ratio=%d%c", &n, &junk) == 1) {
+      FLAGS_tiered_size_ratio = n;
+    } else if (sscanf(argv[i], "--tiered_max_runs=%d%c", &n, &junk) == 1) {
+      FLAGS_tiered_max_runs = n;
+    } else if (sscanf(argv[i], "--tombstone_compaction_percent=%d%c",
+                      &n, &junk) == 1) {
+      FLAGS_tombstone_compaction_percent = n;
     } else if (sscanf(argv[i], "--block_size=%d%c", &n, &junk) == 1) {
       FLAGS_block_size = n;
     } else if (sscanf(argv[i], "--cache_size=%d%c", &n, &junk) == 1) {
       FLAGS_cache_size = n;
     } else if (sscanf(argv[i], "--bloom_bits=%d%c", &n, &junk) == 1) {
       FLAGS_bloom_bits = n;
+    } else if (sscanf(argv[i], "--full_table_filter=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_full_table_filter = n;
+    } else if (sscanf(argv[i], "--filter_keys=%d%c", &n, &junk) == 1) {
+      FLAGS_filter_keys = n;
     } else if (sscanf(argv[i], "--open_files=%d%c", &n, &junk) == 1) {
       FLAGS_open_files = n;
+    } else if (strncmp(argv[i], "--filter_policy=", 16) == 0) {
+      FLAGS_filter_policy = argv[i] + 16;
     } else if (strncmp(argv[i], "--db=", 5) == 0) {
       FLAGS_db = argv[i] + 5;
     } else {
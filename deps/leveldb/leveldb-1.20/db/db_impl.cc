@@ -17,11 +17,15 @@
 #include "db/log_reader.h"
 #include "db/log_writer.h"
 #include "db/memtable.h"
+#include "db/merge_helper.h"
 #include "db/table_cache.h"
 #include "db/version_set.h"
 #include "db/write_batch_internal.h"
+#include "leveldb/compaction_filter.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
+#include "leveldb/merge_operator.h"
+#include "leveldb/rate_limiter.h"
 #include "leveldb/status.h"
 #include "leveldb/table.h"
 #include "leveldb/table_builder.h"
@@ -32,6 +36,7 @@
 #include "util/coding.h"
 #include "util/logging.h"
 #include "util/mutexlock.h"
+#include "util/thread_pool.h"
 
 namespace leveldb {
 
@@ -43,9 +48,26 @@ struct DBImpl::Writer {
   WriteBatch* batch;
   bool sync;
   bool done;
+  // Set by the group leader when this writer should insert its own
+  // batch into insert_mem (see InsertIntoMemTable).
+  MemTable* insert_mem;
+  ParallelInsert* parallel;
+  // For WriteIfUnchanged(): the keys that must have no entry newer
+  // than check_sequence, else NULL.
+  const std::vector<Slice>* check_keys;
+  SequenceNumber check_sequence;
   port::CondVar cv;
 
-  explicit Writer(port::Mutex* mu) : cv(mu) { }
+  explicit Writer(port::Mutex* mu)
+      : insert_mem(NULL), parallel(NULL), check_keys(NULL),
+        check_sequence(0), cv(mu) { }
+};
+
+// State shared by the writers of a group inserting in parallel
+struct DBImpl::ParallelInsert {
+  Writer* leader;
+  int pending;    // Followers that have not finished inserting
+  Status status;  // First error of a follower
 };
 
 struct DBImpl::CompactionState {
@@ -57,11 +79,17 @@ struct DBImpl::CompactionState {
   // we can drop all entries for the same key with sequence numbers < S.
   SequenceNumber smallest_snapshot;
 
+  // No snapshot sees the entries with sequence numbers > newest_snapshot,
+  // so the compaction filter may remove or change them.
+  SequenceNumber newest_snapshot;
+
   // Files produced by compaction
   struct Output {
     uint64_t number;
     uint64_t file_size;
     InternalKey smallest, largest;
+    uint64_t num_entries;
+    uint64_t num_deletions;
   };
   std::vector<Output> outputs;
 
@@ -71,16 +99,34 @@ struct DBImpl::CompactionState {
 
   uint64_t total_bytes;
 
+  // Only the user keys in (*start, *end] are compacted by this state
+  // when the compaction is split into subcompactions.  NULL means
+  // unbounded.
+  const std::string* start;
+  const std::string* end;
+
+  Compaction::Cursor cursor;
+
   Output* current_output() { return &outputs[outputs.size()-1]; }
 
   explicit CompactionState(Compaction* c)
       : compaction(c),
         outfile(NULL),
         builder(NULL),
-        total_bytes(0) {
+        total_bytes(0),
+        start(NULL),
+        end(NULL) {
   }
 };
 
+// A part of a compaction run on a thread of subcompaction_pool_
+struct DBImpl::Subcompaction {
+  DBImpl* db;
+  CompactionState* state;
+  Status status;
+  int* running;  // Subcompactions of the compaction still running
+};
+
 // Fix user-supplied options to be reasonable
 template <class T,class V>
 static void ClipToRange(T* ptr, V minvalue, V maxvalue) {
@@ -96,8 +142,26 @@ Options SanitizeOptions(const std::string& dbname,
   result.filter_policy = (src.filter_policy != NULL) ? ipolicy : NULL;
   ClipToRange(&result.max_open_files,    64 + kNumNonTableCacheFiles, 50000);
   ClipToRange(&result.write_buffer_size, 64<<10,                      1<<30);
+  ClipToRange(&result.max_write_buffer_number, 2,                      64);
+  ClipToRange(&result.max_background_compactions, 1,                   64);
+  ClipToRange(&result.max_subcompactions, 1,                          64);
   ClipToRange(&result.max_file_size,     1<<20,                       1<<30);
   ClipToRange(&result.block_size,        1<<10,                       4<<20);
+  ClipToRange(&result.compression_threads, 1,                         64);
+  ClipToRange(&result.level0_file_num_compaction_trigger, 1,          1000);
+  ClipToRange(&result.tiered_size_ratio, 0,                            1000);
+  ClipToRange(&result.tombstone_compaction_percent, 0,                 100);
+  ClipToRange(&result.tiered_max_runs,
+              result.level0_file_num_compaction_trigger,               1000);
+  ClipToRange(&result.level0_slowdown_writes_trigger,
+              result.compaction_style == kTieredCompaction ?
+                  result.tiered_max_runs + 1 :
+                  result.level0_file_num_compaction_trigger,           1000);
+  ClipToRange(&result.level0_stop_writes_trigger,
+              result.level0_slowdown_writes_trigger,                   1000);
+  ClipToRange(&result.max_mem_compaction_level, 0, config::kNumLevels - 2);
+  ClipToRange(&result.max_bytes_for_level_base, 1<<20,                 1<<30);
+  ClipToRange(&result.max_bytes_for_level_multiplier, 2,               100);
   if (result.info_log == NULL) {
     // Open a log file in the same directory as the db
     src.env->CreateDir(dbname);  // In case it does not exist
@@ -117,7 +181,8 @@ Options SanitizeOptions(const std::string& dbname,
 DBImpl::DBImpl(const Options& raw_options, const std::string& dbname)
     : env_(raw_options.env),
       internal_comparator_(raw_options.comparator),
-      internal_filter_policy_(raw_options.filter_policy),
+      internal_filter_policy_(raw_options.filter_policy,
+                              raw_options.prefix_extractor),
       options_(SanitizeOptions(dbname, &internal_comparator_,
                                &internal_filter_policy_, raw_options)),
       owns_info_log_(options_.info_log != raw_options.info_log),
@@ -127,15 +192,23 @@ DBImpl::DBImpl(const Options& raw_options, const std::string& dbname)
       shutting_down_(NULL),
       bg_cv_(&mutex_),
       mem_(NULL),
-      imm_(NULL),
       logfile_(NULL),
       logfile_number_(0),
       log_(NULL),
       seed_(0),
+      unsynced_log_bytes_(0),
+      wal_sync_cv_(&mutex_),
+      wal_syncer_running_(false),
       tmp_batch_(new WriteBatch),
-      bg_compaction_scheduled_(false),
+      last_allocated_sequence_(0),
+      bg_flush_scheduled_(false),
+      bg_compactions_scheduled_(0),
+      bg_compactions_running_(0),
+      installing_memtable_(false),
+      logging_edit_(false),
       manual_compaction_(NULL) {
-  has_imm_.Release_Store(NULL);
+  env_->IncBackgroundThreadsIfNeeded(options_.max_background_compactions,
+                                     Env::LOW);
 
   // Reserve ten files or so for other uses and give the rest to TableCache.
   const int table_cache_size = options_.max_open_files - kNumNonTableCacheFiles;
@@ -143,13 +216,30 @@ DBImpl::DBImpl(const Options& raw_options, const std::string& dbname)
 
   versions_ = new VersionSet(dbname_, &options_, table_cache_,
                              &internal_comparator_);
+
+  // Enough threads for every compaction and the memtable compaction to
+  // run at full width at once
+  const int max_compactions = options_.max_background_compactions;
+  subcompaction_pool_ = NULL;
+  if (options_.max_subcompactions > 1) {
+    subcompaction_pool_ = new ThreadPool(
+        env_, max_compactions * (options_.max_subcompactions - 1));
+  }
+  compression_pool_ = NULL;
+  if (options_.compression_threads > 1) {
+    compression_pool_ = new ThreadPool(
+        env_, options_.compression_threads *
+              (max_compactions * options_.max_subcompactions + 1));
+  }
 }
 
 DBImpl::~DBImpl() {
   // Wait for background work to finish
   mutex_.Lock();
   shutting_down_.Release_Store(this);  // Any non-NULL value is ok
-  while (bg_compaction_scheduled_) {
+  wal_sync_cv_.Signal();
+  while (bg_flush_scheduled_ || bg_compactions_scheduled_ > 0 ||
+         wal_syncer_running_) {
     bg_cv_.Wait();
   }
   mutex_.Unlock();
@@ -160,11 +250,15 @@ DBImpl::~DBImpl() {
 
   delete versions_;
   if (mem_ != NULL) mem_->Unref();
-  if (imm_ != NULL) imm_->Unref();
+  for (size_t i = 0; i < imm_.size(); i++) {
+    imm_[i].mem->Unref();
+  }
   delete tmp_batch_;
   delete log_;
   delete logfile_;
   delete table_cache_;
+  delete subcompaction_pool_;
+  delete compression_pool_;
 
   if (owns_info_log_) {
     delete options_.info_log;
@@ -438,7 +532,9 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
     if (mem->ApproximateMemoryUsage() > options_.write_buffer_size) {
       compactions++;
       *save_manifest = true;
-      status = WriteLevel0Table(mem, edit, NULL);
+      uint64_t number;
+      status = WriteLevel0Table(mem->NewIterator(), edit, NULL, &number);
+      pending_outputs_.erase(number);
       mem->Unref();
       mem = NULL;
       if (!status.ok()) {
@@ -477,7 +573,9 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
     // mem did not get reused; compact it.
     if (status.ok()) {
       *save_manifest = true;
-      status = WriteLevel0Table(mem, edit, NULL);
+      uint64_t number;
+      status = WriteLevel0Table(mem->NewIterator(), edit, NULL, &number);
+      pending_outputs_.erase(number);
     }
     mem->Unref();
   }
@@ -485,21 +583,22 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
   return status;
 }
 
-Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
-                                Version* base) {
+Status DBImpl::WriteLevel0Table(Iterator* iter, VersionEdit* edit,
+                                Version* base, uint64_t* number) {
   mutex_.AssertHeld();
   const uint64_t start_micros = env_->NowMicros();
   FileMetaData meta;
   meta.number = versions_->NewFileNumber();
   pending_outputs_.insert(meta.number);
-  Iterator* iter = mem->NewIterator();
+  *number = meta.number;
   Log(options_.info_log, "Level-0 table #%llu: started",
       (unsigned long long) meta.number);
 
   Status s;
   {
     mutex_.Unlock();
-    s = BuildTable(dbname_, env_, options_, table_cache_, iter, &meta);
+    s = BuildTable(dbname_, env_, options_, table_cache_, iter, &meta,
+                   compression_pool_);
     mutex_.Lock();
   }
 
@@ -508,8 +607,6 @@ Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
       (unsigned long long) meta.file_size,
       s.ToString().c_str());
   delete iter;
-  pending_outputs_.erase(meta.number);
-
 
   // Note that if file_size is zero, the file has been deleted and
   // should not be added to the manifest.
@@ -517,11 +614,13 @@ Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
   if (s.ok() && meta.file_size > 0) {
     const Slice min_user_key = meta.smallest.user_key();
     const Slice max_user_key = meta.largest.user_key();
-    if (base != NULL) {
+    // Only push the table to a deeper level if no compaction changed the
+    // levels while it was built, or is about to change them.
+    if (base != NULL && base == versions_->current() &&
+        bg_compactions_running_ == 0) {
       level = base->PickLevelForMemTableOutput(min_user_key, max_user_key);
     }
-    edit->AddFile(level, meta.number, meta.file_size,
-                  meta.smallest, meta.largest);
+    edit->AddFile(level, meta);
   }
 
   CompactionStats stats;
@@ -533,13 +632,22 @@ Status DBImpl::WriteLevel0Table(MemTable* mem, VersionEdit* edit,
 
 void DBImpl::CompactMemTable() {
   mutex_.AssertHeld();
-  assert(imm_ != NULL);
+  assert(!imm_.empty());
 
-  // Save the contents of the memtable as a new Table
+  // Save the contents of the immutable memtables as a new Table.  Those
+  // switched out while we are at it are left for the next round.
+  const size_t n = imm_.size();
+  std::vector<Iterator*> list;
+  for (size_t i = 0; i < n; i++) {
+    list.push_back(imm_[i].mem->NewIterator());
+  }
+  Iterator* iter = (n == 1 ? list[0] :
+                    NewMergingIterator(&internal_comparator_, &list[0], n));
   VersionEdit edit;
   Version* base = versions_->current();
   base->Ref();
-  Status s = WriteLevel0Table(imm_, &edit, base);
+  uint64_t number;
+  Status s = WriteLevel0Table(iter, &edit, base, &number);
   base->Unref();
 
   if (s.ok() && shutting_down_.Acquire_Load()) {
@@ -549,15 +657,20 @@ void DBImpl::CompactMemTable() {
   // Replace immutable memtable with the generated Table
   if (s.ok()) {
     edit.SetPrevLogNumber(0);
-    edit.SetLogNumber(logfile_number_);  // Earlier logs no longer needed
-    s = versions_->LogAndApply(&edit, &mutex_);
+    // Earlier logs no longer needed
+    edit.SetLogNumber(n < imm_.size() ? imm_[n].log_number : logfile_number_);
+    installing_memtable_ = true;
+    s = LogAndApply(&edit);
+    installing_memtable_ = false;
   }
+  pending_outputs_.erase(number);
 
   if (s.ok()) {
     // Commit to the new state
-    imm_->Unref();
-    imm_ = NULL;
-    has_imm_.Release_Store(NULL);
+    for (size_t i = 0; i < n; i++) {
+      imm_.front().mem->Unref();
+      imm_.pop_front();
+    }
     DeleteObsoleteFiles();
   } else {
     RecordBackgroundError(s);
@@ -624,16 +737,30 @@ Status DBImpl::TEST_CompactMemTable() {
   if (s.ok()) {
     // Wait until the compaction completes
     MutexLock l(&mutex_);
-    while (imm_ != NULL && bg_error_.ok()) {
+    while (!imm_.empty() && bg_error_.ok()) {
       bg_cv_.Wait();
     }
-    if (imm_ != NULL) {
+    if (!imm_.empty()) {
       s = bg_error_;
     }
   }
   return s;
 }
 
+Status DBImpl::TEST_WaitForCompactions() {
+  MutexLock l(&mutex_);
+  while ((bg_flush_scheduled_ || bg_compactions_scheduled_ > 0) &&
+         bg_error_.ok()) {
+    bg_cv_.Wait();
+  }
+  return bg_error_;
+}
+
+bool DBImpl::TEST_NeedsCompaction() {
+  MutexLock l(&mutex_);
+  return versions_->NeedsCompaction();
+}
+
 void DBImpl::RecordBackgroundError(const Status& s) {
   mutex_.AssertHeld();
   if (bg_error_.ok()) {
@@ -644,19 +771,20 @@ void DBImpl::RecordBackgroundError(const Status& s) {
 
 void DBImpl::MaybeScheduleCompaction() {
   mutex_.AssertHeld();
-  if (bg_compaction_scheduled_) {
-    // Already scheduled
-  } else if (shutting_down_.Acquire_Load()) {
+  if (shutting_down_.Acquire_Load()) {
     // DB is being deleted; no more background compactions
   } else if (!bg_error_.ok()) {
     // Already got an error; no more changes
-  } else if (imm_ == NULL &&
-             manual_compaction_ == NULL &&
-             !versions_->NeedsCompaction()) {
-    // No work to be done
   } else {
-    bg_compaction_scheduled_ = true;
-    env_->Schedule(&DBImpl::BGWork, this);
+    if (!imm_.empty() && !bg_flush_scheduled_) {
+      bg_flush_scheduled_ = true;
+      env_->Schedule(&DBImpl::BGFlushWork, this, Env::HIGH);
+    }
+    while (bg_compactions_scheduled_ < options_.max_background_compactions &&
+           (manual_compaction_ != NULL || versions_->NeedsCompaction())) {
+      bg_compactions_scheduled_++;
+      env_->Schedule(&DBImpl::BGWork, this, Env::LOW);
+    }
   }
 }
 
@@ -664,37 +792,80 @@ void DBImpl::BGWork(void* db) {
   reinterpret_cast<DBImpl*>(db)->BackgroundCall();
 }
 
+void DBImpl::BGFlushWork(void* db) {
+  reinterpret_cast<DBImpl*>(db)->BackgroundFlushCall();
+}
+
 void DBImpl::BackgroundCall() {
   MutexLock l(&mutex_);
-  assert(bg_compaction_scheduled_);
+  assert(bg_compactions_scheduled_ > 0);
+  bool compacted = false;
   if (shutting_down_.Acquire_Load()) {
     // No more background work when shutting down.
   } else if (!bg_error_.ok()) {
     // No more background work after a background error.
   } else {
-    BackgroundCompaction();
+    compacted = BackgroundCompaction();
   }
 
-  bg_compaction_scheduled_ = false;
+  bg_compactions_scheduled_--;
 
   // Previous compaction may have produced too many files in a level,
-  // so reschedule another compaction if needed.
+  // so reschedule another compaction if needed.  If there was nothing
+  // we could do, whatever work kept us idle reschedules when it is done.
+  if (compacted) {
+    MaybeScheduleCompaction();
+  }
+  bg_cv_.SignalAll();
+}
+
+void DBImpl::BackgroundFlushCall() {
+  MutexLock l(&mutex_);
+  assert(bg_flush_scheduled_);
+  if (shutting_down_.Acquire_Load()) {
+    // No more background work when shutting down.
+  } else if (!bg_error_.ok()) {
+    // No more background work after a background error.
+  } else if (!imm_.empty()) {
+    CompactMemTable();
+  }
+
+  bg_flush_scheduled_ = false;
+
+  // More memtables may have filled up meanwhile, and the new level-0
+  // table may call for a compaction.
   MaybeScheduleCompaction();
   bg_cv_.SignalAll();
 }
 
-void DBImpl::BackgroundCompaction() {
+Status DBImpl::LogAndApply(VersionEdit* edit) {
   mutex_.AssertHeld();
+  while (logging_edit_) {
+    bg_cv_.Wait();
+  }
+  logging_edit_ = true;
+  Status s = versions_->LogAndApply(edit, &mutex_);
+  logging_edit_ = false;
+  bg_cv_.SignalAll();
+  return s;
+}
 
-  if (imm_ != NULL) {
-    CompactMemTable();
-    return;
+bool DBImpl::BackgroundCompaction() {
+  mutex_.AssertHeld();
+
+  if (installing_memtable_) {
+    // Wait for the memtable compaction to reschedule us
+    return false;
   }
 
   Compaction* c;
   bool is_manual = (manual_compaction_ != NULL);
   InternalKey manual_end;
   if (is_manual) {
+    if (bg_compactions_running_ > 0) {
+      // Manual compactions run alone
+      return false;
+    }
     ManualCompaction* m = manual_compaction_;
     c = versions_->CompactRange(m->level, m->begin, m->end);
     m->done = (c == NULL);
@@ -709,8 +880,12 @@ void DBImpl::BackgroundCompaction() {
         (m->done ? "(end)" : manual_end.DebugString().c_str()));
   } else {
     c = versions_->PickCompaction();
+    if (c == NULL) {
+      return false;
+    }
   }
 
+  bg_compactions_running_++;
   Status status;
   if (c == NULL) {
     // Nothing to do
@@ -719,9 +894,8 @@ void DBImpl::BackgroundCompaction() {
     assert(c->num_input_files(0) == 1);
     FileMetaData* f = c->input(0, 0);
     c->edit()->DeleteFile(c->level(), f->number);
-    c->edit()->AddFile(c->level() + 1, f->number, f->file_size,
-                       f->smallest, f->largest);
-    status = versions_->LogAndApply(c->edit(), &mutex_);
+    c->edit()->AddFile(c->level() + 1, *f);
+    status = LogAndApply(c->edit());
     if (!status.ok()) {
       RecordBackgroundError(status);
     }
@@ -743,6 +917,7 @@ void DBImpl::BackgroundCompaction() {
     DeleteObsoleteFiles();
   }
   delete c;
+  bg_compactions_running_--;
 
   if (status.ok()) {
     // Done
@@ -766,6 +941,7 @@ void DBImpl::BackgroundCompaction() {
     }
     manual_compaction_ = NULL;
   }
+  return true;
 }
 
 void DBImpl::CleanupCompaction(CompactionState* compact) {
@@ -797,6 +973,8 @@ Status DBImpl::OpenCompactionOutputFile(CompactionState* compact) {
     out.number = file_number;
     out.smallest.Clear();
     out.largest.Clear();
+    out.num_entries = 0;
+    out.num_deletions = 0;
     compact->outputs.push_back(out);
     mutex_.Unlock();
   }
@@ -804,8 +982,13 @@ Status DBImpl::OpenCompactionOutputFile(CompactionState* compact) {
   // Make the output file
   std::string fname = TableFileName(dbname_, file_number);
   Status s = env_->NewWritableFile(fname, &compact->outfile);
+  if (s.ok() && options_.rate_limiter != NULL) {
+    compact->outfile = NewRateLimitedWritableFile(compact->outfile,
+                                                  options_.rate_limiter);
+  }
   if (s.ok()) {
-    compact->builder = new TableBuilder(options_, compact->outfile);
+    compact->builder = new TableBuilder(options_, compact->outfile,
+                                        compression_pool_);
   }
   return s;
 }
@@ -829,6 +1012,7 @@ Status DBImpl::FinishCompactionOutputFile(CompactionState* compact,
   }
   const uint64_t current_bytes = compact->builder->FileSize();
   compact->current_output()->file_size = current_bytes;
+  compact->current_output()->num_entries = current_entries;
   compact->total_bytes += current_bytes;
   delete compact->builder;
   compact->builder = NULL;
@@ -869,65 +1053,278 @@ Status DBImpl::InstallCompactionResults(CompactionState* compact) {
       compact->compaction->num_input_files(0),
       compact->compaction->level(),
       compact->compaction->num_input_files(1),
-      compact->compaction->level() + 1,
+      compact->compaction->output_level(),
       static_cast<long long>(compact->total_bytes));
 
   // Add compaction outputs
   compact->compaction->AddInputDeletions(compact->compaction->edit());
-  const int level = compact->compaction->level();
+  const int level = compact->compaction->output_level();
   for (size_t i = 0; i < compact->outputs.size(); i++) {
     const CompactionState::Output& out = compact->outputs[i];
-    compact->compaction->edit()->AddFile(
-        level + 1,
-        out.number, out.file_size, out.smallest, out.largest);
-  }
-  return versions_->LogAndApply(compact->compaction->edit(), &mutex_);
+    FileMetaData meta;
+    meta.number = out.number;
+    meta.file_size = out.file_size;
+    meta.smallest = out.smallest;
+    meta.largest = out.largest;
+    meta.num_entries = out.num_entries;
+    meta.num_deletions = out.num_deletions;
+    // Only merges of sorted runs write to level-0
+    meta.merged_run = (level == 0);
+    compact->compaction->edit()->AddFile(level, meta);
+  }
+  return LogAndApply(compact->compaction->edit());
+}
+
+void DBImpl::SubcompactionWork(void* arg) {
+  Subcompaction* sub = reinterpret_cast<Subcompaction*>(arg);
+  DBImpl* db = sub->db;
+  Status s = db->ProcessCompaction(sub->state);
+  MutexLock l(&db->mutex_);
+  sub->status = s;
+  (*sub->running)--;
+  db->bg_cv_.SignalAll();
 }
 
 Status DBImpl::DoCompactionWork(CompactionState* compact) {
   const uint64_t start_micros = env_->NowMicros();
-  int64_t imm_micros = 0;  // Micros spent doing imm_ compactions
 
   Log(options_.info_log,  "Compacting %d@%d + %d@%d files",
       compact->compaction->num_input_files(0),
       compact->compaction->level(),
       compact->compaction->num_input_files(1),
-      compact->compaction->level() + 1);
+      compact->compaction->output_level());
 
   assert(versions_->NumLevelFiles(compact->compaction->level()) > 0);
   assert(compact->builder == NULL);
   assert(compact->outfile == NULL);
   if (snapshots_.empty()) {
     compact->smallest_snapshot = versions_->LastSequence();
+    compact->newest_snapshot = 0;
   } else {
     compact->smallest_snapshot = snapshots_.oldest()->number_;
+    compact->newest_snapshot = snapshots_.newest()->number_;
+  }
+
+  // Split the compaction into parts.  This thread merges the first one
+  // into "compact", and the threads of subcompaction_pool_ the others.
+  std::vector<std::string> boundaries;
+  compact->compaction->GetSubcompactionBoundaries(options_.max_subcompactions,
+                                                  &boundaries);
+  std::vector<Subcompaction> subs(boundaries.size());
+  int running = static_cast<int>(subs.size());
+  for (size_t i = 0; i < subs.size(); i++) {
+    CompactionState* state = new CompactionState(compact->compaction);
+    state->smallest_snapshot = compact->smallest_snapshot;
+    state->newest_snapshot = compact->newest_snapshot;
+    state->start = &boundaries[i];
+    state->end = (i + 1 < boundaries.size()) ? &boundaries[i + 1] : NULL;
+    subs[i].db = this;
+    subs[i].state = state;
+    subs[i].running = &running;
+  }
+  if (!boundaries.empty()) {
+    compact->end = &boundaries[0];
+    Log(options_.info_log,  "Compacting in %d subcompactions",
+        static_cast<int>(subs.size()) + 1);
   }
 
   // Release mutex while we're actually doing the compaction work
   mutex_.Unlock();
 
+  for (size_t i = 0; i < subs.size(); i++) {
+    subcompaction_pool_->Schedule(&DBImpl::SubcompactionWork, &subs[i]);
+  }
+  Status status = ProcessCompaction(compact);
+
+  mutex_.Lock();
+  while (running > 0) {
+    bg_cv_.Wait();
+  }
+
+  // Gather the outputs of the subcompactions, in key order, so that they
+  // are installed or cleaned up along with those of "compact".
+  for (size_t i = 0; i < subs.size(); i++) {
+    CompactionState* state = subs[i].state;
+    if (status.ok()) {
+      status = subs[i].status;
+    }
+    if (state->builder != NULL) {
+      state->builder->Abandon();
+      delete state->builder;
+    }
+    delete state->outfile;
+    compact->outputs.insert(compact->outputs.end(),
+                            state->outputs.begin(), state->outputs.end());
+    compact->total_bytes += state->total_bytes;
+    delete state;
+  }
+
+  CompactionStats stats;
+  stats.micros = env_->NowMicros() - start_micros;
+  for (int which = 0; which < 2; which++) {
+    for (int i = 0; i < compact->compaction->num_input_files(which); i++) {
+      stats.bytes_read += compact->compaction->input(which, i)->file_size;
+    }
+  }
+  for (size_t i = 0; i < compact->outputs.size(); i++) {
+    stats.bytes_written += compact->outputs[i].file_size;
+  }
+
+  stats_[compact->compaction->output_level()].Add(stats);
+
+  if (status.ok()) {
+    status = InstallCompactionResults(compact);
+  }
+  if (!status.ok()) {
+    RecordBackgroundError(status);
+  }
+  VersionSet::LevelSummaryStorage tmp;
+  Log(options_.info_log,
+      "compacted to: %s", versions_->LevelSummary(&tmp));
+  return status;
+}
+
+Status DBImpl::AddCompactionOutput(CompactionState* compact, Iterator* input,
+                                   const Slice& key, const Slice& value) {
+  // Open output file if necessary
+  if (compact->builder == NULL) {
+    Status s = OpenCompactionOutputFile(compact);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  if (compact->builder->NumEntries() == 0) {
+    compact->current_output()->smallest.DecodeFrom(key);
+  }
+  compact->current_output()->largest.DecodeFrom(key);
+  if (key.size() >= 8 && ExtractValueType(key) == kTypeDeletion) {
+    compact->current_output()->num_deletions++;
+  }
+  compact->builder->Add(key, value);
+
+  // Close output file if it is big enough
+  if (compact->builder->FileSize() >=
+      compact->compaction->MaxOutputFileSize()) {
+    return FinishCompactionOutputFile(compact, input);
+  }
+  return Status::OK();
+}
+
+bool DBImpl::CollapseMergeOperands(
+    CompactionState* compact, Iterator* input, const ParsedInternalKey& newest,
+    uint64_t now_micros,
+    std::vector<std::pair<std::string, std::string> >* entries,
+    std::string* key, std::string* value) {
+  const std::string user_key = newest.user_key.ToString();
+  const SequenceNumber sequence = newest.sequence;
+
+  // Read the operands, newest first, up to the entry they apply to
+  std::vector<std::string> operands;
+  bool found_base = false;
+  std::string base;
+  ValueType base_type = kTypeDeletion;
+  for (; input->Valid(); input->Next()) {
+    ParsedInternalKey ikey;
+    if (!ParseInternalKey(input->key(), &ikey) ||
+        user_comparator()->Compare(ikey.user_key, user_key) != 0) {
+      break;
+    }
+    entries->push_back(std::make_pair(input->key().ToString(),
+                                      input->value().ToString()));
+    if (ikey.type == kTypeMerge) {
+      operands.push_back(entries->back().second);
+      continue;
+    }
+    found_base = true;
+    base_type = ikey.type;
+    if (base_type == kTypeValueWithExpiry &&
+        IsExpired(input->value(), now_micros)) {
+      base_type = kTypeDeletion;
+    }
+    if (base_type != kTypeDeletion) {
+      base = entries->back().second;
+    }
+    input->Next();
+    break;
+  }
+
+  // Without the entry they apply to, the operands can only be applied
+  // if no older entries of the key are left in deeper levels.
+  if (!found_base &&
+      !compact->compaction->IsBaseLevelForKey(user_key, &compact->cursor)) {
+    return false;
+  }
+  Slice base_value(base);
+  if (base_type == kTypeValueWithExpiry) {
+    base_value = ExtractExpiringValue(base_value);
+  }
+  std::string merged;
+  Status s = ApplyMergeOperands(
+      options_.merge_operator, user_key,
+      base_type == kTypeDeletion ? NULL : &base_value, operands, &merged);
+  if (!s.ok()) {
+    // Leave them for the reads to report
+    return false;
+  }
+
+  // The result keeps the expiry time of the value it was applied to
+  key->clear();
+  AppendInternalKey(key, ParsedInternalKey(user_key, sequence,
+                                           base_type == kTypeValueWithExpiry
+                                           ? kTypeValueWithExpiry
+                                           : kTypeValue));
+  value->clear();
+  if (base_type == kTypeValueWithExpiry) {
+    value->assign(base.data(), kExpiryLength);
+  }
+  value->append(merged);
+  return true;
+}
+
+Status DBImpl::ProcessCompaction(CompactionState* compact) {
   Iterator* input = versions_->MakeInputIterator(compact->compaction);
-  input->SeekToFirst();
-  Status status;
   ParsedInternalKey ikey;
+  if (compact->start == NULL) {
+    input->SeekToFirst();
+  } else {
+    // Skip all the entries for the user key ending the previous part
+    InternalKey start(*compact->start, 0, static_cast<ValueType>(0));
+    input->Seek(start.Encode());
+    while (input->Valid() && ParseInternalKey(input->key(), &ikey) &&
+           user_comparator()->Compare(ikey.user_key, *compact->start) == 0) {
+      input->Next();
+    }
+  }
+  Status status;
   std::string current_user_key;
   bool has_current_user_key = false;
   SequenceNumber last_sequence_for_key = kMaxSequenceNumber;
+  size_t unlimited_read_bytes = 0;  // Read, not yet passed to rate_limiter
+  const uint64_t now_micros = env_->NowMicros();
+  const CompactionFilter* filter = options_.compaction_filter;
+  const int output_level = compact->compaction->output_level();
+  std::string deletion_key;   // Deletion marker replacing a value
+  std::string filter_value;   // Value returned by the compaction filter
+  std::string changed_value;  // Entry value holding filter_value
+  std::string merged_key;     // Entry collapsing merge operands
+  std::string merged_value;
+  std::vector<std::pair<std::string, std::string> > merge_entries;
   for (; input->Valid() && !shutting_down_.Acquire_Load(); ) {
-    // Prioritize immutable compaction work
-    if (has_imm_.NoBarrier_Load() != NULL) {
-      const uint64_t imm_start = env_->NowMicros();
-      mutex_.Lock();
-      if (imm_ != NULL) {
-        CompactMemTable();
-        bg_cv_.SignalAll();  // Wakeup MakeRoomForWrite() if necessary
+    Slice key = input->key();
+    if (options_.rate_limiter != NULL) {
+      // Charge the reads of the inputs a block at a time or so
+      unlimited_read_bytes += key.size() + input->value().size();
+      if (unlimited_read_bytes >= options_.block_size) {
+        options_.rate_limiter->Request(unlimited_read_bytes);
+        unlimited_read_bytes = 0;
       }
-      mutex_.Unlock();
-      imm_micros += (env_->NowMicros() - imm_start);
     }
-
-    Slice key = input->key();
-    if (compact->compaction->ShouldStopBefore(key) &&
+    if (compact->end != NULL && ParseInternalKey(key, &ikey) &&
+        user_comparator()->Compare(ikey.user_key, *compact->end) > 0) {
+      // The rest belongs to the next part
+      break;
+    }
+    if (compact->compaction->ShouldStopBefore(key, &compact->cursor) &&
         compact->builder != NULL) {
       status = FinishCompactionOutputFile(compact, input);
       if (!status.ok()) {
@@ -937,6 +1334,9 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
 
     // Handle key/value, add to state, etc.
     bool drop = false;
+    bool as_deletion = false;
+    bool merging = false;
+    Slice value = input->value();
     if (!ParseInternalKey(key, &ikey)) {
       // Do not hide error keys
       current_user_key.clear();
@@ -955,9 +1355,50 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
       if (last_sequence_for_key <= compact->smallest_snapshot) {
         // Hidden by an newer entry for same user key
         drop = true;    // (A)
-      } else if (ikey.type == kTypeDeletion &&
-                 ikey.sequence <= compact->smallest_snapshot &&
-                 compact->compaction->IsBaseLevelForKey(ikey.user_key)) {
+      } else if (ikey.type == kTypeMerge &&
+                 options_.merge_operator != NULL &&
+                 last_sequence_for_key == kMaxSequenceNumber &&
+                 ikey.sequence <= compact->smallest_snapshot) {
+        // The newest entry of the key is a merge operand, and every
+        // snapshot sees it: try to apply it and the operands below it.
+        merging = true;
+      } else if (ikey.type == kTypeValueWithExpiry &&
+                 IsExpired(value, now_micros)) {
+        // Reads at every snapshot already see an expired value as
+        // deleted, so it behaves exactly like a deletion marker from here.
+        as_deletion = true;
+      } else if (filter != NULL &&
+                 (ikey.type == kTypeValue ||
+                  ikey.type == kTypeValueWithExpiry) &&
+                 last_sequence_for_key == kMaxSequenceNumber &&
+                 ikey.sequence > compact->newest_snapshot) {
+        // The newest value of the key, and no snapshot sees it
+        const bool expiring = (ikey.type == kTypeValueWithExpiry);
+        const Slice user_value = expiring ? ExtractExpiringValue(value)
+                                          : value;
+        filter_value.clear();
+        switch (filter->Filter(output_level, ikey.user_key, user_value,
+                               &filter_value)) {
+          case CompactionFilter::kKeep:
+            break;
+          case CompactionFilter::kRemove:
+            as_deletion = true;
+            break;
+          case CompactionFilter::kChangeValue:
+            if (expiring) {
+              changed_value.assign(value.data(), kExpiryLength);
+              changed_value.append(filter_value);
+              value = changed_value;
+            } else {
+              value = filter_value;
+            }
+            break;
+        }
+      }
+      if (!drop && (ikey.type == kTypeDeletion || as_deletion) &&
+          ikey.sequence <= compact->smallest_snapshot &&
+          compact->compaction->IsBaseLevelForKey(ikey.user_key,
+                                                 &compact->cursor)) {
         // For this user key:
         // (1) there is no data in higher levels
         // (2) data in lower levels will have larger sequence numbers
@@ -976,31 +1417,47 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
         "%d smallest_snapshot: %d",
         ikey.user_key.ToString().c_str(),
         (int)ikey.sequence, ikey.type, kTypeValue, drop,
-        compact->compaction->IsBaseLevelForKey(ikey.user_key),
+        compact->compaction->IsBaseLevelForKey(ikey.user_key,
+                                               &compact->cursor),
         (int)last_sequence_for_key, (int)compact->smallest_snapshot);
 #endif
 
-    if (!drop) {
-      // Open output file if necessary
-      if (compact->builder == NULL) {
-        status = OpenCompactionOutputFile(compact);
-        if (!status.ok()) {
-          break;
+    if (merging) {
+      merge_entries.clear();
+      if (CollapseMergeOperands(compact, input, ikey, now_micros,
+                                &merge_entries, &merged_key, &merged_value)) {
+        status = AddCompactionOutput(compact, input, merged_key,
+                                     merged_value);
+      } else {
+        for (size_t i = 0; i < merge_entries.size() && status.ok(); i++) {
+          status = AddCompactionOutput(compact, input,
+                                       merge_entries[i].first,
+                                       merge_entries[i].second);
+          last_sequence_for_key =
+              DecodeFixed64(merge_entries[i].first.data() +
+                            merge_entries[i].first.size() - 8) >> 8;
         }
       }
-      if (compact->builder->NumEntries() == 0) {
-        compact->current_output()->smallest.DecodeFrom(key);
+      if (!status.ok()) {
+        break;
       }
-      compact->current_output()->largest.DecodeFrom(key);
-      compact->builder->Add(key, input->value());
+      continue;  // "input" is already at the next entry
+    }
 
-      // Close output file if it is big enough
-      if (compact->builder->FileSize() >=
-          compact->compaction->MaxOutputFileSize()) {
-        status = FinishCompactionOutputFile(compact, input);
-        if (!status.ok()) {
-          break;
-        }
+    if (!drop && as_deletion) {
+      // Still needed to hide older values of the key below us
+      deletion_key.clear();
+      AppendInternalKey(&deletion_key,
+                        ParsedInternalKey(ikey.user_key, ikey.sequence,
+                                          kTypeDeletion));
+      key = deletion_key;
+      value = Slice();
+    }
+
+    if (!drop) {
+      status = AddCompactionOutput(compact, input, key, value);
+      if (!status.ok()) {
+        break;
       }
     }
 
@@ -1017,31 +1474,6 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
     status = input->status();
   }
   delete input;
-  input = NULL;
-
-  CompactionStats stats;
-  stats.micros = env_->NowMicros() - start_micros - imm_micros;
-  for (int which = 0; which < 2; which++) {
-    for (int i = 0; i < compact->compaction->num_input_files(which); i++) {
-      stats.bytes_read += compact->compaction->input(which, i)->file_size;
-    }
-  }
-  for (size_t i = 0; i < compact->outputs.size(); i++) {
-    stats.bytes_written += compact->outputs[i].file_size;
-  }
-
-  mutex_.Lock();
-  stats_[compact->compaction->level() + 1].Add(stats);
-
-  if (status.ok()) {
-    status = InstallCompactionResults(compact);
-  }
-  if (!status.ok()) {
-    RecordBackgroundError(status);
-  }
-  VersionSet::LevelSummaryStorage tmp;
-  Log(options_.info_log,
-      "compacted to: %s", versions_->LevelSummary(&tmp));
   return status;
 }
 
@@ -1050,14 +1482,16 @@ struct IterState {
   port::Mutex* mu;
   Version* version;
   MemTable* mem;
-  MemTable* imm;
+  std::vector<MemTable*> imms;
 };
 
 static void CleanupIteratorState(void* arg1, void* arg2) {
   IterState* state = reinterpret_cast<IterState*>(arg1);
   state->mu->Lock();
   state->mem->Unref();
-  if (state->imm != NULL) state->imm->Unref();
+  for (size_t i = 0; i < state->imms.size(); i++) {
+    state->imms[i]->Unref();
+  }
   state->version->Unref();
   state->mu->Unlock();
   delete state;
@@ -1075,9 +1509,10 @@ Iterator* DBImpl::NewInternalIterator(const ReadOptions& options,
   std::vector<Iterator*> list;
   list.push_back(mem_->NewIterator());
   mem_->Ref();
-  if (imm_ != NULL) {
-    list.push_back(imm_->NewIterator());
-    imm_->Ref();
+  for (size_t i = 0; i < imm_.size(); i++) {
+    list.push_back(imm_[i].mem->NewIterator());
+    imm_[i].mem->Ref();
+    cleanup->imms.push_back(imm_[i].mem);
   }
   versions_->current()->AddIterators(options, &list);
   Iterator* internal_iter =
@@ -1086,7 +1521,6 @@ Iterator* DBImpl::NewInternalIterator(const ReadOptions& options,
 
   cleanup->mu = &mutex_;
   cleanup->mem = mem_;
-  cleanup->imm = imm_;
   cleanup->version = versions_->current();
   internal_iter->RegisterCleanup(CleanupIteratorState, cleanup, NULL);
 
@@ -1119,10 +1553,15 @@ Status DBImpl::Get(const ReadOptions& options,
   }
 
   MemTable* mem = mem_;
-  MemTable* imm = imm_;
+  std::vector<MemTable*> imms;  // Newest first
+  for (size_t i = imm_.size(); i > 0; i--) {
+    imms.push_back(imm_[i - 1].mem);
+  }
   Version* current = versions_->current();
   mem->Ref();
-  if (imm != NULL) imm->Ref();
+  for (size_t i = 0; i < imms.size(); i++) {
+    imms[i]->Ref();
+  }
   current->Ref();
 
   bool have_stat_update = false;
@@ -1131,16 +1570,31 @@ Status DBImpl::Get(const ReadOptions& options,
   // Unlock while reading from files and memtables
   {
     mutex_.Unlock();
-    // First look in the memtable, then in the immutable memtable (if any).
+    // First look in the memtable, then in the immutable memtables (if
+    // any) from newest to oldest.
     LookupKey lkey(key, snapshot);
-    if (mem->Get(lkey, value, &s)) {
-      // Done
-    } else if (imm != NULL && imm->Get(lkey, value, &s)) {
-      // Done
-    } else {
-      s = current->Get(options, lkey, value, &stats);
+    std::vector<std::string> operands;  // Merge operands, newest first
+    bool found = mem->Get(lkey, value, &s, env_, &operands);
+    for (size_t i = 0; !found && i < imms.size(); i++) {
+      found = imms[i]->Get(lkey, value, &s, env_, &operands);
+    }
+    if (!found) {
+      RateLimiter* limiter = options_.rate_limiter;
+      if (limiter != NULL && limiter->IsAdaptive()) {
+        // Let the limiter see how long reads from the files take
+        const uint64_t start_micros = env_->NowMicros();
+        s = current->Get(options, lkey, value, &stats, &operands);
+        limiter->RecordForegroundRead(env_->NowMicros() - start_micros);
+      } else {
+        s = current->Get(options, lkey, value, &stats, &operands);
+      }
       have_stat_update = true;
     }
+    if (!operands.empty() && (s.ok() || s.IsNotFound())) {
+      Slice base(*value);
+      s = ApplyMergeOperands(options_.merge_operator, key,
+                             s.ok() ? &base : NULL, operands, value);
+    }
     mutex_.Lock();
   }
 
@@ -1148,7 +1602,9 @@ Status DBImpl::Get(const ReadOptions& options,
     MaybeScheduleCompaction();
   }
   mem->Unref();
-  if (imm != NULL) imm->Unref();
+  for (size_t i = 0; i < imms.size(); i++) {
+    imms[i]->Unref();
+  }
   current->Unref();
   return s;
 }
@@ -1158,11 +1614,11 @@ Iterator* DBImpl::NewIterator(const ReadOptions& options) {
   uint32_t seed;
   Iterator* iter = NewInternalIterator(options, &latest_snapshot, &seed);
   return NewDBIterator(
-      this, user_comparator(), iter,
+      this, user_comparator(), options_.merge_operator, iter,
       (options.snapshot != NULL
        ? reinterpret_cast<const SnapshotImpl*>(options.snapshot)->number_
        : latest_snapshot),
-      seed);
+      env_->NowMicros(), seed);
 }
 
 void DBImpl::RecordReadSample(Slice key) {
@@ -1193,27 +1649,57 @@ Status DBImpl::Delete(const WriteOptions& options, const Slice& key) {
 
 Status DBImpl::Write(const WriteOptions& options, WriteBatch* my_batch) {
   Writer w(&mutex_);
+  return WriteImpl(&w, options, my_batch);
+}
+
+Status DBImpl::WriteIfUnchanged(const WriteOptions& options,
+                                const Snapshot* snapshot,
+                                const std::vector<Slice>& keys,
+                                WriteBatch* my_batch) {
+  Writer w(&mutex_);
+  w.check_keys = &keys;
+  w.check_sequence =
+      reinterpret_cast<const SnapshotImpl*>(snapshot)->number_;
+  return WriteImpl(&w, options, my_batch);
+}
+
+Status DBImpl::WriteImpl(Writer* writer, const WriteOptions& options,
+                         WriteBatch* my_batch) {
+  if (options_.enable_pipelined_write && my_batch != NULL) {
+    return PipelinedWrite(writer, options, my_batch);
+  }
+
+  Writer& w = *writer;
   w.batch = my_batch;
   w.sync = options.sync;
   w.done = false;
 
   MutexLock l(&mutex_);
   writers_.push_back(&w);
-  while (!w.done && &w != writers_.front()) {
+  while (!w.done && w.insert_mem == NULL && &w != writers_.front()) {
     w.cv.Wait();
   }
+  if (w.insert_mem != NULL) {
+    InsertAsFollower(&w);
+  }
   if (w.done) {
     return w.status;
   }
 
   // May temporarily unlock and wait.
   Status status = MakeRoomForWrite(my_batch == NULL);
+  if (status.ok() && w.check_keys != NULL) {
+    status = CheckUnchanged(&w);
+  }
   uint64_t last_sequence = versions_->LastSequence();
   Writer* last_writer = &w;
   if (status.ok() && my_batch != NULL) {  // NULL batch is for compactions
-    WriteBatch* updates = BuildBatchGroup(&last_writer);
+    WriteBatch* updates = BuildBatchGroup(&last_writer, tmp_batch_);
     WriteBatchInternal::SetSequence(updates, last_sequence + 1);
     last_sequence += WriteBatchInternal::Count(updates);
+    const size_t record_size = WriteBatchInternal::ByteSize(updates);
+    const bool parallel =
+        options_.allow_concurrent_memtable_write && updates != my_batch;
 
     // Add to log and apply to memtable.  We can release the lock
     // during this phase since &w is currently responsible for logging
@@ -1229,7 +1715,7 @@ Status DBImpl::Write(const WriteOptions& options, WriteBatch* my_batch) {
           sync_error = true;
         }
       }
-      if (status.ok()) {
+      if (status.ok() && !parallel) {
         status = WriteBatchInternal::InsertInto(updates, mem_);
       }
       mutex_.Lock();
@@ -1238,8 +1724,22 @@ Status DBImpl::Write(const WriteOptions& options, WriteBatch* my_batch) {
         // just added may or may not show up when the DB is re-opened.
         // So we force the DB into a mode where all future writes fail.
         RecordBackgroundError(status);
+      } else if (options.sync) {
+        unsynced_log_bytes_ = 0;
+      } else {
+        unsynced_log_bytes_ += record_size;
+        if (options_.wal_sync_bytes > 0 &&
+            unsynced_log_bytes_ >= options_.wal_sync_bytes) {
+          wal_sync_cv_.Signal();
+        }
       }
     }
+    if (status.ok() && parallel) {
+      std::vector<Writer*> group(
+          writers_.begin(),
+          std::find(writers_.begin(), writers_.end(), last_writer) + 1);
+      status = InsertIntoMemTable(updates, group, mem_);
+    }
     if (updates == tmp_batch_) tmp_batch_->Clear();
 
     versions_->SetLastSequence(last_sequence);
@@ -1264,9 +1764,285 @@ Status DBImpl::Write(const WriteOptions& options, WriteBatch* my_batch) {
   return status;
 }
 
+// Like Write(), but the group leader gives up the log as soon as its
+// group has been appended to it.  Groups are then inserted into the
+// memtable one at a time in log order, and only then is their last
+// sequence number published, so readers never observe a later group
+// before an earlier one.
+Status DBImpl::PipelinedWrite(Writer* writer, const WriteOptions& options,
+                              WriteBatch* my_batch) {
+  Writer& w = *writer;
+  w.batch = my_batch;
+  w.sync = options.sync;
+  w.done = false;
+
+  MutexLock l(&mutex_);
+  writers_.push_back(&w);
+  while (!w.done && w.insert_mem == NULL && &w != writers_.front()) {
+    w.cv.Wait();
+  }
+  if (w.insert_mem != NULL) {
+    InsertAsFollower(&w);
+  }
+  if (w.done) {
+    return w.status;
+  }
+
+  // Log stage.  May temporarily unlock and wait.
+  Status status = MakeRoomForWrite(false);
+  if (status.ok() && w.check_keys != NULL) {
+    // Earlier groups must be in the memtable before they can be checked
+    while (!memtable_writers_.empty()) {
+      bg_cv_.Wait();
+    }
+    status = CheckUnchanged(&w);
+  }
+  Writer* last_writer = &w;
+  WriteBatch group_batch;  // Lives until the memtable stage is over
+  WriteBatch* updates = NULL;
+  if (status.ok()) {
+    updates = BuildBatchGroup(&last_writer, &group_batch);
+    if (memtable_writers_.empty()) {
+      last_allocated_sequence_ = versions_->LastSequence();
+    }
+    WriteBatchInternal::SetSequence(updates, last_allocated_sequence_ + 1);
+    last_allocated_sequence_ += WriteBatchInternal::Count(updates);
+    const size_t record_size = WriteBatchInternal::ByteSize(updates);
+
+    mutex_.Unlock();
+    status = log_->AddRecord(WriteBatchInternal::Contents(updates));
+    bool sync_error = false;
+    if (status.ok() && options.sync) {
+      status = logfile_->Sync();
+      if (!status.ok()) {
+        sync_error = true;
+      }
+    }
+    mutex_.Lock();
+    if (sync_error) {
+      RecordBackgroundError(status);
+    } else if (options.sync) {
+      unsynced_log_bytes_ = 0;
+    } else {
+      unsynced_log_bytes_ += record_size;
+      if (options_.wal_sync_bytes > 0 &&
+          unsynced_log_bytes_ >= options_.wal_sync_bytes) {
+        wal_sync_cv_.Signal();
+      }
+    }
+  }
+  const SequenceNumber last_sequence = last_allocated_sequence_;
+
+  // Hand the log over to the next group.  Our followers stay blocked
+  // until the memtable stage is done.
+  std::vector<Writer*> group;
+  while (true) {
+    Writer* ready = writers_.front();
+    writers_.pop_front();
+    group.push_back(ready);
+    if (ready == last_writer) break;
+  }
+  if (updates != NULL) {
+    memtable_writers_.push_back(&w);
+  }
+  if (!writers_.empty()) {
+    writers_.front()->cv.Signal();
+  }
+
+  // Memtable stage
+  if (updates != NULL) {
+    while (&w != memtable_writers_.front()) {
+      w.cv.Wait();
+    }
+    if (status.ok()) {
+      MemTable* mem = mem_;
+      mem->Ref();
+      status = InsertIntoMemTable(updates, group, mem);
+      mem->Unref();
+    }
+    versions_->SetLastSequence(last_sequence);
+    memtable_writers_.pop_front();
+    if (!memtable_writers_.empty()) {
+      memtable_writers_.front()->cv.Signal();
+    } else {
+      // MakeRoomForWrite() may be waiting for the memtable stage to drain
+      bg_cv_.SignalAll();
+    }
+  }
+
+  for (size_t i = 0; i < group.size(); i++) {
+    Writer* ready = group[i];
+    if (ready != &w) {
+      ready->status = status;
+      ready->done = true;
+      ready->cv.Signal();
+    }
+  }
+  return status;
+}
+
+Status DBImpl::InsertIntoMemTable(WriteBatch* updates,
+                                  const std::vector<Writer*>& group,
+                                  MemTable* mem) {
+  mutex_.AssertHeld();
+  Writer* leader = group[0];
+  ParallelInsert parallel;
+  parallel.leader = leader;
+  parallel.pending = 0;
+  if (options_.allow_concurrent_memtable_write && updates != leader->batch) {
+    // Hand every follower the part of the sequence space its batch
+    // occupies in "updates", and let it do its own insert.
+    SequenceNumber seq = WriteBatchInternal::Sequence(updates);
+    for (size_t i = 0; i < group.size(); i++) {
+      Writer* w = group[i];
+      if (w->batch == NULL) continue;
+      WriteBatchInternal::SetSequence(w->batch, seq);
+      seq += WriteBatchInternal::Count(w->batch);
+      if (w != leader) {
+        w->insert_mem = mem;
+        w->parallel = &parallel;
+        parallel.pending++;
+        w->cv.Signal();
+      }
+    }
+  }
+
+  const bool concurrently = parallel.pending > 0;
+  mutex_.Unlock();
+  Status s;
+  if (concurrently) {
+    s = WriteBatchInternal::InsertIntoConcurrently(leader->batch, mem);
+  } else {
+    s = WriteBatchInternal::InsertInto(updates, mem);
+  }
+  mutex_.Lock();
+  while (parallel.pending > 0) {
+    leader->cv.Wait();
+  }
+  if (s.ok()) {
+    s = parallel.status;
+  }
+  return s;
+}
+
+void DBImpl::InsertAsFollower(Writer* w) {
+  mutex_.AssertHeld();
+  MemTable* mem = w->insert_mem;
+  mutex_.Unlock();
+  Status s = WriteBatchInternal::InsertIntoConcurrently(w->batch, mem);
+  mutex_.Lock();
+  ParallelInsert* parallel = w->parallel;
+  w->insert_mem = NULL;
+  w->parallel = NULL;
+  if (!s.ok() && parallel->status.ok()) {
+    parallel->status = s;
+  }
+  if (--parallel->pending == 0) {
+    parallel->leader->cv.Signal();
+  }
+  while (!w->done) {
+    w->cv.Wait();
+  }
+}
+
+Status DBImpl::SyncWAL() {
+  // Join the writer queue so that nobody appends to or switches the
+  // log file while we sync it.  A sync writer at the head of a group
+  // may pick us up (see BuildBatchGroup) and do the sync on our behalf.
+  Writer w(&mutex_);
+  w.batch = NULL;
+  w.sync = true;
+  w.done = false;
+
+  MutexLock l(&mutex_);
+  writers_.push_back(&w);
+  while (!w.done && &w != writers_.front()) {
+    w.cv.Wait();
+  }
+  if (w.done) {
+    return w.status;
+  }
+
+  Status status = bg_error_;
+  if (status.ok() && unsynced_log_bytes_ > 0) {
+    WritableFile* file = logfile_;
+    mutex_.Unlock();
+    status = file->Sync();
+    mutex_.Lock();
+    if (status.ok()) {
+      unsynced_log_bytes_ = 0;
+    } else {
+      RecordBackgroundError(status);
+    }
+  }
+
+  writers_.pop_front();
+  if (!writers_.empty()) {
+    writers_.front()->cv.Signal();
+  }
+  return status;
+}
+
+void DBImpl::MaybeStartWALSyncer() {
+  mutex_.AssertHeld();
+  if (options_.wal_sync_interval_ms > 0 || options_.wal_sync_bytes > 0) {
+    wal_syncer_running_ = true;
+    env_->StartThread(&DBImpl::WALSyncerWork, this);
+  }
+}
+
+void DBImpl::WALSyncerWork(void* db) {
+  reinterpret_cast<DBImpl*>(db)->WALSyncerCall();
+}
+
+void DBImpl::WALSyncerCall() {
+  const uint64_t interval =
+      static_cast<uint64_t>(options_.wal_sync_interval_ms) * 1000;
+  MutexLock l(&mutex_);
+  uint64_t last_sync = env_->NowMicros();
+  while (shutting_down_.Acquire_Load() == NULL) {
+    if (interval > 0) {
+      const uint64_t now = env_->NowMicros();
+      if (now < last_sync + interval) {
+        wal_sync_cv_.TimedWait(last_sync + interval - now);
+      }
+    } else {
+      wal_sync_cv_.Wait();
+    }
+    if (shutting_down_.Acquire_Load() != NULL) {
+      break;
+    }
+
+    const bool due = interval > 0 && env_->NowMicros() >= last_sync + interval;
+    const bool full = options_.wal_sync_bytes > 0 &&
+                      unsynced_log_bytes_ >= options_.wal_sync_bytes;
+    if (!due && !full) {
+      continue;
+    }
+    last_sync = env_->NowMicros();
+    if (unsynced_log_bytes_ > 0 && bg_error_.ok()) {
+      mutex_.Unlock();
+      Status s = SyncWAL();
+      mutex_.Lock();
+      if (!s.ok()) {
+        Log(options_.info_log, "Background log sync error: %s\n",
+            s.ToString().c_str());
+      }
+    }
+  }
+
+  // Leave nothing unsynced behind on a clean close.
+  if (unsynced_log_bytes_ > 0 && bg_error_.ok() && logfile_ != NULL) {
+    logfile_->Sync();
+  }
+  wal_syncer_running_ = false;
+  bg_cv_.SignalAll();
+}
+
 // REQUIRES: Writer list must be non-empty
 // REQUIRES: First writer must have a non-NULL batch
-WriteBatch* DBImpl::BuildBatchGroup(Writer** last_writer) {
+WriteBatch* DBImpl::BuildBatchGroup(Writer** last_writer,
+                                    WriteBatch* tmp_batch) {
   assert(!writers_.empty());
   Writer* first = writers_.front();
   WriteBatch* result = first->batch;
@@ -1292,6 +2068,11 @@ WriteBatch* DBImpl::BuildBatchGroup(Writer** last_writer) {
       break;
     }
 
+    if (w->check_keys != NULL) {
+      // A conditional write must be checked by its own group.
+      break;
+    }
+
     if (w->batch != NULL) {
       size += WriteBatchInternal::ByteSize(w->batch);
       if (size > max_size) {
@@ -1302,7 +2083,7 @@ WriteBatch* DBImpl::BuildBatchGroup(Writer** last_writer) {
       // Append to *result
       if (result == first->batch) {
         // Switch to temporary batch instead of disturbing caller's batch
-        result = tmp_batch_;
+        result = tmp_batch;
         assert(WriteBatchInternal::Count(result) == 0);
         WriteBatchInternal::Append(result, first->batch);
       }
@@ -1313,6 +2094,87 @@ WriteBatch* DBImpl::BuildBatchGroup(Writer** last_writer) {
   return result;
 }
 
+// If "iter" has an entry for the user key of "lkey", store the sequence
+// number of the newest one in *seq and return true.
+static bool NewestSequence(Iterator* iter, const LookupKey& lkey,
+                           const Comparator* ucmp, SequenceNumber* seq,
+                           Status* s) {
+  iter->Seek(lkey.internal_key());
+  if (!iter->Valid()) {
+    *s = iter->status();
+    return false;
+  }
+  ParsedInternalKey ikey;
+  if (!ParseInternalKey(iter->key(), &ikey)) {
+    *s = Status::Corruption("corrupted key for ", lkey.user_key());
+    return false;
+  }
+  if (ucmp->Compare(ikey.user_key, lkey.user_key()) != 0) {
+    return false;
+  }
+  *seq = ikey.sequence;
+  return true;
+}
+
+Status DBImpl::CheckUnchanged(Writer* w) {
+  mutex_.AssertHeld();
+  MemTable* mem = mem_;
+  std::vector<MemTable*> imms;
+  for (size_t i = imm_.size(); i > 0; i--) {
+    imms.push_back(imm_[i - 1].mem);  // Newest first
+  }
+  Version* current = versions_->current();
+  mem->Ref();
+  for (size_t i = 0; i < imms.size(); i++) {
+    imms[i]->Ref();
+  }
+  current->Ref();
+
+  // Later writers wait for us, so nothing can change the newest entry
+  // of a key while the lock is released.
+  Status s;
+  {
+    mutex_.Unlock();
+    const Comparator* ucmp = internal_comparator_.user_comparator();
+    Iterator* version_iter = NULL;
+    const std::vector<Slice>& keys = *w->check_keys;
+    for (size_t i = 0; s.ok() && i < keys.size(); i++) {
+      LookupKey lkey(keys[i], kMaxSequenceNumber);
+      SequenceNumber newest = 0;
+      bool found = false;
+      // The memtables hold the newest entries, so the tables are only
+      // searched for keys they do not have.
+      for (size_t j = 0; !found && j <= imms.size(); j++) {
+        Iterator* iter = (j == 0 ? mem : imms[j - 1])->NewIterator();
+        found = NewestSequence(iter, lkey, ucmp, &newest, &s);
+        delete iter;
+      }
+      if (!found && s.ok()) {
+        if (version_iter == NULL) {
+          std::vector<Iterator*> list;
+          current->AddIterators(ReadOptions(), &list);
+          version_iter = NewMergingIterator(
+              &internal_comparator_, list.empty() ? NULL : &list[0],
+              list.size());
+        }
+        found = NewestSequence(version_iter, lkey, ucmp, &newest, &s);
+      }
+      if (s.ok() && found && newest > w->check_sequence) {
+        s = Status::Busy("key changed since the snapshot", keys[i]);
+      }
+    }
+    delete version_iter;
+    mutex_.Lock();
+  }
+
+  mem->Unref();
+  for (size_t i = 0; i < imms.size(); i++) {
+    imms[i]->Unref();
+  }
+  current->Unref();
+  return s;
+}
+
 // REQUIRES: mutex_ is held
 // REQUIRES: this thread is currently at the front of the writer queue
 Status DBImpl::MakeRoomForWrite(bool force) {
@@ -1327,7 +2189,8 @@ Status DBImpl::MakeRoomForWrite(bool force) {
       break;
     } else if (
         allow_delay &&
-        versions_->NumLevelFiles(0) >= config::kL0_SlowdownWritesTrigger) {
+        versions_->NumLevelFiles(0) >=
+            options_.level0_slowdown_writes_trigger) {
       // We are getting close to hitting a hard limit on the number of
       // L0 files.  Rather than delaying a single write by several
       // seconds when we hit the hard limit, start delaying each
@@ -1342,18 +2205,34 @@ Status DBImpl::MakeRoomForWrite(bool force) {
                (mem_->ApproximateMemoryUsage() <= options_.write_buffer_size)) {
       // There is room in current memtable
       break;
-    } else if (imm_ != NULL) {
+    } else if (imm_.size() + 1 >=
+               static_cast<size_t>(options_.max_write_buffer_number)) {
       // We have filled up the current memtable, but the previous
-      // one is still being compacted, so we wait.
+      // ones are still being compacted, so we wait.
       Log(options_.info_log, "Current memtable full; waiting...\n");
       bg_cv_.Wait();
-    } else if (versions_->NumLevelFiles(0) >= config::kL0_StopWritesTrigger) {
+    } else if (versions_->NumLevelFiles(0) >=
+               options_.level0_stop_writes_trigger) {
       // There are too many level-0 files.
       Log(options_.info_log, "Too many L0 files; waiting...\n");
       bg_cv_.Wait();
+    } else if (!memtable_writers_.empty()) {
+      // Pipelined writes logged to the current log are still being
+      // inserted into mem_, so neither may be switched yet.
+      bg_cv_.Wait();
     } else {
       // Attempt to switch to a new memtable and trigger compaction of old
       assert(versions_->PrevLogNumber() == 0);
+      if (unsynced_log_bytes_ > 0 &&
+          (options_.wal_sync_interval_ms > 0 || options_.wal_sync_bytes > 0)) {
+        // The log syncer only ever looks at the current log, so make
+        // sure the tail of the one we are about to close is durable.
+        s = logfile_->Sync();
+        if (!s.ok()) {
+          RecordBackgroundError(s);
+          break;
+        }
+      }
       uint64_t new_log_number = versions_->NewFileNumber();
       WritableFile* lfile = NULL;
       s = env_->NewWritableFile(LogFileName(dbname_, new_log_number), &lfile);
@@ -1362,13 +2241,16 @@ Status DBImpl::MakeRoomForWrite(bool force) {
         versions_->ReuseFileNumber(new_log_number);
         break;
       }
+      ImmutableMemTable imm;
+      imm.mem = mem_;
+      imm.log_number = logfile_number_;
+      imm_.push_back(imm);
       delete log_;
       delete logfile_;
       logfile_ = lfile;
       logfile_number_ = new_log_number;
       log_ = new log::Writer(lfile);
-      imm_ = mem_;
-      has_imm_.Release_Store(imm_);
+      unsynced_log_bytes_ = 0;
       mem_ = new MemTable(internal_comparator_);
       mem_->Ref();
       force = false;   // Do not force another compaction if have room
@@ -1400,6 +2282,20 @@ bool DBImpl::GetProperty(const Slice& property, std::string* value) {
       *value = buf;
       return true;
     }
+  } else if (in.starts_with("total-bytes-at-level")) {
+    in.remove_prefix(strlen("total-bytes-at-level"));
+    uint64_t level;
+    bool ok = ConsumeDecimalNumber(&in, &level) && in.empty();
+    if (!ok || level >= config::kNumLevels) {
+      return false;
+    } else {
+      char buf[100];
+      snprintf(buf, sizeof(buf), "%lld",
+               static_cast<long long>(
+                   versions_->NumLevelBytes(static_cast<int>(level))));
+      *value = buf;
+      return true;
+    }
   } else if (in == "stats") {
     char buf[200];
     snprintf(buf, sizeof(buf),
@@ -1427,13 +2323,16 @@ bool DBImpl::GetProperty(const Slice& property, std::string* value) {
   } else if (in == "sstables") {
     *value = versions_->current()->DebugString();
     return true;
+  } else if (in == "tombstones") {
+    *value = versions_->current()->TombstoneSummary();
+    return true;
   } else if (in == "approximate-memory-usage") {
     size_t total_usage = options_.block_cache->TotalCharge();
     if (mem_) {
       total_usage += mem_->ApproximateMemoryUsage();
     }
-    if (imm_) {
-      total_usage += imm_->ApproximateMemoryUsage();
+    for (size_t i = 0; i < imm_.size(); i++) {
+      total_usage += imm_[i].mem->ApproximateMemoryUsage();
     }
     char buf[50];
     snprintf(buf, sizeof(buf), "%llu",
@@ -1479,6 +2378,26 @@ Status DB::Put(const WriteOptions& opt, const Slice& key, const Slice& value) {
   return Write(opt, &batch);
 }
 
+Status DB::PutWithExpiry(const WriteOptions& opt, const Slice& key,
+                         const Slice& value, uint64_t expiry_micros) {
+  WriteBatch batch;
+  batch.PutWithExpiry(key, value, expiry_micros);
+  return Write(opt, &batch);
+}
+
+Status DB::Merge(const WriteOptions& opt, const Slice& key,
+                 const Slice& value) {
+  WriteBatch batch;
+  batch.Merge(key, value);
+  return Write(opt, &batch);
+}
+
+Status DB::WriteIfUnchanged(const WriteOptions& opt, const Snapshot* snapshot,
+                            const std::vector<Slice>& keys,
+                            WriteBatch* updates) {
+  return Status::NotSupported("WriteIfUnchanged");
+}
+
 Status DB::Delete(const WriteOptions& opt, const Slice& key) {
   WriteBatch batch;
   batch.Delete(key);
@@ -1518,8 +2437,17 @@ Status DB::Open(const Options& options, const std::string& dbname,
     s = impl->versions_->LogAndApply(&edit, &impl->mutex_);
   }
   if (s.ok()) {
+    if (options.compaction_filter != NULL) {
+      Log(impl->options_.info_log, "Compaction filter: %s",
+          options.compaction_filter->Name());
+    }
+    if (options.merge_operator != NULL) {
+      Log(impl->options_.info_log, "Merge operator: %s",
+          options.merge_operator->Name());
+    }
     impl->DeleteObsoleteFiles();
     impl->MaybeScheduleCompaction();
+    impl->MaybeStartWALSyncer();
   }
   impl->mutex_.Unlock();
   if (s.ok()) {
@@ -7,6 +7,7 @@
 
 #include <deque>
 #include <set>
+#include <vector>
 #include "db/dbformat.h"
 #include "db/log_writer.h"
 #include "db/snapshot.h"
@@ -19,6 +20,7 @@ namespace leveldb {
 
 class MemTable;
 class TableCache;
+class ThreadPool;
 class Version;
 class VersionEdit;
 class VersionSet;
@@ -32,6 +34,10 @@ class DBImpl : public DB {
   virtual Status Put(const WriteOptions&, const Slice& key, const Slice& value);
   virtual Status Delete(const WriteOptions&, const Slice& key);
   virtual Status Write(const WriteOptions& options, WriteBatch* updates);
+  virtual Status WriteIfUnchanged(const WriteOptions& options,
+                                  const Snapshot* snapshot,
+                                  const std::vector<Slice>& keys,
+                                  WriteBatch* updates);
   virtual Status Get(const ReadOptions& options,
                      const Slice& key,
                      std::string* value);
@@ -41,6 +47,7 @@ class DBImpl : public DB {
   virtual bool GetProperty(const Slice& property, std::string* value);
   virtual void GetApproximateSizes(const Range* range, int n, uint64_t* sizes);
   virtual void CompactRange(const Slice* begin, const Slice* end);
+  virtual Status SyncWAL();
 
   // Extra methods (for testing) that are not in the public DB interface
 
@@ -50,6 +57,15 @@ class DBImpl : public DB {
   // Force current memtable contents to be compacted.
   Status TEST_CompactMemTable();
 
+  // Wait until no flush or compaction is scheduled in the background.
+  Status TEST_WaitForCompactions();
+
+  // Return true if the current version asks for a background compaction.
+  bool TEST_NeedsCompaction();
+
+  // Return the options the database runs with, after sanitization.
+  const Options& TEST_Options() const { return options_; }
+
   // Return an internal iterator over the current state of the database.
   // The keys of this iterator are internal keys (see format.h).
   // The returned iterator should be deleted when no longer needed.
@@ -67,7 +83,9 @@ class DBImpl : public DB {
  private:
   friend class DB;
   struct CompactionState;
+  struct Subcompaction;
   struct Writer;
+  struct ParallelInsert;
 
   Iterator* NewInternalIterator(const ReadOptions&,
                                 SequenceNumber* latest_snapshot,
@@ -95,25 +113,83 @@ class DBImpl : public DB {
                         VersionEdit* edit, SequenceNumber* max_sequence)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
-  Status WriteLevel0Table(MemTable* mem, VersionEdit* edit, Version* base)
+  // Takes ownership of "iter".  The number of the new table is stored in
+  // *number and left in pending_outputs_ for the caller to remove once
+  // "edit" has been applied.
+  Status WriteLevel0Table(Iterator* iter, VersionEdit* edit, Version* base,
+                          uint64_t* number)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   Status MakeRoomForWrite(bool force /* compact even if there is room? */)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
-  WriteBatch* BuildBatchGroup(Writer** last_writer);
+  WriteBatch* BuildBatchGroup(Writer** last_writer, WriteBatch* tmp_batch);
+
+  // Write() for options_.enable_pipelined_write
+  Status PipelinedWrite(Writer* w, const WriteOptions& options,
+                        WriteBatch* my_batch);
+  // Write() and WriteIfUnchanged() for a writer set up by the caller
+  Status WriteImpl(Writer* w, const WriteOptions& options,
+                   WriteBatch* my_batch);
+
+  // Return a Busy status if any of the keys checked by "w" has an entry
+  // newer than its snapshot.  May temporarily unlock.
+  // REQUIRES: "w" is at the front of the writer queue and all earlier
+  // writes have been applied to the memtable.
+  Status CheckUnchanged(Writer* w) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Insert "updates", made of the batches of "group" in order, into
+  // "mem".  With options_.allow_concurrent_memtable_write each writer of
+  // the group inserts its own batch.  May temporarily unlock.
+  Status InsertIntoMemTable(WriteBatch* updates,
+                            const std::vector<Writer*>& group,
+                            MemTable* mem)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Insert the batch of "w" as its group leader asked, then wait until
+  // the group is done.
+  void InsertAsFollower(Writer* w) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   void RecordBackgroundError(const Status& s);
 
+  // Background thread that syncs the log according to
+  // options_.wal_sync_interval_ms and options_.wal_sync_bytes.
+  void MaybeStartWALSyncer() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  static void WALSyncerWork(void* db);
+  void WALSyncerCall();
+
   void MaybeScheduleCompaction() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   static void BGWork(void* db);
+  static void BGFlushWork(void* db);
   void BackgroundCall();
-  void  BackgroundCompaction() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void BackgroundFlushCall();
+  // Returns false if there was no compaction it could run.
+  bool BackgroundCompaction() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // versions_->LogAndApply(), one caller at a time.  May temporarily
+  // unlock and wait.
+  Status LogAndApply(VersionEdit* edit) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   void CleanupCompaction(CompactionState* compact)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   Status DoCompactionWork(CompactionState* compact)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Merge the inputs of "compact" in its key range into its outputs.
+  // Runs without mutex_, beside the other parts of the compaction.
+  Status ProcessCompaction(CompactionState* compact);
+  static void SubcompactionWork(void* sub);
+  // Read the merge operand at "input", already parsed into "newest", and
+  // the older entries of its key up to the value or deletion they apply
+  // to.  If they can be collapsed, return true and the resulting entry in
+  // *key and *value.  Else return false and the entries read, in order,
+  // in *entries.  Leaves "input" at the first entry not read.
+  bool CollapseMergeOperands(
+      CompactionState* compact, Iterator* input,
+      const ParsedInternalKey& newest, uint64_t now_micros,
+      std::vector<std::pair<std::string, std::string> >* entries,
+      std::string* key, std::string* value);
 
   Status OpenCompactionOutputFile(CompactionState* compact);
+  // Add an entry to the current output of "compact", opening and
+  // finishing output files as needed.
+  Status AddCompactionOutput(CompactionState* compact, Iterator* input,
+                             const Slice& key, const Slice& value);
   Status FinishCompactionOutputFile(CompactionState* compact, Iterator* input);
   Status InstallCompactionResults(CompactionState* compact)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
@@ -130,6 +206,12 @@ class DBImpl : public DB {
   // table_cache_ provides its own synchronization
   TableCache* table_cache_;
 
+  // Threads of the subcompactions and of the parallel compression of the
+  // tables being built.  Separate, since a subcompaction waits for the
+  // compression of its blocks.  NULL if the options never use them.
+  ThreadPool* subcompaction_pool_;
+  ThreadPool* compression_pool_;
+
   // Lock over the persistent DB state.  Non-NULL iff successfully acquired.
   FileLock* db_lock_;
 
@@ -138,25 +220,56 @@ class DBImpl : public DB {
   port::AtomicPointer shutting_down_;
   port::CondVar bg_cv_;          // Signalled when background work finishes
   MemTable* mem_;
-  MemTable* imm_;                // Memtable being compacted
-  port::AtomicPointer has_imm_;  // So bg thread can detect non-NULL imm_
+  // Memtables waiting to be compacted, oldest first, along with the
+  // number of the log file holding their contents.
+  struct ImmutableMemTable {
+    MemTable* mem;
+    uint64_t log_number;
+  };
+  std::deque<ImmutableMemTable> imm_;
   WritableFile* logfile_;
   uint64_t logfile_number_;
   log::Writer* log_;
   uint32_t seed_;                // For sampling.
 
+  // Bytes appended to logfile_ since it was last synced.
+  uint64_t unsynced_log_bytes_;
+
+  // State of the background log syncer thread.
+  port::CondVar wal_sync_cv_;    // Wakes up the log syncer
+  bool wal_syncer_running_;
+
   // Queue of writers.
   std::deque<Writer*> writers_;
   WriteBatch* tmp_batch_;
 
+  // Leaders of the groups that have been logged, but not yet inserted
+  // into mem_, in log order.  Only used by pipelined writes.
+  std::deque<Writer*> memtable_writers_;
+  // Last sequence number handed out to a logged group.  Only meaningful
+  // while memtable_writers_ is non-empty.
+  SequenceNumber last_allocated_sequence_;
+
   SnapshotList snapshots_;
 
   // Set of table files to protect from deletion because they are
   // part of ongoing compactions.
   std::set<uint64_t> pending_outputs_;
 
-  // Has a background compaction been scheduled or is running?
-  bool bg_compaction_scheduled_;
+  // Has a memtable compaction been scheduled or is running?
+  bool bg_flush_scheduled_;
+
+  // Number of background compactions scheduled or running, and how many
+  // of them have picked their inputs (see options_.max_background_compactions).
+  int bg_compactions_scheduled_;
+  int bg_compactions_running_;
+
+  // Set while a memtable compaction installs the table it built.  The
+  // level it picked for it is only safe if no compaction starts meanwhile.
+  bool installing_memtable_;
+
+  // Is a call to versions_->LogAndApply() in progress?
+  bool logging_edit_;
 
   // Information for a manual compaction
   struct ManualCompaction {
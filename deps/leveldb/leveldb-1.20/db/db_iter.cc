@@ -4,9 +4,12 @@
 
 #include "db/db_iter.h"
 
+#include <algorithm>
+
 #include "db/filename.h"
 #include "db/db_impl.h"
 #include "db/dbformat.h"
+#include "db/merge_helper.h"
 #include "leveldb/env.h"
 #include "leveldb/iterator.h"
 #include "port/port.h"
@@ -43,19 +46,26 @@ class DBIter: public Iterator {
   //     the exact entry that yields this->key(), this->value()
   // (2) When moving backwards, the internal iterator is positioned
   //     just before all entries whose user key == this->key().
+  // When moving forward over merge operands, their result is kept in
+  // saved_key_ and saved_value_, and the internal iterator is positioned
+  // after the merge operands applied (see merged_).
   enum Direction {
     kForward,
     kReverse
   };
 
-  DBIter(DBImpl* db, const Comparator* cmp, Iterator* iter, SequenceNumber s,
+  DBIter(DBImpl* db, const Comparator* cmp, const MergeOperator* merge,
+         Iterator* iter, SequenceNumber s, uint64_t now_micros,
          uint32_t seed)
       : db_(db),
         user_comparator_(cmp),
+        merge_operator_(merge),
         iter_(iter),
         sequence_(s),
+        now_micros_(now_micros),
         direction_(kForward),
         valid_(false),
+        merged_(false),
         rnd_(seed),
         bytes_counter_(RandomPeriod()) {
   }
@@ -65,11 +75,18 @@ class DBIter: public Iterator {
   virtual bool Valid() const { return valid_; }
   virtual Slice key() const {
     assert(valid_);
-    return (direction_ == kForward) ? ExtractUserKey(iter_->key()) : saved_key_;
+    return (direction_ == kForward && !merged_)
+        ? ExtractUserKey(iter_->key()) : saved_key_;
   }
   virtual Slice value() const {
     assert(valid_);
-    return (direction_ == kForward) ? iter_->value() : saved_value_;
+    if (direction_ == kReverse || merged_) {
+      return saved_value_;
+    } else if (ExtractValueType(iter_->key()) == kTypeValueWithExpiry) {
+      return ExtractExpiringValue(iter_->value());
+    } else {
+      return iter_->value();
+    }
   }
   virtual Status status() const {
     if (status_.ok()) {
@@ -88,8 +105,19 @@ class DBIter: public Iterator {
  private:
   void FindNextUserEntry(bool skipping, std::string* skip);
   void FindPrevUserEntry();
+  void MergeForward();
   bool ParseKey(ParsedInternalKey* key);
 
+  // Return the type of the entry at iter_, with expired values turned
+  // into deletions.
+  inline ValueType EffectiveType(const ParsedInternalKey& ikey) const {
+    if (ikey.type == kTypeValueWithExpiry &&
+        IsExpired(iter_->value(), now_micros_)) {
+      return kTypeDeletion;
+    }
+    return ikey.type;
+  }
+
   inline void SaveKey(const Slice& k, std::string* dst) {
     dst->assign(k.data(), k.size());
   }
@@ -110,14 +138,17 @@ class DBIter: public Iterator {
 
   DBImpl* db_;
   const Comparator* const user_comparator_;
+  const MergeOperator* const merge_operator_;
   Iterator* const iter_;
   SequenceNumber const sequence_;
+  uint64_t const now_micros_;
 
   Status status_;
   std::string saved_key_;     // == current key when direction_==kReverse
   std::string saved_value_;   // == current raw value when direction_==kReverse
   Direction direction_;
   bool valid_;
+  bool merged_;               // current entry is the result of merges
 
   Random rnd_;
   ssize_t bytes_counter_;
@@ -162,6 +193,15 @@ void DBIter::Next() {
       return;
     }
     // saved_key_ already contains the key to skip past.
+  } else if (merged_) {
+    // saved_key_ already contains the key to skip past, and iter_ is
+    // past the merge operands of this->key().
+    merged_ = false;
+    if (!iter_->Valid()) {
+      valid_ = false;
+      saved_key_.clear();
+      return;
+    }
   } else {
     // Store in saved_key_ the current key so we skip it below.
     SaveKey(ExtractUserKey(iter_->key()), &saved_key_);
@@ -174,10 +214,11 @@ void DBIter::FindNextUserEntry(bool skipping, std::string* skip) {
   // Loop until we hit an acceptable entry to yield
   assert(iter_->Valid());
   assert(direction_ == kForward);
+  merged_ = false;
   do {
     ParsedInternalKey ikey;
     if (ParseKey(&ikey) && ikey.sequence <= sequence_) {
-      switch (ikey.type) {
+      switch (EffectiveType(ikey)) {
         case kTypeDeletion:
           // Arrange to skip all upcoming entries for this key since
           // they are hidden by this deletion.
@@ -185,6 +226,7 @@ void DBIter::FindNextUserEntry(bool skipping, std::string* skip) {
           skipping = true;
           break;
         case kTypeValue:
+        case kTypeValueWithExpiry:
           if (skipping &&
               user_comparator_->Compare(ikey.user_key, *skip) <= 0) {
             // Entry hidden
@@ -194,6 +236,15 @@ void DBIter::FindNextUserEntry(bool skipping, std::string* skip) {
             return;
           }
           break;
+        case kTypeMerge:
+          if (skipping &&
+              user_comparator_->Compare(ikey.user_key, *skip) <= 0) {
+            // Entry hidden
+          } else {
+            MergeForward();
+            return;
+          }
+          break;
       }
     }
     iter_->Next();
@@ -202,14 +253,68 @@ void DBIter::FindNextUserEntry(bool skipping, std::string* skip) {
   valid_ = false;
 }
 
+void DBIter::MergeForward() {
+  // iter_ is at the newest merge operand for its key.  The older entries
+  // of the key follow it, all of them visible at sequence_.
+  SaveKey(ExtractUserKey(iter_->key()), &saved_key_);
+  std::vector<std::string> operands;  // Newest first
+  operands.push_back(iter_->value().ToString());
+  std::string base;
+  bool has_base = false;
+  for (iter_->Next(); iter_->Valid(); iter_->Next()) {
+    ParsedInternalKey ikey;
+    if (!ParseKey(&ikey) ||
+        user_comparator_->Compare(ikey.user_key, saved_key_) != 0) {
+      break;
+    }
+    const ValueType type = EffectiveType(ikey);
+    if (type == kTypeMerge) {
+      operands.push_back(iter_->value().ToString());
+      continue;
+    }
+    if (type != kTypeDeletion) {
+      Slice raw_value = iter_->value();
+      if (type == kTypeValueWithExpiry) {
+        raw_value = ExtractExpiringValue(raw_value);
+      }
+      base.assign(raw_value.data(), raw_value.size());
+      has_base = true;
+    }
+    break;
+  }
+
+  Slice base_value(base);
+  Status s = ApplyMergeOperands(merge_operator_, saved_key_,
+                                has_base ? &base_value : NULL, operands,
+                                &saved_value_);
+  if (s.ok()) {
+    merged_ = true;
+    valid_ = true;
+  } else {
+    status_ = s;
+    saved_key_.clear();
+    ClearSavedValue();
+    valid_ = false;
+  }
+}
+
 void DBIter::Prev() {
   assert(valid_);
 
   if (direction_ == kForward) {  // Switch directions?
     // iter_ is pointing at the current entry.  Scan backwards until
     // the key changes so we can use the normal reverse scanning code.
-    assert(iter_->Valid());  // Otherwise valid_ would have been false
-    SaveKey(ExtractUserKey(iter_->key()), &saved_key_);
+    if (merged_) {
+      // saved_key_ already contains the current key, and iter_ is
+      // past its merge operands.
+      merged_ = false;
+      if (!iter_->Valid()) {
+        iter_->SeekToLast();
+      }
+    } else {
+      assert(iter_->Valid());  // Otherwise valid_ would have been false
+      SaveKey(ExtractUserKey(iter_->key()), &saved_key_);
+    }
     while (true) {
       iter_->Prev();
       if (!iter_->Valid()) {
@@ -233,6 +338,8 @@ void DBIter::FindPrevUserEntry() {
   assert(direction_ == kReverse);
 
   ValueType value_type = kTypeDeletion;
+  std::vector<std::string> operands;  // Merge operands, oldest first
+  bool has_base = false;              // saved_value_ is what they apply to
   if (iter_->Valid()) {
     do {
       ParsedInternalKey ikey;
@@ -242,24 +349,46 @@ void DBIter::FindPrevUserEntry() {
           // We encountered a non-deleted value in entries for previous keys,
           break;
         }
-        value_type = ikey.type;
+        value_type = EffectiveType(ikey);
         if (value_type == kTypeDeletion) {
           saved_key_.clear();
           ClearSavedValue();
+          operands.clear();
+          has_base = false;
+        } else if (value_type == kTypeMerge) {
+          SaveKey(ExtractUserKey(iter_->key()), &saved_key_);
+          operands.push_back(iter_->value().ToString());
         } else {
           Slice raw_value = iter_->value();
+          if (value_type == kTypeValueWithExpiry) {
+            raw_value = ExtractExpiringValue(raw_value);
+          }
           if (saved_value_.capacity() > raw_value.size() + 1048576) {
             std::string empty;
             swap(empty, saved_value_);
           }
           SaveKey(ExtractUserKey(iter_->key()), &saved_key_);
           saved_value_.assign(raw_value.data(), raw_value.size());
+          operands.clear();
+          has_base = true;
         }
       }
       iter_->Prev();
     } while (iter_->Valid());
   }
 
+  if (value_type != kTypeDeletion && !operands.empty()) {
+    std::reverse(operands.begin(), operands.end());
+    Slice base_value(saved_value_);
+    Status s = ApplyMergeOperands(merge_operator_, saved_key_,
+                                  has_base ? &base_value : NULL, operands,
+                                  &saved_value_);
+    if (!s.ok()) {
+      status_ = s;
+      value_type = kTypeDeletion;
+    }
+  }
+
   if (value_type == kTypeDeletion) {
     // End
     valid_ = false;
@@ -298,6 +427,7 @@ void DBIter::SeekToFirst() {
 
 void DBIter::SeekToLast() {
   direction_ = kReverse;
+  merged_ = false;
   ClearSavedValue();
   iter_->SeekToLast();
   FindPrevUserEntry();
@@ -308,10 +438,13 @@ void DBIter::SeekToLast() {
 Iterator* NewDBIterator(
     DBImpl* db,
     const Comparator* user_key_comparator,
+    const MergeOperator* merge_operator,
     Iterator* internal_iter,
     SequenceNumber sequence,
+    uint64_t now_micros,
     uint32_t seed) {
-  return new DBIter(db, user_key_comparator, internal_iter, sequence, seed);
+  return new DBIter(db, user_key_comparator, merge_operator, internal_iter,
+                    sequence, now_micros, seed);
 }
 
 }  // namespace leveldb
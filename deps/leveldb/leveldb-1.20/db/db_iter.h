@@ -12,15 +12,20 @@
 namespace leveldb {
 
 class DBImpl;
+class MergeOperator;
 
 // Return a new iterator that converts internal keys (yielded by
 // "*internal_iter") that were live at the specified "sequence" number
-// into appropriate user keys.
+// into appropriate user keys.  Values that expire at or before
+// "now_micros" are treated as deleted.  Merge operands are applied with
+// "merge_operator".
 extern Iterator* NewDBIterator(
     DBImpl* db,
     const Comparator* user_key_comparator,
+    const MergeOperator* merge_operator,
     Iterator* internal_iter,
     SequenceNumber sequence,
+    uint64_t now_micros,
     uint32_t seed);
 
 }  // namespace leveldb
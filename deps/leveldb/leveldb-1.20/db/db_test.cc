@@ -9,7 +9,11 @@
 #include "db/version_set.h"
 #include "db/write_batch_internal.h"
 #include "leveldb/cache.h"
+#include "leveldb/compaction_filter.h"
 #include "leveldb/env.h"
+#include "leveldb/merge_operator.h"
+#include "leveldb/rate_limiter.h"
+#include "leveldb/slice_transform.h"
 #include "leveldb/table.h"
 #include "util/hash.h"
 #include "util/logging.h"
@@ -78,6 +82,9 @@ class SpecialEnv : public EnvWrapper {
   bool count_random_reads_;
   AtomicCounter random_read_counter_;
 
+  // Number of successful sstable/log Sync() calls.
+  AtomicCounter data_sync_counter_;
+
   explicit SpecialEnv(Env* base) : EnvWrapper(base) {
     delay_data_sync_.Release_Store(NULL);
     data_sync_error_.Release_Store(NULL);
@@ -117,6 +124,7 @@ class SpecialEnv : public EnvWrapper {
         while (env_->delay_data_sync_.Acquire_Load() != NULL) {
           DelayMilliseconds(100);
         }
+        env_->data_sync_counter_.Increment();
         return base_->Sync();
       }
     };
@@ -189,13 +197,22 @@ class SpecialEnv : public EnvWrapper {
 class DBTest {
  private:
   const FilterPolicy* filter_policy_;
+  const FilterPolicy* xor_filter_policy_;
 
   // Sequence of option configurations to try
   enum OptionConfig {
     kDefault,
     kReuse,
     kFilter,
+    kXorFilter,
     kUncompressed,
+    kPipelinedWrite,
+    kConcurrentMemTableWrite,
+    kPipelinedConcurrentMemTableWrite,
+    kParallelCompactions,
+    kSubcompactions,
+    kParallelCompression,
+    kDynamicLevelBytes,
     kEnd
   };
   int option_config_;
@@ -210,6 +227,7 @@ class DBTest {
   DBTest() : option_config_(kDefault),
              env_(new SpecialEnv(Env::Default())) {
     filter_policy_ = NewBloomFilterPolicy(10);
+    xor_filter_policy_ = NewXorFilterPolicy(10);
     dbname_ = test::TmpDir() + "/db_test";
     DestroyDB(dbname_, Options());
     db_ = NULL;
@@ -221,6 +239,7 @@ class DBTest {
     DestroyDB(dbname_, Options());
     delete env_;
     delete filter_policy_;
+    delete xor_filter_policy_;
   }
 
   // Switch to a fresh database with the next option configuration to
@@ -246,9 +265,34 @@ class DBTest {
       case kFilter:
         options.filter_policy = filter_policy_;
         break;
+      case kXorFilter:
+        options.filter_policy = xor_filter_policy_;
+        break;
       case kUncompressed:
         options.compression = kNoCompression;
         break;
+      case kPipelinedWrite:
+        options.enable_pipelined_write = true;
+        break;
+      case kConcurrentMemTableWrite:
+        options.allow_concurrent_memtable_write = true;
+        break;
+      case kPipelinedConcurrentMemTableWrite:
+        options.enable_pipelined_write = true;
+        options.allow_concurrent_memtable_write = true;
+        break;
+      case kParallelCompactions:
+        options.max_background_compactions = 4;
+        break;
+      case kSubcompactions:
+        options.max_subcompactions = 4;
+        break;
+      case kParallelCompression:
+        options.compression_threads = 4;
+        break;
+      case kDynamicLevelBytes:
+        options.level_compaction_dynamic_level_bytes = true;
+        break;
       default:
         break;
     }
@@ -367,6 +411,13 @@ class DBTest {
             case kTypeDeletion:
               result += "DEL";
               break;
+            case kTypeValueWithExpiry:
+              result += "EXP(" +
+                  ExtractExpiringValue(iter->value()).ToString() + ")";
+              break;
+            case kTypeMerge:
+              result += "MERGE(" + iter->value().ToString() + ")";
+              break;
           }
         }
         iter->Next();
@@ -388,6 +439,14 @@ class DBTest {
     return atoi(property.c_str());
   }
 
+  int64_t TotalBytesAtLevel(int level) {
+    std::string property;
+    ASSERT_TRUE(
+        db_->GetProperty("leveldb.total-bytes-at-level" + NumberToString(level),
+                         &property));
+    return atoll(property.c_str());
+  }
+
   int TotalTableFiles() {
     int result = 0;
     for (int level = 0; level < config::kNumLevels; level++) {
@@ -555,6 +614,41 @@ TEST(DBTest, GetFromImmutableLayer) {
   } while (ChangeOptions());
 }
 
+TEST(DBTest, GetFromImmutableLayers) {
+  do {
+    Options options = CurrentOptions();
+    options.env = env_;
+    options.write_buffer_size = 100000;  // Small write buffer
+    options.max_write_buffer_number = 4;
+    Reopen(&options);
+
+    ASSERT_OK(Put("foo", "v1"));
+    env_->delay_data_sync_.Release_Store(env_);      // Block sync calls
+    // Fill three memtables without waiting for the first compaction
+    ASSERT_OK(Put("k1", std::string(100000, 'x')));
+    ASSERT_OK(Put("k2", std::string(100000, 'y')));
+    ASSERT_OK(Put("k3", std::string(100000, 'z')));
+    ASSERT_OK(Put("foo", "v2"));
+    ASSERT_EQ("v2", Get("foo"));
+    ASSERT_EQ(std::string(100000, 'x'), Get("k1"));
+    ASSERT_EQ(std::string(100000, 'y'), Get("k2"));
+    Iterator* iter = db_->NewIterator(ReadOptions());
+    int count = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      count++;
+    }
+    ASSERT_EQ(4, count);
+    delete iter;
+    env_->delay_data_sync_.Release_Store(NULL);      // Release sync calls
+
+    ASSERT_OK(dbfull()->TEST_CompactMemTable());
+    ASSERT_EQ("v2", Get("foo"));
+    Reopen(&options);
+    ASSERT_EQ("v2", Get("foo"));
+    ASSERT_EQ(std::string(100000, 'z'), Get("k3"));
+  } while (ChangeOptions());
+}
+
 TEST(DBTest, GetFromVersions) {
   do {
     ASSERT_OK(Put("foo", "v1"));
@@ -1002,6 +1096,84 @@ TEST(DBTest, CompactionsGenerateMultipleFiles) {
   }
 }
 
+TEST(DBTest, SubcompactionsKeepAllKeys) {
+  Options options = CurrentOptions();
+  options.write_buffer_size = 100000000;        // Large write buffer
+  options.max_subcompactions = 4;
+  Reopen(&options);
+
+  Random rnd(301);
+
+  // Write 8MB (80 values, each 100K) and compact them into several
+  // level-1 files
+  std::vector<std::string> values;
+  for (int i = 0; i < 80; i++) {
+    values.push_back(RandomString(&rnd, 100000));
+    ASSERT_OK(Put(Key(i), values[i]));
+  }
+  Reopen(&options);
+  dbfull()->TEST_CompactRange(0, NULL, NULL);
+  ASSERT_GT(NumTableFilesAtLevel(1), 1);
+
+  // Overwrite and delete some of them, then merge everything into
+  // level-2 with a compaction split at the level-1 file boundaries
+  for (int i = 0; i < 80; i += 2) {
+    values[i] = RandomString(&rnd, 100000);
+    ASSERT_OK(Put(Key(i), values[i]));
+  }
+  for (int i = 0; i < 80; i += 3) {
+    ASSERT_OK(Delete(Key(i)));
+    values[i] = "NOT_FOUND";
+  }
+  Reopen(&options);
+  dbfull()->TEST_CompactRange(0, NULL, NULL);
+  dbfull()->TEST_CompactRange(1, NULL, NULL);
+  ASSERT_EQ(NumTableFilesAtLevel(0), 0);
+  ASSERT_EQ(NumTableFilesAtLevel(1), 0);
+  ASSERT_GT(NumTableFilesAtLevel(2), 1);
+
+  for (int i = 0; i < 80; i++) {
+    ASSERT_EQ(Get(Key(i)), values[i]);
+  }
+  Iterator* iter = db_->NewIterator(ReadOptions());
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    count++;
+  }
+  ASSERT_OK(iter->status());
+  delete iter;
+  ASSERT_EQ(count, 80 - 27);
+}
+
+TEST(DBTest, RateLimitedCompactions) {
+  RateLimiter* limiter = NewRateLimiter(Env::Default(), 10 << 20, true);
+  Options options = CurrentOptions();
+  options.write_buffer_size = 100000000;        // Large write buffer
+  options.rate_limiter = limiter;
+  Reopen(&options);
+
+  Random rnd(301);
+  std::vector<std::string> values;
+  for (int i = 0; i < 20; i++) {
+    values.push_back(RandomString(&rnd, 100000));
+    ASSERT_OK(Put(Key(i), values[i]));
+  }
+  Reopen(&options);
+
+  // 2MB read and written at 10MB/s
+  const uint64_t start = env_->NowMicros();
+  dbfull()->TEST_CompactRange(0, NULL, NULL);
+  ASSERT_GE(env_->NowMicros() - start, static_cast<uint64_t>(200000));
+  ASSERT_EQ(NumTableFilesAtLevel(0), 0);
+  ASSERT_GT(NumTableFilesAtLevel(1), 0);
+  for (int i = 0; i < 20; i++) {
+    ASSERT_EQ(Get(Key(i)), values[i]);
+  }
+
+  Close();
+  delete limiter;
+}
+
 TEST(DBTest, RepeatedWritesToSameKey) {
   Options options = CurrentOptions();
   options.env = env_;
@@ -1009,8 +1181,9 @@ TEST(DBTest, RepeatedWritesToSameKey) {
   Reopen(&options);
 
   // We must have at most one file per level except for level-0,
-  // which may have up to kL0_StopWritesTrigger files.
-  const int kMaxFiles = config::kNumLevels + config::kL0_StopWritesTrigger;
+  // which may have up to level0_stop_writes_trigger files.
+  const int kMaxFiles = config::kNumLevels +
+                        Options().level0_stop_writes_trigger;
 
   Random rnd(301);
   std::string value = RandomString(&rnd, 2 * options.write_buffer_size);
@@ -1258,7 +1431,7 @@ TEST(DBTest, HiddenValuesAreRemoved) {
 TEST(DBTest, DeletionMarkers1) {
   Put("foo", "v1");
   ASSERT_OK(dbfull()->TEST_CompactMemTable());
-  const int last = config::kMaxMemCompactLevel;
+  const int last = Options().max_mem_compaction_level;
   ASSERT_EQ(NumTableFilesAtLevel(last), 1);   // foo => v1 is now in last level
 
   // Place a table at level last-1 to prevent merging with preceding mutation
@@ -1287,7 +1460,7 @@ TEST(DBTest, DeletionMarkers1) {
 TEST(DBTest, DeletionMarkers2) {
   Put("foo", "v1");
   ASSERT_OK(dbfull()->TEST_CompactMemTable());
-  const int last = config::kMaxMemCompactLevel;
+  const int last = Options().max_mem_compaction_level;
   ASSERT_EQ(NumTableFilesAtLevel(last), 1);   // foo => v1 is now in last level
 
   // Place a table at level last-1 to prevent merging with preceding mutation
@@ -1310,9 +1483,400 @@ TEST(DBTest, DeletionMarkers2) {
   ASSERT_EQ(AllEntriesFor("foo"), "[ ]");
 }
 
+TEST(DBTest, ExpiringValues) {
+  const uint64_t now = env_->NowMicros();
+  const uint64_t later = now + 3600 * 1000000ull;
+  ASSERT_OK(db_->PutWithExpiry(WriteOptions(), "a", "va", later));
+  ASSERT_OK(db_->PutWithExpiry(WriteOptions(), "b", "vb", now - 1));
+  ASSERT_OK(db_->PutWithExpiry(WriteOptions(), "c", "vc", later));
+  ASSERT_EQ("va", Get("a"));
+  ASSERT_EQ("NOT_FOUND", Get("b"));
+  ASSERT_EQ("(a->va)(c->vc)", Contents());
+
+  // An expired value hides the older values of its key
+  Put("d", "old");
+  ASSERT_OK(db_->PutWithExpiry(WriteOptions(), "d", "vd", now - 1));
+  ASSERT_EQ("NOT_FOUND", Get("d"));
+  ASSERT_OK(dbfull()->TEST_CompactMemTable());
+  ASSERT_EQ("va", Get("a"));
+  ASSERT_EQ("NOT_FOUND", Get("b"));
+  ASSERT_EQ("NOT_FOUND", Get("d"));
+  ASSERT_EQ("(a->va)(c->vc)", Contents());
+  ASSERT_EQ(AllEntriesFor("a"), "[ EXP(va) ]");
+  ASSERT_EQ(AllEntriesFor("d"), "[ EXP(vd), old ]");
+
+  // Compaction drops expired values that nothing older depends on
+  const int last = Options().max_mem_compaction_level;
+  ASSERT_EQ(NumTableFilesAtLevel(last), 1);
+  dbfull()->TEST_CompactRange(last, NULL, NULL);
+  ASSERT_EQ(AllEntriesFor("a"), "[ EXP(va) ]");
+  ASSERT_EQ(AllEntriesFor("b"), "[ ]");
+  ASSERT_EQ(AllEntriesFor("d"), "[ ]");
+  ASSERT_EQ("(a->va)(c->vc)", Contents());
+}
+
+TEST(DBTest, ExpiringValuesHideOlderLevels) {
+  const uint64_t now = env_->NowMicros();
+  Put("foo", "v1");
+  ASSERT_OK(dbfull()->TEST_CompactMemTable());
+  const int last = Options().max_mem_compaction_level;
+  ASSERT_EQ(NumTableFilesAtLevel(last), 1);   // foo => v1 is now in last level
+
+  // Place a table at level last-1 to prevent merging with preceding mutation
+  Put("a", "begin");
+  Put("z", "end");
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_EQ(NumTableFilesAtLevel(last), 1);
+  ASSERT_EQ(NumTableFilesAtLevel(last-1), 1);
+
+  ASSERT_OK(db_->PutWithExpiry(WriteOptions(), "foo", "v2", now - 1));
+  ASSERT_OK(dbfull()->TEST_CompactMemTable());  // Moves to level last-2
+  ASSERT_EQ(AllEntriesFor("foo"), "[ EXP(v2), v1 ]");
+  ASSERT_EQ("NOT_FOUND", Get("foo"));
+  dbfull()->TEST_CompactRange(last-2, NULL, NULL);
+  // Expired value turns into a deletion: "last" file still holds v1
+  ASSERT_EQ(AllEntriesFor("foo"), "[ DEL, v1 ]");
+  ASSERT_EQ("NOT_FOUND", Get("foo"));
+  dbfull()->TEST_CompactRange(last-1, NULL, NULL);
+  ASSERT_EQ(AllEntriesFor("foo"), "[ ]");
+}
+
+TEST(DBTest, CompactionFilterRemovesKeys) {
+  const CompactionFilter* filter = NewKeyPrefixRemovingFilter("tmp");
+  Options options = CurrentOptions();
+  options.compaction_filter = filter;
+  Reopen(&options);
+
+  Put("foo", "v1");
+  Put("tmp1", "v1");
+  ASSERT_OK(dbfull()->TEST_CompactMemTable());
+  const int last = options.max_mem_compaction_level;
+  ASSERT_EQ(NumTableFilesAtLevel(last), 1);
+  ASSERT_EQ("v1", Get("tmp1"));   // Memtable compactions do not filter
+
+  // Place a table at level last-1 to prevent merging with preceding mutation
+  Put("a", "begin");
+  Put("z", "end");
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_EQ(NumTableFilesAtLevel(last), 1);
+  ASSERT_EQ(NumTableFilesAtLevel(last-1), 1);
+
+  Put("tmp1", "v2");
+  Put("tmp2", "v2");
+  const Snapshot* snapshot = db_->GetSnapshot();
+  Put("tmp3", "v3");
+  ASSERT_OK(dbfull()->TEST_CompactMemTable());  // Moves to level last-2
+  dbfull()->TEST_CompactRange(last-2, NULL, NULL);
+  // The snapshot still sees tmp1 and tmp2, but not tmp3
+  ASSERT_EQ(AllEntriesFor("tmp1"), "[ v2, v1 ]");
+  ASSERT_EQ(AllEntriesFor("tmp2"), "[ v2 ]");
+  ASSERT_EQ(AllEntriesFor("tmp3"), "[ DEL ]");
+  ASSERT_EQ("NOT_FOUND", Get("tmp3"));
+  ReadOptions ropts;
+  ropts.snapshot = snapshot;
+  std::string value;
+  ASSERT_OK(db_->Get(ropts, "tmp2", &value));
+  ASSERT_EQ("v2", value);
+
+  db_->ReleaseSnapshot(snapshot);
+  dbfull()->TEST_CompactRange(last-1, NULL, NULL);
+  ASSERT_EQ(AllEntriesFor("tmp1"), "[ ]");
+  ASSERT_EQ(AllEntriesFor("tmp2"), "[ ]");
+  ASSERT_EQ(AllEntriesFor("tmp3"), "[ ]");
+  ASSERT_EQ("(a->begin)(foo->v1)(z->end)", Contents());
+
+  Close();
+  delete filter;
+}
+
+TEST(DBTest, CompactionFilterChangesValues) {
+  const CompactionFilter* filter = NewValuePrefixStrippingFilter("old:");
+  Options options = CurrentOptions();
+  options.compaction_filter = filter;
+  Reopen(&options);
+
+  const uint64_t later = env_->NowMicros() + 3600 * 1000000ull;
+  Put("a", "old:va");
+  Put("b", "vb");
+  ASSERT_OK(db_->PutWithExpiry(WriteOptions(), "c", "old:vc", later));
+  ASSERT_OK(dbfull()->TEST_CompactMemTable());
+  ASSERT_EQ("(a->old:va)(b->vb)(c->old:vc)", Contents());
+
+  dbfull()->TEST_CompactRange(options.max_mem_compaction_level, NULL, NULL);
+  ASSERT_EQ("(a->va)(b->vb)(c->vc)", Contents());
+  ASSERT_EQ(AllEntriesFor("c"), "[ EXP(vc) ]");
+
+  Close();
+  delete filter;
+}
+
+TEST(DBTest, MergeOperands) {
+  const MergeOperator* add = NewInt64AddOperator();
+  do {
+    Options options = CurrentOptions();
+    options.create_if_missing = true;
+    options.merge_operator = add;
+    DestroyAndReopen(&options);
+
+    ASSERT_OK(db_->Merge(WriteOptions(), "c", "1"));
+    ASSERT_OK(db_->Merge(WriteOptions(), "c", "2"));
+    ASSERT_EQ("3", Get("c"));
+    Put("a", "va");
+    Put("d", "vd");
+    ASSERT_OK(dbfull()->TEST_CompactMemTable());
+    ASSERT_EQ("3", Get("c"));
+    ASSERT_OK(db_->Merge(WriteOptions(), "c", "10"));
+    ASSERT_EQ("13", Get("c"));
+    const Snapshot* snapshot = db_->GetSnapshot();
+    ASSERT_OK(db_->Merge(WriteOptions(), "c", "-20"));
+    ASSERT_EQ("-7", Get("c"));
+    ASSERT_EQ("13", Get("c", snapshot));
+    db_->ReleaseSnapshot(snapshot);
+
+    // Operands apply to the newest value or deletion below them
+    Put("b", "5");
+    ASSERT_OK(db_->Merge(WriteOptions(), "b", "1"));
+    ASSERT_EQ("6", Get("b"));
+    Delete("b");
+    ASSERT_OK(db_->Merge(WriteOptions(), "b", "2"));
+    ASSERT_EQ("2", Get("b"));
+    ASSERT_EQ("(a->va)(b->2)(c->-7)(d->vd)", Contents());
+
+    // Compactions collapse them into plain values
+    db_->CompactRange(NULL, NULL);
+    ASSERT_EQ("(a->va)(b->2)(c->-7)(d->vd)", Contents());
+    ASSERT_EQ(AllEntriesFor("b"), "[ 2 ]");
+    ASSERT_EQ(AllEntriesFor("c"), "[ -7 ]");
+
+    // Malformed operands fail the reads
+    ASSERT_OK(db_->Merge(WriteOptions(), "c", "x"));
+    ASSERT_TRUE(Get("c").find("Corruption") == 0) << Get("c");
+  } while (ChangeOptions());
+  Close();
+  delete add;
+}
+
+TEST(DBTest, MergeOperandsWithoutOperator) {
+  ASSERT_OK(db_->Merge(WriteOptions(), "foo", "1"));
+  ASSERT_TRUE(Get("foo").find("Not implemented") == 0) << Get("foo");
+  Iterator* iter = db_->NewIterator(ReadOptions());
+  iter->SeekToFirst();
+  ASSERT_TRUE(!iter->Valid());
+  ASSERT_TRUE(iter->status().ToString().find("Not implemented") == 0);
+  delete iter;
+}
+
+TEST(DBTest, MergeOperandsIteration) {
+  const MergeOperator* append = NewAppendOperator();
+  Options options = CurrentOptions();
+  options.merge_operator = append;
+  Reopen(&options);
+
+  Put("a", "va");
+  ASSERT_OK(db_->Merge(WriteOptions(), "b", "x"));
+  Put("c", "vc");
+  ASSERT_OK(db_->Merge(WriteOptions(), "b", "y"));
+  for (int flush = 0; flush < 2; flush++) {
+    ASSERT_OK(db_->Merge(WriteOptions(), "b", "z"));
+    ASSERT_OK(db_->Merge(WriteOptions(), "d", "vd"));
+    Iterator* iter = db_->NewIterator(ReadOptions());
+    iter->Seek("b");
+    ASSERT_EQ(IterStatus(iter), flush ? "b->xyzz" : "b->xyz");
+    iter->Prev();
+    ASSERT_EQ(IterStatus(iter), "a->va");
+    iter->Next();
+    ASSERT_EQ(IterStatus(iter), flush ? "b->xyzz" : "b->xyz");
+    iter->Next();
+    ASSERT_EQ(IterStatus(iter), "c->vc");
+    iter->Prev();
+    ASSERT_EQ(IterStatus(iter), flush ? "b->xyzz" : "b->xyz");
+    iter->Seek("d");
+    ASSERT_EQ(IterStatus(iter), flush ? "d->vdvd" : "d->vd");
+    iter->Next();
+    ASSERT_EQ(IterStatus(iter), "(invalid)");
+    iter->SeekToLast();
+    iter->Prev();
+    iter->Next();
+    ASSERT_EQ(IterStatus(iter), flush ? "d->vdvd" : "d->vd");
+    ASSERT_OK(iter->status());
+    delete iter;
+    ASSERT_OK(dbfull()->TEST_CompactMemTable());
+  }
+
+  Close();
+  delete append;
+}
+
+TEST(DBTest, MergeOperandsRandomized) {
+  const MergeOperator* add = NewInt64AddOperator();
+  for (int tiered = 0; tiered < 2; tiered++) {
+    Options options = CurrentOptions();
+    options.create_if_missing = true;
+    options.write_buffer_size = 100000;
+    options.merge_operator = add;
+    if (tiered) {
+      options.compaction_style = kTieredCompaction;
+      options.level0_file_num_compaction_trigger = 3;
+    }
+    DestroyAndReopen(&options);
+
+    // Counters updated across many memtables and compactions
+    Random rnd(301);
+    std::map<std::string, int> expected;
+    for (int i = 0; i < 20000; i++) {
+      const std::string k = Key(rnd.Uniform(500));
+      if (rnd.OneIn(20)) {
+        ASSERT_OK(Delete(k));
+        expected.erase(k);
+      } else if (rnd.OneIn(10)) {
+        ASSERT_OK(Put(k, NumberToString(i)));
+        expected[k] = i;
+      } else {
+        ASSERT_OK(db_->Merge(WriteOptions(), k, "1"));
+        expected[k] += 1;
+      }
+    }
+
+    for (int check = 0; check < 2; check++) {
+      std::string contents;
+      for (std::map<std::string, int>::const_iterator it = expected.begin();
+           it != expected.end(); ++it) {
+        ASSERT_EQ(NumberToString(it->second), Get(it->first));
+        contents += "(" + it->first + "->" + NumberToString(it->second) + ")";
+      }
+      ASSERT_EQ(contents, Contents());
+      db_->CompactRange(NULL, NULL);
+    }
+  }
+  Close();
+  delete add;
+}
+
+TEST(DBTest, WriteIfUnchanged) {
+  do {
+    ASSERT_OK(Put("a", "va"));
+    ASSERT_OK(Put("b", "vb"));
+    ASSERT_OK(Put("c", "vc"));
+    const Snapshot* snapshot = db_->GetSnapshot();
+    ASSERT_OK(Put("b", "vb2"));
+    ASSERT_OK(Delete("c"));
+
+    std::vector<Slice> keys;
+    keys.push_back("a");
+    keys.push_back("d");
+    WriteBatch batch;
+    batch.Put("a", "va2");
+    ASSERT_OK(db_->WriteIfUnchanged(WriteOptions(), snapshot, keys, &batch));
+    ASSERT_EQ("va2", Get("a"));
+
+    // Overwritten and deleted keys conflict, even once they are only in
+    // the tables
+    for (int flush = 0; flush < 2; flush++) {
+      for (char k = 'b'; k <= 'c'; k++) {
+        keys.clear();
+        keys.push_back(std::string(1, k));
+        batch.Clear();
+        batch.Put("e", "ve");
+        Status s = db_->WriteIfUnchanged(WriteOptions(), snapshot, keys,
+                                         &batch);
+        ASSERT_TRUE(s.IsBusy()) << s.ToString();
+        ASSERT_EQ("NOT_FOUND", Get("e"));
+      }
+      dbfull()->TEST_CompactMemTable();
+    }
+
+    // A new snapshot sees the writes
+    db_->ReleaseSnapshot(snapshot);
+    snapshot = db_->GetSnapshot();
+    ASSERT_OK(db_->WriteIfUnchanged(WriteOptions(), snapshot, keys, &batch));
+    ASSERT_EQ("ve", Get("e"));
+    db_->ReleaseSnapshot(snapshot);
+  } while (ChangeOptions());
+}
+
+namespace {
+
+static const int kTxnThreads = 4;
+static const int kTxnIncrements = 200;
+
+struct TxnState {
+  DB* db;
+  port::AtomicPointer thread_done[kTxnThreads];
+};
+
+struct TxnThread {
+  TxnState* state;
+  int id;
+  int retries;
+};
+
+// Add one to a shared counter and to the counter of the thread in one
+// optimistic transaction, retrying it on conflicts
+static void TxnThreadBody(void* arg) {
+  TxnThread* t = reinterpret_cast<TxnThread*>(arg);
+  DB* db = t->state->db;
+  std::vector<Slice> keys;
+  keys.push_back("shared");
+  for (int i = 0; i < kTxnIncrements; ) {
+    const Snapshot* snapshot = db->GetSnapshot();
+    ReadOptions options;
+    options.snapshot = snapshot;
+    std::string value;
+    int shared = 0;
+    if (db->Get(options, "shared", &value).ok()) {
+      shared = atoi(value.c_str());
+    }
+    WriteBatch batch;
+    char buf[20];
+    snprintf(buf, sizeof(buf), "%d", shared + 1);
+    batch.Put("shared", buf);
+    snprintf(buf, sizeof(buf), "%d", i + 1);
+    batch.Put("thread" + NumberToString(t->id), buf);
+    Status s = db->WriteIfUnchanged(WriteOptions(), snapshot, keys, &batch);
+    db->ReleaseSnapshot(snapshot);
+    if (s.ok()) {
+      i++;
+    } else {
+      ASSERT_TRUE(s.IsBusy()) << s.ToString();
+      t->retries++;
+    }
+  }
+  t->state->thread_done[t->id].Release_Store(t);
+}
+
+}  // namespace
+
+TEST(DBTest, WriteIfUnchangedConcurrently) {
+  do {
+    TxnState state;
+    state.db = db_;
+    TxnThread thread[kTxnThreads];
+    for (int id = 0; id < kTxnThreads; id++) {
+      state.thread_done[id].Release_Store(NULL);
+      thread[id].state = &state;
+      thread[id].id = id;
+      thread[id].retries = 0;
+      env_->StartThread(TxnThreadBody, &thread[id]);
+    }
+    for (int id = 0; id < kTxnThreads; id++) {
+      while (state.thread_done[id].Acquire_Load() == NULL) {
+        DelayMilliseconds(10);
+      }
+    }
+
+    // No increment is lost
+    ASSERT_EQ(NumberToString(kTxnThreads * kTxnIncrements), Get("shared"));
+    for (int id = 0; id < kTxnThreads; id++) {
+      ASSERT_EQ(NumberToString(kTxnIncrements),
+                Get("thread" + NumberToString(id)));
+    }
+  } while (ChangeOptions());
+}
+
 TEST(DBTest, OverlapInLevel0) {
   do {
-    ASSERT_EQ(config::kMaxMemCompactLevel, 2) << "Fix test to match config";
+    ASSERT_EQ(Options().max_mem_compaction_level, 2)
+        << "Fix test to match config";
 
     // Fill levels 1 and 2 to disable the pushing of new memtables to levels > 0.
     ASSERT_OK(Put("100", "v100"));
@@ -1473,8 +2037,8 @@ TEST(DBTest, CustomComparator) {
 }
 
 TEST(DBTest, ManualCompaction) {
-  ASSERT_EQ(config::kMaxMemCompactLevel, 2)
-      << "Need to update this test to match kMaxMemCompactLevel";
+  ASSERT_EQ(Options().max_mem_compaction_level, 2)
+      << "Need to update this test to match max_mem_compaction_level";
 
   MakeTables(3, "p", "q");
   ASSERT_EQ("1,1,1", FilesPerLevel());
@@ -1506,6 +2070,285 @@ TEST(DBTest, ManualCompaction) {
   ASSERT_EQ("0,0,1", FilesPerLevel());
 }
 
+TEST(DBTest, Level0TriggerOptions) {
+  Options options = CurrentOptions();
+  options.max_mem_compaction_level = 0;
+  options.level0_file_num_compaction_trigger = 2;
+  Reopen(&options);
+
+  // Compacted memtables stay in level-0 until there are two of them
+  ASSERT_OK(Put("a", "va"));
+  ASSERT_OK(Put("z", "vz"));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_EQ("1", FilesPerLevel());
+  ASSERT_OK(Put("b", "vb"));
+  ASSERT_OK(Put("z", "vz2"));
+  dbfull()->TEST_CompactMemTable();
+  for (int i = 0; i < 100 && NumTableFilesAtLevel(0) > 0; i++) {
+    env_->SleepForMicroseconds(10000);
+  }
+  ASSERT_EQ("0,1", FilesPerLevel());
+  ASSERT_EQ("va", Get("a"));
+  ASSERT_EQ("vb", Get("b"));
+  ASSERT_EQ("vz2", Get("z"));
+
+  // Inconsistent triggers are raised to be in order
+  options.level0_slowdown_writes_trigger = 1;
+  options.level0_stop_writes_trigger = 0;
+  Reopen(&options);
+  ASSERT_EQ(2, dbfull()->TEST_Options().level0_slowdown_writes_trigger);
+  ASSERT_EQ(2, dbfull()->TEST_Options().level0_stop_writes_trigger);
+  ASSERT_OK(Put("c", "vc"));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_OK(Put("d", "vd"));
+  ASSERT_EQ("vc", Get("c"));
+  ASSERT_EQ("vd", Get("d"));
+
+  // Tiered compaction lets level-0 hold tiered_max_runs runs before writes
+  // slow down
+  options.compaction_style = kTieredCompaction;
+  options.tiered_max_runs = 4;
+  Reopen(&options);
+  ASSERT_EQ(5, dbfull()->TEST_Options().level0_slowdown_writes_trigger);
+  ASSERT_EQ(5, dbfull()->TEST_Options().level0_stop_writes_trigger);
+  ASSERT_EQ("vc", Get("c"));
+  ASSERT_EQ("vd", Get("d"));
+}
+
+TEST(DBTest, DynamicLevelBytes) {
+  Options options = CurrentOptions();
+  options.write_buffer_size = 100000;
+  options.max_file_size = 1 << 20;
+  options.max_bytes_for_level_base = 1 << 20;
+  options.max_bytes_for_level_multiplier = 2;
+  options.level_compaction_dynamic_level_bytes = true;
+  Reopen(&options);
+
+  Random rnd(301);
+  const int kNumKeys = 20000;
+  for (int pass = 0; pass < 3; pass++) {
+    for (int i = 0; i < kNumKeys; i++) {
+      ASSERT_OK(Put(Key(rnd.Uniform(kNumKeys)), RandomString(&rnd, 300)));
+    }
+  }
+  dbfull()->TEST_CompactMemTable();
+  for (int i = 0; i < 500 && NumTableFilesAtLevel(0) > 0; i++) {
+    env_->SleepForMicroseconds(10000);
+  }
+  env_->SleepForMicroseconds(100000);
+
+  int bottom = config::kNumLevels - 1;
+  while (bottom > 1 && NumTableFilesAtLevel(bottom) == 0) {
+    bottom--;
+  }
+  ASSERT_GT(bottom, 1);
+
+  // Each level above the bottom holds about half as much as the one
+  // below it, or max_bytes_for_level_base when that is larger.
+  double target = static_cast<double>(TotalBytesAtLevel(bottom));
+  for (int level = bottom - 1; level >= 1; level--) {
+    target /= options.max_bytes_for_level_multiplier;
+    const double limit = std::max(
+        target, static_cast<double>(options.max_bytes_for_level_base));
+    ASSERT_LE(TotalBytesAtLevel(level), limit + options.max_file_size)
+        << "level " << level << " of " << FilesPerLevel();
+  }
+}
+
+TEST(DBTest, TieredCompaction) {
+  Options options = CurrentOptions();
+  options.write_buffer_size = 100000;
+  options.compaction_style = kTieredCompaction;
+  options.level0_file_num_compaction_trigger = 3;
+  options.tiered_max_runs = 5;
+  Reopen(&options);
+
+  // Overwrite and delete keys across many memtables, so that merges of
+  // runs see several versions of them.
+  Random rnd(301);
+  std::map<std::string, std::string> expected;
+  for (int i = 0; i < 20000; i++) {
+    const std::string k = Key(rnd.Uniform(2000));
+    if (rnd.OneIn(4)) {
+      ASSERT_OK(Delete(k));
+      expected.erase(k);
+    } else {
+      const std::string v = RandomString(&rnd, 100);
+      ASSERT_OK(Put(k, v));
+      expected[k] = v;
+    }
+  }
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_OK(dbfull()->TEST_WaitForCompactions());
+
+  // Every sorted run stays in level-0, and merges keep their count down
+  const int runs = NumTableFilesAtLevel(0);
+  ASSERT_GT(runs, 0);
+  ASSERT_LE(runs, options.tiered_max_runs);
+  ASSERT_EQ(runs, TotalTableFiles());
+
+  for (int reopen = 0; reopen < 2; reopen++) {
+    for (int i = 0; i < 2000; i++) {
+      const std::string k = Key(i);
+      std::map<std::string, std::string>::const_iterator it =
+          expected.find(k);
+      ASSERT_EQ(it == expected.end() ? "NOT_FOUND" : it->second, Get(k));
+    }
+    std::string contents;
+    for (std::map<std::string, std::string>::const_iterator it =
+             expected.begin(); it != expected.end(); ++it) {
+      contents += "(" + it->first + "->" + it->second + ")";
+    }
+    ASSERT_EQ(contents, Contents());
+    Reopen(&options);
+  }
+}
+
+TEST(DBTest, TieredCompactionScore) {
+  Options options = CurrentOptions();
+  options.compaction_style = kTieredCompaction;
+  options.level0_file_num_compaction_trigger = 2;
+  options.tiered_max_runs = 6;
+  Reopen(&options);
+
+  // Runs that each hold four times less than the one before: past the
+  // trigger, but none of similar size and not too many
+  Random rnd(301);
+  int key = 0;
+  for (int entries = 64; entries >= 4; entries /= 4) {
+    for (int i = 0; i < entries; i++) {
+      ASSERT_OK(Put(Key(key++), RandomString(&rnd, 10000)));
+    }
+    dbfull()->TEST_CompactMemTable();
+  }
+  ASSERT_OK(dbfull()->TEST_WaitForCompactions());
+  ASSERT_EQ("3", FilesPerLevel());
+  ASSERT_TRUE(!dbfull()->TEST_NeedsCompaction());
+
+  // A run of the size of the newest one makes a window to merge
+  for (int i = 0; i < 4; i++) {
+    ASSERT_OK(Put(Key(key++), RandomString(&rnd, 10000)));
+  }
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_OK(dbfull()->TEST_WaitForCompactions());
+  ASSERT_EQ("3", FilesPerLevel());
+  ASSERT_TRUE(!dbfull()->TEST_NeedsCompaction());
+}
+
+TEST(DBTest, TieredToLevelCompaction) {
+  Options options = CurrentOptions();
+  options.compaction_style = kTieredCompaction;
+  options.level0_file_num_compaction_trigger = 3;
+  Reopen(&options);
+
+  // Two runs of similar size, then a much smaller newer one: only the two
+  // older runs are merged, into a file numbered after the newest run.
+  Random rnd(301);
+  for (int run = 0; run < 2; run++) {
+    for (int i = 0; i < 100; i++) {
+      ASSERT_OK(Put(Key(i), RandomString(&rnd, 1000)));
+    }
+    ASSERT_OK(Put("foo", run == 0 ? "v1" : "v2"));
+    ASSERT_OK(Put("bar", run == 0 ? "v1" : "v2"));
+    dbfull()->TEST_CompactMemTable();
+  }
+  ASSERT_EQ("2", FilesPerLevel());
+  ASSERT_OK(Put("foo", "v3"));
+  ASSERT_OK(Delete("bar"));
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_OK(dbfull()->TEST_WaitForCompactions());
+  ASSERT_EQ("2", FilesPerLevel());
+
+  for (int style = 0; style < 2; style++) {
+    ASSERT_EQ("v3", Get("foo"));
+    ASSERT_EQ("NOT_FOUND", Get("bar"));
+    options.compaction_style = kLevelCompaction;
+    Reopen(&options);
+  }
+}
+
+TEST(DBTest, TombstoneCompaction) {
+  for (int enabled = 0; enabled < 2; enabled++) {
+    Options options = CurrentOptions();
+    options.create_if_missing = true;
+    options.tombstone_compaction_percent = enabled ? 50 : 0;
+    DestroyAndReopen(&options);
+
+    // The keys end up in level 2, and the deletions of most of them in
+    // level 1, which is far from large enough to be compacted.
+    for (int i = 0; i < 1000; i++) {
+      ASSERT_OK(Put(Key(i), "value"));
+    }
+    dbfull()->TEST_CompactMemTable();
+    ASSERT_EQ("0,0,1", FilesPerLevel());
+    for (int i = 0; i < 900; i++) {
+      ASSERT_OK(Delete(Key(i)));
+    }
+    dbfull()->TEST_CompactMemTable();
+    for (int i = 0; i < 100 && NumTableFilesAtLevel(1) > 0; i++) {
+      env_->SleepForMicroseconds(10000);
+    }
+
+    std::string tombstones;
+    ASSERT_TRUE(db_->GetProperty("leveldb.tombstones", &tombstones));
+    if (enabled) {
+      // Merged into level 2, where the deleted keys are gone for good
+      ASSERT_EQ("0,0,1", FilesPerLevel());
+      ASSERT_EQ("2 ", tombstones.substr(0, 2));
+      ASSERT_TRUE(tombstones.find(" 100 0\n") != std::string::npos)
+          << tombstones;
+    } else {
+      ASSERT_EQ("0,1,1", FilesPerLevel());
+      ASSERT_TRUE(tombstones.find(" 900 900\n") != std::string::npos)
+          << tombstones;
+    }
+    ASSERT_EQ("NOT_FOUND", Get(Key(0)));
+    ASSERT_EQ("value", Get(Key(999)));
+
+    // The counts are only written to the MANIFEST when they are used,
+    // so that builds without them can still open the database.
+    Reopen(&options);
+    ASSERT_TRUE(db_->GetProperty("leveldb.tombstones", &tombstones));
+    if (enabled) {
+      ASSERT_TRUE(tombstones.find(" 100 0\n") != std::string::npos)
+          << tombstones;
+    } else {
+      ASSERT_TRUE(tombstones.find(" 900 900\n") == std::string::npos)
+          << tombstones;
+      ASSERT_TRUE(tombstones.find(" 0 0\n") != std::string::npos)
+          << tombstones;
+    }
+  }
+}
+
+TEST(DBTest, TombstoneCompactionWithNothingBelow) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.max_mem_compaction_level = 1;
+  options.tombstone_compaction_percent = 50;
+  DestroyAndReopen(&options);
+
+  // A level-1 file of mostly deletions, with no older data under it
+  for (int i = 0; i < 1000; i++) {
+    if (i < 900) {
+      ASSERT_OK(Delete(Key(i)));
+    } else {
+      ASSERT_OK(Put(Key(i), "value"));
+    }
+  }
+  dbfull()->TEST_CompactMemTable();
+  ASSERT_OK(dbfull()->TEST_WaitForCompactions());
+
+  // Merged into level 2 without the markers, instead of moved down
+  std::string tombstones;
+  ASSERT_TRUE(db_->GetProperty("leveldb.tombstones", &tombstones));
+  ASSERT_EQ("0,0,1", FilesPerLevel());
+  ASSERT_TRUE(tombstones.find(" 100 0\n") != std::string::npos)
+      << tombstones;
+  ASSERT_EQ("NOT_FOUND", Get(Key(0)));
+  ASSERT_EQ("value", Get(Key(999)));
+}
+
 TEST(DBTest, DBOpen_Options) {
   std::string dbname = test::TmpDir() + "/db_options_test";
   DestroyDB(dbname, Options());
@@ -1622,6 +2465,72 @@ TEST(DBTest, WriteSyncError) {
   ASSERT_EQ("NOT_FOUND", Get("k3"));
 }
 
+TEST(DBTest, SyncWAL) {
+  Options options = CurrentOptions();
+  options.env = env_;
+  Reopen(&options);
+
+  // Nothing to sync yet
+  env_->data_sync_counter_.Reset();
+  ASSERT_OK(db_->SyncWAL());
+  ASSERT_EQ(0, env_->data_sync_counter_.Read());
+
+  ASSERT_OK(Put("foo", "v1"));
+  ASSERT_OK(db_->SyncWAL());
+  ASSERT_EQ(1, env_->data_sync_counter_.Read());
+  ASSERT_OK(db_->SyncWAL());
+  ASSERT_EQ(1, env_->data_sync_counter_.Read());
+
+  // A sync write leaves nothing behind for SyncWAL()
+  WriteOptions w;
+  w.sync = true;
+  ASSERT_OK(db_->Put(w, "foo", "v2"));
+  env_->data_sync_counter_.Reset();
+  ASSERT_OK(db_->SyncWAL());
+  ASSERT_EQ(0, env_->data_sync_counter_.Read());
+
+  // A failed sync disallows future writes
+  ASSERT_OK(Put("foo", "v3"));
+  env_->data_sync_error_.Release_Store(env_);
+  ASSERT_TRUE(!db_->SyncWAL().ok());
+  env_->data_sync_error_.Release_Store(NULL);
+  ASSERT_TRUE(!Put("foo", "v4").ok());
+  ASSERT_EQ("v3", Get("foo"));
+}
+
+TEST(DBTest, PeriodicWALSync) {
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.wal_sync_interval_ms = 10;
+  Reopen(&options);
+
+  env_->data_sync_counter_.Reset();
+  ASSERT_OK(Put("foo", "v1"));
+  for (int i = 0; i < 100 && env_->data_sync_counter_.Read() == 0; i++) {
+    DelayMilliseconds(10);
+  }
+  ASSERT_GE(env_->data_sync_counter_.Read(), 1);
+
+  // Byte threshold alone
+  options.wal_sync_interval_ms = 0;
+  options.wal_sync_bytes = 1000;
+  Reopen(&options);
+  env_->data_sync_counter_.Reset();
+  ASSERT_OK(Put("foo", "v2"));
+  DelayMilliseconds(100);
+  ASSERT_EQ(0, env_->data_sync_counter_.Read());
+  ASSERT_OK(Put("bar", std::string(1000, 'x')));
+  for (int i = 0; i < 100 && env_->data_sync_counter_.Read() == 0; i++) {
+    DelayMilliseconds(10);
+  }
+  ASSERT_EQ(1, env_->data_sync_counter_.Read());
+
+  // Unsynced writes are synced on close
+  ASSERT_OK(Put("foo", "v3"));
+  Close();
+  ASSERT_EQ(2, env_->data_sync_counter_.Read());
+}
+
 TEST(DBTest, ManifestWriteError) {
   // Test for the following problem:
   // (a) Compaction produces file F
@@ -1648,7 +2557,7 @@ TEST(DBTest, ManifestWriteError) {
     // Memtable compaction (will succeed)
     dbfull()->TEST_CompactMemTable();
     ASSERT_EQ("bar", Get("foo"));
-    const int last = config::kMaxMemCompactLevel;
+    const int last = Options().max_mem_compaction_level;
     ASSERT_EQ(NumTableFilesAtLevel(last), 1);   // foo=>bar is now in last level
 
     // Merging compaction (will fail)
@@ -1755,6 +2664,127 @@ TEST(DBTest, BloomFilter) {
   delete options.filter_policy;
 }
 
+TEST(DBTest, FullTableFilter) {
+  env_->count_random_reads_ = true;
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.block_cache = NewLRUCache(0);  // Prevent cache hits
+  options.filter_policy = NewBloomFilterPolicy(10);
+  options.full_table_filter = true;
+  Reopen(&options);
+
+  const int N = 10000;
+  for (int i = 0; i < N; i++) {
+    ASSERT_OK(Put(Key(i), Key(i)));
+  }
+  Compact("a", "z");
+
+  // Prevent auto compactions triggered by seeks
+  env_->delay_data_sync_.Release_Store(env_);
+
+  env_->random_read_counter_.Reset();
+  for (int i = 0; i < N; i++) {
+    ASSERT_EQ("NOT_FOUND", Get(Key(i) + ".missing"));
+  }
+  int reads = env_->random_read_counter_.Read();
+  fprintf(stderr, "%d missing => %d reads\n", N, reads);
+  ASSERT_LE(reads, 2*N/100);
+
+  // Tables keep their filter format when the option changes
+  env_->delay_data_sync_.Release_Store(NULL);
+  options.full_table_filter = false;
+  Reopen(&options);
+  for (int i = 0; i < N; i += 100) {
+    ASSERT_OK(Put(Key(i), "v2"));
+  }
+  dbfull()->TEST_CompactMemTable();
+  env_->delay_data_sync_.Release_Store(env_);
+  env_->random_read_counter_.Reset();
+  for (int i = 0; i < N; i++) {
+    ASSERT_EQ(i % 100 == 0 ? "v2" : Key(i), Get(Key(i)));
+    ASSERT_EQ("NOT_FOUND", Get(Key(i) + ".missing"));
+  }
+  reads = env_->random_read_counter_.Read();
+  ASSERT_GE(reads, N);
+  ASSERT_LE(reads, N + 4*N/100);
+
+  env_->delay_data_sync_.Release_Store(NULL);
+  Close();
+  delete options.block_cache;
+  delete options.filter_policy;
+}
+
+namespace {
+std::string PrefixKey(int prefix, int i) {
+  char buf[100];
+  snprintf(buf, sizeof(buf), "p%04d/%03d", prefix, i);
+  return std::string(buf);
+}
+
+// Return the keys of "prefix" found by a prefix seek, "" if none
+std::string PrefixScan(DB* db, int prefix) {
+  const std::string p = PrefixKey(prefix, 0).substr(0, 6);
+  const Slice prefix_slice(p);
+  ReadOptions options;
+  options.prefix = &prefix_slice;
+  Iterator* iter = db->NewIterator(options);
+  std::string result;
+  for (iter->Seek(p); iter->Valid() && iter->key().starts_with(p);
+       iter->Next()) {
+    result += iter->key().ToString() + " ";
+  }
+  delete iter;
+  return result;
+}
+}  // namespace
+
+TEST(DBTest, PrefixSeek) {
+  env_->count_random_reads_ = true;
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.block_cache = NewLRUCache(0);  // Prevent cache hits
+  options.filter_policy = NewBloomFilterPolicy(10);
+  options.prefix_extractor = NewDelimiterPrefixTransform('/', 1);
+  Reopen(&options);
+
+  // Populate multiple layers with the even prefixes
+  const int kPrefixes = 200;
+  for (int p = 0; p < kPrefixes; p += 2) {
+    for (int i = 0; i < 10; i++) {
+      ASSERT_OK(Put(PrefixKey(p, i), std::string(100, 'v')));
+    }
+  }
+  Compact("a", "z");
+  for (int p = 0; p < kPrefixes; p += 20) {
+    ASSERT_OK(Put(PrefixKey(p, 10), "v"));
+  }
+  dbfull()->TEST_CompactMemTable();
+  env_->delay_data_sync_.Release_Store(env_);
+
+  for (int p = 0; p < kPrefixes; p += 2) {
+    std::string expected;
+    for (int i = 0; i < (p % 20 == 0 ? 11 : 10); i++) {
+      expected += PrefixKey(p, i) + " ";
+    }
+    ASSERT_EQ(expected, PrefixScan(db_, p));
+  }
+
+  // Missing prefixes rarely read a data block
+  env_->random_read_counter_.Reset();
+  for (int p = 1; p < kPrefixes; p += 2) {
+    ASSERT_EQ("", PrefixScan(db_, p));
+  }
+  int reads = env_->random_read_counter_.Read();
+  fprintf(stderr, "%d missing prefixes => %d reads\n", kPrefixes / 2, reads);
+  ASSERT_LE(reads, 2 * kPrefixes / 100 + 2);
+
+  env_->delay_data_sync_.Release_Store(NULL);
+  Close();
+  delete options.block_cache;
+  delete options.filter_policy;
+  delete options.prefix_extractor;
+}
+
 // Multi-threaded test:
 namespace {
 
@@ -1923,6 +2953,9 @@ class ModelDB: public DB {
   }
   virtual void CompactRange(const Slice* start, const Slice* end) {
   }
+  virtual Status SyncWAL() {
+    return Status::OK();
+  }
 
  private:
   class ModelIter: public Iterator {
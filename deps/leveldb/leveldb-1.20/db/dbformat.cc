@@ -3,6 +3,7 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 
 #include <stdio.h>
+#include <vector>
 #include "db/dbformat.h"
 #include "port/port.h"
 #include "util/coding.h"
@@ -111,7 +112,27 @@ void InternalFilterPolicy::CreateFilter(const Slice* keys, int n,
     mkey[i] = ExtractUserKey(keys[i]);
     // TODO(sanjay): Suppress dups?
   }
-  user_policy_->CreateFilter(keys, n, dst);
+  if (prefix_extractor_ == NULL || n == 0) {
+    user_policy_->CreateFilter(keys, n, dst);
+    return;
+  }
+
+  // Keys are sorted, so the keys of a prefix are adjacent
+  std::vector<Slice> entries(keys, keys + n);
+  Slice last_prefix;
+  bool has_prefix = false;
+  for (int i = 0; i < n; i++) {
+    if (prefix_extractor_->InDomain(keys[i])) {
+      Slice prefix = prefix_extractor_->Transform(keys[i]);
+      if (!has_prefix || prefix != last_prefix) {
+        entries.push_back(prefix);
+        last_prefix = prefix;
+        has_prefix = true;
+      }
+    }
+  }
+  user_policy_->CreateFilter(&entries[0], static_cast<int>(entries.size()),
+                             dst);
 }
 
 bool InternalFilterPolicy::KeyMayMatch(const Slice& key, const Slice& f) const {
@@ -10,6 +10,7 @@
 #include "leveldb/db.h"
 #include "leveldb/filter_policy.h"
 #include "leveldb/slice.h"
+#include "leveldb/slice_transform.h"
 #include "leveldb/table_builder.h"
 #include "util/coding.h"
 #include "util/logging.h"
@@ -21,22 +22,10 @@ namespace leveldb {
 namespace config {
 static const int kNumLevels = 7;
 
-// Level-0 compaction is started when we hit this many files.
-static const int kL0_CompactionTrigger = 4;
-
-// Soft limit on number of level-0 files.  We slow down writes at this point.
-static const int kL0_SlowdownWritesTrigger = 8;
-
-// Maximum number of level-0 files.  We stop writes at this point.
-static const int kL0_StopWritesTrigger = 12;
-
-// Maximum level to which a new compacted memtable is pushed if it
-// does not create overlap.  We try to push to level 2 to avoid the
-// relatively expensive level 0=>1 compactions and to avoid some
-// expensive manifest file operations.  We do not push all the way to
-// the largest level since that can generate a lot of wasted disk
-// space if the same key space is being repeatedly overwritten.
-static const int kMaxMemCompactLevel = 2;
+// The level-0 compaction and write throttling triggers, the maximum
+// level of compacted memtables and the sizes of the levels are set by
+// Options::level0_*_trigger, Options::max_mem_compaction_level and
+// Options::max_bytes_for_level_*.
 
 // Approximate gap in bytes between samples of data read during iteration.
 static const int kReadBytesPeriod = 1048576;
@@ -50,7 +39,9 @@ class InternalKey;
 // data structures.
 enum ValueType {
   kTypeDeletion = 0x0,
-  kTypeValue = 0x1
+  kTypeValue = 0x1,
+  kTypeValueWithExpiry = 0x2,
+  kTypeMerge = 0x3
 };
 // kValueTypeForSeek defines the ValueType that should be passed when
 // constructing a ParsedInternalKey object for seeking to a particular
@@ -58,7 +49,7 @@ enum ValueType {
 // and the value type is embedded as the low 8 bits in the sequence
 // number in internal keys, we need to use the highest-numbered
 // ValueType, not the lowest).
-static const ValueType kValueTypeForSeek = kTypeValue;
+static const ValueType kValueTypeForSeek = kTypeMerge;
 
 typedef uint64_t SequenceNumber;
 
@@ -127,12 +118,16 @@ class InternalKeyComparator : public Comparator {
   int Compare(const InternalKey& a, const InternalKey& b) const;
 };
 
-// Filter policy wrapper that converts from internal keys to user keys
+// Filter policy wrapper that converts from internal keys to user keys,
+// and adds the prefixes of the user keys when given a prefix extractor
 class InternalFilterPolicy : public FilterPolicy {
  private:
   const FilterPolicy* const user_policy_;
+  const SliceTransform* const prefix_extractor_;
  public:
-  explicit InternalFilterPolicy(const FilterPolicy* p) : user_policy_(p) { }
+  explicit InternalFilterPolicy(const FilterPolicy* p,
+                                const SliceTransform* prefix_extractor = NULL)
+      : user_policy_(p), prefix_extractor_(prefix_extractor) { }
   virtual const char* Name() const;
   virtual void CreateFilter(const Slice* keys, int n, std::string* dst) const;
   virtual bool KeyMayMatch(const Slice& key, const Slice& filter) const;
@@ -182,7 +177,24 @@ inline bool ParseInternalKey(const Slice& internal_key,
   result->sequence = num >> 8;
   result->type = static_cast<ValueType>(c);
   result->user_key = Slice(internal_key.data(), n - 8);
-  return (c <= static_cast<unsigned char>(kTypeValue));
+  return (c <= static_cast<unsigned char>(kTypeMerge));
+}
+
+// The value of a kTypeValueWithExpiry entry is the time at which it
+// expires, in microseconds since the epoch as returned by
+// Env::NowMicros(), encoded as a fixed64, followed by the user value.
+// Once expired, the entry reads as a deletion.
+static const size_t kExpiryLength = 8;
+
+inline bool IsExpired(const Slice& entry_value, uint64_t now_micros) {
+  return (entry_value.size() < kExpiryLength ||
+          DecodeFixed64(entry_value.data()) <= now_micros);
+}
+
+inline Slice ExtractExpiringValue(const Slice& entry_value) {
+  assert(entry_value.size() >= kExpiryLength);
+  return Slice(entry_value.data() + kExpiryLength,
+               entry_value.size() - kExpiryLength);
 }
 
 // A helper class useful for DBImpl::Get()
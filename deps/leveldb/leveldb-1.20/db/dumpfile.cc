@@ -85,6 +85,25 @@ class WriteBatchItemPrinter : public WriteBatch::Handler {
     r += "'\n";
     dst_->Append(r);
   }
+  virtual void PutWithExpiry(const Slice& key, const Slice& value,
+                             uint64_t expiry_micros) {
+    std::string r = "  put '";
+    AppendEscapedStringTo(&r, key);
+    r += "' '";
+    AppendEscapedStringTo(&r, value);
+    r += "' expiry ";
+    AppendNumberTo(&r, expiry_micros);
+    r += "\n";
+    dst_->Append(r);
+  }
+  virtual void Merge(const Slice& key, const Slice& value) {
+    std::string r = "  merge '";
+    AppendEscapedStringTo(&r, key);
+    r += "' '";
+    AppendEscapedStringTo(&r, value);
+    r += "'\n";
+    dst_->Append(r);
+  }
 };
 
 
@@ -185,6 +204,10 @@ Status DumpTable(Env* env, const std::string& fname, WritableFile* dst) {
         r += "del";
       } else if (key.type == kTypeValue) {
         r += "val";
+      } else if (key.type == kTypeValueWithExpiry) {
+        r += "exp";
+      } else if (key.type == kTypeMerge) {
+        r += "merge";
       } else {
         AppendNumberTo(&r, key.type);
       }
@@ -79,9 +79,14 @@ Iterator* MemTable::NewIterator() {
   return new MemTableIterator(&table_);
 }
 
-void MemTable::Add(SequenceNumber s, ValueType type,
-                   const Slice& key,
-                   const Slice& value) {
+size_t MemTable::EntryLength(const Slice& key, const Slice& value) {
+  size_t internal_key_size = key.size() + 8;
+  return VarintLength(internal_key_size) + internal_key_size +
+         VarintLength(value.size()) + value.size();
+}
+
+void MemTable::EncodeEntry(char* buf, SequenceNumber s, ValueType type,
+                           const Slice& key, const Slice& value) {
   // Format of an entry is concatenation of:
   //  key_size     : varint32 of internal_key.size()
   //  key bytes    : char[internal_key.size()]
@@ -90,10 +95,6 @@ void MemTable::Add(SequenceNumber s, ValueType type,
   size_t key_size = key.size();
   size_t val_size = value.size();
   size_t internal_key_size = key_size + 8;
-  const size_t encoded_len =
-      VarintLength(internal_key_size) + internal_key_size +
-      VarintLength(val_size) + val_size;
-  char* buf = arena_.Allocate(encoded_len);
   char* p = EncodeVarint32(buf, internal_key_size);
   memcpy(p, key.data(), key_size);
   p += key_size;
@@ -101,15 +102,31 @@ void MemTable::Add(SequenceNumber s, ValueType type,
   p += 8;
   p = EncodeVarint32(p, val_size);
   memcpy(p, value.data(), val_size);
-  assert((p + val_size) - buf == encoded_len);
+  assert((p + val_size) - buf == EntryLength(key, value));
+}
+
+void MemTable::Add(SequenceNumber s, ValueType type,
+                   const Slice& key,
+                   const Slice& value) {
+  char* buf = arena_.Allocate(EntryLength(key, value));
+  EncodeEntry(buf, s, type, key, value);
   table_.Insert(buf);
 }
 
-bool MemTable::Get(const LookupKey& key, std::string* value, Status* s) {
+void MemTable::AddConcurrently(SequenceNumber s, ValueType type,
+                               const Slice& key,
+                               const Slice& value) {
+  char* buf = arena_.AllocateConcurrently(EntryLength(key, value));
+  EncodeEntry(buf, s, type, key, value);
+  table_.InsertConcurrently(buf);
+}
+
+bool MemTable::Get(const LookupKey& key, std::string* value, Status* s,
+                   Env* clock, std::vector<std::string>* operands) {
   Slice memkey = key.memtable_key();
   Table::Iterator iter(&table_);
-  iter.Seek(memkey.data());
-  if (iter.Valid()) {
+  // Merge operands make us look at older entries for the key too
+  for (iter.Seek(memkey.data()); iter.Valid(); iter.Next()) {
     // entry format is:
     //    klength  varint32
     //    userkey  char[klength]
@@ -124,18 +141,34 @@ bool MemTable::Get(const LookupKey& key, std::string* value, Status* s) {
     const char* key_ptr = GetVarint32Ptr(entry, entry+5, &key_length);
     if (comparator_.comparator.user_comparator()->Compare(
             Slice(key_ptr, key_length - 8),
-            key.user_key()) == 0) {
-      // Correct user key
-      const uint64_t tag = DecodeFixed64(key_ptr + key_length - 8);
-      switch (static_cast<ValueType>(tag & 0xff)) {
-        case kTypeValue: {
-          Slice v = GetLengthPrefixedSlice(key_ptr + key_length);
+            key.user_key()) != 0) {
+      break;
+    }
+    // Correct user key
+    const uint64_t tag = DecodeFixed64(key_ptr + key_length - 8);
+    switch (static_cast<ValueType>(tag & 0xff)) {
+      case kTypeValue: {
+        Slice v = GetLengthPrefixedSlice(key_ptr + key_length);
+        value->assign(v.data(), v.size());
+        return true;
+      }
+      case kTypeValueWithExpiry: {
+        Slice v = GetLengthPrefixedSlice(key_ptr + key_length);
+        if (IsExpired(v, clock->NowMicros())) {
+          *s = Status::NotFound(Slice());
+        } else {
+          v = ExtractExpiringValue(v);
           value->assign(v.data(), v.size());
-          return true;
         }
-        case kTypeDeletion:
-          *s = Status::NotFound(Slice());
-          return true;
+        return true;
+      }
+      case kTypeDeletion:
+        *s = Status::NotFound(Slice());
+        return true;
+      case kTypeMerge: {
+        Slice v = GetLengthPrefixedSlice(key_ptr + key_length);
+        operands->push_back(v.ToString());
+        break;
       }
     }
   }
@@ -6,6 +6,7 @@
 #define STORAGE_LEVELDB_DB_MEMTABLE_H_
 
 #include <string>
+#include <vector>
 #include "leveldb/db.h"
 #include "db/dbformat.h"
 #include "db/skiplist.h"
@@ -13,6 +14,7 @@
 
 namespace leveldb {
 
+class Env;
 class InternalKeyComparator;
 class Mutex;
 class MemTableIterator;
@@ -54,15 +56,30 @@ class MemTable {
            const Slice& key,
            const Slice& value);
 
+  // Same as Add(), but may be called from several threads at the same
+  // time.  REQUIRES: no concurrent call of Add().
+  void AddConcurrently(SequenceNumber seq, ValueType type,
+                       const Slice& key,
+                       const Slice& value);
+
   // If memtable contains a value for key, store it in *value and return true.
-  // If memtable contains a deletion for key, store a NotFound() error
-  // in *status and return true.
+  // If memtable contains a deletion or an expired value for key, store a
+  // NotFound() error in *status and return true.  "clock" tells whether
+  // values with an expiry time have expired.
   // Else, return false.
-  bool Get(const LookupKey& key, std::string* value, Status* s);
+  // The merge operands found on the way, if any, are appended to
+  // *operands, newest first; they apply to the result.
+  bool Get(const LookupKey& key, std::string* value, Status* s, Env* clock,
+           std::vector<std::string>* operands);
 
  private:
   ~MemTable();  // Private since only Unref() should be used to delete it
 
+  // Encode an entry for Add() into "buf" of EntryLength() bytes.
+  static size_t EntryLength(const Slice& key, const Slice& value);
+  static void EncodeEntry(char* buf, SequenceNumber s, ValueType type,
+                          const Slice& key, const Slice& value);
+
   struct KeyComparator {
     const InternalKeyComparator comparator;
     explicit KeyComparator(const InternalKeyComparator& c) : comparator(c) { }
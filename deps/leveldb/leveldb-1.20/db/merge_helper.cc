@@ -0,0 +1,33 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "db/merge_helper.h"
+
+#include "leveldb/merge_operator.h"
+
+namespace leveldb {
+
+Status ApplyMergeOperands(const MergeOperator* op,
+                          const Slice& user_key,
+                          const Slice* base,
+                          const std::vector<std::string>& operands,
+                          std::string* result) {
+  if (op == NULL) {
+    return Status::NotSupported("merge operands without a merge operator");
+  }
+  std::vector<Slice> oldest_first;
+  oldest_first.reserve(operands.size());
+  for (size_t i = operands.size(); i > 0; i--) {
+    oldest_first.push_back(operands[i - 1]);
+  }
+  std::string merged;
+  if (!op->Merge(user_key, base, oldest_first, &merged)) {
+    return Status::Corruption("merge operands can not be applied",
+                              op->Name());
+  }
+  result->swap(merged);
+  return Status::OK();
+}
+
+}  // namespace leveldb
@@ -0,0 +1,29 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_DB_MERGE_HELPER_H_
+#define STORAGE_LEVELDB_DB_MERGE_HELPER_H_
+
+#include <string>
+#include <vector>
+#include "leveldb/slice.h"
+#include "leveldb/status.h"
+
+namespace leveldb {
+
+class MergeOperator;
+
+// Apply the merge "operands" found for "user_key", newest first as
+// lookups find them, to "base", which is NULL if the key has no value,
+// and store the result in *result.  "base" may point into *result.
+// Fails if "op" is NULL or can not apply the operands.
+extern Status ApplyMergeOperands(const MergeOperator* op,
+                                 const Slice& user_key,
+                                 const Slice* base,
+                                 const std::vector<std::string>& operands,
+                                 std::string* result);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_MERGE_HELPER_H_
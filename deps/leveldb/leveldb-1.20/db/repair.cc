@@ -224,7 +224,8 @@ class Repairer {
     FileMetaData meta;
     meta.number = next_file_number_++;
     Iterator* iter = mem->NewIterator();
-    status = BuildTable(dbname_, env_, options_, table_cache_, iter, &meta);
+    status = BuildTable(dbname_, env_, options_, table_cache_, iter, &meta,
+                        NULL);
     delete iter;
     mem->Unref();
     mem = NULL;
@@ -293,6 +294,9 @@ class Repairer {
       }
 
       counter++;
+      if (parsed.type == kTypeDeletion) {
+        t.meta.num_deletions++;
+      }
       if (empty) {
         empty = false;
         t.meta.smallest.DecodeFrom(key);
@@ -306,6 +310,7 @@ class Repairer {
       status = iter->status();
     }
     delete iter;
+    t.meta.num_entries = counter;
     Log(options_.info_log, "Table #%llu: %d entries %s",
         (unsigned long long) t.meta.number,
         counter,
@@ -394,9 +399,14 @@ class Repairer {
 
     for (size_t i = 0; i < tables_.size(); i++) {
       // TODO(opt): separate out into multiple levels
-      const TableInfo& t = tables_[i];
-      edit_.AddFile(0, t.meta.number, t.meta.file_size,
-                    t.meta.smallest, t.meta.largest);
+      // Salvaged tables may come from any level, so their numbers do not
+      // tell which holds the newer data
+      TableInfo t = tables_[i];
+      t.meta.merged_run = true;
+      edit_.AddFile(0, t.meta);
+    }
+    if (options_.tombstone_compaction_percent == 0) {
+      edit_.ClearFileCounts();
     }
 
     //fprintf(stderr, "NewDescriptor:\n%s\n", edit_.DebugString().c_str());
@@ -9,6 +9,8 @@
 // -------------
 //
 // Writes require external synchronization, most likely a mutex.
+// The exception is InsertConcurrently(), which may run in several
+// threads at once as long as no Insert() runs at the same time.
 // Reads require a guarantee that the SkipList will not be destroyed
 // while the read is in progress.  Apart from that, reads progress
 // without any internal locking or synchronization.
@@ -52,6 +54,13 @@ class SkipList {
   // REQUIRES: nothing that compares equal to key is currently in the list.
   void Insert(const Key& key);
 
+  // Like Insert(), but may be called from several threads at the same
+  // time.  Nodes are linked in with compare-and-swap, bottom level first,
+  // so concurrent readers see the same guarantees as with Insert().
+  // REQUIRES: no concurrent call of Insert()
+  // REQUIRES: nothing that compares equal to key is currently in the list.
+  void InsertConcurrently(const Key& key);
+
   // Returns true iff an entry that compares equal to key is in the list.
   bool Contains(const Key& key) const;
 
@@ -115,8 +124,13 @@ class SkipList {
   // Read/written only by Insert().
   Random rnd_;
 
+  // Random seed of InsertConcurrently(), advanced with compare-and-swap.
+  port::AtomicPointer concurrent_seed_;
+
   Node* NewNode(const Key& key, int height);
+  Node* NewNodeConcurrently(const Key& key, int height);
   int RandomHeight();
+  int RandomHeightConcurrently();
   bool Equal(const Key& a, const Key& b) const { return (compare_(a, b) == 0); }
 
   // Return true if key is greater than the data stored in "n"
@@ -129,6 +143,11 @@ class SkipList {
   // node at "level" for every level in [0..max_height_-1].
   Node* FindGreaterOrEqual(const Key& key, Node** prev) const;
 
+  // Starting at "before", which must be head_ or a node with a key < key,
+  // find the nodes *prev and *next at "level" between which key belongs.
+  void FindSpliceForLevel(const Key& key, Node* before, int level,
+                          Node** prev, Node** next) const;
+
   // Return the latest node with a key < key.
   // Return head_ if there is no such node.
   Node* FindLessThan(const Key& key) const;
@@ -174,6 +193,12 @@ struct SkipList<Key,Comparator>::Node {
     next_[n].NoBarrier_Store(x);
   }
 
+  // Link in "x" iff the "n"th next pointer is still "expected".
+  bool CASNext(int n, Node* expected, Node* x) {
+    assert(n >= 0);
+    return next_[n].CompareAndSwap(expected, x);
+  }
+
  private:
   // Array of length equal to the node height.  next_[0] is lowest level link.
   port::AtomicPointer next_[1];
@@ -187,6 +212,14 @@ SkipList<Key,Comparator>::NewNode(const Key& key, int height) {
   return new (mem) Node(key);
 }
 
+template<typename Key, class Comparator>
+typename SkipList<Key,Comparator>::Node*
+SkipList<Key,Comparator>::NewNodeConcurrently(const Key& key, int height) {
+  char* mem = arena_->AllocateAlignedConcurrently(
+      sizeof(Node) + sizeof(port::AtomicPointer) * (height - 1));
+  return new (mem) Node(key);
+}
+
 template<typename Key, class Comparator>
 inline SkipList<Key,Comparator>::Iterator::Iterator(const SkipList* list) {
   list_ = list;
@@ -252,6 +285,32 @@ int SkipList<Key,Comparator>::RandomHeight() {
   return height;
 }
 
+template<typename Key, class Comparator>
+int SkipList<Key,Comparator>::RandomHeightConcurrently() {
+  // Same distribution as RandomHeight(), but rnd_ is not thread-safe.
+  // Each call takes one step of a shared generator and uses two bits
+  // of the result per level (kMaxHeight * 2 < 31).
+  static const unsigned int kBranching = 4;
+  uint32_t bits;
+  while (true) {
+    void* seed = concurrent_seed_.NoBarrier_Load();
+    Random rnd(static_cast<uint32_t>(reinterpret_cast<uintptr_t>(seed)));
+    bits = rnd.Next();
+    if (concurrent_seed_.CompareAndSwap(
+            seed, reinterpret_cast<void*>(static_cast<uintptr_t>(bits)))) {
+      break;
+    }
+  }
+  int height = 1;
+  while (height < kMaxHeight && (bits % kBranching) == 0) {
+    height++;
+    bits /= kBranching;
+  }
+  assert(height > 0);
+  assert(height <= kMaxHeight);
+  return height;
+}
+
 template<typename Key, class Comparator>
 bool SkipList<Key,Comparator>::KeyIsAfterNode(const Key& key, Node* n) const {
   // NULL n is considered infinite
@@ -280,6 +339,23 @@ typename SkipList<Key,Comparator>::Node* SkipList<Key,Comparator>::FindGreaterOr
   }
 }
 
+template<typename Key, class Comparator>
+void SkipList<Key,Comparator>::FindSpliceForLevel(const Key& key,
+                                                  Node* before, int level,
+                                                  Node** prev,
+                                                  Node** next) const {
+  while (true) {
+    Node* after = before->Next(level);
+    if (KeyIsAfterNode(key, after)) {
+      before = after;
+    } else {
+      *prev = before;
+      *next = after;
+      return;
+    }
+  }
+}
+
 template<typename Key, class Comparator>
 typename SkipList<Key,Comparator>::Node*
 SkipList<Key,Comparator>::FindLessThan(const Key& key) const {
@@ -327,7 +403,8 @@ SkipList<Key,Comparator>::SkipList(Comparator cmp, Arena* arena)
       arena_(arena),
       head_(NewNode(0 /* any key will do */, kMaxHeight)),
       max_height_(reinterpret_cast<void*>(1)),
-      rnd_(0xdeadbeef) {
+      rnd_(0xdeadbeef),
+      concurrent_seed_(reinterpret_cast<void*>(0xdeadbeef)) {
   for (int i = 0; i < kMaxHeight; i++) {
     head_->SetNext(i, NULL);
   }
@@ -369,6 +446,47 @@ void SkipList<Key,Comparator>::Insert(const Key& key) {
   }
 }
 
+template<typename Key, class Comparator>
+void SkipList<Key,Comparator>::InsertConcurrently(const Key& key) {
+  const int height = RandomHeightConcurrently();
+
+  // Raise max_height_ if needed.  Readers treat the NULL links of head_
+  // at the new levels like Insert() explains.
+  int max_height = GetMaxHeight();
+  while (height > max_height) {
+    if (max_height_.CompareAndSwap(reinterpret_cast<void*>(max_height),
+                                   reinterpret_cast<void*>(height))) {
+      max_height = height;
+      break;
+    }
+    max_height = GetMaxHeight();
+  }
+
+  Node* prev[kMaxHeight];
+  Node* next[kMaxHeight];
+  Node* before = head_;
+  for (int i = max_height - 1; i >= 0; i--) {
+    FindSpliceForLevel(key, before, i, &prev[i], &next[i]);
+    before = prev[i];
+  }
+
+  // Our data structure does not allow duplicate insertion
+  assert(next[0] == NULL || !Equal(key, next[0]->key));
+
+  Node* x = NewNodeConcurrently(key, height);
+  for (int i = 0; i < height; i++) {
+    while (true) {
+      x->NoBarrier_SetNext(i, next[i]);
+      if (prev[i]->CASNext(i, next[i], x)) {
+        break;
+      }
+      // Another node was linked in after prev[i] meanwhile; since keys
+      // never move, the splice can only have moved forward.
+      FindSpliceForLevel(key, prev[i], i, &prev[i], &next[i]);
+    }
+  }
+}
+
 template<typename Key, class Comparator>
 bool SkipList<Key,Comparator>::Contains(const Key& key) const {
   Node* x = FindGreaterOrEqual(key, NULL);
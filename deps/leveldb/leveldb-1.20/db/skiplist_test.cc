@@ -371,6 +371,65 @@ TEST(SkipTest, Concurrent3) { RunConcurrent(3); }
 TEST(SkipTest, Concurrent4) { RunConcurrent(4); }
 TEST(SkipTest, Concurrent5) { RunConcurrent(5); }
 
+// Several threads calling InsertConcurrently() on disjoint keys
+struct ConcurrentInsertState {
+  static const int kThreads = 4;
+  static const int kKeysPerThread = 10000;
+
+  Arena arena;
+  SkipList<Key, Comparator> list;
+  port::Mutex mu;
+  port::CondVar cv;
+  int next_id;
+  int done;
+
+  ConcurrentInsertState()
+      : list(Comparator(), &arena), cv(&mu), next_id(0), done(0) { }
+};
+
+static void ConcurrentInserter(void* arg) {
+  ConcurrentInsertState* state = reinterpret_cast<ConcurrentInsertState*>(arg);
+  state->mu.Lock();
+  const int id = state->next_id++;
+  state->mu.Unlock();
+  for (int i = 0; i < ConcurrentInsertState::kKeysPerThread; i++) {
+    // Interleave the keys of the threads
+    state->list.InsertConcurrently(i * ConcurrentInsertState::kThreads + id);
+  }
+  state->mu.Lock();
+  state->done++;
+  state->cv.Signal();
+  state->mu.Unlock();
+}
+
+TEST(SkipTest, ConcurrentInsert) {
+  ConcurrentInsertState state;
+  for (int i = 0; i < ConcurrentInsertState::kThreads; i++) {
+    Env::Default()->StartThread(ConcurrentInserter, &state);
+  }
+  state.mu.Lock();
+  while (state.done < ConcurrentInsertState::kThreads) {
+    state.cv.Wait();
+  }
+  state.mu.Unlock();
+
+  // Every key must be linked in, in order
+  std::set<Key> seen;
+  SkipList<Key, Comparator>::Iterator iter(&state.list);
+  Key prev = 0;
+  for (iter.SeekToFirst(); iter.Valid(); iter.Next()) {
+    if (!seen.empty()) {
+      ASSERT_LT(prev, iter.key());
+    }
+    prev = iter.key();
+    seen.insert(iter.key());
+    ASSERT_TRUE(state.list.Contains(iter.key()));
+  }
+  ASSERT_EQ(ConcurrentInsertState::kThreads *
+            ConcurrentInsertState::kKeysPerThread,
+            static_cast<int>(seen.size()));
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
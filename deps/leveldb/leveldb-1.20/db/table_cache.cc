@@ -94,6 +94,15 @@ Iterator* TableCache::NewIterator(const ReadOptions& options,
   }
 
   Table* table = reinterpret_cast<TableAndFile*>(cache_->Value(handle))->table;
+  if (options.prefix != NULL) {
+    // Skip the table without reading any of its data blocks
+    InternalKey prefix_key(*options.prefix, kMaxSequenceNumber,
+                           kValueTypeForSeek);
+    if (!table->PrefixMayMatch(prefix_key.Encode())) {
+      cache_->Release(handle);
+      return NewEmptyIterator();
+    }
+  }
   Iterator* result = table->NewIterator(options);
   result->RegisterCleanup(&UnrefEntry, cache_, handle);
   if (tableptr != NULL) {
@@ -20,7 +20,9 @@ enum Tag {
   kDeletedFile          = 6,
   kNewFile              = 7,
   // 8 was used for large value refs
-  kPrevLogNumber        = 9
+  kPrevLogNumber        = 9,
+  kNewFileWithCounts    = 10,
+  kMergedRun            = 11
 };
 
 void VersionEdit::Clear() {
@@ -76,12 +78,20 @@ void VersionEdit::EncodeTo(std::string* dst) const {
 
   for (size_t i = 0; i < new_files_.size(); i++) {
     const FileMetaData& f = new_files_[i].second;
-    PutVarint32(dst, kNewFile);
+    PutVarint32(dst, f.num_entries > 0 ? kNewFileWithCounts : kNewFile);
     PutVarint32(dst, new_files_[i].first);  // level
     PutVarint64(dst, f.number);
     PutVarint64(dst, f.file_size);
     PutLengthPrefixedSlice(dst, f.smallest.Encode());
     PutLengthPrefixedSlice(dst, f.largest.Encode());
+    if (f.num_entries > 0) {
+      PutVarint64(dst, f.num_entries);
+      PutVarint64(dst, f.num_deletions);
+    }
+    if (f.merged_run) {
+      PutVarint32(dst, kMergedRun);
+      PutVarint64(dst, f.number);
+    }
   }
 }
 
@@ -192,6 +202,40 @@ Status VersionEdit::DecodeFrom(const Slice& src) {
         }
         break;
 
+      case kNewFileWithCounts:
+        if (GetLevel(&input, &level) &&
+            GetVarint64(&input, &f.number) &&
+            GetVarint64(&input, &f.file_size) &&
+            GetInternalKey(&input, &f.smallest) &&
+            GetInternalKey(&input, &f.largest) &&
+            GetVarint64(&input, &f.num_entries) &&
+            GetVarint64(&input, &f.num_deletions)) {
+          new_files_.push_back(std::make_pair(level, f));
+          f.num_entries = 0;
+          f.num_deletions = 0;
+        } else {
+          msg = "new-file entry";
+        }
+        break;
+
+      case kMergedRun: {
+        // Follows the entry of the file in the same edit
+        uint64_t number;
+        bool found = false;
+        if (GetVarint64(&input, &number)) {
+          for (size_t i = new_files_.size(); !found && i-- > 0; ) {
+            if (new_files_[i].second.number == number) {
+              new_files_[i].second.merged_run = true;
+              found = true;
+            }
+          }
+        }
+        if (!found) {
+          msg = "merged run entry";
+        }
+        break;
+      }
+
       default:
         msg = "unknown tag";
         break;
@@ -258,6 +302,9 @@ std::string VersionEdit::DebugString() const {
     r.append(f.smallest.DebugString());
     r.append(" .. ");
     r.append(f.largest.DebugString());
+    if (f.merged_run) {
+      r.append(" merged");
+    }
   }
   r.append("\n}\n");
   return r;
@@ -21,8 +21,16 @@ struct FileMetaData {
   uint64_t file_size;         // File size in bytes
   InternalKey smallest;       // Smallest internal key served by table
   InternalKey largest;        // Largest internal key served by table
-
-  FileMetaData() : refs(0), allowed_seeks(1 << 30), file_size(0) { }
+  bool being_compacted;       // Input of a running compaction
+  uint64_t num_entries;       // Entries in table, or 0 when not recorded
+  uint64_t num_deletions;     // Deletion markers among them
+  bool merged_run;            // Level-0 run written by a tiered merge,
+                              // whose number may be newer than its data
+
+  FileMetaData()
+      : refs(0), allowed_seeks(1 << 30), file_size(0),
+        being_compacted(false), num_entries(0), num_deletions(0),
+        merged_run(false) { }
 };
 
 class VersionEdit {
@@ -71,6 +79,25 @@ class VersionEdit {
     new_files_.push_back(std::make_pair(level, f));
   }
 
+  // Add the file described by "meta", along with its entry counts and
+  // whether it is a merged run, at the specified level.
+  // REQUIRES: This version has not been saved (see VersionSet::SaveTo)
+  void AddFile(int level, const FileMetaData& meta) {
+    AddFile(level, meta.number, meta.file_size, meta.smallest, meta.largest);
+    new_files_.back().second.num_entries = meta.num_entries;
+    new_files_.back().second.num_deletions = meta.num_deletions;
+    new_files_.back().second.merged_run = meta.merged_run;
+  }
+
+  // Encode the new files without their entry counts, which builds that
+  // predate them can not read.
+  void ClearFileCounts() {
+    for (size_t i = 0; i < new_files_.size(); i++) {
+      new_files_[i].second.num_entries = 0;
+      new_files_[i].second.num_deletions = 0;
+    }
+  }
+
   // Delete the specified "file" from the specified "level".
   void DeleteFile(int level, uint64_t file) {
     deleted_files_.insert(std::make_pair(level, file));
@@ -39,6 +39,52 @@ TEST(VersionEditTest, EncodeDecode) {
   TestEncodeDecode(edit);
 }
 
+TEST(VersionEditTest, EntryCounts) {
+  FileMetaData meta;
+  meta.number = 7;
+  meta.file_size = 1000;
+  meta.smallest = InternalKey("foo", 5, kTypeValue);
+  meta.largest = InternalKey("zoo", 6, kTypeDeletion);
+  meta.num_entries = 50;
+  meta.num_deletions = 20;
+
+  VersionEdit edit;
+  edit.AddFile(1, meta);
+  meta.number = 8;
+  meta.num_entries = 0;  // Not recorded
+  meta.num_deletions = 0;
+  edit.AddFile(2, meta);
+  // The counts are part of the encoding, so they survive the round trip
+  TestEncodeDecode(edit);
+}
+
+TEST(VersionEditTest, MergedRuns) {
+  FileMetaData meta;
+  meta.number = 7;
+  meta.file_size = 1000;
+  meta.smallest = InternalKey("foo", 5, kTypeValue);
+  meta.largest = InternalKey("zoo", 6, kTypeDeletion);
+  meta.merged_run = true;
+
+  VersionEdit edit;
+  edit.AddFile(0, meta);
+  meta.number = 8;
+  meta.merged_run = false;
+  edit.AddFile(0, meta);
+  TestEncodeDecode(edit);
+
+  std::string encoded;
+  edit.EncodeTo(&encoded);
+  VersionEdit parsed;
+  ASSERT_OK(parsed.DecodeFrom(encoded));
+  // Only the first file is marked as a merged run
+  const std::string debug = parsed.DebugString();
+  const size_t pos = debug.find(" merged");
+  ASSERT_TRUE(pos != std::string::npos);
+  ASSERT_TRUE(debug.find(" merged", pos + 1) == std::string::npos);
+  ASSERT_TRUE(debug.rfind(" 7 1000 ", pos) != std::string::npos);
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
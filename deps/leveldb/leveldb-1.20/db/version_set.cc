@@ -42,9 +42,9 @@ static double MaxBytesForLevel(const Options* options, int level) {
   // the level-0 compaction threshold based on number of files.
 
   // Result for both level-0 and level-1
-  double result = 10. * 1048576.0;
+  double result = static_cast<double>(options->max_bytes_for_level_base);
   while (level > 1) {
-    result *= 10;
+    result *= options->max_bytes_for_level_multiplier;
     level--;
   }
   return result;
@@ -257,12 +257,15 @@ enum SaverState {
   kFound,
   kDeleted,
   kCorrupt,
+  kMerge,
 };
 struct Saver {
   SaverState state;
   const Comparator* ucmp;
   Slice user_key;
   std::string* value;
+  SequenceNumber sequence;
+  Env* clock;
 };
 }
 static void SaveValue(void* arg, const Slice& ikey, const Slice& v) {
@@ -272,8 +275,19 @@ static void SaveValue(void* arg, const Slice& ikey, const Slice& v) {
     s->state = kCorrupt;
   } else {
     if (s->ucmp->Compare(parsed_key.user_key, s->user_key) == 0) {
-      s->state = (parsed_key.type == kTypeValue) ? kFound : kDeleted;
-      if (s->state == kFound) {
+      s->state = (parsed_key.type == kTypeDeletion) ? kDeleted : kFound;
+      s->sequence = parsed_key.sequence;
+      if (parsed_key.type == kTypeMerge) {
+        // The operands and what they apply to are read separately
+        s->state = kMerge;
+      } else if (parsed_key.type == kTypeValueWithExpiry) {
+        if (IsExpired(v, s->clock->NowMicros())) {
+          s->state = kDeleted;
+        } else {
+          Slice value = ExtractExpiringValue(v);
+          s->value->assign(value.data(), value.size());
+        }
+      } else if (s->state == kFound) {
         s->value->assign(v.data(), v.size());
       }
     }
@@ -329,10 +343,54 @@ void Version::ForEachOverlapping(Slice user_key, Slice internal_key,
   }
 }
 
+Status Version::GetMergeOperands(const ReadOptions& options,
+                                 const LookupKey& k,
+                                 std::string* value,
+                                 std::vector<std::string>* operands) {
+  std::vector<Iterator*> iters;
+  AddIterators(options, &iters);
+  Iterator* iter = NewMergingIterator(&vset_->icmp_,
+                                      iters.empty() ? NULL : &iters[0],
+                                      iters.size());
+  const Comparator* ucmp = vset_->icmp_.user_comparator();
+  Status s = Status::NotFound(Slice());
+  for (iter->Seek(k.internal_key()); iter->Valid(); iter->Next()) {
+    ParsedInternalKey ikey;
+    if (!ParseInternalKey(iter->key(), &ikey)) {
+      s = Status::Corruption("corrupted key for ", k.user_key());
+      break;
+    }
+    if (ucmp->Compare(ikey.user_key, k.user_key()) != 0) {
+      break;
+    }
+    Slice v = iter->value();
+    if (ikey.type == kTypeMerge) {
+      operands->push_back(v.ToString());
+      continue;
+    }
+    if (ikey.type == kTypeValueWithExpiry &&
+        !IsExpired(v, vset_->env_->NowMicros())) {
+      v = ExtractExpiringValue(v);
+      value->assign(v.data(), v.size());
+      s = Status::OK();
+    } else if (ikey.type == kTypeValue) {
+      value->assign(v.data(), v.size());
+      s = Status::OK();
+    }
+    break;
+  }
+  if (s.IsNotFound() && !iter->status().ok()) {
+    s = iter->status();
+  }
+  delete iter;
+  return s;
+}
+
 Status Version::Get(const ReadOptions& options,
                     const LookupKey& k,
                     std::string* value,
-                    GetStats* stats) {
+                    GetStats* stats,
+                    std::vector<std::string>* operands) {
   Slice ikey = k.internal_key();
   Slice user_key = k.user_key();
   const Comparator* ucmp = vset_->icmp_.user_comparator();
@@ -354,6 +412,15 @@ Status Version::Get(const ReadOptions& options,
 
     // Get the list of files to search in this level
     FileMetaData* const* files = &files_[level][0];
+    // Merges of sorted runs (kTieredCompaction) write level-0 files that
+    // are numbered newer than the data they hold, and such files stay
+    // behind when the database is reopened with another style.  While one
+    // of them overlaps user_key, every overlapping level-0 file has to be
+    // searched for the newest version of the key.
+    bool newest_by_sequence = false;
+    SaverState newest_state = kNotFound;
+    SequenceNumber newest_sequence = 0;
+    std::string newest_value;
     if (level == 0) {
       // Level-0 files may overlap each other.  Find all files that
       // overlap user_key and process them in order from newest to oldest.
@@ -363,6 +430,7 @@ Status Version::Get(const ReadOptions& options,
         if (ucmp->Compare(user_key, f->smallest.user_key()) >= 0 &&
             ucmp->Compare(user_key, f->largest.user_key()) <= 0) {
           tmp.push_back(f);
+          newest_by_sequence = newest_by_sequence || f->merged_run;
         }
       }
       if (tmp.empty()) continue;
@@ -404,12 +472,25 @@ Status Version::Get(const ReadOptions& options,
       saver.state = kNotFound;
       saver.ucmp = ucmp;
       saver.user_key = user_key;
-      saver.value = value;
+      saver.value = newest_by_sequence ? &newest_value : value;
+      saver.clock = vset_->env_;
       s = vset_->table_cache_->Get(options, f->number, f->file_size,
                                    ikey, &saver, SaveValue);
       if (!s.ok()) {
         return s;
       }
+      if (newest_by_sequence &&
+          (saver.state == kFound || saver.state == kDeleted ||
+           saver.state == kMerge)) {
+        if (newest_state == kNotFound || saver.sequence > newest_sequence) {
+          newest_state = saver.state;
+          newest_sequence = saver.sequence;
+          if (saver.state == kFound) {
+            value->swap(newest_value);
+          }
+        }
+        continue;
+      }
       switch (saver.state) {
         case kNotFound:
           break;      // Keep searching in other files
@@ -421,8 +502,17 @@ Status Version::Get(const ReadOptions& options,
         case kCorrupt:
           s = Status::Corruption("corrupted key for ", user_key);
           return s;
+        case kMerge:
+          return GetMergeOperands(options, k, value, operands);
       }
     }
+    if (newest_state == kFound) {
+      return s;
+    } else if (newest_state == kDeleted) {
+      return Status::NotFound(Slice());
+    } else if (newest_state == kMerge) {
+      return GetMergeOperands(options, k, value, operands);
+    }
   }
 
   return Status::NotFound(Slice());  // Use an empty error message for speed
@@ -430,7 +520,7 @@ Status Version::Get(const ReadOptions& options,
 
 bool Version::UpdateStats(const GetStats& stats) {
   FileMetaData* f = stats.seek_file;
-  if (f != NULL) {
+  if (f != NULL && vset_->options_->compaction_style != kTieredCompaction) {
     f->allowed_seeks--;
     if (f->allowed_seeks <= 0 && file_to_compact_ == NULL) {
       file_to_compact_ = f;
@@ -503,13 +593,15 @@ int Version::PickLevelForMemTableOutput(
     const Slice& smallest_user_key,
     const Slice& largest_user_key) {
   int level = 0;
-  if (!OverlapInLevel(0, &smallest_user_key, &largest_user_key)) {
+  if (vset_->options_->compaction_style == kTieredCompaction) {
+    // All sorted runs stay in level-0
+  } else if (!OverlapInLevel(0, &smallest_user_key, &largest_user_key)) {
     // Push to next level if there is no overlap in next level,
     // and the #bytes overlapping in the level after that are limited.
     InternalKey start(smallest_user_key, kMaxSequenceNumber, kValueTypeForSeek);
     InternalKey limit(largest_user_key, 0, static_cast<ValueType>(0));
     std::vector<FileMetaData*> overlaps;
-    while (level < config::kMaxMemCompactLevel) {
+    while (level < vset_->options_->max_mem_compaction_level) {
       if (OverlapInLevel(level + 1, &smallest_user_key, &largest_user_key)) {
         break;
       }
@@ -597,6 +689,26 @@ std::string Version::DebugString() const {
   return r;
 }
 
+std::string Version::TombstoneSummary() const {
+  std::string r;
+  for (int level = 0; level < config::kNumLevels; level++) {
+    // E.g.,
+    //   1 17 5000 4200
+    const std::vector<FileMetaData*>& files = files_[level];
+    for (size_t i = 0; i < files.size(); i++) {
+      AppendNumberTo(&r, level);
+      r.push_back(' ');
+      AppendNumberTo(&r, files[i]->number);
+      r.push_back(' ');
+      AppendNumberTo(&r, files[i]->num_entries);
+      r.push_back(' ');
+      AppendNumberTo(&r, files[i]->num_deletions);
+      r.push_back('\n');
+    }
+  }
+  return r;
+}
+
 // A helper class so we can efficiently apply a whole sequence
 // of edits to a particular state without creating intermediate
 // Versions that contain full copies of the intermediate state.
@@ -839,6 +951,11 @@ Status VersionSet::LogAndApply(VersionEdit* edit, port::Mutex* mu) {
     builder.SaveTo(v);
   }
   Finalize(v);
+  // The counts are only recorded for the tombstone compactions, and
+  // stay in memory for the "leveldb.tombstones" property.
+  if (options_->tombstone_compaction_percent == 0) {
+    edit->ClearFileCounts();
+  }
 
   // Initialize new descriptor log file if necessary by creating
   // a temporary file that contains a snapshot of the current version.
@@ -1061,11 +1178,82 @@ void VersionSet::MarkFileNumberUsed(uint64_t number) {
   }
 }
 
+static bool NewestRunFirst(FileMetaData* a, FileMetaData* b) {
+  return a->number > b->number;
+}
+
+// Pick the level-0 runs [*start, *limit) of "runs", sorted newest first,
+// that the next tiered compaction merges.  Returns false if it has
+// nothing to merge.
+static bool PickTieredRuns(const Options* options,
+                           const std::vector<FileMetaData*>& runs,
+                           size_t* start, size_t* limit) {
+  const int trigger = options->level0_file_num_compaction_trigger;
+  *start = *limit = 0;
+  if (static_cast<int>(runs.size()) < trigger) {
+    return false;
+  }
+
+  // Grow a window of runs from the newest one while the next older run
+  // is not much larger than all the runs in the window together.
+  for (size_t i = 0; i < runs.size() && *limit - *start < 2; i++) {
+    if (runs[i]->being_compacted) {
+      continue;
+    }
+    uint64_t window_bytes = runs[i]->file_size;
+    size_t j = i + 1;
+    for (; j < runs.size() && !runs[j]->being_compacted; j++) {
+      if (runs[j]->file_size * 100 >
+          window_bytes * (100 + options->tiered_size_ratio)) {
+        break;
+      }
+      window_bytes += runs[j]->file_size;
+    }
+    *start = i;
+    *limit = j;
+  }
+
+  // Too many runs of different sizes: merge the newest ones until the
+  // count is below the trigger again.
+  if (*limit - *start < 2 &&
+      static_cast<int>(runs.size()) > options->tiered_max_runs) {
+    const size_t want = runs.size() - trigger + 2;
+    for (*start = 0; *start < runs.size(); (*start)++) {
+      for (*limit = *start; *limit < runs.size() && *limit - *start < want &&
+                            !runs[*limit]->being_compacted; (*limit)++) {
+      }
+      if (*limit - *start >= 2) {
+        break;
+      }
+    }
+  }
+  return *limit - *start >= 2;
+}
+
 void VersionSet::Finalize(Version* v) {
   // Precomputed best level for next compaction
   int best_level = -1;
   double best_score = -1;
 
+  // With dynamic level bytes, the targets of the levels above the
+  // deepest non-empty one are derived from its actual size.
+  double max_bytes[config::kNumLevels];
+  for (int level = 0; level < config::kNumLevels; level++) {
+    max_bytes[level] = MaxBytesForLevel(options_, level);
+  }
+  if (options_->level_compaction_dynamic_level_bytes) {
+    int bottom = config::kNumLevels - 1;
+    while (bottom > 1 && v->files_[bottom].empty()) {
+      bottom--;
+    }
+    double target = static_cast<double>(TotalFileSize(v->files_[bottom]));
+    for (int level = bottom - 1; level >= 1; level--) {
+      target /= options_->max_bytes_for_level_multiplier;
+      max_bytes[level] = std::max(
+          target, static_cast<double>(options_->max_bytes_for_level_base));
+    }
+  }
+
   for (int level = 0; level < config::kNumLevels-1; level++) {
     double score;
     if (level == 0) {
@@ -1081,22 +1269,62 @@ void VersionSet::Finalize(Version* v) {
       // setting, or very high compression ratios, or lots of
       // overwrites/deletions).
       score = v->files_[level].size() /
-          static_cast<double>(config::kL0_CompactionTrigger);
+          static_cast<double>(options_->level0_file_num_compaction_trigger);
+      if (options_->compaction_style == kTieredCompaction) {
+        // Runs are only merged as PickTieredCompaction() would pick them
+        std::vector<FileMetaData*> runs = v->files_[level];
+        std::sort(runs.begin(), runs.end(), NewestRunFirst);
+        size_t start, limit;
+        if (!PickTieredRuns(options_, runs, &start, &limit)) {
+          score = 0;
+        }
+      }
+    } else if (options_->compaction_style == kTieredCompaction) {
+      // Only level-0 runs are merged; the deeper levels are only
+      // filled by CompactRange().
+      score = 0;
     } else {
       // Compute the ratio of current size to size limit.
       const uint64_t level_bytes = TotalFileSize(v->files_[level]);
       score =
-          static_cast<double>(level_bytes) / MaxBytesForLevel(options_, level);
+          static_cast<double>(level_bytes) / max_bytes[level];
     }
 
+    v->compaction_scores_[level] = score;
     if (score > best_score) {
       best_level = level;
       best_score = score;
     }
   }
+  v->compaction_scores_[config::kNumLevels-1] = 0;
 
   v->compaction_level_ = best_level;
   v->compaction_score_ = best_score;
+
+  // Look for the file most filled with deletion markers.  Level-0 files
+  // are compacted soon anyway, and files in the last level have nowhere
+  // to go.
+  v->tombstone_file_to_compact_ = NULL;
+  v->tombstone_file_to_compact_level_ = -1;
+  if (options_->tombstone_compaction_percent > 0 &&
+      options_->compaction_style == kLevelCompaction) {
+    double best_ratio = options_->tombstone_compaction_percent / 100.0;
+    for (int level = 1; level < config::kNumLevels-1; level++) {
+      for (size_t i = 0; i < v->files_[level].size(); i++) {
+        FileMetaData* f = v->files_[level][i];
+        if (f->num_entries == 0) {
+          continue;
+        }
+        const double ratio =
+            static_cast<double>(f->num_deletions) / f->num_entries;
+        if (ratio >= best_ratio) {
+          best_ratio = ratio;
+          v->tombstone_file_to_compact_ = f;
+          v->tombstone_file_to_compact_level_ = level;
+        }
+      }
+    }
+  }
 }
 
 Status VersionSet::WriteSnapshot(log::Writer* log) {
@@ -1120,9 +1348,12 @@ Status VersionSet::WriteSnapshot(log::Writer* log) {
     const std::vector<FileMetaData*>& files = current_->files_[level];
     for (size_t i = 0; i < files.size(); i++) {
       const FileMetaData* f = files[i];
-      edit.AddFile(level, f->number, f->file_size, f->smallest, f->largest);
+      edit.AddFile(level, *f);
     }
   }
+  if (options_->tombstone_compaction_percent == 0) {
+    edit.ClearFileCounts();
+  }
 
   std::string record;
   edit.EncodeTo(&record);
@@ -1288,46 +1519,127 @@ Iterator* VersionSet::MakeInputIterator(Compaction* c) {
   return result;
 }
 
+static bool AnyBeingCompacted(const std::vector<FileMetaData*>& files) {
+  for (size_t i = 0; i < files.size(); i++) {
+    if (files[i]->being_compacted) {
+      return true;
+    }
+  }
+  return false;
+}
+
 Compaction* VersionSet::PickCompaction() {
-  Compaction* c;
-  int level;
+  if (options_->compaction_style == kTieredCompaction) {
+    return PickTieredCompaction();
+  }
+
+  Compaction* c = NULL;
 
   // We prefer compactions triggered by too much data in a level over
-  // the compactions triggered by seeks.
-  const bool size_compaction = (current_->compaction_score_ >= 1);
-  const bool seek_compaction = (current_->file_to_compact_ != NULL);
-  if (size_compaction) {
-    level = current_->compaction_level_;
-    assert(level >= 0);
-    assert(level+1 < config::kNumLevels);
-    c = new Compaction(options_, level);
-
-    // Pick the first file that comes after compact_pointer_[level]
-    for (size_t i = 0; i < current_->files_[level].size(); i++) {
-      FileMetaData* f = current_->files_[level][i];
-      if (compact_pointer_[level].empty() ||
-          icmp_.Compare(f->largest.Encode(), compact_pointer_[level]) > 0) {
-        c->inputs_[0].push_back(f);
-        break;
-      }
+  // the compactions triggered by seeks.  Levels are tried from the
+  // highest score down, since the best one may be busy with compactions
+  // that are already running.
+  int levels[config::kNumLevels - 1];
+  for (int i = 0; i < config::kNumLevels - 1; i++) {
+    int j = i;
+    for (; j > 0 && current_->compaction_scores_[levels[j-1]] <
+                    current_->compaction_scores_[i]; j--) {
+      levels[j] = levels[j-1];
     }
-    if (c->inputs_[0].empty()) {
-      // Wrap-around to the beginning of the key space
-      c->inputs_[0].push_back(current_->files_[level][0]);
+    levels[j] = i;
+  }
+  for (int i = 0; c == NULL && i < config::kNumLevels - 1; i++) {
+    if (current_->compaction_scores_[levels[i]] < 1) {
+      break;
     }
-  } else if (seek_compaction) {
-    level = current_->file_to_compact_level_;
-    c = new Compaction(options_, level);
-    c->inputs_[0].push_back(current_->file_to_compact_);
-  } else {
+    c = PickSizeCompaction(levels[i]);
+  }
+
+  FileMetaData* f = current_->file_to_compact_;
+  if (c == NULL && f != NULL && !f->being_compacted) {
+    c = new Compaction(options_, current_->file_to_compact_level_);
+    c->inputs_[0].push_back(f);
+    if (!SetupInputs(c)) {
+      delete c;
+      c = NULL;
+    }
+  }
+
+  // Push deletion markers down to the data they delete, so that reads
+  // over a deleted range stop skipping them.
+  f = current_->tombstone_file_to_compact_;
+  if (c == NULL && f != NULL && !f->being_compacted) {
+    c = new Compaction(options_, current_->tombstone_file_to_compact_level_);
+    c->drops_tombstones_ = true;
+    c->inputs_[0].push_back(f);
+    if (!SetupInputs(c)) {
+      delete c;
+      c = NULL;
+    }
+  }
+
+  return c;
+}
+
+Compaction* VersionSet::PickSizeCompaction(int level) {
+  const std::vector<FileMetaData*>& files = current_->files_[level];
+
+  // Pick the first file that comes after compact_pointer_[level],
+  // wrapping around to the beginning of the key space.  Skip the ones
+  // that conflict with running compactions.
+  size_t start = 0;
+  while (start < files.size() && !compact_pointer_[level].empty() &&
+         icmp_.Compare(files[start]->largest.Encode(),
+                       compact_pointer_[level]) <= 0) {
+    start++;
+  }
+  for (size_t i = 0; i < files.size(); i++) {
+    FileMetaData* f = files[(start + i) % files.size()];
+    if (f->being_compacted) {
+      continue;
+    }
+    Compaction* c = new Compaction(options_, level);
+    c->inputs_[0].push_back(f);
+    if (SetupInputs(c)) {
+      return c;
+    }
+    delete c;
+  }
+  return NULL;
+}
+
+Compaction* VersionSet::PickTieredCompaction() {
+  std::vector<FileMetaData*> runs = current_->files_[0];
+  std::sort(runs.begin(), runs.end(), NewestRunFirst);
+  size_t start, limit;
+  if (!PickTieredRuns(options_, runs, &start, &limit)) {
     return NULL;
   }
 
+  Compaction* c = new Compaction(options_, 0);
+  c->output_level_ = 0;
+  // A merged run is a single file, however large
+  c->max_output_file_size_ = ~static_cast<uint64_t>(0);
+  c->inputs_[0].assign(runs.begin() + start, runs.begin() + limit);
+  c->covers_level0_ = (limit - start == runs.size());
+  c->input_version_ = current_;
+  c->input_version_->Ref();
+  c->MarkInputsBeingCompacted(true);
+  return c;
+}
+
+bool VersionSet::SetupInputs(Compaction* c) {
+  const int level = c->level();
+  assert(level >= 0);
+  assert(level+1 < config::kNumLevels);
   c->input_version_ = current_;
   c->input_version_->Ref();
 
   // Files in level 0 may overlap each other, so pick up all overlapping ones
   if (level == 0) {
+    if (AnyBeingCompacted(current_->files_[0])) {
+      return false;
+    }
     InternalKey smallest, largest;
     GetRange(c->inputs_[0], &smallest, &largest);
     // Note that the next call will discard the file we placed in
@@ -1338,8 +1650,20 @@ Compaction* VersionSet::PickCompaction() {
   }
 
   SetupOtherInputs(c);
+  if (AnyBeingCompacted(c->inputs_[0]) || AnyBeingCompacted(c->inputs_[1])) {
+    return false;
+  }
+  c->MarkInputsBeingCompacted(true);
 
-  return c;
+  // Update the place where we will do the next compaction for this level.
+  // We update this immediately instead of waiting for the VersionEdit
+  // to be applied so that if the compaction fails, we will try a different
+  // key range next time.
+  InternalKey smallest, largest;
+  GetRange(c->inputs_[0], &smallest, &largest);
+  compact_pointer_[level] = largest.Encode().ToString();
+  c->edit_.SetCompactPointer(level, largest);
+  return true;
 }
 
 void VersionSet::SetupOtherInputs(Compaction* c) {
@@ -1363,7 +1687,8 @@ void VersionSet::SetupOtherInputs(Compaction* c) {
     const int64_t expanded0_size = TotalFileSize(expanded0);
     if (expanded0.size() > c->inputs_[0].size() &&
         inputs1_size + expanded0_size <
-            ExpandedCompactionByteSizeLimit(options_)) {
+            ExpandedCompactionByteSizeLimit(options_) &&
+        !AnyBeingCompacted(expanded0)) {
       InternalKey new_start, new_limit;
       GetRange(expanded0, &new_start, &new_limit);
       std::vector<FileMetaData*> expanded1;
@@ -1401,13 +1726,6 @@ void VersionSet::SetupOtherInputs(Compaction* c) {
         smallest.DebugString().c_str(),
         largest.DebugString().c_str());
   }
-
-  // Update the place where we will do the next compaction for this level.
-  // We update this immediately instead of waiting for the VersionEdit
-  // to be applied so that if the compaction fails, we will try a different
-  // key range next time.
-  compact_pointer_[level] = largest.Encode().ToString();
-  c->edit_.SetCompactPointer(level, largest);
 }
 
 Compaction* VersionSet::CompactRange(
@@ -1438,37 +1756,58 @@ Compaction* VersionSet::CompactRange(
   }
 
   Compaction* c = new Compaction(options_, level);
-  c->input_version_ = current_;
-  c->input_version_->Ref();
   c->inputs_[0] = inputs;
-  SetupOtherInputs(c);
+  if (!SetupInputs(c)) {
+    delete c;
+    return NULL;
+  }
   return c;
 }
 
 Compaction::Compaction(const Options* options, int level)
     : level_(level),
+      output_level_(level + 1),
       max_output_file_size_(MaxFileSizeForLevel(options, level)),
       input_version_(NULL),
-      grandparent_index_(0),
-      seen_key_(false),
-      overlapped_bytes_(0) {
+      marked_(false),
+      covers_level0_(false),
+      drops_tombstones_(false) {
+}
+
+Compaction::Cursor::Cursor()
+    : grandparent_index(0),
+      seen_key(false),
+      overlapped_bytes(0) {
   for (int i = 0; i < config::kNumLevels; i++) {
-    level_ptrs_[i] = 0;
+    level_ptrs[i] = 0;
   }
 }
 
 Compaction::~Compaction() {
   if (input_version_ != NULL) {
+    MarkInputsBeingCompacted(false);
     input_version_->Unref();
   }
 }
 
+void Compaction::MarkInputsBeingCompacted(bool being_compacted) {
+  if (marked_ == being_compacted) return;
+  marked_ = being_compacted;
+  for (int which = 0; which < 2; which++) {
+    for (size_t i = 0; i < inputs_[which].size(); i++) {
+      inputs_[which][i]->being_compacted = being_compacted;
+    }
+  }
+}
+
 bool Compaction::IsTrivialMove() const {
   const VersionSet* vset = input_version_->vset_;
   // Avoid a move if there is lots of overlapping grandparent data.
   // Otherwise, the move could create a parent file that will require
-  // a very expensive merge later on.
-  return (num_input_files(0) == 1 && num_input_files(1) == 0 &&
+  // a very expensive merge later on.  A file picked for its deletion
+  // markers is always merged, since a move would keep them all.
+  return (output_level_ != level_ && !drops_tombstones_ &&
+          num_input_files(0) == 1 && num_input_files(1) == 0 &&
           TotalFileSize(grandparents_) <=
               MaxGrandParentOverlapBytes(vset->options_));
 }
@@ -1481,13 +1820,23 @@ void Compaction::AddInputDeletions(VersionEdit* edit) {
   }
 }
 
-bool Compaction::IsBaseLevelForKey(const Slice& user_key) {
+bool Compaction::IsBaseLevelForKey(const Slice& user_key,
+                                   Cursor* cursor) const {
   // Maybe use binary search to find right entry instead of linear search?
   const Comparator* user_cmp = input_version_->vset_->icmp_.user_comparator();
-  for (int lvl = level_ + 2; lvl < config::kNumLevels; lvl++) {
+  int first_level = level_ + 2;
+  if (output_level_ == level_) {
+    // The level-0 runs left out of the merge may hold older versions
+    if (!covers_level0_) {
+      return false;
+    }
+    first_level = level_ + 1;
+  }
+  for (int lvl = first_level; lvl < config::kNumLevels; lvl++) {
     const std::vector<FileMetaData*>& files = input_version_->files_[lvl];
-    for (; level_ptrs_[lvl] < files.size(); ) {
-      FileMetaData* f = files[level_ptrs_[lvl]];
+    size_t& ptr = cursor->level_ptrs[lvl];
+    for (; ptr < files.size(); ) {
+      FileMetaData* f = files[ptr];
       if (user_cmp->Compare(user_key, f->largest.user_key()) <= 0) {
         // We've advanced far enough
         if (user_cmp->Compare(user_key, f->smallest.user_key()) >= 0) {
@@ -1496,37 +1845,86 @@ bool Compaction::IsBaseLevelForKey(const Slice& user_key) {
         }
         break;
       }
-      level_ptrs_[lvl]++;
+      ptr++;
     }
   }
   return true;
 }
 
-bool Compaction::ShouldStopBefore(const Slice& internal_key) {
+bool Compaction::ShouldStopBefore(const Slice& internal_key,
+                                  Cursor* cursor) const {
   const VersionSet* vset = input_version_->vset_;
   // Scan to find earliest grandparent file that contains key.
   const InternalKeyComparator* icmp = &vset->icmp_;
-  while (grandparent_index_ < grandparents_.size() &&
+  while (cursor->grandparent_index < grandparents_.size() &&
       icmp->Compare(internal_key,
-                    grandparents_[grandparent_index_]->largest.Encode()) > 0) {
-    if (seen_key_) {
-      overlapped_bytes_ += grandparents_[grandparent_index_]->file_size;
+                    grandparents_[cursor->grandparent_index]->largest.Encode())
+      > 0) {
+    if (cursor->seen_key) {
+      cursor->overlapped_bytes +=
+          grandparents_[cursor->grandparent_index]->file_size;
     }
-    grandparent_index_++;
+    cursor->grandparent_index++;
   }
-  seen_key_ = true;
+  cursor->seen_key = true;
 
-  if (overlapped_bytes_ > MaxGrandParentOverlapBytes(vset->options_)) {
+  if (cursor->overlapped_bytes > MaxGrandParentOverlapBytes(vset->options_)) {
     // Too much overlap for current output; start new output
-    overlapped_bytes_ = 0;
+    cursor->overlapped_bytes = 0;
     return true;
   } else {
     return false;
   }
 }
 
+namespace {
+struct UserKeyLess {
+  const Comparator* user_cmp;
+  explicit UserKeyLess(const Comparator* c) : user_cmp(c) { }
+  bool operator()(const Slice& a, const Slice& b) const {
+    return user_cmp->Compare(a, b) < 0;
+  }
+};
+}  // namespace
+
+void Compaction::GetSubcompactionBoundaries(
+    int n, std::vector<std::string>* boundaries) const {
+  boundaries->clear();
+  if (n <= 1 || output_level_ == level_) {
+    // A merge of level-0 runs must write a single run
+    return;
+  }
+
+  // Every input file ends at a user key that no other part of the
+  // compaction needs to see, except for the versions of that same key
+  // in other files.  Boundaries are inclusive, so those stay together.
+  const Comparator* user_cmp = input_version_->vset_->icmp_.user_comparator();
+  std::vector<Slice> ends;
+  for (int which = 0; which < 2; which++) {
+    for (size_t i = 0; i < inputs_[which].size(); i++) {
+      ends.push_back(inputs_[which][i]->largest.user_key());
+    }
+  }
+  std::sort(ends.begin(), ends.end(), UserKeyLess(user_cmp));
+
+  // The largest end needs no boundary: the last part is unbounded.
+  for (int i = 1; i < n; i++) {
+    const size_t index = ends.size() * i / n;
+    if (index == 0 || index >= ends.size() ||
+        user_cmp->Compare(ends[index - 1], ends.back()) == 0) {
+      continue;
+    }
+    const Slice& key = ends[index - 1];
+    if (boundaries->empty() ||
+        user_cmp->Compare(boundaries->back(), key) < 0) {
+      boundaries->push_back(key.ToString());
+    }
+  }
+}
+
 void Compaction::ReleaseInputs() {
   if (input_version_ != NULL) {
+    MarkInputsBeingCompacted(false);
     input_version_->Unref();
     input_version_ = NULL;
   }
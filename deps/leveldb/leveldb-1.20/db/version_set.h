@@ -64,14 +64,16 @@ class Version {
   void AddIterators(const ReadOptions&, std::vector<Iterator*>* iters);
 
   // Lookup the value for key.  If found, store it in *val and
-  // return OK.  Else return a non-OK status.  Fills *stats.
+  // return OK.  Else return a non-OK status.  Fills *stats.  The merge
+  // operands found on the way, if any, are appended to *operands,
+  // newest first; they apply to the result.
   // REQUIRES: lock is not held
   struct GetStats {
     FileMetaData* seek_file;
     int seek_file_level;
   };
   Status Get(const ReadOptions&, const LookupKey& key, std::string* val,
-             GetStats* stats);
+             GetStats* stats, std::vector<std::string>* operands);
 
   // Adds "stats" into the current state.  Returns true if a new
   // compaction may need to be triggered, false otherwise.
@@ -113,6 +115,11 @@ class Version {
   // Return a human readable string that describes this version's contents.
   std::string DebugString() const;
 
+  // Return one line per table file holding its level, number, number of
+  // entries and number of deletion markers, separated by spaces.  Counts
+  // are 0 for files written before they were recorded.
+  std::string TombstoneSummary() const;
+
  private:
   friend class Compaction;
   friend class VersionSet;
@@ -120,6 +127,14 @@ class Version {
   class LevelFileNumIterator;
   Iterator* NewConcatenatingIterator(const ReadOptions&, int level) const;
 
+  // Get() of a key whose newest entry is a merge operand.  Reads the
+  // entries of the key through iterators over all files, which see them
+  // in order of sequence numbers even when merges of sorted runs wrote
+  // level-0 files out of order.
+  Status GetMergeOperands(const ReadOptions& options, const LookupKey& key,
+                          std::string* val,
+                          std::vector<std::string>* operands);
+
   // Call func(arg, level, f) for every file that overlaps user_key in
   // order from newest to oldest.  If an invocation of func returns
   // false, makes no more calls.
@@ -147,12 +162,23 @@ class Version {
   double compaction_score_;
   int compaction_level_;
 
+  // Compaction score of every level, also initialized by Finalize().
+  double compaction_scores_[config::kNumLevels];
+
+  // File whose share of deletion markers is the highest one above
+  // Options::tombstone_compaction_percent, or NULL.  Also initialized
+  // by Finalize().
+  FileMetaData* tombstone_file_to_compact_;
+  int tombstone_file_to_compact_level_;
+
   explicit Version(VersionSet* vset)
       : vset_(vset), next_(this), prev_(this), refs_(0),
         file_to_compact_(NULL),
         file_to_compact_level_(-1),
         compaction_score_(-1),
-        compaction_level_(-1) {
+        compaction_level_(-1),
+        tombstone_file_to_compact_(NULL),
+        tombstone_file_to_compact_level_(-1) {
   }
 
   ~Version();
@@ -228,12 +254,17 @@ class VersionSet {
   // Returns NULL if there is no compaction to be done.
   // Otherwise returns a pointer to a heap-allocated object that
   // describes the compaction.  Caller should delete the result.
+  //
+  // The inputs of the result are flagged as being compacted until it is
+  // deleted or its inputs are released, and are never picked by another
+  // compaction meanwhile, so non-overlapping compactions may run
+  // concurrently.  Only one compaction out of level-0 runs at a time.
   Compaction* PickCompaction();
 
   // Return a compaction object for compacting the range [begin,end] in
   // the specified level.  Returns NULL if there is nothing in that
-  // level that overlaps the specified range.  Caller should delete
-  // the result.
+  // level that overlaps the specified range, or if some of the files
+  // involved are being compacted.  Caller should delete the result.
   Compaction* CompactRange(
       int level,
       const InternalKey* begin,
@@ -250,7 +281,8 @@ class VersionSet {
   // Returns true iff some level needs a compaction.
   bool NeedsCompaction() const {
     Version* v = current_;
-    return (v->compaction_score_ >= 1) || (v->file_to_compact_ != NULL);
+    return (v->compaction_score_ >= 1) || (v->file_to_compact_ != NULL) ||
+           (v->tombstone_file_to_compact_ != NULL);
   }
 
   // Add all files listed in any live version to *live.
@@ -289,6 +321,19 @@ class VersionSet {
 
   void SetupOtherInputs(Compaction* c);
 
+  // Size compaction of "level" that starts after compact_pointer_[level]
+  // and does not conflict with running compactions, or NULL.
+  Compaction* PickSizeCompaction(int level);
+
+  // Merge of sorted runs in level-0 picked by the kTieredCompaction
+  // rules that does not conflict with running compactions, or NULL.
+  Compaction* PickTieredCompaction();
+
+  // Complete the inputs of "c" from its first files in "level", flag
+  // them as being compacted and advance compact_pointer_.  Returns false
+  // without flagging anything if one of them is already being compacted.
+  bool SetupInputs(Compaction* c);
+
   // Save current contents to *log
   Status WriteSnapshot(log::Writer* log);
 
@@ -329,6 +374,10 @@ class Compaction {
   // and "level+1" will be merged to produce a set of "level+1" files.
   int level() const { return level_; }
 
+  // Return the level the merged files are written to: "level+1", or
+  // "level" itself for a merge of level-0 sorted runs (kTieredCompaction).
+  int output_level() const { return output_level_; }
+
   // Return the object that holds the edits to the descriptor done
   // by this compaction.
   VersionEdit* edit() { return &edit_; }
@@ -349,14 +398,45 @@ class Compaction {
   // Add all inputs to this compaction as delete operations to *edit.
   void AddInputDeletions(VersionEdit* edit);
 
+  // Position of a pass over the keys of the compaction, in increasing
+  // order, kept by IsBaseLevelForKey() and ShouldStopBefore().  Passes
+  // over disjoint key ranges of the same compaction (subcompactions)
+  // each use their own cursor.
+  struct Cursor {
+    // State used to check for number of of overlapping grandparent files
+    // (parent == level_ + 1, grandparent == level_ + 2)
+    size_t grandparent_index;  // Index in grandparents_
+    bool seen_key;             // Some output key has been seen
+    int64_t overlapped_bytes;  // Bytes of overlap between current output
+                               // and grandparent files
+
+    // State for implementing IsBaseLevelForKey
+
+    // level_ptrs holds indices into input_version_->levels_: our state
+    // is that we are positioned at one of the file ranges for each
+    // higher level than the ones involved in this compaction (i.e. for
+    // all L >= level_ + 2).
+    size_t level_ptrs[config::kNumLevels];
+
+    Cursor();
+  };
+
   // Returns true if the information we have available guarantees that
   // the compaction is producing data in "level+1" for which no data exists
-  // in levels greater than "level+1".
-  bool IsBaseLevelForKey(const Slice& user_key);
+  // in levels greater than "level+1".  For a merge of level-0 runs, no
+  // older data may exist in the other runs or in any level below.
+  bool IsBaseLevelForKey(const Slice& user_key, Cursor* cursor) const;
 
   // Returns true iff we should stop building the current output
   // before processing "internal_key".
-  bool ShouldStopBefore(const Slice& internal_key);
+  bool ShouldStopBefore(const Slice& internal_key, Cursor* cursor) const;
+
+  // Store in *boundaries up to "n" - 1 user keys, in increasing order,
+  // that split the key range of the inputs into "n" parts of about the
+  // same number of input files.  Part i holds the user keys greater
+  // than (*boundaries)[i-1] and no greater than (*boundaries)[i].
+  void GetSubcompactionBoundaries(int n,
+                                  std::vector<std::string>* boundaries) const;
 
   // Release the input version for the compaction, once the compaction
   // is successful.
@@ -368,29 +448,23 @@ class Compaction {
 
   Compaction(const Options* options, int level);
 
+  void MarkInputsBeingCompacted(bool being_compacted);
+
   int level_;
+  int output_level_;
   uint64_t max_output_file_size_;
   Version* input_version_;
   VersionEdit edit_;
 
   // Each compaction reads inputs from "level_" and "level_+1"
   std::vector<FileMetaData*> inputs_[2];      // The two sets of inputs
+  bool marked_;               // Inputs are flagged as being compacted
+  bool covers_level0_;        // Merge of level-0 runs that takes them all
+  bool drops_tombstones_;     // Picked for its deletion markers
 
-  // State used to check for number of of overlapping grandparent files
-  // (parent == level_ + 1, grandparent == level_ + 2)
+  // Grandparent files (parent == level_ + 1, grandparent == level_ + 2)
+  // overlapping the compaction
   std::vector<FileMetaData*> grandparents_;
-  size_t grandparent_index_;  // Index in grandparent_starts_
-  bool seen_key_;             // Some output key has been seen
-  int64_t overlapped_bytes_;  // Bytes of overlap between current output
-                              // and grandparent files
-
-  // State for implementing IsBaseLevelForKey
-
-  // level_ptrs_ holds indices into input_version_->levels_: our state
-  // is that we are positioned at one of the file ranges for each
-  // higher level than the ones involved in this compaction (i.e. for
-  // all L >= level_ + 2).
-  size_t level_ptrs_[config::kNumLevels];
 };
 
 }  // namespace leveldb
@@ -8,7 +8,11 @@
 //    data: record[count]
 // record :=
 //    kTypeValue varstring varstring         |
-//    kTypeDeletion varstring
+//    kTypeDeletion varstring                |
+//    kTypeValueWithExpiry varstring varstring |
+//    kTypeMerge varstring varstring
+// where the value of kTypeValueWithExpiry starts with the fixed64 expiry
+// time, as in the memtable and the tables.
 // varstring :=
 //    len: varint32
 //    data: uint8[len]
@@ -34,6 +38,14 @@ WriteBatch::~WriteBatch() { }
 
 WriteBatch::Handler::~Handler() { }
 
+void WriteBatch::Handler::PutWithExpiry(const Slice& key, const Slice& value,
+                                        uint64_t expiry_micros) {
+  Put(key, value);
+}
+
+void WriteBatch::Handler::Merge(const Slice& key, const Slice& value) {
+}
+
 void WriteBatch::Clear() {
   rep_.clear();
   rep_.resize(kHeader);
@@ -68,6 +80,24 @@ Status WriteBatch::Iterate(Handler* handler) const {
           return Status::Corruption("bad WriteBatch Delete");
         }
         break;
+      case kTypeValueWithExpiry:
+        if (GetLengthPrefixedSlice(&input, &key) &&
+            GetLengthPrefixedSlice(&input, &value) &&
+            value.size() >= kExpiryLength) {
+          handler->PutWithExpiry(key, ExtractExpiringValue(value),
+                                 DecodeFixed64(value.data()));
+        } else {
+          return Status::Corruption("bad WriteBatch PutWithExpiry");
+        }
+        break;
+      case kTypeMerge:
+        if (GetLengthPrefixedSlice(&input, &key) &&
+            GetLengthPrefixedSlice(&input, &value)) {
+          handler->Merge(key, value);
+        } else {
+          return Status::Corruption("bad WriteBatch Merge");
+        }
+        break;
       default:
         return Status::Corruption("unknown WriteBatch tag");
     }
@@ -102,24 +132,62 @@ void WriteBatch::Put(const Slice& key, const Slice& value) {
   PutLengthPrefixedSlice(&rep_, value);
 }
 
+void WriteBatch::PutWithExpiry(const Slice& key, const Slice& value,
+                               uint64_t expiry_micros) {
+  WriteBatchInternal::SetCount(this, WriteBatchInternal::Count(this) + 1);
+  rep_.push_back(static_cast<char>(kTypeValueWithExpiry));
+  PutLengthPrefixedSlice(&rep_, key);
+  PutVarint32(&rep_, kExpiryLength + value.size());
+  PutFixed64(&rep_, expiry_micros);
+  rep_.append(value.data(), value.size());
+}
+
 void WriteBatch::Delete(const Slice& key) {
   WriteBatchInternal::SetCount(this, WriteBatchInternal::Count(this) + 1);
   rep_.push_back(static_cast<char>(kTypeDeletion));
   PutLengthPrefixedSlice(&rep_, key);
 }
 
+void WriteBatch::Merge(const Slice& key, const Slice& value) {
+  WriteBatchInternal::SetCount(this, WriteBatchInternal::Count(this) + 1);
+  rep_.push_back(static_cast<char>(kTypeMerge));
+  PutLengthPrefixedSlice(&rep_, key);
+  PutLengthPrefixedSlice(&rep_, value);
+}
+
 namespace {
 class MemTableInserter : public WriteBatch::Handler {
  public:
   SequenceNumber sequence_;
   MemTable* mem_;
+  bool concurrently_;
 
   virtual void Put(const Slice& key, const Slice& value) {
-    mem_->Add(sequence_, kTypeValue, key, value);
-    sequence_++;
+    Add(kTypeValue, key, value);
   }
   virtual void Delete(const Slice& key) {
-    mem_->Add(sequence_, kTypeDeletion, key, Slice());
+    Add(kTypeDeletion, key, Slice());
+  }
+  virtual void PutWithExpiry(const Slice& key, const Slice& value,
+                             uint64_t expiry_micros) {
+    scratch_.clear();
+    PutFixed64(&scratch_, expiry_micros);
+    scratch_.append(value.data(), value.size());
+    Add(kTypeValueWithExpiry, key, scratch_);
+  }
+  virtual void Merge(const Slice& key, const Slice& value) {
+    Add(kTypeMerge, key, value);
+  }
+
+ private:
+  std::string scratch_;
+
+  void Add(ValueType type, const Slice& key, const Slice& value) {
+    if (concurrently_) {
+      mem_->AddConcurrently(sequence_, type, key, value);
+    } else {
+      mem_->Add(sequence_, type, key, value);
+    }
     sequence_++;
   }
 };
@@ -130,6 +198,16 @@ Status WriteBatchInternal::InsertInto(const WriteBatch* b,
   MemTableInserter inserter;
   inserter.sequence_ = WriteBatchInternal::Sequence(b);
   inserter.mem_ = memtable;
+  inserter.concurrently_ = false;
+  return b->Iterate(&inserter);
+}
+
+Status WriteBatchInternal::InsertIntoConcurrently(const WriteBatch* b,
+                                                  MemTable* memtable) {
+  MemTableInserter inserter;
+  inserter.sequence_ = WriteBatchInternal::Sequence(b);
+  inserter.mem_ = memtable;
+  inserter.concurrently_ = true;
   return b->Iterate(&inserter);
 }
 
@@ -41,6 +41,11 @@ class WriteBatchInternal {
 
   static Status InsertInto(const WriteBatch* batch, MemTable* memtable);
 
+  // Like InsertInto(), but other batches may be inserted into the same
+  // memtable at the same time with this function.
+  static Status InsertIntoConcurrently(const WriteBatch* batch,
+                                       MemTable* memtable);
+
   static void Append(WriteBatch* dst, const WriteBatch* src);
 };
 
@@ -32,6 +32,24 @@ static std::string PrintContents(WriteBatch* b) {
         state.append(")");
         count++;
         break;
+      case kTypeValueWithExpiry:
+        state.append("PutWithExpiry(");
+        state.append(ikey.user_key.ToString());
+        state.append(", ");
+        state.append(ExtractExpiringValue(iter->value()).ToString());
+        state.append(", ");
+        state.append(NumberToString(DecodeFixed64(iter->value().data())));
+        state.append(")");
+        count++;
+        break;
+      case kTypeMerge:
+        state.append("Merge(");
+        state.append(ikey.user_key.ToString());
+        state.append(", ");
+        state.append(iter->value().ToString());
+        state.append(")");
+        count++;
+        break;
       case kTypeDeletion:
         state.append("Delete(");
         state.append(ikey.user_key.ToString());
@@ -74,6 +92,30 @@ TEST(WriteBatchTest, Multiple) {
             PrintContents(&batch));
 }
 
+TEST(WriteBatchTest, PutWithExpiry) {
+  WriteBatch batch;
+  batch.PutWithExpiry(Slice("foo"), Slice("bar"), 12345);
+  batch.Put(Slice("baz"), Slice("boo"));
+  WriteBatchInternal::SetSequence(&batch, 200);
+  ASSERT_EQ(2, WriteBatchInternal::Count(&batch));
+  ASSERT_EQ("Put(baz, boo)@201"
+            "PutWithExpiry(foo, bar, 12345)@200",
+            PrintContents(&batch));
+}
+
+TEST(WriteBatchTest, Merge) {
+  WriteBatch batch;
+  batch.Merge(Slice("foo"), Slice("1"));
+  batch.Put(Slice("baz"), Slice("boo"));
+  batch.Merge(Slice("foo"), Slice("2"));
+  WriteBatchInternal::SetSequence(&batch, 300);
+  ASSERT_EQ(3, WriteBatchInternal::Count(&batch));
+  ASSERT_EQ("Put(baz, boo)@301"
+            "Merge(foo, 2)@302"
+            "Merge(foo, 1)@300",
+            PrintContents(&batch));
+}
+
 TEST(WriteBatchTest, Corruption) {
   WriteBatch batch;
   batch.Put(Slice("foo"), Slice("bar"));
@@ -0,0 +1,406 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// The index is a skiplist of entries copied into an arena:
+//    key_size     : varint32 of key.size()
+//    key bytes    : char[key.size()]
+//    update       : fixed32 of the number of the update in the batch
+//    type         : char, kTypeValue or kTypeDeletion
+//    value_size   : varint32 of value.size()
+//    value bytes  : char[value.size()]
+// Entries are ordered by key and then by decreasing update number, so
+// the first entry of a key holds its newest update.
+
+#include "leveldb/write_batch_with_index.h"
+
+#include "db/dbformat.h"
+#include "db/skiplist.h"
+#include "leveldb/db.h"
+#include "leveldb/iterator.h"
+#include "leveldb/write_batch.h"
+#include "util/arena.h"
+#include "util/coding.h"
+
+namespace leveldb {
+
+namespace {
+
+Slice GetLengthPrefixedSlice(const char* data) {
+  uint32_t len;
+  const char* p = data;
+  p = GetVarint32Ptr(p, p + 5, &len);  // +5: we assume "p" is not corrupted
+  return Slice(p, len);
+}
+
+struct IndexComparator {
+  const Comparator* user_comparator;
+  explicit IndexComparator(const Comparator* c) : user_comparator(c) { }
+  int operator()(const char* a, const char* b) const {
+    Slice akey = GetLengthPrefixedSlice(a);
+    Slice bkey = GetLengthPrefixedSlice(b);
+    int r = user_comparator->Compare(akey, bkey);
+    if (r == 0) {
+      const uint32_t anum = DecodeFixed32(akey.data() + akey.size());
+      const uint32_t bnum = DecodeFixed32(bkey.data() + bkey.size());
+      if (anum > bnum) {
+        r = -1;
+      } else if (anum < bnum) {
+        r = +1;
+      }
+    }
+    return r;
+  }
+};
+
+typedef SkipList<const char*, IndexComparator> Index;
+
+// Encode the key of an index lookup that sorts before every entry of
+// "key" into *buf
+const char* EncodeLookupKey(const Slice& key, std::string* buf) {
+  buf->clear();
+  PutLengthPrefixedSlice(buf, key);
+  PutFixed32(buf, 0xffffffffu);
+  return buf->data();
+}
+
+}  // namespace
+
+// The batch and its index, shared with the iterators created from them
+struct IndexedUpdates {
+  WriteBatch batch;
+  Arena arena;
+  Index index;
+  uint32_t updates;
+  int refs;
+
+  explicit IndexedUpdates(const Comparator* c)
+      : index(IndexComparator(c), &arena), updates(0), refs(1) { }
+
+  void Ref() { ++refs; }
+  void Unref() {
+    --refs;
+    assert(refs >= 0);
+    if (refs <= 0) {
+      delete this;
+    }
+  }
+
+  void Add(ValueType type, const Slice& key, const Slice& value) {
+    const size_t encoded_len =
+        VarintLength(key.size()) + key.size() + 4 + 1 +
+        VarintLength(value.size()) + value.size();
+    char* buf = arena.Allocate(encoded_len);
+    char* p = EncodeVarint32(buf, key.size());
+    memcpy(p, key.data(), key.size());
+    p += key.size();
+    EncodeFixed32(p, updates++);
+    p += 4;
+    *p++ = static_cast<char>(type);
+    p = EncodeVarint32(p, value.size());
+    memcpy(p, value.data(), value.size());
+    assert(p + value.size() == buf + encoded_len);
+    index.Insert(buf);
+  }
+};
+
+namespace {
+
+// Decoded index entry
+struct Update {
+  Slice key;
+  ValueType type;
+  Slice value;
+
+  explicit Update(const char* entry) {
+    key = GetLengthPrefixedSlice(entry);
+    const char* p = key.data() + key.size() + 4;
+    type = static_cast<ValueType>(*p++);
+    uint32_t value_size;
+    p = GetVarint32Ptr(p, p + 5, &value_size);
+    value = Slice(p, value_size);
+  }
+};
+
+// Iterates over the newest update of every key in the index
+class UpdateIterator {
+ public:
+  UpdateIterator(const Index* index, const Comparator* comparator)
+      : iter_(index), comparator_(comparator) { }
+
+  bool Valid() const { return iter_.Valid(); }
+  Update current() const { return Update(iter_.key()); }
+
+  void SeekToFirst() { iter_.SeekToFirst(); }
+
+  void SeekToLast() {
+    iter_.SeekToLast();
+    if (iter_.Valid()) {
+      // Move to the newest update of the last key
+      SeekToNewest(Update(iter_.key()).key);
+    }
+  }
+
+  void Seek(const Slice& target) {
+    iter_.Seek(EncodeLookupKey(target, &tmp_));
+  }
+
+  void Next() {
+    assert(Valid());
+    const Slice key = Update(iter_.key()).key;
+    do {
+      iter_.Next();
+    } while (iter_.Valid() &&
+             comparator_->Compare(Update(iter_.key()).key, key) == 0);
+  }
+
+  void Prev() {
+    assert(Valid());
+    iter_.Prev();
+    if (iter_.Valid()) {
+      SeekToNewest(Update(iter_.key()).key);
+    }
+  }
+
+ private:
+  void SeekToNewest(const Slice& key) {
+    // "key" points into the arena, which outlives the lookup
+    iter_.Seek(EncodeLookupKey(key, &tmp_));
+  }
+
+  Index::Iterator iter_;
+  const Comparator* const comparator_;
+  std::string tmp_;
+};
+
+// Merges the updates of a batch into the entries of a base iterator.
+// The batch wins for keys found in both, and its deletions hide keys.
+class BaseWithUpdatesIterator : public Iterator {
+ public:
+  BaseWithUpdatesIterator(Iterator* base, const Comparator* comparator,
+                          IndexedUpdates* rep)
+      : base_(base),
+        updates_(&rep->index, comparator),
+        comparator_(comparator),
+        rep_(rep),
+        forward_(true),
+        current_at_base_(true),
+        equal_keys_(false) {
+    rep_->Ref();
+  }
+
+  virtual ~BaseWithUpdatesIterator() {
+    delete base_;
+    rep_->Unref();
+  }
+
+  virtual bool Valid() const {
+    return current_at_base_ ? base_->Valid() : updates_.Valid();
+  }
+
+  virtual void SeekToFirst() {
+    forward_ = true;
+    base_->SeekToFirst();
+    updates_.SeekToFirst();
+    UpdateCurrent();
+  }
+
+  virtual void SeekToLast() {
+    forward_ = false;
+    base_->SeekToLast();
+    updates_.SeekToLast();
+    UpdateCurrent();
+  }
+
+  virtual void Seek(const Slice& target) {
+    forward_ = true;
+    base_->Seek(target);
+    updates_.Seek(target);
+    UpdateCurrent();
+  }
+
+  virtual void Next() {
+    assert(Valid());
+    if (!forward_) {
+      // Position both children at or after key()
+      const std::string target = key().ToString();
+      Seek(target);
+    }
+    Advance();
+  }
+
+  virtual void Prev() {
+    assert(Valid());
+    if (forward_) {
+      // Position both children at or before key()
+      const std::string target = key().ToString();
+      forward_ = false;
+      base_->Seek(target);
+      if (!base_->Valid()) {
+        base_->SeekToLast();
+      } else if (comparator_->Compare(base_->key(), target) > 0) {
+        base_->Prev();
+      }
+      updates_.Seek(target);
+      if (!updates_.Valid()) {
+        updates_.SeekToLast();
+      } else if (comparator_->Compare(updates_.current().key, target) > 0) {
+        updates_.Prev();
+      }
+      UpdateCurrent();
+    }
+    Advance();
+  }
+
+  virtual Slice key() const {
+    return current_at_base_ ? base_->key() : updates_.current().key;
+  }
+
+  virtual Slice value() const {
+    return current_at_base_ ? base_->value() : updates_.current().value;
+  }
+
+  virtual Status status() const {
+    return base_->status();
+  }
+
+ private:
+  // Move past the current entry in the current direction
+  void Advance() {
+    if (equal_keys_ || current_at_base_) {
+      Step(base_);
+    }
+    if (equal_keys_ || !current_at_base_) {
+      StepUpdates();
+    }
+    UpdateCurrent();
+  }
+
+  void Step(Iterator* iter) {
+    if (forward_) {
+      iter->Next();
+    } else {
+      iter->Prev();
+    }
+  }
+
+  void StepUpdates() {
+    if (forward_) {
+      updates_.Next();
+    } else {
+      updates_.Prev();
+    }
+  }
+
+  // Pick the child that holds the entry to return, skipping the keys
+  // deleted by the batch
+  void UpdateCurrent() {
+    while (true) {
+      equal_keys_ = false;
+      if (!updates_.Valid()) {
+        current_at_base_ = true;
+        return;
+      }
+      const Update update = updates_.current();
+      int r = -1;
+      if (base_->Valid()) {
+        r = comparator_->Compare(update.key, base_->key());
+        if (!forward_) {
+          r = -r;
+        }
+      }
+      if (r > 0) {
+        current_at_base_ = true;
+        return;
+      }
+      equal_keys_ = (r == 0);
+      if (update.type != kTypeDeletion) {
+        current_at_base_ = false;
+        return;
+      }
+      if (equal_keys_) {
+        Step(base_);
+      }
+      StepUpdates();
+    }
+  }
+
+  Iterator* const base_;
+  UpdateIterator updates_;
+  const Comparator* const comparator_;
+  IndexedUpdates* const rep_;
+  bool forward_;
+  bool current_at_base_;
+  bool equal_keys_;
+};
+
+}  // namespace
+
+WriteBatchWithIndex::WriteBatchWithIndex(const Comparator* comparator)
+    : rep_(new IndexedUpdates(comparator)),
+      comparator_(comparator) {
+}
+
+WriteBatchWithIndex::~WriteBatchWithIndex() {
+  rep_->Unref();
+}
+
+void WriteBatchWithIndex::Put(const Slice& key, const Slice& value) {
+  rep_->batch.Put(key, value);
+  rep_->Add(kTypeValue, key, value);
+}
+
+void WriteBatchWithIndex::Delete(const Slice& key) {
+  rep_->batch.Delete(key);
+  rep_->Add(kTypeDeletion, key, Slice());
+}
+
+void WriteBatchWithIndex::Clear() {
+  // Live iterators hold a reference to the old updates
+  rep_->Unref();
+  rep_ = new IndexedUpdates(comparator_);
+}
+
+int WriteBatchWithIndex::Count() const {
+  return rep_->updates;
+}
+
+WriteBatch* WriteBatchWithIndex::GetWriteBatch() {
+  return &rep_->batch;
+}
+
+bool WriteBatchWithIndex::GetFromBatch(const Slice& key, std::string* value,
+                                       bool* deleted) const {
+  Index::Iterator iter(&rep_->index);
+  std::string tmp;
+  iter.Seek(EncodeLookupKey(key, &tmp));
+  if (!iter.Valid()) {
+    return false;
+  }
+  const Update update(iter.key());
+  if (comparator_->Compare(update.key, key) != 0) {
+    return false;
+  }
+  *deleted = (update.type == kTypeDeletion);
+  if (!*deleted) {
+    value->assign(update.value.data(), update.value.size());
+  }
+  return true;
+}
+
+Status WriteBatchWithIndex::GetFromBatchAndDB(DB* db,
+                                              const ReadOptions& options,
+                                              const Slice& key,
+                                              std::string* value) const {
+  bool deleted;
+  if (GetFromBatch(key, value, &deleted)) {
+    return deleted ? Status::NotFound(Slice()) : Status::OK();
+  }
+  return db->Get(options, key, value);
+}
+
+Iterator* WriteBatchWithIndex::NewIteratorWithBase(Iterator* base) const {
+  return new BaseWithUpdatesIterator(base, comparator_, rep_);
+}
+
+}  // namespace leveldb
@@ -0,0 +1,229 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/write_batch_with_index.h"
+
+#include <map>
+#include "db/write_batch_internal.h"
+#include "leveldb/db.h"
+#include "leveldb/iterator.h"
+#include "leveldb/write_batch.h"
+#include "util/random.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+class WriteBatchWithIndexTest {
+ public:
+  std::string dbname_;
+  DB* db_;
+
+  WriteBatchWithIndexTest() : db_(NULL) {
+    dbname_ = test::TmpDir() + "/write_batch_with_index_test";
+    DestroyDB(dbname_, Options());
+    Options options;
+    options.create_if_missing = true;
+    ASSERT_OK(DB::Open(options, dbname_, &db_));
+  }
+
+  ~WriteBatchWithIndexTest() {
+    delete db_;
+    DestroyDB(dbname_, Options());
+  }
+
+  std::string Get(const WriteBatchWithIndex& batch, const std::string& k) {
+    std::string result;
+    Status s = batch.GetFromBatchAndDB(db_, ReadOptions(), k, &result);
+    if (s.IsNotFound()) {
+      result = "NOT_FOUND";
+    } else if (!s.ok()) {
+      result = s.ToString();
+    }
+    return result;
+  }
+
+  // Return the entries of the batch merged with the database, checking
+  // that reverse iteration yields the same entries
+  std::string Contents(const WriteBatchWithIndex& batch) {
+    Iterator* iter = batch.NewIteratorWithBase(db_->NewIterator(ReadOptions()));
+    std::vector<std::string> forward;
+    std::string result;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      std::string s = iter->key().ToString() + "=" + iter->value().ToString();
+      result += s + " ";
+      forward.push_back(s);
+    }
+    size_t matched = 0;
+    for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+      ASSERT_LT(matched, forward.size());
+      ASSERT_EQ(iter->key().ToString() + "=" + iter->value().ToString(),
+                forward[forward.size() - matched - 1]);
+      matched++;
+    }
+    ASSERT_EQ(matched, forward.size());
+    delete iter;
+    return result;
+  }
+};
+
+TEST(WriteBatchWithIndexTest, Empty) {
+  WriteBatchWithIndex batch;
+  ASSERT_EQ(0, batch.Count());
+  ASSERT_EQ("NOT_FOUND", Get(batch, "foo"));
+  ASSERT_EQ("", Contents(batch));
+}
+
+TEST(WriteBatchWithIndexTest, ReadYourOwnWrites) {
+  ASSERT_OK(db_->Put(WriteOptions(), "a", "db-a"));
+  ASSERT_OK(db_->Put(WriteOptions(), "b", "db-b"));
+  ASSERT_OK(db_->Put(WriteOptions(), "c", "db-c"));
+
+  WriteBatchWithIndex batch;
+  batch.Put("b", "v1");
+  batch.Put("b", "v2");
+  batch.Delete("c");
+  batch.Put("d", "v3");
+  batch.Delete("e");
+  ASSERT_EQ(5, batch.Count());
+
+  std::string value;
+  bool deleted;
+  ASSERT_TRUE(!batch.GetFromBatch("a", &value, &deleted));
+  ASSERT_TRUE(batch.GetFromBatch("b", &value, &deleted));
+  ASSERT_TRUE(!deleted);
+  ASSERT_EQ("v2", value);
+  ASSERT_TRUE(batch.GetFromBatch("c", &value, &deleted));
+  ASSERT_TRUE(deleted);
+
+  ASSERT_EQ("db-a", Get(batch, "a"));
+  ASSERT_EQ("v2", Get(batch, "b"));
+  ASSERT_EQ("NOT_FOUND", Get(batch, "c"));
+  ASSERT_EQ("v3", Get(batch, "d"));
+  ASSERT_EQ("NOT_FOUND", Get(batch, "e"));
+  ASSERT_EQ("a=db-a b=v2 d=v3 ", Contents(batch));
+
+  // The database is unchanged until the batch is written
+  ASSERT_OK(db_->Get(ReadOptions(), "c", &value));
+  ASSERT_OK(db_->Write(WriteOptions(), batch.GetWriteBatch()));
+  ASSERT_TRUE(db_->Get(ReadOptions(), "c", &value).IsNotFound());
+  ASSERT_OK(db_->Get(ReadOptions(), "b", &value));
+  ASSERT_EQ("v2", value);
+}
+
+TEST(WriteBatchWithIndexTest, ChangeDirection) {
+  ASSERT_OK(db_->Put(WriteOptions(), "a", "1"));
+  ASSERT_OK(db_->Put(WriteOptions(), "c", "3"));
+  ASSERT_OK(db_->Put(WriteOptions(), "e", "5"));
+  WriteBatchWithIndex batch;
+  batch.Put("b", "2");
+  batch.Delete("c");
+  batch.Put("d", "4");
+
+  Iterator* iter = batch.NewIteratorWithBase(db_->NewIterator(ReadOptions()));
+  iter->Seek("b");
+  ASSERT_EQ("b", iter->key().ToString());
+  iter->Next();
+  ASSERT_EQ("d", iter->key().ToString());
+  iter->Prev();
+  ASSERT_EQ("b", iter->key().ToString());
+  iter->Prev();
+  ASSERT_EQ("a", iter->key().ToString());
+  iter->Next();
+  ASSERT_EQ("b", iter->key().ToString());
+  iter->Next();
+  iter->Next();
+  ASSERT_EQ("e", iter->key().ToString());
+  iter->Next();
+  ASSERT_TRUE(!iter->Valid());
+  ASSERT_OK(iter->status());
+  delete iter;
+}
+
+TEST(WriteBatchWithIndexTest, ClearKeepsIterators) {
+  WriteBatchWithIndex* batch = new WriteBatchWithIndex;
+  batch->Put("a", "1");
+  Iterator* iter = batch->NewIteratorWithBase(db_->NewIterator(ReadOptions()));
+  batch->Clear();
+  ASSERT_EQ(0, batch->Count());
+  ASSERT_EQ(0, WriteBatchInternal::Count(batch->GetWriteBatch()));
+  ASSERT_EQ("NOT_FOUND", Get(*batch, "a"));
+  delete batch;
+
+  iter->SeekToFirst();
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ("a", iter->key().ToString());
+  ASSERT_EQ("1", iter->value().ToString());
+  delete iter;
+}
+
+TEST(WriteBatchWithIndexTest, Randomized) {
+  Random rnd(301);
+  for (int round = 0; round < 20; round++) {
+    std::map<std::string, std::string> model;
+    WriteBatch base;
+    for (int i = 0; i < 50; i++) {
+      const std::string k(1, 'a' + rnd.Uniform(26));
+      const std::string v = "db" + std::string(1, 'a' + rnd.Uniform(26));
+      base.Put(k, v);
+      model[k] = v;
+    }
+    ASSERT_OK(db_->Write(WriteOptions(), &base));
+
+    WriteBatchWithIndex batch;
+    for (int i = 0; i < 50; i++) {
+      const std::string k(1, 'a' + rnd.Uniform(26));
+      if (rnd.OneIn(3)) {
+        batch.Delete(k);
+        model.erase(k);
+      } else {
+        const std::string v = "b" + std::string(1, 'a' + rnd.Uniform(26));
+        batch.Put(k, v);
+        model[k] = v;
+      }
+    }
+
+    std::string expected;
+    for (std::map<std::string, std::string>::const_iterator it = model.begin();
+         it != model.end(); ++it) {
+      expected += it->first + "=" + it->second + " ";
+    }
+    ASSERT_EQ(expected, Contents(batch));
+
+    // Random walks that change direction
+    Iterator* iter = batch.NewIteratorWithBase(db_->NewIterator(ReadOptions()));
+    std::map<std::string, std::string>::const_iterator pos;
+    const std::string target(1, 'a' + rnd.Uniform(26));
+    iter->Seek(target);
+    pos = model.lower_bound(target);
+    for (int step = 0; step < 100 && pos != model.end(); step++) {
+      ASSERT_TRUE(iter->Valid());
+      ASSERT_EQ(pos->first, iter->key().ToString());
+      ASSERT_EQ(pos->second, iter->value().ToString());
+      if (rnd.OneIn(2)) {
+        iter->Next();
+        ++pos;
+      } else if (pos != model.begin()) {
+        iter->Prev();
+        --pos;
+      }
+    }
+    if (pos == model.end()) {
+      ASSERT_TRUE(!iter->Valid());
+    }
+    delete iter;
+
+    // Start the next round from an empty database
+    WriteBatch cleanup;
+    for (char c = 'a'; c <= 'z'; c++) {
+      cleanup.Delete(std::string(1, c));
+    }
+    ASSERT_OK(db_->Write(WriteOptions(), &cleanup));
+  }
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
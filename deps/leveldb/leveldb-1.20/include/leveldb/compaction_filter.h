@@ -0,0 +1,66 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A CompactionFilter lets the application drop or rewrite records while
+// they are compacted, e.g. to apply retention rules or to convert old
+// value formats, without reading and writing them back itself.  A filter
+// is called from several compaction threads at once, so it must be
+// thread-safe.
+//
+// Builtin filters that drop keys with a given prefix and strip a given
+// prefix from values are provided.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_COMPACTION_FILTER_H_
+#define STORAGE_LEVELDB_INCLUDE_COMPACTION_FILTER_H_
+
+#include <string>
+
+namespace leveldb {
+
+class Slice;
+
+class CompactionFilter {
+ public:
+  enum Decision {
+    kKeep,         // Leave the record as it is
+    kRemove,       // Delete the key
+    kChangeValue   // Replace the value by *new_value
+  };
+
+  CompactionFilter() { }
+  virtual ~CompactionFilter();
+
+  // Return the name of this filter.  It is written to the info log
+  // when the database is opened.
+  virtual const char* Name() const = 0;
+
+  // Called for the newest value of "key", unless a snapshot sees it,
+  // while it is compacted into "level".  Older values
+  // of the key stay hidden after kRemove.  Deletion markers and expired
+  // values are not passed to the filter.  A kept or changed value is
+  // passed again by later compactions, so the decisions must not change
+  // the result when they are repeated.
+  virtual Decision Filter(int level, const Slice& key, const Slice& value,
+                          std::string* new_value) const = 0;
+
+ private:
+  // No copying allowed
+  CompactionFilter(const CompactionFilter&);
+  void operator=(const CompactionFilter&);
+};
+
+// Return a filter that removes every key starting with "prefix", e.g.
+// to retire a whole key range in the background.
+extern const CompactionFilter* NewKeyPrefixRemovingFilter(
+    const Slice& prefix);
+
+// Return a filter that strips "prefix" from every value starting with
+// it, e.g. to shrink a legacy value header that is no longer needed.
+// Values without the header must not start with "prefix" themselves.
+extern const CompactionFilter* NewValuePrefixStrippingFilter(
+    const Slice& prefix);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_COMPACTION_FILTER_H_
@@ -58,6 +58,27 @@ class Comparator {
 // must not be deleted.
 extern const Comparator* BytewiseComparator();
 
+// Return a builtin comparator that orders keys in the reverse of the
+// byte-wise order.  The result remains the property of this module and
+// must not be deleted.
+extern const Comparator* ReverseBytewiseComparator();
+
+// Return a builtin comparator for keys that are unsigned big-endian
+// integers of up to 8 bytes, ordered by value.  Longer keys hold an
+// 8-byte integer followed by a suffix that orders the keys of the same
+// integer byte-wise.  Of two encodings of the same value, the shorter
+// sorts first.  The result remains the property of this module and
+// must not be deleted.
+extern const Comparator* Uint64BigEndianComparator();
+
+// Return a builtin comparator for keys made of components, each encoded
+// as a varint32 length followed by its bytes.  Keys are ordered
+// component by component, byte-wise, and a key sorts before the keys it
+// is a prefix of.  A truncated component takes the rest of the key.
+// The result remains the property of this module and must not be
+// deleted.
+extern const Comparator* TupleComparator();
+
 }  // namespace leveldb
 
 #endif  // STORAGE_LEVELDB_INCLUDE_COMPARATOR_H_
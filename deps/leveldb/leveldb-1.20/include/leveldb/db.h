@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <vector>
 #include "leveldb/iterator.h"
 #include "leveldb/options.h"
 
@@ -68,11 +69,39 @@ class DB {
   // Note: consider setting options.sync = true.
   virtual Status Delete(const WriteOptions& options, const Slice& key) = 0;
 
+  // Set the database entry for "key" to "value" until the time
+  // "expiry_micros", in microseconds since the epoch as returned by
+  // Env::NowMicros().  From then on, reads treat "key" as deleted, and
+  // compactions drop the entry without any further writes.
+  // Returns OK on success, and a non-OK status on error.
+  virtual Status PutWithExpiry(const WriteOptions& options,
+                               const Slice& key,
+                               const Slice& value,
+                               uint64_t expiry_micros);
+
+  // Apply the merge operand "value" to the database entry for "key"
+  // without reading it first.  Reads see the result of
+  // Options::merge_operator applied to the entry and its operands.
+  // Returns OK on success, and a non-OK status on error.
+  virtual Status Merge(const WriteOptions& options,
+                       const Slice& key,
+                       const Slice& value);
+
   // Apply the specified updates to the database.
   // Returns OK on success, non-OK on failure.
   // Note: consider setting options.sync = true.
   virtual Status Write(const WriteOptions& options, WriteBatch* updates) = 0;
 
+  // Apply the specified updates to the database only if none of "keys"
+  // has been written since "snapshot" was taken.  Else write nothing
+  // and return a status for which Status::IsBusy() returns true.  The
+  // check and the write are atomic, which lets optimistic transactions
+  // read at a snapshot and commit without holding any locks.
+  virtual Status WriteIfUnchanged(const WriteOptions& options,
+                                  const Snapshot* snapshot,
+                                  const std::vector<Slice>& keys,
+                                  WriteBatch* updates);
+
   // If the database contains an entry for "key" store the
   // corresponding value in *value and return OK.
   //
@@ -111,10 +140,14 @@ class DB {
   //
   //  "leveldb.num-files-at-level<N>" - return the number of files at level <N>,
   //     where <N> is an ASCII representation of a level number (e.g. "0").
+  //  "leveldb.total-bytes-at-level<N>" - return the total size in bytes of
+  //     the files at level <N>.
   //  "leveldb.stats" - returns a multi-line string that describes statistics
   //     about the internal operation of the DB.
   //  "leveldb.sstables" - returns a multi-line string that describes all
   //     of the sstables that make up the db contents.
+  //  "leveldb.tombstones" - returns one line per sstable with its level,
+  //     file number, number of entries and number of deletion markers.
   //  "leveldb.approximate-memory-usage" - returns the approximate number of
   //     bytes of memory in use by the DB.
   virtual bool GetProperty(const Slice& property, std::string* value) = 0;
@@ -142,6 +175,11 @@ class DB {
   //    db->CompactRange(NULL, NULL);
   virtual void CompactRange(const Slice* begin, const Slice* end) = 0;
 
+  // Sync the current log file to stable storage.  On success, every
+  // write that completed before this call survives a machine crash,
+  // exactly as if it had been made with WriteOptions::sync set.
+  virtual Status SyncWAL() = 0;
+
  private:
   // No copying allowed
   DB(const DB&);
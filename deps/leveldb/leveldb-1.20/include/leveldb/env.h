@@ -33,6 +33,11 @@ class Env {
   Env() { }
   virtual ~Env();
 
+  // Background work items are queued by priority.  Each priority has its
+  // own threads, so that short HIGH items (memtable compactions) never
+  // wait behind long LOW ones (table compactions).
+  enum Priority { LOW, HIGH };
+
   // Return a default environment suitable for the current operating
   // system.  Sophisticated users may wish to provide their own Env
   // implementation instead of relying on this default environment.
@@ -140,6 +145,21 @@ class Env {
       void (*function)(void* arg),
       void* arg) = 0;
 
+  // Like Schedule(), but queue the work item with priority "pri".
+  //
+  // The default implementation ignores the priority.
+  virtual void Schedule(void (*function)(void* arg), void* arg,
+                        Priority pri) {
+    Schedule(function, arg);
+  }
+
+  // Arrange for at least "number" threads to run the background work
+  // items of priority "pri".  Threads are never stopped, so the number
+  // of threads of a priority only grows.
+  //
+  // The default implementation does nothing.
+  virtual void IncBackgroundThreadsIfNeeded(int number, Priority pri) { }
+
   // Start a new thread, invoking "function(arg)" within the new thread.
   // When "function(arg)" returns, the thread will be destroyed.
   virtual void StartThread(void (*function)(void* arg), void* arg) = 0;
@@ -327,6 +347,12 @@ class EnvWrapper : public Env {
   void Schedule(void (*f)(void*), void* a) {
     return target_->Schedule(f, a);
   }
+  void Schedule(void (*f)(void*), void* a, Priority pri) {
+    return target_->Schedule(f, a, pri);
+  }
+  void IncBackgroundThreadsIfNeeded(int number, Priority pri) {
+    return target_->IncBackgroundThreadsIfNeeded(number, pri);
+  }
   void StartThread(void (*f)(void*), void* a) {
     return target_->StartThread(f, a);
   }
@@ -65,6 +65,26 @@ class FilterPolicy {
 // trailing spaces in keys.
 extern const FilterPolicy* NewBloomFilterPolicy(int bits_per_key);
 
+// Return a new filter policy that uses a bloom filter whose probes for a
+// key all fall within one 64-byte cache line, with approximately the
+// specified number of bits per key.  A lookup costs a single cache miss
+// instead of one per probe, and the probes are tested with AVX2 when the
+// CPU supports it.  The false positive rate is slightly higher than the
+// one of NewBloomFilterPolicy() for the same bits_per_key.  The same
+// caveats and ownership rules apply.
+extern const FilterPolicy* NewBlockedBloomFilterPolicy(int bits_per_key);
+
+// Return a new filter policy that uses a static xor filter with
+// approximately the specified number of bits per key.  It stores an
+// r-bit fingerprint in about 1.23 slots per key, with r the largest
+// width that fits in bits_per_key, and has a false positive rate of
+// 2^-r: 9 bits per key give ~ 0.8%, less than a bloom filter with 10.
+// Building it is slower than building a bloom filter, and the filters
+// of less than a few hundred keys are larger than bloom filters, so use
+// it with Options::full_table_filter.  The same caveats and ownership
+// rules as for NewBloomFilterPolicy() apply.
+extern const FilterPolicy* NewXorFilterPolicy(int bits_per_key);
+
 }
 
 #endif  // STORAGE_LEVELDB_INCLUDE_FILTER_POLICY_H_
@@ -0,0 +1,67 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A MergeOperator turns read-modify-write updates into blind writes.
+// DB::Merge() stores an operand for a key without reading it; reads
+// combine the operands with the value they apply to, and compactions
+// collapse them into a plain value.  An operator is called from several
+// threads at once, so it must be thread-safe.
+//
+// Builtin operators for counters, maximums, appends and set unions are
+// provided.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_MERGE_OPERATOR_H_
+#define STORAGE_LEVELDB_INCLUDE_MERGE_OPERATOR_H_
+
+#include <string>
+#include <vector>
+
+namespace leveldb {
+
+class Slice;
+
+class MergeOperator {
+ public:
+  MergeOperator() { }
+  virtual ~MergeOperator();
+
+  // Return the name of this operator.  It is written to the info log
+  // when the database is opened.
+  virtual const char* Name() const = 0;
+
+  // Apply "operands", oldest first, to "existing_value", which is NULL
+  // if "key" has no value, and store the result in *new_value.  Return
+  // false if the operands can not be applied, e.g. because they are
+  // malformed; reads of the key then fail with a Corruption status.
+  virtual bool Merge(const Slice& key, const Slice* existing_value,
+                     const std::vector<Slice>& operands,
+                     std::string* new_value) const = 0;
+
+ private:
+  // No copying allowed
+  MergeOperator(const MergeOperator&);
+  void operator=(const MergeOperator&);
+};
+
+// Return an operator that adds operands to the value.  Values and
+// operands are signed 64-bit integers in decimal, e.g. "42" or "-1",
+// and a missing value counts as 0.
+extern const MergeOperator* NewInt64AddOperator();
+
+// Return an operator that keeps the largest of the value and the
+// operands, all signed 64-bit integers in decimal.
+extern const MergeOperator* NewInt64MaxOperator();
+
+// Return an operator that appends the operands to the value.
+extern const MergeOperator* NewAppendOperator();
+
+// Return an operator that adds the elements of the operands to the set
+// held by the value.  Sets are written as sorted, comma separated lists
+// of distinct elements, e.g. "a,b,c"; operands may be in any order and
+// contain duplicates.
+extern const MergeOperator* NewSetUnionOperator();
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_MERGE_OPERATOR_H_
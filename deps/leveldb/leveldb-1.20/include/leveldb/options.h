@@ -10,10 +10,15 @@
 namespace leveldb {
 
 class Cache;
+class CompactionFilter;
 class Comparator;
 class Env;
 class FilterPolicy;
 class Logger;
+class MergeOperator;
+class RateLimiter;
+class Slice;
+class SliceTransform;
 class Snapshot;
 
 // DB contents are stored in a set of blocks, each of which holds a
@@ -27,6 +32,21 @@ enum CompressionType {
   kSnappyCompression = 0x1
 };
 
+// How the table files of the database are merged in the background.
+enum CompactionStyle {
+  // Files are organized in levels of increasing size and each level is
+  // merged into the next one when it grows too large.  Every byte is
+  // rewritten about max_bytes_for_level_multiplier times per level,
+  // but reads look into at most one file per level above level-0.
+  kLevelCompaction = 0x0,
+
+  // All files stay in level-0 as sorted runs, and runs of similar size
+  // are merged together.  Every byte is rewritten much less often, but
+  // reads may have to look into every run.  Suited to write-heavy
+  // databases that are rarely read.
+  kTieredCompaction = 0x1
+};
+
 // Options to control the behavior of a database (passed to DB::Open)
 struct Options {
   // -------------------
@@ -74,14 +94,66 @@ struct Options {
   // on disk) before converting to a sorted on-disk file.
   //
   // Larger values increase performance, especially during bulk loads.
-  // Up to two write buffers may be held in memory at the same time,
-  // so you may wish to adjust this parameter to control memory usage.
+  // Up to max_write_buffer_number write buffers may be held in memory at
+  // the same time, so you may wish to adjust this parameter to control
+  // memory usage.
   // Also, a larger write buffer will result in a longer recovery time
   // the next time the database is opened.
   //
   // Default: 4MB
   size_t write_buffer_size;
 
+  // Maximum number of write buffers held in memory: the one being
+  // written to and those waiting to be compacted.  Once that many are
+  // full, writes wait for the oldest to be compacted.  Larger values
+  // absorb longer write bursts without stalling; write buffers waiting
+  // together are compacted into a single level-0 file.
+  //
+  // Default: 2
+  int max_write_buffer_number;
+
+  // Maximum number of compactions to run concurrently.  Compactions whose
+  // input files do not overlap are run side by side by the low priority
+  // background threads of env, of which there will be at least this many.
+  // Memtable compactions are run separately by the high priority ones.
+  //
+  // Default: 1
+  int max_background_compactions;
+
+  // Maximum number of threads a single compaction is split into.  The
+  // key range of a compaction is partitioned at the boundaries of its
+  // input files, and each part is merged by a thread of the database's
+  // pool into output files of its own.  All outputs are installed
+  // together.  The threads are started as needed and reused.
+  // Larger values shorten the large compactions that may stall writes,
+  // at the cost of more threads and open files while they run.
+  //
+  // Default: 1
+  int max_subcompactions;
+
+  // If non-NULL, the reads and writes of compactions go through this
+  // limiter, which bounds their rate to keep the device responsive to
+  // foreground reads.  If the limiter is adaptive, the time taken by
+  // DB::Get() is reported to it.  Memtable compactions are not limited.
+  // See NewRateLimiter() in rate_limiter.h.
+  //
+  // Default: NULL
+  RateLimiter* rate_limiter;
+
+  // If non-NULL, compactions pass the newest value of each key to this
+  // filter, which may remove the key or change its value.  Memtable
+  // compactions do not call it.  See compaction_filter.h.
+  //
+  // Default: NULL
+  const CompactionFilter* compaction_filter;
+
+  // Applies the operands written by DB::Merge() to the values of their
+  // keys.  Reads of keys with merge operands fail without one, so it
+  // must stay set once DB::Merge() has been used.  See merge_operator.h.
+  //
+  // Default: NULL
+  const MergeOperator* merge_operator;
+
   // Number of open files that can be used by the DB.  You may need to
   // increase this if your database has a large working set (budget
   // one open file per 2MB of working set).
@@ -124,6 +196,93 @@ struct Options {
   // Default: 2MB
   size_t max_file_size;
 
+  // Number of level-0 files that triggers a compaction of level 0.
+  // Level-0 files are merged on every read, so fewer of them make reads
+  // cheaper, while more of them save compaction work during bulk loads.
+  //
+  // Default: 4
+  int level0_file_num_compaction_trigger;
+
+  // Soft limit on the number of level-0 files: each write is delayed
+  // by 1ms once there are this many.  Raised to at least
+  // level0_file_num_compaction_trigger.
+  //
+  // Default: 8
+  int level0_slowdown_writes_trigger;
+
+  // Maximum number of level-0 files: writes stop until a compaction
+  // brings them below this many.  Raised to at least
+  // level0_slowdown_writes_trigger.
+  //
+  // Default: 12
+  int level0_stop_writes_trigger;
+
+  // Maximum level to which a new compacted memtable is pushed if it
+  // does not create overlap.  Pushing it down avoids the relatively
+  // expensive level 0=>1 compactions, but pushing it too far can waste
+  // disk space if the same keys are repeatedly overwritten.  Clipped to
+  // [0, 5].
+  //
+  // Default: 2
+  int max_mem_compaction_level;
+
+  // Maximum total size of the files in level 1.  Each level above it
+  // may hold max_bytes_for_level_multiplier times as much as the level
+  // before it.  Larger values mean fewer compactions and more space
+  // taken by overwritten data; the multiplier also sets how many
+  // levels a given amount of data spreads over.
+  //
+  // Default: 10MB and 10
+  size_t max_bytes_for_level_base;
+  int max_bytes_for_level_multiplier;
+
+  // If true, the size targets of levels 1 and above are derived from
+  // the current size of the deepest non-empty level instead of from
+  // max_bytes_for_level_base: each level above it may hold
+  // 1/max_bytes_for_level_multiplier as much as the level below it,
+  // but never less than max_bytes_for_level_base.  This keeps most of
+  // the data in the bottom level however large or small the database
+  // is, so that about 1/multiplier of the space is taken by data that
+  // later gets overwritten or deleted.  The bottom level itself still
+  // spills into the next level once it outgrows its static target.
+  //
+  // Default: false
+  bool level_compaction_dynamic_level_bytes;
+
+  // The way the table files are merged in the background.  Level-0
+  // tables are written by every compaction style, so a database may be
+  // reopened with another style.  CompactRange() always pushes data
+  // into the deeper levels.
+  //
+  // Default: kLevelCompaction
+  CompactionStyle compaction_style;
+
+  // With kTieredCompaction, once there are at least
+  // level0_file_num_compaction_trigger sorted runs, the newest runs are
+  // merged together as long as each next older run is at most
+  // tiered_size_ratio percent larger than the runs merged before it.
+  //
+  // Default: 1
+  int tiered_size_ratio;
+
+  // With kTieredCompaction, when there are more than this many sorted
+  // runs and none of them are of similar size, the newest runs are
+  // merged anyway to get back under level0_file_num_compaction_trigger.
+  // Raised to at least level0_file_num_compaction_trigger, and writes
+  // are slowed down only past it.
+  //
+  // Default: 6
+  int tiered_max_runs;
+
+  // With kLevelCompaction, a table file in levels 1 and above in which
+  // at least this percentage of the entries are deletion markers is
+  // compacted into the next level even if no level is too large.  This
+  // clears out the markers left by deleting many keys, which otherwise
+  // slow down every iteration over the deleted range.  0 disables it.
+  //
+  // Default: 0
+  int tombstone_compaction_percent;
+
   // Compress blocks using the specified compression algorithm.  This
   // parameter can be changed dynamically.
   //
@@ -140,6 +299,16 @@ struct Options {
   // efficiently detect that and will switch to uncompressed mode.
   CompressionType compression;
 
+  // If greater than 1, each table being built hands its data blocks to
+  // up to this many threads at a time to be compressed and checksummed,
+  // and writes them out in order as they are done.  The threads come
+  // from a pool of the database, started as needed and reused.  The table format does
+  // not change.  Lets flushes and compactions spread the cost of
+  // compression over several cores.
+  //
+  // Default: 1 (blocks are compressed by the thread building the table)
+  int compression_threads;
+
   // EXPERIMENTAL: If true, append to existing MANIFEST and log files
   // when a database is opened.  This can significantly speed up open.
   //
@@ -153,6 +322,57 @@ struct Options {
   // Default: NULL
   const FilterPolicy* filter_policy;
 
+  // If true, the tables are built with a single filter over all of their
+  // keys instead of one filter per 2KB of data blocks.  A lookup checks
+  // it before searching the index block, so a table that cannot hold the
+  // key costs a single filter probe.  Tables of both formats can be read
+  // whatever the setting.  Only used together with filter_policy.
+  //
+  // Default: false
+  bool full_table_filter;
+
+  // If non-NULL, the prefixes it extracts from the keys are added to the
+  // filters next to the keys themselves, so iterators created with
+  // ReadOptions::prefix can skip the tables that hold no key of their
+  // prefix.  Only used together with filter_policy.  See
+  // slice_transform.h.
+  //
+  // Default: NULL
+  const SliceTransform* prefix_extractor;
+
+  // If non-zero, a background thread syncs the current log file at
+  // least every wal_sync_interval_ms milliseconds whenever it holds
+  // writes that were not made with WriteOptions::sync.  This bounds
+  // the window of writes that can be lost on a machine crash without
+  // paying for a sync on every write.  See also DB::SyncWAL().
+  //
+  // Default: 0 (no periodic sync)
+  int wal_sync_interval_ms;
+
+  // If non-zero, the background log syncer is also woken up as soon
+  // as this many bytes have been appended to the log since the last
+  // sync.  May be combined with wal_sync_interval_ms.
+  //
+  // Default: 0
+  size_t wal_sync_bytes;
+
+  // If true, a group of concurrent writes is inserted into the memtable
+  // while the next group is already being appended to the log, instead
+  // of the next group waiting for both steps.  Writes still become
+  // visible in log order.  Only helps when several threads write at
+  // the same time.
+  //
+  // Default: false
+  bool enable_pipelined_write;
+
+  // If true, the writes that are grouped together by concurrent writers
+  // are inserted into the memtable in parallel, each by its own thread,
+  // instead of all of them by the thread that leads the group.  Only
+  // helps when several threads write at the same time.
+  //
+  // Default: false
+  bool allow_concurrent_memtable_write;
+
   // Create an Options object with default values for all fields.
   Options();
 };
@@ -176,10 +396,20 @@ struct ReadOptions {
   // Default: NULL
   const Snapshot* snapshot;
 
+  // If non-NULL, an iterator only has to return the keys whose prefix,
+  // as extracted by Options::prefix_extractor, is "*prefix": it skips
+  // the tables whose filters show they hold no such key, and may return
+  // any subset of the other keys.  Seek() to a key of the prefix and
+  // stop at the first key of another prefix.  "*prefix" must remain
+  // live while the iterator is in use.
+  // Default: NULL
+  const Slice* prefix;
+
   ReadOptions()
       : verify_checksums(false),
         fill_cache(true),
-        snapshot(NULL) {
+        snapshot(NULL),
+        prefix(NULL) {
   }
 };
 
@@ -0,0 +1,64 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A RateLimiter bounds the rate of background I/O, such as the reads
+// and writes of compactions, so that it leaves room on the device for
+// foreground reads.  It has internal synchronization and may be shared
+// by several databases.
+//
+// A builtin token bucket implementation is provided.  In adaptive mode
+// it also lowers its rate while foreground reads are slower than usual.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_RATE_LIMITER_H_
+#define STORAGE_LEVELDB_INCLUDE_RATE_LIMITER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace leveldb {
+
+class Env;
+class RateLimiter;
+class WritableFile;
+
+// Create a token bucket rate limiter that lets through up to
+// "bytes_per_second" bytes per second, timed by "env".  If "adaptive",
+// the rate is lowered while the foreground reads reported through
+// RecordForegroundRead() take much longer than usual, and raised back
+// once they no longer do.
+extern RateLimiter* NewRateLimiter(Env* env, int64_t bytes_per_second,
+                                   bool adaptive);
+
+// Return a file that passes every Append() to "base" through "limiter"
+// first.  The result owns "base" but not "limiter".
+extern WritableFile* NewRateLimitedWritableFile(WritableFile* base,
+                                                RateLimiter* limiter);
+
+class RateLimiter {
+ public:
+  RateLimiter() { }
+  virtual ~RateLimiter();
+
+  // Wait until "bytes" more bytes of I/O may be done.  Requests larger
+  // than what the limiter saves up are let through piece by piece.
+  virtual void Request(size_t bytes) = 0;
+
+  // Returns true iff the limiter has a use for RecordForegroundRead().
+  virtual bool IsAdaptive() const = 0;
+
+  // Report that a foreground read took "micros" microseconds.
+  virtual void RecordForegroundRead(uint64_t micros) = 0;
+
+  // Return the number of bytes per second currently let through.
+  virtual int64_t GetBytesPerSecond() = 0;
+
+ private:
+  // No copying allowed
+  RateLimiter(const RateLimiter&);
+  void operator=(const RateLimiter&);
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_RATE_LIMITER_H_
@@ -0,0 +1,57 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A SliceTransform extracts the prefix of a key, e.g. "tenant/42/" from
+// "tenant/42/orders/7".  Given as Options::prefix_extractor, the prefixes
+// of the keys are added to the filters of the tables, and iterators
+// created with ReadOptions::prefix skip the tables that hold no key of
+// the prefix.  A transform is called from several threads at once, so it
+// must be thread-safe.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_SLICE_TRANSFORM_H_
+#define STORAGE_LEVELDB_INCLUDE_SLICE_TRANSFORM_H_
+
+#include <stddef.h>
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+class SliceTransform {
+ public:
+  SliceTransform() { }
+  virtual ~SliceTransform();
+
+  // Return the name of this transform.  It is recorded in the tables
+  // whose filters hold the prefixes, so the client should switch to a
+  // new name whenever the extracted prefixes change.
+  virtual const char* Name() const = 0;
+
+  // Return true if "key" has a prefix.
+  virtual bool InDomain(const Slice& key) const = 0;
+
+  // Return the prefix of "key", which must be InDomain().  The result
+  // must be a prefix of "key" in the byte-wise sense, and the keys that
+  // share a prefix must be adjacent in the order of the comparator and
+  // sort after their prefix, as with BytewiseComparator().
+  virtual Slice Transform(const Slice& key) const = 0;
+
+ private:
+  // No copying allowed
+  SliceTransform(const SliceTransform&);
+  void operator=(const SliceTransform&);
+};
+
+// Return a transform whose prefix is the first "length" bytes of the
+// keys.  Shorter keys have no prefix.
+extern const SliceTransform* NewFixedPrefixTransform(size_t length);
+
+// Return a transform whose prefix runs up to and including the "count"th
+// "delimiter" of the keys, e.g. "tenant/42/" for '/' and a count of 2.
+// Keys with fewer delimiters have no prefix.
+extern const SliceTransform* NewDelimiterPrefixTransform(char delimiter,
+                                                          int count);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_SLICE_TRANSFORM_H_
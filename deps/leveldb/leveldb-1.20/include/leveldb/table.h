@@ -71,6 +71,11 @@ class Table {
       void* arg,
       void (*handle_result)(void* arg, const Slice& k, const Slice& v));
 
+  // Return false if the filter shows that the table holds no key of
+  // the prefix of Options::prefix_extractor whose first possible key
+  // is "k".  Like for InternalGet(), the filter is queried with "k".
+  bool PrefixMayMatch(const Slice& k);
+
 
   void ReadMeta(const Footer& footer);
   void ReadFilter(const Slice& filter_handle_value);
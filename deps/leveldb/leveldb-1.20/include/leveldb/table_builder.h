@@ -21,6 +21,7 @@ namespace leveldb {
 
 class BlockBuilder;
 class BlockHandle;
+class ThreadPool;
 class WritableFile;
 
 class TableBuilder {
@@ -30,6 +31,13 @@ class TableBuilder {
   // caller to close the file after calling Finish().
   TableBuilder(const Options& options, WritableFile* file);
 
+  // Like the constructor above, but with options.compression_threads > 1
+  // the blocks are compressed on the threads of *compression_pool, which
+  // may be shared by several builders, instead of threads of the
+  // builder's own.  *compression_pool must outlive the builder.
+  TableBuilder(const Options& options, WritableFile* file,
+               ThreadPool* compression_pool);
+
   // REQUIRES: Either Finish() or Abandon() has been called.
   ~TableBuilder();
 
@@ -72,12 +80,21 @@ class TableBuilder {
 
   // Size of the file generated so far.  If invoked after a successful
   // Finish() call, returns the size of the final generated file.
+  // With options.compression_threads > 1, blocks still being compressed
+  // are counted at their uncompressed size.
   uint64_t FileSize() const;
 
  private:
   bool ok() const { return status().ok(); }
   void WriteBlock(BlockBuilder* block, BlockHandle* handle);
   void WriteRawBlock(const Slice& data, CompressionType, BlockHandle* handle);
+  void AppendBlock(const Slice& data, const char* trailer, BlockHandle* handle);
+
+  // Write the data blocks compressed so far by the compression threads,
+  // in order.  If "wait", wait for all of them to be compressed, else
+  // only as long as too many are in flight.
+  void WritePendingBlocks(bool wait);
+  void StopCompression();
 
   struct Rep;
   Rep* rep_;
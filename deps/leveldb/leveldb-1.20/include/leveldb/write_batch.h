@@ -21,6 +21,7 @@
 #ifndef STORAGE_LEVELDB_INCLUDE_WRITE_BATCH_H_
 #define STORAGE_LEVELDB_INCLUDE_WRITE_BATCH_H_
 
+#include <stdint.h>
 #include <string>
 #include "leveldb/status.h"
 
@@ -36,9 +37,20 @@ class WriteBatch {
   // Store the mapping "key->value" in the database.
   void Put(const Slice& key, const Slice& value);
 
+  // Store the mapping "key->value" in the database until the time
+  // "expiry_micros", in microseconds since the epoch as returned by
+  // Env::NowMicros().  From then on, reads treat "key" as deleted and
+  // compactions drop the mapping.
+  void PutWithExpiry(const Slice& key, const Slice& value,
+                     uint64_t expiry_micros);
+
   // If the database contains a mapping for "key", erase it.  Else do nothing.
   void Delete(const Slice& key);
 
+  // Apply the merge operand "value" to the mapping for "key".  See
+  // DB::Merge().
+  void Merge(const Slice& key, const Slice& value);
+
   // Clear all updates buffered in this batch.
   void Clear();
 
@@ -48,6 +60,11 @@ class WriteBatch {
     virtual ~Handler();
     virtual void Put(const Slice& key, const Slice& value) = 0;
     virtual void Delete(const Slice& key) = 0;
+    // The default implementation calls Put(key, value).
+    virtual void PutWithExpiry(const Slice& key, const Slice& value,
+                               uint64_t expiry_micros);
+    // The default implementation ignores the merge.
+    virtual void Merge(const Slice& key, const Slice& value);
   };
   Status Iterate(Handler* handler) const;
 
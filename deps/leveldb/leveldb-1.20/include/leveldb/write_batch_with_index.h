@@ -0,0 +1,86 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// WriteBatchWithIndex is a WriteBatch that can be read back before it
+// is written.  Next to the batch, it keeps a sorted index of the newest
+// update of every key, so a read-modify-write transaction can look up
+// its own pending writes and iterate over them merged with the database:
+//
+//    WriteBatchWithIndex batch;
+//    batch.Put("key", "v1");
+//    batch.GetFromBatchAndDB(db, ReadOptions(), "key", &value);  // "v1"
+//    Iterator* it = batch.NewIteratorWithBase(db->NewIterator(options));
+//    ...
+//    db->Write(WriteOptions(), batch.GetWriteBatch());
+//
+// Only Put() and Delete() are indexed.  The same synchronization rules
+// as for WriteBatch apply.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_WRITE_BATCH_WITH_INDEX_H_
+#define STORAGE_LEVELDB_INCLUDE_WRITE_BATCH_WITH_INDEX_H_
+
+#include <string>
+#include "leveldb/comparator.h"
+#include "leveldb/status.h"
+
+namespace leveldb {
+
+class DB;
+struct IndexedUpdates;
+class Iterator;
+class Slice;
+class WriteBatch;
+struct ReadOptions;
+
+class WriteBatchWithIndex {
+ public:
+  // Keys are ordered by "comparator", which must be the comparator of
+  // the database the batch is read together with.
+  explicit WriteBatchWithIndex(
+      const Comparator* comparator = BytewiseComparator());
+  ~WriteBatchWithIndex();
+
+  void Put(const Slice& key, const Slice& value);
+  void Delete(const Slice& key);
+
+  // Clear all updates buffered in this batch.  Iterators created
+  // before keep seeing the old updates.
+  void Clear();
+
+  // Return the number of updates in the batch.
+  int Count() const;
+
+  // Return the batch to hand to DB::Write().  The index keeps pointing
+  // to it, so it must only be changed through this object.
+  WriteBatch* GetWriteBatch();
+
+  // Return true if the batch has an update of "key".  *deleted is set
+  // to whether it is a deletion, else *value is set to the new value.
+  bool GetFromBatch(const Slice& key, std::string* value,
+                    bool* deleted) const;
+
+  // Read "key" as if the batch had been written to "db": the update
+  // of the batch if it has one, else the value read from "db".
+  Status GetFromBatchAndDB(DB* db, const ReadOptions& options,
+                           const Slice& key, std::string* value) const;
+
+  // Return an iterator over the entries of "base", usually a DB
+  // iterator, with the updates of the batch applied.  The result takes
+  // ownership of "base" and sees the updates added to the batch while
+  // it is live, but not the effect of a later Clear().  The batch object
+  // itself may be destroyed before the iterator.
+  Iterator* NewIteratorWithBase(Iterator* base) const;
+
+ private:
+  IndexedUpdates* rep_;
+  const Comparator* const comparator_;
+
+  // No copying allowed
+  WriteBatchWithIndex(const WriteBatchWithIndex&);
+  void operator=(const WriteBatchWithIndex&);
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_WRITE_BATCH_WITH_INDEX_H_
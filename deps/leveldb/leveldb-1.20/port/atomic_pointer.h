@@ -140,6 +140,17 @@ class AtomicPointer {
     MemoryBarrier();
     rep_ = v;
   }
+  // Atomically replace the stored pointer by "v" iff it is "expected".
+  // Returns true on success.  Acts as a full memory barrier.
+  inline bool CompareAndSwap(void* expected, void* v) {
+#if defined(OS_WIN)
+    return InterlockedCompareExchangePointer(&rep_, v, expected) == expected;
+#elif defined(OS_MACOSX)
+    return OSAtomicCompareAndSwapPtrBarrier(expected, v, &rep_);
+#else
+    return __sync_bool_compare_and_swap(&rep_, expected, v);
+#endif
+  }
 };
 
 // AtomicPointer based on <cstdatomic>
@@ -162,6 +173,10 @@ class AtomicPointer {
   inline void NoBarrier_Store(void* v) {
     rep_.store(v, std::memory_order_relaxed);
   }
+  inline bool CompareAndSwap(void* expected, void* v) {
+    return rep_.compare_exchange_strong(expected, v,
+                                        std::memory_order_acq_rel);
+  }
 };
 
 // Atomic pointer based on sparc memory barriers
@@ -192,6 +207,9 @@ class AtomicPointer {
   }
   inline void* NoBarrier_Load() const { return rep_; }
   inline void NoBarrier_Store(void* v) { rep_ = v; }
+  inline bool CompareAndSwap(void* expected, void* v) {
+    return __sync_bool_compare_and_swap(&rep_, expected, v);
+  }
 };
 
 // Atomic pointer based on ia64 acq/rel
@@ -222,6 +240,9 @@ class AtomicPointer {
   }
   inline void* NoBarrier_Load() const { return rep_; }
   inline void NoBarrier_Store(void* v) { rep_ = v; }
+  inline bool CompareAndSwap(void* expected, void* v) {
+    return __sync_bool_compare_and_swap(&rep_, expected, v);
+  }
 };
 
 // We have neither MemoryBarrier(), nor <atomic>
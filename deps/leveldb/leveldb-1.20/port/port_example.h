@@ -53,6 +53,11 @@ class CondVar {
   // REQUIRES: this thread holds *mu
   void Wait();
 
+  // Like Wait(), but gives up after "micros" microseconds have elapsed.
+  // Returns true iff the wait timed out.
+  // REQUIRES: this thread holds *mu
+  bool TimedWait(uint64_t micros);
+
   // If there are some threads waiting, wake up at least one of them.
   void Signal();
 
@@ -97,6 +102,10 @@ class AtomicPointer {
 
   // Set va as the stored pointer with no ordering guarantees.
   void NoBarrier_Store(void* v);
+
+  // Atomically replace the stored pointer by v iff it currently holds
+  // expected.  Returns true on success.  Acts as a full memory barrier.
+  bool CompareAndSwap(void* expected, void* v);
 };
 
 // ------------------ Compression -------------------
@@ -15,11 +15,16 @@ namespace leveldb {
 static const size_t kFilterBaseLg = 11;
 static const size_t kFilterBase = 1 << kFilterBaseLg;
 
-FilterBlockBuilder::FilterBlockBuilder(const FilterPolicy* policy)
-    : policy_(policy) {
+FilterBlockBuilder::FilterBlockBuilder(const FilterPolicy* policy,
+                                       bool full_table)
+    : policy_(policy),
+      full_table_(full_table) {
 }
 
 void FilterBlockBuilder::StartBlock(uint64_t block_offset) {
+  if (full_table_) {
+    return;  // All keys go to the filter generated by Finish()
+  }
   uint64_t filter_index = (block_offset / kFilterBase);
   assert(filter_index >= filter_offsets_.size());
   while (filter_index > filter_offsets_.size()) {
@@ -34,7 +39,7 @@ void FilterBlockBuilder::AddKey(const Slice& key) {
 }
 
 Slice FilterBlockBuilder::Finish() {
-  if (!start_.empty()) {
+  if (!start_.empty() || (full_table_ && filter_offsets_.empty())) {
     GenerateFilter();
   }
 
@@ -26,9 +26,13 @@ class FilterPolicy;
 //
 // The sequence of calls to FilterBlockBuilder must match the regexp:
 //      (StartBlock AddKey*)* Finish
+//
+// If "full_table" is true, a single filter is built over all of the keys
+// and the block offsets passed to StartBlock are ignored.  Look keys up
+// in it with a block_offset of 0.
 class FilterBlockBuilder {
  public:
-  explicit FilterBlockBuilder(const FilterPolicy*);
+  explicit FilterBlockBuilder(const FilterPolicy*, bool full_table = false);
 
   void StartBlock(uint64_t block_offset);
   void AddKey(const Slice& key);
@@ -38,6 +42,7 @@ class FilterBlockBuilder {
   void GenerateFilter();
 
   const FilterPolicy* policy_;
+  const bool full_table_;
   std::string keys_;              // Flattened key contents
   std::vector<size_t> start_;     // Starting index in keys_ of each key
   std::string result_;            // Filter data computed so far
@@ -121,6 +121,29 @@ TEST(FilterBlockTest, MultiChunk) {
   ASSERT_TRUE(! reader.KeyMayMatch(9000, "bar"));
 }
 
+TEST(FilterBlockTest, FullTable) {
+  FilterBlockBuilder builder(&policy_, true);
+  builder.StartBlock(0);
+  builder.AddKey("foo");
+  builder.StartBlock(3100);
+  builder.AddKey("bar");
+  builder.StartBlock(9000);
+  builder.AddKey("hello");
+  Slice block = builder.Finish();
+  FilterBlockReader reader(&policy_, block);
+  ASSERT_TRUE(reader.KeyMayMatch(0, "foo"));
+  ASSERT_TRUE(reader.KeyMayMatch(0, "bar"));
+  ASSERT_TRUE(reader.KeyMayMatch(0, "hello"));
+  ASSERT_TRUE(! reader.KeyMayMatch(0, "box"));
+}
+
+TEST(FilterBlockTest, EmptyFullTable) {
+  FilterBlockBuilder builder(&policy_, true);
+  Slice block = builder.Finish();
+  FilterBlockReader reader(&policy_, block);
+  ASSERT_TRUE(! reader.KeyMayMatch(0, "foo"));
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
@@ -9,6 +9,7 @@
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
 #include "leveldb/options.h"
+#include "leveldb/slice_transform.h"
 #include "table/block.h"
 #include "table/filter_block.h"
 #include "table/format.h"
@@ -30,6 +31,8 @@ struct Table::Rep {
   uint64_t cache_id;
   FilterBlockReader* filter;
   const char* filter_data;
+  bool full_filter;      // filter is a single filter over the whole table
+  bool prefix_filtered;  // filter holds the prefixes of prefix_extractor
 
   BlockHandle metaindex_handle;  // Handle to metaindex_block: saved from footer
   Block* index_block;
@@ -79,6 +82,8 @@ Status Table::Open(const Options& options,
     rep->cache_id = (options.block_cache ? options.block_cache->NewId() : 0);
     rep->filter_data = NULL;
     rep->filter = NULL;
+    rep->full_filter = false;
+    rep->prefix_filtered = false;
     *table = new Table(rep);
     (*table)->ReadMeta(footer);
   } else {
@@ -107,11 +112,25 @@ void Table::ReadMeta(const Footer& footer) {
   Block* meta = new Block(contents);
 
   Iterator* iter = meta->NewIterator(BytewiseComparator());
-  std::string key = "filter.";
+  std::string key = "fullfilter.";
   key.append(rep_->options.filter_policy->Name());
   iter->Seek(key);
   if (iter->Valid() && iter->key() == Slice(key)) {
     ReadFilter(iter->value());
+    rep_->full_filter = (rep_->filter != NULL);
+  } else {
+    key = "filter.";
+    key.append(rep_->options.filter_policy->Name());
+    iter->Seek(key);
+    if (iter->Valid() && iter->key() == Slice(key)) {
+      ReadFilter(iter->value());
+    }
+  }
+  if (rep_->filter != NULL && rep_->options.prefix_extractor != NULL) {
+    key = "prefix.";
+    key.append(rep_->options.prefix_extractor->Name());
+    iter->Seek(key);
+    rep_->prefix_filtered = iter->Valid() && iter->key() == Slice(key);
   }
   delete iter;
   delete meta;
@@ -227,11 +246,14 @@ Status Table::InternalGet(const ReadOptions& options, const Slice& k,
                           void* arg,
                           void (*saver)(void*, const Slice&, const Slice&)) {
   Status s;
+  if (rep_->full_filter && !rep_->filter->KeyMayMatch(0, k)) {
+    return s;  // Not found, without looking at the index
+  }
   Iterator* iiter = rep_->index_block->NewIterator(rep_->options.comparator);
   iiter->Seek(k);
   if (iiter->Valid()) {
     Slice handle_value = iiter->value();
-    FilterBlockReader* filter = rep_->filter;
+    FilterBlockReader* filter = rep_->full_filter ? NULL : rep_->filter;
     BlockHandle handle;
     if (filter != NULL &&
         handle.DecodeFrom(&handle_value).ok() &&
@@ -254,6 +276,31 @@ Status Table::InternalGet(const ReadOptions& options, const Slice& k,
   return s;
 }
 
+bool Table::PrefixMayMatch(const Slice& k) {
+  if (!rep_->prefix_filtered) {
+    return true;
+  }
+  if (rep_->full_filter) {
+    return rep_->filter->KeyMayMatch(0, k);
+  }
+  // The first key of the prefix is in the block found by the index or,
+  // if the index key is past the end of that block, in the next one
+  bool may_match = false;
+  Iterator* iiter = rep_->index_block->NewIterator(rep_->options.comparator);
+  iiter->Seek(k);
+  for (int i = 0; i < 2 && iiter->Valid() && !may_match; i++) {
+    Slice handle_value = iiter->value();
+    BlockHandle handle;
+    may_match = !handle.DecodeFrom(&handle_value).ok() ||
+                rep_->filter->KeyMayMatch(handle.offset(), k);
+    iiter->Next();
+  }
+  if (!iiter->status().ok()) {
+    may_match = true;
+  }
+  delete iiter;
+  return may_match;
+}
 
 uint64_t Table::ApproximateOffsetOf(const Slice& key) const {
   Iterator* index_iter =
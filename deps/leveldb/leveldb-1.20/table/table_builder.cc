@@ -5,18 +5,82 @@
 #include "leveldb/table_builder.h"
 
 #include <assert.h>
+#include <deque>
+#include <vector>
 #include "leveldb/comparator.h"
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
 #include "leveldb/options.h"
+#include "leveldb/slice_transform.h"
 #include "table/block_builder.h"
 #include "table/filter_block.h"
 #include "table/format.h"
 #include "util/coding.h"
 #include "util/crc32c.h"
+#include "util/mutexlock.h"
+#include "util/thread_pool.h"
 
 namespace leveldb {
 
+// Compress "raw" as "type" asks into *compressed if that is worth it.
+// Stores the contents to write in *contents and returns their type.
+static CompressionType CompressBlock(const Slice& raw, CompressionType type,
+                                     std::string* compressed,
+                                     Slice* contents) {
+  // TODO(postrelease): Support more compression options: zlib?
+  switch (type) {
+    case kNoCompression:
+      *contents = raw;
+      break;
+
+    case kSnappyCompression: {
+      if (port::Snappy_Compress(raw.data(), raw.size(), compressed) &&
+          compressed->size() < raw.size() - (raw.size() / 8u)) {
+        *contents = *compressed;
+      } else {
+        // Snappy not supported, or compressed less than 12.5%, so just
+        // store uncompressed form
+        *contents = raw;
+        type = kNoCompression;
+      }
+      break;
+    }
+  }
+  return type;
+}
+
+static void EncodeBlockTrailer(const Slice& contents, CompressionType type,
+                               char* trailer) {
+  trailer[0] = type;
+  uint32_t crc = crc32c::Value(contents.data(), contents.size());
+  crc = crc32c::Extend(crc, trailer, 1);  // Extend crc to cover block type
+  EncodeFixed32(trailer+1, crc32c::Mask(crc));
+}
+
+namespace {
+// A data block compressed by the compression threads, waiting to be
+// written to the file and added to the index block in order.
+struct PendingBlock {
+  std::string raw;
+  std::string compressed;
+  Slice contents;         // Points into raw or compressed
+  char trailer[kBlockTrailerSize];
+  bool done;              // Compressed and checksummed
+
+  // Keys of the block for the filter block, in the format of
+  // FilterBlockBuilder.
+  std::string keys;
+  std::vector<size_t> key_starts;
+
+  bool written;
+  BlockHandle handle;
+  bool has_index_key;     // Is the first key of the next block known?
+  std::string index_key;
+
+  PendingBlock() : done(false), written(false), has_index_key(false) { }
+};
+}  // namespace
+
 struct TableBuilder::Rep {
   Options options;
   Options index_block_options;
@@ -44,7 +108,25 @@ struct TableBuilder::Rep {
 
   std::string compressed_output;
 
-  Rep(const Options& opt, WritableFile* f)
+  // With options.compression_threads > 1, data blocks are compressed
+  // and checksummed on the threads of "pool", by up to that many
+  // CompressionWork() calls at a time.  "blocks" holds the ones not yet
+  // added to the index block, in file order.  Only the thread building
+  // the table uses it; the compression work only takes blocks from
+  // "work" and sets their "done" flag, both under "mu".
+  bool parallel;
+  ThreadPool* pool;
+  ThreadPool* own_pool;       // Pool of this builder, if none is shared
+  std::deque<PendingBlock*> blocks;
+  uint64_t pending_bytes;     // Raw size of the blocks not yet written
+  std::string filter_keys;    // Filter keys of data_block
+  std::vector<size_t> filter_key_starts;
+  port::Mutex mu;
+  port::CondVar done_cv;      // Signalled when a block or the work is done
+  std::deque<PendingBlock*> work;
+  int live_workers;           // CompressionWork() calls not yet returned
+
+  Rep(const Options& opt, WritableFile* f, ThreadPool* shared_pool)
       : options(opt),
         index_block_options(opt),
         file(f),
@@ -54,14 +136,52 @@ struct TableBuilder::Rep {
         num_entries(0),
         closed(false),
         filter_block(opt.filter_policy == NULL ? NULL
-                     : new FilterBlockBuilder(opt.filter_policy)),
-        pending_index_entry(false) {
+                     : new FilterBlockBuilder(opt.filter_policy,
+                                                opt.full_table_filter)),
+        pending_index_entry(false),
+        parallel(opt.compression_threads > 1),
+        pool(shared_pool),
+        own_pool(NULL),
+        pending_bytes(0),
+        done_cv(&mu),
+        live_workers(0) {
     index_block_options.block_restart_interval = 1;
+    if (parallel && pool == NULL) {
+      own_pool = new ThreadPool(opt.env, opt.compression_threads);
+      pool = own_pool;
+    }
+  }
+
+  // Compresses the queued blocks until there are none left
+  static void CompressionWork(void* arg) {
+    Rep* r = reinterpret_cast<Rep*>(arg);
+    MutexLock l(&r->mu);
+    while (!r->work.empty()) {
+      PendingBlock* b = r->work.front();
+      r->work.pop_front();
+      r->mu.Unlock();
+      CompressionType type = CompressBlock(b->raw, r->options.compression,
+                                           &b->compressed, &b->contents);
+      EncodeBlockTrailer(b->contents, type, b->trailer);
+      r->mu.Lock();
+      b->done = true;
+      r->done_cv.SignalAll();
+    }
+    r->live_workers--;
+    r->done_cv.SignalAll();
   }
 };
 
 TableBuilder::TableBuilder(const Options& options, WritableFile* file)
-    : rep_(new Rep(options, file)) {
+    : rep_(new Rep(options, file, NULL)) {
+  if (rep_->filter_block != NULL) {
+    rep_->filter_block->StartBlock(0);
+  }
+}
+
+TableBuilder::TableBuilder(const Options& options, WritableFile* file,
+                           ThreadPool* compression_pool)
+    : rep_(new Rep(options, file, compression_pool)) {
   if (rep_->filter_block != NULL) {
     rep_->filter_block->StartBlock(0);
   }
@@ -69,7 +189,12 @@ TableBuilder::TableBuilder(const Options& options, WritableFile* file)
 
 TableBuilder::~TableBuilder() {
   assert(rep_->closed);  // Catch errors where caller forgot to call Finish()
+  assert(rep_->live_workers == 0);
+  for (size_t i = 0; i < rep_->blocks.size(); i++) {
+    delete rep_->blocks[i];
+  }
   delete rep_->filter_block;
+  delete rep_->own_pool;
   delete rep_;
 }
 
@@ -80,6 +205,14 @@ Status TableBuilder::ChangeOptions(const Options& options) {
   if (options.comparator != rep_->options.comparator) {
     return Status::InvalidArgument("changing comparator while building table");
   }
+  if (options.compression_threads != rep_->options.compression_threads) {
+    return Status::InvalidArgument(
+        "changing compression threads while building table");
+  }
+  if (options.full_table_filter != rep_->options.full_table_filter) {
+    return Status::InvalidArgument(
+        "changing filter format while building table");
+  }
 
   // Note that any live BlockBuilders point to rep_->options and therefore
   // will automatically pick up the updated options.
@@ -100,14 +233,28 @@ void TableBuilder::Add(const Slice& key, const Slice& value) {
   if (r->pending_index_entry) {
     assert(r->data_block.empty());
     r->options.comparator->FindShortestSeparator(&r->last_key, key);
-    std::string handle_encoding;
-    r->pending_handle.EncodeTo(&handle_encoding);
-    r->index_block.Add(r->last_key, Slice(handle_encoding));
+    if (r->parallel) {
+      // Added to the index block once the block has been written
+      PendingBlock* b = r->blocks.back();
+      b->index_key = r->last_key;
+      b->has_index_key = true;
+    } else {
+      std::string handle_encoding;
+      r->pending_handle.EncodeTo(&handle_encoding);
+      r->index_block.Add(r->last_key, Slice(handle_encoding));
+    }
     r->pending_index_entry = false;
   }
 
   if (r->filter_block != NULL) {
-    r->filter_block->AddKey(key);
+    if (r->parallel) {
+      // The filter block needs the offset of the data block, which is
+      // only known once the blocks before it have been compressed.
+      r->filter_key_starts.push_back(r->filter_keys.size());
+      r->filter_keys.append(key.data(), key.size());
+    } else {
+      r->filter_block->AddKey(key);
+    }
   }
 
   r->last_key.assign(key.data(), key.size());
@@ -126,6 +273,26 @@ void TableBuilder::Flush() {
   if (!ok()) return;
   if (r->data_block.empty()) return;
   assert(!r->pending_index_entry);
+  if (r->parallel) {
+    PendingBlock* b = new PendingBlock;
+    b->raw = r->data_block.Finish().ToString();
+    b->keys.swap(r->filter_keys);
+    b->key_starts.swap(r->filter_key_starts);
+    r->data_block.Reset();
+    r->blocks.push_back(b);
+    r->pending_bytes += b->raw.size();
+    r->pending_index_entry = true;
+    {
+      MutexLock l(&r->mu);
+      r->work.push_back(b);
+      if (r->live_workers < r->options.compression_threads) {
+        r->live_workers++;
+        r->pool->Schedule(&Rep::CompressionWork, r);
+      }
+    }
+    WritePendingBlocks(false);
+    return;
+  }
   WriteBlock(&r->data_block, &r->pending_handle);
   if (ok()) {
     r->pending_index_entry = true;
@@ -136,6 +303,67 @@ void TableBuilder::Flush() {
   }
 }
 
+void TableBuilder::WritePendingBlocks(bool wait) {
+  Rep* r = rep_;
+  // Keep the memory held by blocks in flight bounded
+  const size_t max_pending = 2 * r->options.compression_threads;
+  while (!r->blocks.empty()) {
+    PendingBlock* b = r->blocks.front();
+    if (!b->written) {
+      {
+        MutexLock l(&r->mu);
+        while (!b->done) {
+          if (!wait && r->blocks.size() <= max_pending) {
+            return;
+          }
+          r->done_cv.Wait();
+        }
+      }
+      if (ok()) {
+        if (r->filter_block != NULL) {
+          r->filter_block->StartBlock(r->offset);
+          for (size_t i = 0; i < b->key_starts.size(); i++) {
+            const size_t start = b->key_starts[i];
+            const size_t limit = (i + 1 < b->key_starts.size()
+                                  ? b->key_starts[i + 1] : b->keys.size());
+            r->filter_block->AddKey(Slice(b->keys.data() + start,
+                                          limit - start));
+          }
+        }
+        AppendBlock(b->contents, b->trailer, &b->handle);
+        if (ok()) {
+          r->status = r->file->Flush();
+        }
+        if (r->filter_block != NULL) {
+          r->filter_block->StartBlock(r->offset);
+        }
+      }
+      b->written = true;
+      r->pending_bytes -= b->raw.size();
+    }
+    if (!b->has_index_key) {
+      // The last block, until the next key or Finish() comes
+      break;
+    }
+    if (ok()) {
+      std::string handle_encoding;
+      b->handle.EncodeTo(&handle_encoding);
+      r->index_block.Add(b->index_key, Slice(handle_encoding));
+    }
+    r->blocks.pop_front();
+    delete b;
+  }
+}
+
+void TableBuilder::StopCompression() {
+  Rep* r = rep_;
+  MutexLock l(&r->mu);
+  r->work.clear();
+  while (r->live_workers > 0) {
+    r->done_cv.Wait();
+  }
+}
+
 void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
   // File format contains a sequence of blocks where each block has:
   //    block_data: uint8[n]
@@ -146,27 +374,9 @@ void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
   Slice raw = block->Finish();
 
   Slice block_contents;
-  CompressionType type = r->options.compression;
-  // TODO(postrelease): Support more compression options: zlib?
-  switch (type) {
-    case kNoCompression:
-      block_contents = raw;
-      break;
-
-    case kSnappyCompression: {
-      std::string* compressed = &r->compressed_output;
-      if (port::Snappy_Compress(raw.data(), raw.size(), compressed) &&
-          compressed->size() < raw.size() - (raw.size() / 8u)) {
-        block_contents = *compressed;
-      } else {
-        // Snappy not supported, or compressed less than 12.5%, so just
-        // store uncompressed form
-        block_contents = raw;
-        type = kNoCompression;
-      }
-      break;
-    }
-  }
+  CompressionType type = CompressBlock(raw, r->options.compression,
+                                       &r->compressed_output,
+                                       &block_contents);
   WriteRawBlock(block_contents, type, handle);
   r->compressed_output.clear();
   block->Reset();
@@ -175,16 +385,19 @@ void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
 void TableBuilder::WriteRawBlock(const Slice& block_contents,
                                  CompressionType type,
                                  BlockHandle* handle) {
+  char trailer[kBlockTrailerSize];
+  EncodeBlockTrailer(block_contents, type, trailer);
+  AppendBlock(block_contents, trailer, handle);
+}
+
+void TableBuilder::AppendBlock(const Slice& block_contents,
+                               const char* trailer,
+                               BlockHandle* handle) {
   Rep* r = rep_;
   handle->set_offset(r->offset);
   handle->set_size(block_contents.size());
   r->status = r->file->Append(block_contents);
   if (r->status.ok()) {
-    char trailer[kBlockTrailerSize];
-    trailer[0] = type;
-    uint32_t crc = crc32c::Value(block_contents.data(), block_contents.size());
-    crc = crc32c::Extend(crc, trailer, 1);  // Extend crc to cover block type
-    EncodeFixed32(trailer+1, crc32c::Mask(crc));
     r->status = r->file->Append(Slice(trailer, kBlockTrailerSize));
     if (r->status.ok()) {
       r->offset += block_contents.size() + kBlockTrailerSize;
@@ -202,6 +415,18 @@ Status TableBuilder::Finish() {
   assert(!r->closed);
   r->closed = true;
 
+  if (r->parallel) {
+    if (r->pending_index_entry) {
+      PendingBlock* b = r->blocks.back();
+      b->index_key = r->last_key;
+      r->options.comparator->FindShortSuccessor(&b->index_key);
+      b->has_index_key = true;
+      r->pending_index_entry = false;
+    }
+    WritePendingBlocks(true);
+    StopCompression();
+  }
+
   BlockHandle filter_block_handle, metaindex_block_handle, index_block_handle;
 
   // Write filter block
@@ -214,12 +439,21 @@ Status TableBuilder::Finish() {
   if (ok()) {
     BlockBuilder meta_index_block(&r->options);
     if (r->filter_block != NULL) {
-      // Add mapping from "filter.Name" to location of filter data
-      std::string key = "filter.";
+      // Add mapping from "filter.Name" (or "fullfilter.Name" for a
+      // single filter over the whole table) to location of filter data
+      std::string key = r->options.full_table_filter ? "fullfilter."
+                                                     : "filter.";
       key.append(r->options.filter_policy->Name());
       std::string handle_encoding;
       filter_block_handle.EncodeTo(&handle_encoding);
       meta_index_block.Add(key, handle_encoding);
+
+      // Record that the filter holds the prefixes of the keys too
+      if (r->options.prefix_extractor != NULL) {
+        key = "prefix.";
+        key.append(r->options.prefix_extractor->Name());
+        meta_index_block.Add(key, Slice());
+      }
     }
 
     // TODO(postrelease): Add stats and other meta blocks
@@ -257,6 +491,9 @@ void TableBuilder::Abandon() {
   Rep* r = rep_;
   assert(!r->closed);
   r->closed = true;
+  if (r->parallel) {
+    StopCompression();
+  }
 }
 
 uint64_t TableBuilder::NumEntries() const {
@@ -264,7 +501,8 @@ uint64_t TableBuilder::NumEntries() const {
 }
 
 uint64_t TableBuilder::FileSize() const {
-  return rep_->offset;
+  // Blocks still being compressed are counted at their raw size
+  return rep_->offset + rep_->pending_bytes;
 }
 
 }  // namespace leveldb
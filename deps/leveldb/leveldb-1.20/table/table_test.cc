@@ -11,6 +11,7 @@
 #include "db/write_batch_internal.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
+#include "leveldb/filter_policy.h"
 #include "leveldb/iterator.h"
 #include "leveldb/table_builder.h"
 #include "table/block.h"
@@ -869,6 +870,43 @@ TEST(TableTest, ApproximateOffsetOfCompressed) {
   ASSERT_TRUE(Between(c.ApproximateOffsetOf("xyz"), 2 * min_z, 2 * max_z));
 }
 
+static std::string BuildTable(const Options& options,
+                              const std::vector<std::string>& keys,
+                              const std::vector<std::string>& values) {
+  StringSink sink;
+  TableBuilder builder(options, &sink);
+  for (size_t i = 0; i < keys.size(); i++) {
+    builder.Add(keys[i], values[i]);
+  }
+  ASSERT_OK(builder.Finish());
+  ASSERT_EQ(sink.contents().size(), builder.FileSize());
+  return sink.contents();
+}
+
+TEST(TableTest, ParallelCompressionMatchesSerial) {
+  Random rnd(301);
+  std::vector<std::string> keys, values;
+  std::string tmp;
+  for (int i = 0; i < 2000; i++) {
+    char buf[100];
+    snprintf(buf, sizeof(buf), "key%06d", i);
+    keys.push_back(buf);
+    values.push_back(test::CompressibleString(&rnd, 0.5, rnd.Uniform(500),
+                                              &tmp).ToString());
+  }
+
+  const FilterPolicy* filter_policy = NewBloomFilterPolicy(10);
+  Options options;
+  options.block_size = 1024;
+  options.filter_policy = filter_policy;
+  const std::string serial = BuildTable(options, keys, values);
+  for (int threads = 2; threads <= 4; threads++) {
+    options.compression_threads = threads;
+    ASSERT_TRUE(BuildTable(options, keys, values) == serial);
+  }
+  delete filter_policy;
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
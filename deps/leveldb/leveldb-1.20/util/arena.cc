@@ -4,6 +4,7 @@
 
 #include "util/arena.h"
 #include <assert.h>
+#include "util/mutexlock.h"
 
 namespace leveldb {
 
@@ -57,6 +58,16 @@ char* Arena::AllocateAligned(size_t bytes) {
   return result;
 }
 
+char* Arena::AllocateConcurrently(size_t bytes) {
+  MutexLock l(&mu_);
+  return Allocate(bytes);
+}
+
+char* Arena::AllocateAlignedConcurrently(size_t bytes) {
+  MutexLock l(&mu_);
+  return AllocateAligned(bytes);
+}
+
 char* Arena::AllocateNewBlock(size_t block_bytes) {
   char* result = new char[block_bytes];
   blocks_.push_back(result);
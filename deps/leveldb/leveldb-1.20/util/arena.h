@@ -24,6 +24,12 @@ class Arena {
   // Allocate memory with the normal alignment guarantees provided by malloc
   char* AllocateAligned(size_t bytes);
 
+  // Thread-safe variants of Allocate() and AllocateAligned().  They may
+  // be called from several threads at once, but not at the same time as
+  // the unsynchronized variants.
+  char* AllocateConcurrently(size_t bytes);
+  char* AllocateAlignedConcurrently(size_t bytes);
+
   // Returns an estimate of the total memory usage of data allocated
   // by the arena.
   size_t MemoryUsage() const {
@@ -44,6 +50,9 @@ class Arena {
   // Total memory usage of the arena.
   port::AtomicPointer memory_usage_;
 
+  // Serializes the *Concurrently() allocations.
+  port::Mutex mu_;
+
   // No copying allowed
   Arena(const Arena&);
   void operator=(const Arena&);
@@ -0,0 +1,185 @@
+// Copyright (c) 2012 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A bloom filter that keeps all the bits of a key within one 64-byte
+// cache line, so a probe costs a single cache miss.  The line is chosen
+// from the hash of the key and the bits within the line are taken from
+// the top bits of the hash multiplied by a fixed odd constant per probe,
+// which lets the probes be computed in parallel.
+//
+// Filter layout:
+//     [line 0] ... [line N-1]       : 64 bytes each
+//     [number of probes]            : 1 byte
+
+#include "util/blocked_bloom.h"
+
+#include "leveldb/filter_policy.h"
+#include "leveldb/slice.h"
+#include "util/hash.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+// The AVX2 probe is compiled through a function attribute and picked at
+// runtime, so that it needs no build flags.
+#define LEVELDB_BLOCKED_BLOOM_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace leveldb {
+
+namespace {
+
+static const size_t kLineBytes = 64;
+static const size_t kLineBits = kLineBytes * 8;
+static const size_t kMaxProbes = 16;
+
+// One odd multiplier per probe: bit (h * kSalt[i]) >> 23 of the line
+static const uint32_t kSalt[kMaxProbes] = {
+  0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+  0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U,
+  0x9e3779b1U, 0x85ebca6bU, 0xc2b2ae35U, 0x27d4eb2fU,
+  0x165667b1U, 0xd3a2646dU, 0xfd7046c5U, 0xb55a4f09U
+};
+
+static uint32_t BlockedBloomHash(const Slice& key) {
+  return Hash(key.data(), key.size(), 0xbc9f1d34);
+}
+
+static size_t LineIndex(uint32_t h, size_t lines) {
+  // Maps h onto [0, lines) without a division
+  return static_cast<size_t>((static_cast<uint64_t>(h) * lines) >> 32);
+}
+
+static bool ProbeLine(const char* line, uint32_t h, size_t k) {
+  for (size_t i = 0; i < k; i++) {
+    const uint32_t bitpos = (h * kSalt[i]) >> 23;
+    if ((line[bitpos / 8] & (1 << (bitpos % 8))) == 0) return false;
+  }
+  return true;
+}
+
+#if defined(LEVELDB_BLOCKED_BLOOM_AVX2)
+// Tests eight probes at a time.  The line is read as sixteen little-endian
+// 32-bit words, which holds the same bits as the bytes ProbeLine() reads.
+__attribute__((target("avx2")))
+static bool ProbeLineAVX2(const char* line, uint32_t h, size_t k) {
+  const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(line));
+  const __m256i hi = _mm256_loadu_si256(
+      reinterpret_cast<const __m256i*>(line + 32));
+  const __m256i hash = _mm256_set1_epi32(static_cast<int>(h));
+  const __m256i probes = _mm256_set1_epi32(static_cast<int>(k));
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i low5 = _mm256_set1_epi32(31);
+  __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  for (size_t i = 0; i < k; i += 8) {
+    const __m256i salt = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(kSalt + i));
+    const __m256i bitpos = _mm256_srli_epi32(_mm256_mullo_epi32(hash, salt),
+                                             23);
+    // Word 0-15 of the line: the low three bits pick the word within each
+    // half, the fourth bit picks the half
+    const __m256i word = _mm256_srli_epi32(bitpos, 5);
+    const __m256i value = _mm256_castps_si256(_mm256_blendv_ps(
+        _mm256_castsi256_ps(_mm256_permutevar8x32_epi32(lo, word)),
+        _mm256_castsi256_ps(_mm256_permutevar8x32_epi32(hi, word)),
+        _mm256_castsi256_ps(_mm256_slli_epi32(word, 28))));
+    __m256i bit = _mm256_sllv_epi32(one, _mm256_and_si256(bitpos, low5));
+    // Lanes past the last probe test no bit
+    bit = _mm256_and_si256(bit, _mm256_cmpgt_epi32(probes, lane));
+    if (!_mm256_testc_si256(value, bit)) return false;
+    lane = _mm256_add_epi32(lane, _mm256_set1_epi32(8));
+  }
+  return true;
+}
+
+static bool HaveAVX2() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+#endif  // defined(LEVELDB_BLOCKED_BLOOM_AVX2)
+
+class BlockedBloomFilterPolicy : public FilterPolicy {
+ private:
+  size_t bits_per_key_;
+  size_t k_;
+  bool avx2_;
+
+ public:
+  BlockedBloomFilterPolicy(int bits_per_key, bool allow_avx2)
+      : bits_per_key_(bits_per_key < 1 ? 1 : bits_per_key),
+        avx2_(false) {
+    k_ = static_cast<size_t>(bits_per_key_ * 0.69);  // 0.69 =~ ln(2)
+    if (k_ < 1) k_ = 1;
+    if (k_ > kMaxProbes) k_ = kMaxProbes;
+#if defined(LEVELDB_BLOCKED_BLOOM_AVX2)
+    avx2_ = allow_avx2 && HaveAVX2();
+#endif
+  }
+
+  virtual const char* Name() const {
+    return "leveldb.BlockedBloomFilter";
+  }
+
+  virtual void CreateFilter(const Slice* keys, int n, std::string* dst) const {
+    const size_t bits = n * bits_per_key_;
+    const size_t lines = (bits + kLineBits - 1) / kLineBits + (n == 0);
+
+    const size_t init_size = dst->size();
+    dst->resize(init_size + lines * kLineBytes, 0);
+    dst->push_back(static_cast<char>(k_));  // Remember # of probes in filter
+    char* array = &(*dst)[init_size];
+    for (int i = 0; i < n; i++) {
+      const uint32_t h = BlockedBloomHash(keys[i]);
+      char* line = array + LineIndex(h, lines) * kLineBytes;
+      for (size_t j = 0; j < k_; j++) {
+        const uint32_t bitpos = (h * kSalt[j]) >> 23;
+        line[bitpos / 8] |= (1 << (bitpos % 8));
+      }
+    }
+  }
+
+  virtual bool KeyMayMatch(const Slice& key, const Slice& filter) const {
+    const size_t len = filter.size();
+    if (len < kLineBytes + 1) return false;
+    if ((len - 1) % kLineBytes != 0) {
+      return true;  // Not a filter of this policy: consider it a match
+    }
+
+    const char* array = filter.data();
+    const size_t k = static_cast<unsigned char>(array[len-1]);
+    if (k > kMaxProbes) {
+      // Reserved for potentially new encodings.  Consider it a match.
+      return true;
+    }
+
+    const uint32_t h = BlockedBloomHash(key);
+    const char* line = array + LineIndex(h, (len - 1) / kLineBytes) *
+                               kLineBytes;
+#if defined(LEVELDB_BLOCKED_BLOOM_AVX2)
+    if (avx2_) {
+      return ProbeLineAVX2(line, h, k);
+    }
+#endif
+    return ProbeLine(line, h, k);
+  }
+};
+
+}  // namespace
+
+const FilterPolicy* NewBlockedBloomFilterPolicy(int bits_per_key) {
+  return new BlockedBloomFilterPolicy(bits_per_key, true);
+}
+
+const FilterPolicy* NewPortableBlockedBloomFilterPolicy(int bits_per_key) {
+  return new BlockedBloomFilterPolicy(bits_per_key, false);
+}
+
+bool BlockedBloomProbesUseAVX2() {
+#if defined(LEVELDB_BLOCKED_BLOOM_AVX2)
+  return HaveAVX2();
+#else
+  return false;
+#endif
+}
+
+}  // namespace leveldb
@@ -0,0 +1,23 @@
+// Copyright (c) 2012 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_UTIL_BLOCKED_BLOOM_H_
+#define STORAGE_LEVELDB_UTIL_BLOCKED_BLOOM_H_
+
+namespace leveldb {
+
+class FilterPolicy;
+
+// Returns true if the filters of NewBlockedBloomFilterPolicy() are probed
+// with AVX2 instructions on this CPU.
+extern bool BlockedBloomProbesUseAVX2();
+
+// Like NewBlockedBloomFilterPolicy(), but the filters are always probed
+// without AVX2 instructions, so that tests can compare both probes.
+extern const FilterPolicy* NewPortableBlockedBloomFilterPolicy(
+    int bits_per_key);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_BLOCKED_BLOOM_H_
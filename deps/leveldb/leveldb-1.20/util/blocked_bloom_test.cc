@@ -0,0 +1,131 @@
+// Copyright (c) 2012 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "util/blocked_bloom.h"
+
+#include "leveldb/filter_policy.h"
+#include "util/filter_testutil.h"
+#include "util/logging.h"
+#include "util/testharness.h"
+#include "util/testutil.h"
+
+namespace leveldb {
+
+typedef test::FilterTest<NewBlockedBloomFilterPolicy> BlockedBloomTest;
+
+TEST(BlockedBloomTest, EmptyFilter) {
+  ASSERT_TRUE(! Matches("hello"));
+  Build();
+  ASSERT_EQ(static_cast<size_t>(65), FilterSize());
+  ASSERT_TRUE(! Matches("hello"));
+  ASSERT_TRUE(! Matches("world"));
+}
+
+TEST(BlockedBloomTest, Small) {
+  Add("hello");
+  Add("world");
+  ASSERT_TRUE(Matches("hello"));
+  ASSERT_TRUE(Matches("world"));
+  ASSERT_TRUE(! Matches("x"));
+  ASSERT_TRUE(! Matches("foo"));
+}
+
+TEST(BlockedBloomTest, VaryingLengths) {
+  char buffer[sizeof(int)];
+
+  // Count number of filters that significantly exceed the false positive rate
+  int mediocre_filters = 0;
+  int good_filters = 0;
+
+  for (int length = 1; length <= 10000; length = NextLength(length)) {
+    Reset();
+    for (int i = 0; i < length; i++) {
+      Add(Key(i, buffer));
+    }
+    Build();
+
+    ASSERT_LE(FilterSize(), static_cast<size_t>((length * 10 / 8) + 65))
+        << length;
+
+    // All added keys must match
+    for (int i = 0; i < length; i++) {
+      ASSERT_TRUE(Matches(Key(i, buffer)))
+          << "Length " << length << "; key " << i;
+    }
+
+    // Check false positive rate
+    double rate = FalsePositiveRate();
+    if (kVerbose >= 1) {
+      fprintf(stderr, "False positives: %5.2f%% @ length = %6d ; bytes = %6d\n",
+              rate*100.0, length, static_cast<int>(FilterSize()));
+    }
+    ASSERT_LE(rate, 0.02);   // Must not be over 2%
+    if (rate > 0.0125) mediocre_filters++;  // Allowed, but not too often
+    else good_filters++;
+  }
+  if (kVerbose >= 1) {
+    fprintf(stderr, "Filters: %d good, %d mediocre\n",
+            good_filters, mediocre_filters);
+  }
+  ASSERT_LE(mediocre_filters, good_filters/5);
+}
+
+TEST(BlockedBloomTest, BitsPerKey) {
+  char buffer[sizeof(int)];
+  // From one probe up to the maximum number of probes
+  const int bits[] = { 1, 4, 12, 16, 23, 40 };
+  double last_rate = 1.0;
+  for (size_t b = 0; b < sizeof(bits) / sizeof(bits[0]); b++) {
+    SetBitsPerKey(bits[b]);
+    for (int i = 0; i < 5000; i++) {
+      Add(Key(i, buffer));
+    }
+    Build();
+    for (int i = 0; i < 5000; i++) {
+      ASSERT_TRUE(Matches(Key(i, buffer))) << bits[b] << "; key " << i;
+    }
+    const double rate = FalsePositiveRate();
+    if (kVerbose >= 1) {
+      fprintf(stderr, "False positives: %5.2f%% @ bits per key = %d\n",
+              rate*100.0, bits[b]);
+    }
+    ASSERT_LE(rate, last_rate);
+    last_rate = rate;
+  }
+}
+
+TEST(BlockedBloomTest, PortableProbe) {
+  if (!BlockedBloomProbesUseAVX2()) {
+    fprintf(stderr, "skipping: the filters are probed without AVX2\n");
+    return;
+  }
+  char buffer[sizeof(int)];
+  // One to eight probes take the first AVX2 step, more take two
+  const int bits[] = { 1, 4, 10, 12, 16, 23, 40 };
+  for (size_t b = 0; b < sizeof(bits) / sizeof(bits[0]); b++) {
+    SetBitsPerKey(bits[b]);
+    const FilterPolicy* portable = NewPortableBlockedBloomFilterPolicy(bits[b]);
+    for (int length = 1; length <= 10000; length = NextLength(length)) {
+      Reset();
+      for (int i = 0; i < length; i++) {
+        Add(Key(i, buffer));
+      }
+      Build();
+      // Both probes see the same bits, of added keys and missing ones
+      for (int i = 0; i < 2 * length + 1000; i++) {
+        const Slice key = Key(i, buffer);
+        ASSERT_EQ(portable->KeyMayMatch(key, filter()),
+                  policy()->KeyMayMatch(key, filter()))
+            << bits[b] << "; length " << length << "; key " << i;
+      }
+    }
+    delete portable;
+  }
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
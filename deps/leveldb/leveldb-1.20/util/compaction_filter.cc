@@ -0,0 +1,66 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/compaction_filter.h"
+
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+CompactionFilter::~CompactionFilter() { }
+
+namespace {
+
+class KeyPrefixRemovingFilter : public CompactionFilter {
+ private:
+  const std::string prefix_;
+
+ public:
+  explicit KeyPrefixRemovingFilter(const Slice& prefix)
+      : prefix_(prefix.data(), prefix.size()) { }
+
+  virtual const char* Name() const {
+    return "leveldb.RemoveKeyPrefix";
+  }
+
+  virtual Decision Filter(int level, const Slice& key, const Slice& value,
+                          std::string* new_value) const {
+    return key.starts_with(prefix_) ? kRemove : kKeep;
+  }
+};
+
+class ValuePrefixStrippingFilter : public CompactionFilter {
+ private:
+  const std::string prefix_;
+
+ public:
+  explicit ValuePrefixStrippingFilter(const Slice& prefix)
+      : prefix_(prefix.data(), prefix.size()) { }
+
+  virtual const char* Name() const {
+    return "leveldb.StripValuePrefix";
+  }
+
+  virtual Decision Filter(int level, const Slice& key, const Slice& value,
+                          std::string* new_value) const {
+    if (prefix_.empty() || !value.starts_with(prefix_)) {
+      return kKeep;
+    }
+    new_value->assign(value.data() + prefix_.size(),
+                      value.size() - prefix_.size());
+    return kChangeValue;
+  }
+};
+
+}  // namespace
+
+const CompactionFilter* NewKeyPrefixRemovingFilter(const Slice& prefix) {
+  return new KeyPrefixRemovingFilter(prefix);
+}
+
+const CompactionFilter* NewValuePrefixStrippingFilter(const Slice& prefix) {
+  return new ValuePrefixStrippingFilter(prefix);
+}
+
+}  // namespace leveldb
@@ -7,6 +7,7 @@
 #include "leveldb/comparator.h"
 #include "leveldb/slice.h"
 #include "port/port.h"
+#include "util/coding.h"
 #include "util/logging.h"
 
 namespace leveldb {
@@ -64,13 +65,219 @@ class BytewiseComparatorImpl : public Comparator {
     // *key is a run of 0xffs.  Leave it alone.
   }
 };
+
+class ReverseBytewiseComparatorImpl : public Comparator {
+ public:
+  ReverseBytewiseComparatorImpl() { }
+
+  virtual const char* Name() const {
+    return "leveldb.ReverseBytewiseComparator";
+  }
+
+  virtual int Compare(const Slice& a, const Slice& b) const {
+    return -a.compare(b);
+  }
+
+  virtual void FindShortestSeparator(
+      std::string* start,
+      const Slice& limit) const {
+    // Byte-wise, limit < *start here, so the prefix of *start that ends
+    // with the first byte after the common prefix still sorts after limit
+    size_t min_length = std::min(start->size(), limit.size());
+    size_t diff_index = 0;
+    while ((diff_index < min_length) &&
+           ((*start)[diff_index] == limit[diff_index])) {
+      diff_index++;
+    }
+
+    if (diff_index + 1 < start->size()) {
+      start->resize(diff_index + 1);
+      assert(Compare(*start, limit) < 0);
+    }
+  }
+
+  virtual void FindShortSuccessor(std::string* key) const {
+    // Every prefix of *key sorts after it
+    if (key->size() > 1) {
+      key->resize(1);
+    }
+  }
+};
+
+// The integer at the start of "key" and the number of bytes it takes
+uint64_t DecodeUint64BigEndian(const Slice& key, size_t* n) {
+  *n = std::min(key.size(), static_cast<size_t>(8));
+  uint64_t value = 0;
+  for (size_t i = 0; i < *n; i++) {
+    value = (value << 8) | static_cast<uint8_t>(key[i]);
+  }
+  return value;
+}
+
+// The shortest encoding of "value", at least one byte
+std::string EncodeUint64BigEndian(uint64_t value) {
+  char buf[8];
+  size_t n = 0;
+  do {
+    buf[7 - n++] = static_cast<char>(value & 0xff);
+    value >>= 8;
+  } while (value != 0);
+  return std::string(buf + 8 - n, n);
+}
+
+class Uint64BigEndianComparatorImpl : public Comparator {
+ public:
+  Uint64BigEndianComparatorImpl() { }
+
+  virtual const char* Name() const {
+    return "leveldb.Uint64BigEndianComparator";
+  }
+
+  virtual int Compare(const Slice& a, const Slice& b) const {
+    size_t an, bn;
+    const uint64_t av = DecodeUint64BigEndian(a, &an);
+    const uint64_t bv = DecodeUint64BigEndian(b, &bn);
+    if (av != bv) {
+      return av < bv ? -1 : +1;
+    }
+    if (an != bn) {
+      return an < bn ? -1 : +1;
+    }
+    return Slice(a.data() + an, a.size() - an).compare(
+        Slice(b.data() + bn, b.size() - bn));
+  }
+
+  virtual void FindShortestSeparator(
+      std::string* start,
+      const Slice& limit) const {
+    size_t n;
+    const uint64_t value = DecodeUint64BigEndian(*start, &n);
+    const uint64_t limit_value = DecodeUint64BigEndian(limit, &n);
+    // value + 1 cannot overflow since value < limit_value
+    if (value < limit_value && value + 1 < limit_value) {
+      std::string separator = EncodeUint64BigEndian(value + 1);
+      if (separator.size() < start->size()) {
+        start->swap(separator);
+        assert(Compare(*start, limit) < 0);
+      }
+    }
+  }
+
+  virtual void FindShortSuccessor(std::string* key) const {
+    size_t n;
+    const uint64_t value = DecodeUint64BigEndian(*key, &n);
+    if (value != ~static_cast<uint64_t>(0)) {
+      std::string successor = EncodeUint64BigEndian(value + 1);
+      if (successor.size() < key->size()) {
+        key->swap(successor);
+      }
+    }
+  }
+};
+
+// Remove the first component from "*input" into "*component" and
+// return true, or return false and take the rest of "*input" if the
+// component is truncated
+bool GetComponent(Slice* input, Slice* component) {
+  Slice rest = *input;
+  uint32_t len;
+  if (GetVarint32(&rest, &len) && len <= rest.size()) {
+    *component = Slice(rest.data(), len);
+    rest.remove_prefix(len);
+    *input = rest;
+    return true;
+  }
+  *component = *input;
+  input->remove_prefix(input->size());
+  return false;
+}
+
+class TupleComparatorImpl : public Comparator {
+ public:
+  TupleComparatorImpl() { }
+
+  virtual const char* Name() const {
+    return "leveldb.TupleComparator";
+  }
+
+  virtual int Compare(const Slice& a, const Slice& b) const {
+    Slice x = a, y = b;
+    Slice cx, cy;
+    while (!x.empty() && !y.empty()) {
+      GetComponent(&x, &cx);
+      GetComponent(&y, &cy);
+      const int r = cx.compare(cy);
+      if (r != 0) {
+        return r;
+      }
+    }
+    if (x.empty() != y.empty()) {
+      return x.empty() ? -1 : +1;
+    }
+    // Only keys with truncated components can get here unequal
+    return a.compare(b);
+  }
+
+  virtual void FindShortestSeparator(
+      std::string* start,
+      const Slice& limit) const {
+    Slice x(*start), y(limit);
+    Slice cx, cy;
+    while (!x.empty() && !y.empty()) {
+      const size_t offset = x.data() - start->data();
+      const bool complete = GetComponent(&x, &cx);
+      GetComponent(&y, &cy);
+      const int r = cx.compare(cy);
+      if (r == 0) {
+        continue;
+      }
+      if (r < 0 && complete) {
+        // Shorten the first component that differs, dropping the rest
+        std::string component = cx.ToString();
+        BytewiseComparator()->FindShortestSeparator(&component, cy);
+        if (Slice(component).compare(cx) > 0) {
+          std::string separator(start->data(), offset);
+          PutLengthPrefixedSlice(&separator, component);
+          if (separator.size() < start->size()) {
+            start->swap(separator);
+            assert(Compare(*start, limit) < 0);
+          }
+        }
+      }
+      return;
+    }
+  }
+
+  virtual void FindShortSuccessor(std::string* key) const {
+    Slice x(*key);
+    Slice first;
+    if (!GetComponent(&x, &first)) {
+      return;
+    }
+    std::string component = first.ToString();
+    BytewiseComparator()->FindShortSuccessor(&component);
+    if (Slice(component).compare(first) > 0) {
+      std::string successor;
+      PutLengthPrefixedSlice(&successor, component);
+      if (successor.size() < key->size()) {
+        key->swap(successor);
+      }
+    }
+  }
+};
 }  // namespace
 
 static port::OnceType once = LEVELDB_ONCE_INIT;
 static const Comparator* bytewise;
+static const Comparator* reverse_bytewise;
+static const Comparator* uint64_big_endian;
+static const Comparator* tuple;
 
 static void InitModule() {
   bytewise = new BytewiseComparatorImpl;
+  reverse_bytewise = new ReverseBytewiseComparatorImpl;
+  uint64_big_endian = new Uint64BigEndianComparatorImpl;
+  tuple = new TupleComparatorImpl;
 }
 
 const Comparator* BytewiseComparator() {
@@ -78,4 +285,19 @@ const Comparator* BytewiseComparator() {
   return bytewise;
 }
 
+const Comparator* ReverseBytewiseComparator() {
+  port::InitOnce(&once, InitModule);
+  return reverse_bytewise;
+}
+
+const Comparator* Uint64BigEndianComparator() {
+  port::InitOnce(&once, InitModule);
+  return uint64_big_endian;
+}
+
+const Comparator* TupleComparator() {
+  port::InitOnce(&once, InitModule);
+  return tuple;
+}
+
 }  // namespace leveldb
@@ -0,0 +1,168 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/comparator.h"
+
+#include <algorithm>
+#include <vector>
+#include "leveldb/db.h"
+#include "leveldb/slice.h"
+#include "util/coding.h"
+#include "util/random.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+class ComparatorTest {
+ public:
+  struct Less {
+    const Comparator* cmp;
+    explicit Less(const Comparator* c) : cmp(c) { }
+    bool operator()(const std::string& a, const std::string& b) const {
+      return cmp->Compare(a, b) < 0;
+    }
+  };
+
+  static std::string Tuple(const char* a, const char* b = NULL) {
+    std::string key;
+    PutLengthPrefixedSlice(&key, a);
+    if (b != NULL) {
+      PutLengthPrefixedSlice(&key, b);
+    }
+    return key;
+  }
+
+  static std::string RandomKey(Random* rnd) {
+    std::string key;
+    const int len = rnd->Uniform(12);
+    for (int i = 0; i < len; i++) {
+      // Favor bytes that exercise the edge cases
+      const int r = rnd->Uniform(4);
+      key.push_back(static_cast<char>(r == 0 ? 0 : r == 1 ? 0xff
+                                      : rnd->Uniform(256)));
+    }
+    return key;
+  }
+
+  // Check that "cmp" is a total order compatible with its separators
+  static void CheckComparator(const Comparator* cmp) {
+    Random rnd(301);
+    std::vector<std::string> keys;
+    for (int i = 0; i < 500; i++) {
+      keys.push_back(RandomKey(&rnd));
+    }
+    for (size_t i = 0; i < keys.size(); i++) {
+      const std::string& a = keys[i];
+      const std::string& b = keys[(i * 7 + 3) % keys.size()];
+      const int r = cmp->Compare(a, b);
+      ASSERT_EQ(r == 0, a == b);
+      ASSERT_EQ(r < 0, cmp->Compare(b, a) > 0);
+
+      if (r < 0) {
+        std::string separator = a;
+        cmp->FindShortestSeparator(&separator, b);
+        ASSERT_LE(cmp->Compare(a, separator), 0);
+        ASSERT_LT(cmp->Compare(separator, b), 0);
+        ASSERT_LE(separator.size(), a.size());
+      }
+
+      std::string successor = a;
+      cmp->FindShortSuccessor(&successor);
+      ASSERT_LE(cmp->Compare(a, successor), 0);
+      ASSERT_LE(successor.size(), a.size());
+    }
+
+    // Transitivity over a sorted sample
+    std::vector<std::string> sorted(keys.begin(), keys.begin() + 100);
+    std::sort(sorted.begin(), sorted.end(), Less(cmp));
+    for (size_t i = 0; i < sorted.size(); i++) {
+      for (size_t j = i + 1; j < sorted.size(); j++) {
+        ASSERT_LE(cmp->Compare(sorted[i], sorted[j]), 0);
+      }
+    }
+  }
+};
+
+TEST(ComparatorTest, ReverseBytewise) {
+  const Comparator* cmp = ReverseBytewiseComparator();
+  ASSERT_GT(cmp->Compare("a", "b"), 0);
+  ASSERT_GT(cmp->Compare("a", "ab"), 0);
+  ASSERT_EQ(0, cmp->Compare("a", "a"));
+
+  std::string s = "foobar";
+  cmp->FindShortestSeparator(&s, "fa");
+  ASSERT_EQ("fo", s);
+  s = "foo";
+  cmp->FindShortSuccessor(&s);
+  ASSERT_EQ("f", s);
+  CheckComparator(cmp);
+}
+
+TEST(ComparatorTest, Uint64BigEndian) {
+  const Comparator* cmp = Uint64BigEndianComparator();
+  ASSERT_LT(cmp->Compare("\x02", std::string("\x01\x00", 2)), 0);
+  ASSERT_LT(cmp->Compare(std::string("\x00\x00\x01", 3),
+                         std::string("\x00\x02", 2)), 0);
+  // The same value: shorter encoding first
+  ASSERT_LT(cmp->Compare("\x01", std::string("\x00\x01", 2)), 0);
+  // 8-byte integer followed by a suffix
+  const std::string one(std::string(7, '\0') + "\x01");
+  ASSERT_LT(cmp->Compare(one, one + "a"), 0);
+  ASSERT_LT(cmp->Compare(one + "b", "\x02"), 0);
+
+  std::string s = std::string(7, '\0') + "\x10";
+  cmp->FindShortestSeparator(&s,
+                             std::string(6, '\0') + std::string("\x01\x00", 2));
+  ASSERT_EQ("\x11", s);
+  s = std::string(7, '\0') + "\x10";
+  cmp->FindShortSuccessor(&s);
+  ASSERT_EQ("\x11", s);
+  CheckComparator(cmp);
+}
+
+TEST(ComparatorTest, Tuple) {
+  const Comparator* cmp = TupleComparator();
+  ASSERT_LT(cmp->Compare(Tuple("a", "z"), Tuple("ab")), 0);
+  ASSERT_LT(cmp->Compare(Tuple("a"), Tuple("a", "")), 0);
+  ASSERT_LT(cmp->Compare(Tuple("b", "a"), Tuple("b", "b")), 0);
+  ASSERT_LT(cmp->Compare(Tuple("zz", "a"), Tuple("zzz")), 0);
+
+  std::string s = Tuple("apple", "pie");
+  cmp->FindShortestSeparator(&s, Tuple("cherry"));
+  ASSERT_EQ(Tuple("b"), s);
+  s = Tuple("apple", "pie");
+  cmp->FindShortSuccessor(&s);
+  ASSERT_EQ(Tuple("b"), s);
+  CheckComparator(cmp);
+}
+
+TEST(ComparatorTest, ReopenWithOtherComparator) {
+  const std::string dbname = test::TmpDir() + "/comparator_test";
+  Options options;
+  options.create_if_missing = true;
+  options.comparator = Uint64BigEndianComparator();
+  DestroyDB(dbname, options);
+  DB* db;
+  ASSERT_OK(DB::Open(options, dbname, &db));
+  ASSERT_OK(db->Put(WriteOptions(), "\x02", "two"));
+  ASSERT_OK(db->Put(WriteOptions(), std::string("\x01\x00", 2), "256"));
+  Iterator* iter = db->NewIterator(ReadOptions());
+  iter->SeekToFirst();
+  ASSERT_EQ("two", iter->value().ToString());
+  delete iter;
+  delete db;
+
+  options.comparator = ReverseBytewiseComparator();
+  Status s = DB::Open(options, dbname, &db);
+  ASSERT_TRUE(s.IsInvalidArgument());
+  ASSERT_TRUE(s.ToString().find("Uint64BigEndianComparator") !=
+              std::string::npos);
+  DestroyDB(dbname, options);
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
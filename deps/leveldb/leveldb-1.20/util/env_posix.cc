@@ -497,6 +497,10 @@ class PosixEnv : public Env {
 
   virtual void Schedule(void (*function)(void*), void* arg);
 
+  virtual void Schedule(void (*function)(void*), void* arg, Priority pri);
+
+  virtual void IncBackgroundThreadsIfNeeded(int number, Priority pri);
+
   virtual void StartThread(void (*function)(void* arg), void* arg);
 
   virtual Status GetTestDirectory(std::string* result) {
@@ -549,22 +553,35 @@ class PosixEnv : public Env {
     }
   }
 
-  // BGThread() is the body of the background thread
-  void BGThread();
+  // BGThread() is the body of the background threads of priority "pri"
+  void BGThread(Priority pri);
+  struct BGThreadArg { PosixEnv* env; Priority pri; };
   static void* BGThreadWrapper(void* arg) {
-    reinterpret_cast<PosixEnv*>(arg)->BGThread();
+    BGThreadArg* bg = reinterpret_cast<BGThreadArg*>(arg);
+    PosixEnv* env = bg->env;
+    Priority pri = bg->pri;
+    delete bg;
+    env->BGThread(pri);
     return NULL;
   }
 
+  // Start the missing threads of priority "pri".  REQUIRES: mu_ held.
+  void StartBGThreads(Priority pri);
+
   pthread_mutex_t mu_;
-  pthread_cond_t bgsignal_;
-  pthread_t bgthread_;
-  bool started_bgthread_;
 
   // Entry per Schedule() call
   struct BGItem { void* arg; void (*function)(void*); };
   typedef std::deque<BGItem> BGQueue;
-  BGQueue queue_;
+
+  // Work items and threads of one priority
+  struct BGPool {
+    pthread_cond_t bgsignal;
+    int started_threads;
+    int max_threads;
+    BGQueue queue;
+  };
+  BGPool pools_[HIGH + 1];
 
   PosixLockTable locks_;
   Limiter mmap_limit_;
@@ -600,49 +617,77 @@ static intptr_t MaxOpenFiles() {
 }
 
 PosixEnv::PosixEnv()
-    : started_bgthread_(false),
-      mmap_limit_(MaxMmaps()),
+    : mmap_limit_(MaxMmaps()),
       fd_limit_(MaxOpenFiles()) {
   PthreadCall("mutex_init", pthread_mutex_init(&mu_, NULL));
-  PthreadCall("cvar_init", pthread_cond_init(&bgsignal_, NULL));
+  for (int pri = LOW; pri <= HIGH; pri++) {
+    PthreadCall("cvar_init", pthread_cond_init(&pools_[pri].bgsignal, NULL));
+    pools_[pri].started_threads = 0;
+    pools_[pri].max_threads = 1;
+  }
 }
 
 void PosixEnv::Schedule(void (*function)(void*), void* arg) {
-  PthreadCall("lock", pthread_mutex_lock(&mu_));
+  Schedule(function, arg, LOW);
+}
 
-  // Start background thread if necessary
-  if (!started_bgthread_) {
-    started_bgthread_ = true;
-    PthreadCall(
-        "create thread",
-        pthread_create(&bgthread_, NULL,  &PosixEnv::BGThreadWrapper, this));
-  }
+void PosixEnv::Schedule(void (*function)(void*), void* arg, Priority pri) {
+  PthreadCall("lock", pthread_mutex_lock(&mu_));
+  BGPool* pool = &pools_[pri];
 
-  // If the queue is currently empty, the background thread may currently be
-  // waiting.
-  if (queue_.empty()) {
-    PthreadCall("signal", pthread_cond_signal(&bgsignal_));
-  }
+  // Start background threads if necessary
+  StartBGThreads(pri);
 
   // Add to priority queue
-  queue_.push_back(BGItem());
-  queue_.back().function = function;
-  queue_.back().arg = arg;
+  pool->queue.push_back(BGItem());
+  pool->queue.back().function = function;
+  pool->queue.back().arg = arg;
 
+  // Wake up one of the threads that may be waiting
+  PthreadCall("signal", pthread_cond_signal(&pool->bgsignal));
+
+  PthreadCall("unlock", pthread_mutex_unlock(&mu_));
+}
+
+void PosixEnv::IncBackgroundThreadsIfNeeded(int number, Priority pri) {
+  PthreadCall("lock", pthread_mutex_lock(&mu_));
+  BGPool* pool = &pools_[pri];
+  if (number > pool->max_threads) {
+    pool->max_threads = number;
+    if (pool->started_threads > 0) {
+      StartBGThreads(pri);
+    }
+  }
   PthreadCall("unlock", pthread_mutex_unlock(&mu_));
 }
 
-void PosixEnv::BGThread() {
+void PosixEnv::StartBGThreads(Priority pri) {
+  BGPool* pool = &pools_[pri];
+  while (pool->started_threads < pool->max_threads) {
+    BGThreadArg* bg = new BGThreadArg;
+    bg->env = this;
+    bg->pri = pri;
+    pthread_t t;
+    PthreadCall(
+        "create thread",
+        pthread_create(&t, NULL,  &PosixEnv::BGThreadWrapper, bg));
+    PthreadCall("detach thread", pthread_detach(t));
+    pool->started_threads++;
+  }
+}
+
+void PosixEnv::BGThread(Priority pri) {
+  BGPool* pool = &pools_[pri];
   while (true) {
     // Wait until there is an item that is ready to run
     PthreadCall("lock", pthread_mutex_lock(&mu_));
-    while (queue_.empty()) {
-      PthreadCall("wait", pthread_cond_wait(&bgsignal_, &mu_));
+    while (pool->queue.empty()) {
+      PthreadCall("wait", pthread_cond_wait(&pool->bgsignal, &mu_));
     }
 
-    void (*function)(void*) = queue_.front().function;
-    void* arg = queue_.front().arg;
-    queue_.pop_front();
+    void (*function)(void*) = pool->queue.front().function;
+    void* arg = pool->queue.front().arg;
+    pool->queue.pop_front();
 
     PthreadCall("unlock", pthread_mutex_unlock(&mu_));
     (*function)(arg);
@@ -99,6 +99,49 @@ TEST(EnvTest, StartThread) {
   ASSERT_EQ(state.val, 3);
 }
 
+// Blocks its thread until "release" is set
+struct BlockingItem {
+  port::AtomicPointer release;
+  port::AtomicPointer running;
+
+  BlockingItem() : release(NULL), running(NULL) { }
+
+  static void Run(void* v) {
+    BlockingItem* item = reinterpret_cast<BlockingItem*>(v);
+    item->running.Release_Store(item);
+    while (item->release.Acquire_Load() == NULL) {
+      Env::Default()->SleepForMicroseconds(1000);
+    }
+    item->running.Release_Store(NULL);
+  }
+};
+
+TEST(EnvTest, HighPriorityRunsBesideLow) {
+  BlockingItem low;
+  env_->Schedule(&BlockingItem::Run, &low, Env::LOW);
+  port::AtomicPointer called(NULL);
+  env_->Schedule(&SetBool, &called, Env::HIGH);
+  env_->SleepForMicroseconds(kDelayMicros);
+  ASSERT_TRUE(called.NoBarrier_Load() != NULL);
+  ASSERT_TRUE(low.running.Acquire_Load() != NULL);
+  low.release.Release_Store(&low);
+  env_->SleepForMicroseconds(kDelayMicros);
+  ASSERT_TRUE(low.running.Acquire_Load() == NULL);
+}
+
+TEST(EnvTest, IncBackgroundThreads) {
+  env_->IncBackgroundThreadsIfNeeded(2, Env::LOW);
+  BlockingItem first, second;
+  env_->Schedule(&BlockingItem::Run, &first, Env::LOW);
+  env_->Schedule(&BlockingItem::Run, &second, Env::LOW);
+  env_->SleepForMicroseconds(kDelayMicros);
+  ASSERT_TRUE(first.running.Acquire_Load() != NULL);
+  ASSERT_TRUE(second.running.Acquire_Load() != NULL);
+  first.release.Release_Store(&first);
+  second.release.Release_Store(&second);
+  env_->SleepForMicroseconds(kDelayMicros);
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
@@ -0,0 +1,125 @@
+// Copyright (c) 2012 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_UTIL_FILTER_TESTUTIL_H_
+#define STORAGE_LEVELDB_UTIL_FILTER_TESTUTIL_H_
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "leveldb/filter_policy.h"
+#include "leveldb/slice.h"
+#include "util/coding.h"
+
+namespace leveldb {
+namespace test {
+
+// Fixture of the tests of a filter policy, made by NewPolicy(bits_per_key)
+template <const FilterPolicy* (*NewPolicy)(int)>
+class FilterTest {
+ private:
+  const FilterPolicy* policy_;
+  std::string filter_;
+  std::vector<std::string> keys_;
+
+ public:
+  static const int kVerbose = 1;
+
+  FilterTest() : policy_(NewPolicy(10)) { }
+
+  ~FilterTest() {
+    delete policy_;
+  }
+
+  static Slice Key(int i, char* buffer) {
+    EncodeFixed32(buffer, i);
+    return Slice(buffer, sizeof(uint32_t));
+  }
+
+  static int NextLength(int length) {
+    if (length < 10) {
+      length += 1;
+    } else if (length < 100) {
+      length += 10;
+    } else if (length < 1000) {
+      length += 100;
+    } else {
+      length += 1000;
+    }
+    return length;
+  }
+
+  const FilterPolicy* policy() const {
+    return policy_;
+  }
+
+  const std::string& filter() const {
+    return filter_;
+  }
+
+  void SetBitsPerKey(int bits_per_key) {
+    delete policy_;
+    policy_ = NewPolicy(bits_per_key);
+    Reset();
+  }
+
+  void Reset() {
+    keys_.clear();
+    filter_.clear();
+  }
+
+  void Add(const Slice& s) {
+    keys_.push_back(s.ToString());
+  }
+
+  void Build() {
+    std::vector<Slice> key_slices;
+    for (size_t i = 0; i < keys_.size(); i++) {
+      key_slices.push_back(Slice(keys_[i]));
+    }
+    filter_.clear();
+    policy_->CreateFilter(key_slices.empty() ? NULL : &key_slices[0],
+                          static_cast<int>(key_slices.size()), &filter_);
+    keys_.clear();
+    if (kVerbose >= 2) DumpFilter();
+  }
+
+  size_t FilterSize() const {
+    return filter_.size();
+  }
+
+  void DumpFilter() {
+    fprintf(stderr, "F(");
+    for (size_t i = 0; i+1 < filter_.size(); i++) {
+      const unsigned int c = static_cast<unsigned int>(filter_[i]);
+      for (int j = 0; j < 8; j++) {
+        fprintf(stderr, "%c", (c & (1 <<j)) ? '1' : '.');
+      }
+    }
+    fprintf(stderr, ")\n");
+  }
+
+  bool Matches(const Slice& s) {
+    if (!keys_.empty()) {
+      Build();
+    }
+    return policy_->KeyMayMatch(s, filter_);
+  }
+
+  double FalsePositiveRate() {
+    char buffer[sizeof(int)];
+    int result = 0;
+    for (int i = 0; i < 10000; i++) {
+      if (Matches(Key(i + 1000000000, buffer))) {
+        result++;
+      }
+    }
+    return result / 10000.0;
+  }
+};
+
+}  // namespace test
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_FILTER_TESTUTIL_H_
@@ -0,0 +1,199 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/merge_operator.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+MergeOperator::~MergeOperator() { }
+
+namespace {
+
+// Parse a signed decimal integer that makes up all of "s"
+bool ParseInt64(const Slice& s, int64_t* result) {
+  const char* p = s.data();
+  const char* limit = p + s.size();
+  const bool negative = (p < limit && *p == '-');
+  if (negative) {
+    p++;
+  }
+  if (p == limit) {
+    return false;
+  }
+  const uint64_t max = negative ? (1ull << 63) : (1ull << 63) - 1;
+  uint64_t v = 0;
+  for (; p < limit; p++) {
+    if (*p < '0' || *p > '9') {
+      return false;
+    }
+    const uint64_t digit = *p - '0';
+    if (v > (max - digit) / 10) {
+      return false;  // Overflow
+    }
+    v = v * 10 + digit;
+  }
+  *result = negative ? static_cast<int64_t>(0 - v) : static_cast<int64_t>(v);
+  return true;
+}
+
+void FormatInt64(int64_t v, std::string* result) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(v));
+  result->assign(buf);
+}
+
+class Int64AddOperator : public MergeOperator {
+ public:
+  virtual const char* Name() const {
+    return "leveldb.Int64Add";
+  }
+
+  virtual bool Merge(const Slice& key, const Slice* existing_value,
+                     const std::vector<Slice>& operands,
+                     std::string* new_value) const {
+    int64_t sum = 0;
+    if (existing_value != NULL && !ParseInt64(*existing_value, &sum)) {
+      return false;
+    }
+    for (size_t i = 0; i < operands.size(); i++) {
+      int64_t delta;
+      if (!ParseInt64(operands[i], &delta)) {
+        return false;
+      }
+      // Wrap around instead of overflowing
+      sum = static_cast<int64_t>(static_cast<uint64_t>(sum) +
+                                 static_cast<uint64_t>(delta));
+    }
+    FormatInt64(sum, new_value);
+    return true;
+  }
+};
+
+class Int64MaxOperator : public MergeOperator {
+ public:
+  virtual const char* Name() const {
+    return "leveldb.Int64Max";
+  }
+
+  virtual bool Merge(const Slice& key, const Slice* existing_value,
+                     const std::vector<Slice>& operands,
+                     std::string* new_value) const {
+    int64_t max;
+    size_t i = 0;
+    if (existing_value != NULL) {
+      if (!ParseInt64(*existing_value, &max)) {
+        return false;
+      }
+    } else if (operands.empty()) {
+      return false;
+    } else if (!ParseInt64(operands[i++], &max)) {
+      return false;
+    }
+    for (; i < operands.size(); i++) {
+      int64_t v;
+      if (!ParseInt64(operands[i], &v)) {
+        return false;
+      }
+      max = std::max(max, v);
+    }
+    FormatInt64(max, new_value);
+    return true;
+  }
+};
+
+class AppendOperator : public MergeOperator {
+ public:
+  virtual const char* Name() const {
+    return "leveldb.Append";
+  }
+
+  virtual bool Merge(const Slice& key, const Slice* existing_value,
+                     const std::vector<Slice>& operands,
+                     std::string* new_value) const {
+    new_value->clear();
+    if (existing_value != NULL) {
+      new_value->assign(existing_value->data(), existing_value->size());
+    }
+    for (size_t i = 0; i < operands.size(); i++) {
+      new_value->append(operands[i].data(), operands[i].size());
+    }
+    return true;
+  }
+};
+
+class SetUnionOperator : public MergeOperator {
+ public:
+  virtual const char* Name() const {
+    return "leveldb.SetUnion";
+  }
+
+  virtual bool Merge(const Slice& key, const Slice* existing_value,
+                     const std::vector<Slice>& operands,
+                     std::string* new_value) const {
+    std::vector<Slice> elements;
+    if (existing_value != NULL) {
+      Split(*existing_value, &elements);
+    }
+    for (size_t i = 0; i < operands.size(); i++) {
+      Split(operands[i], &elements);
+    }
+    std::sort(elements.begin(), elements.end(), Less);
+    std::string result;
+    for (size_t i = 0; i < elements.size(); i++) {
+      if (i > 0 && elements[i] == elements[i - 1]) {
+        continue;
+      }
+      if (!result.empty()) {
+        result.push_back(',');
+      }
+      result.append(elements[i].data(), elements[i].size());
+    }
+    new_value->swap(result);
+    return true;
+  }
+
+ private:
+  static bool Less(const Slice& a, const Slice& b) {
+    return a.compare(b) < 0;
+  }
+
+  // Append the non-empty elements of "list" to *elements
+  static void Split(const Slice& list, std::vector<Slice>* elements) {
+    const char* start = list.data();
+    const char* limit = start + list.size();
+    for (const char* p = start; p <= limit; p++) {
+      if (p == limit || *p == ',') {
+        if (p > start) {
+          elements->push_back(Slice(start, p - start));
+        }
+        start = p + 1;
+      }
+    }
+  }
+};
+
+}  // namespace
+
+const MergeOperator* NewInt64AddOperator() {
+  return new Int64AddOperator;
+}
+
+const MergeOperator* NewInt64MaxOperator() {
+  return new Int64MaxOperator;
+}
+
+const MergeOperator* NewAppendOperator() {
+  return new AppendOperator;
+}
+
+const MergeOperator* NewSetUnionOperator() {
+  return new SetUnionOperator;
+}
+
+}  // namespace leveldb
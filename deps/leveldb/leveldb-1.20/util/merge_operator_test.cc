@@ -0,0 +1,84 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/merge_operator.h"
+
+#include "leveldb/slice.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+class MergeOperatorTest {
+ public:
+  // Apply the operands, separated by spaces, to "existing", or to no
+  // value if it is "-".  Returns "error" if they can not be applied.
+  static std::string Merge(const MergeOperator* op,
+                           const std::string& existing,
+                           const std::string& operands) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (start <= operands.size()) {
+      size_t end = operands.find(' ', start);
+      if (end == std::string::npos) {
+        end = operands.size();
+      }
+      parts.push_back(operands.substr(start, end - start));
+      start = end + 1;
+    }
+    std::vector<Slice> slices(parts.begin(), parts.end());
+    Slice existing_value(existing);
+    std::string result;
+    if (!op->Merge("key", existing == "-" ? NULL : &existing_value, slices,
+                   &result)) {
+      return "error";
+    }
+    return result;
+  }
+};
+
+TEST(MergeOperatorTest, Int64Add) {
+  const MergeOperator* op = NewInt64AddOperator();
+  ASSERT_EQ("3", Merge(op, "-", "1 2"));
+  ASSERT_EQ("-5", Merge(op, "10", "-20 5"));
+  ASSERT_EQ("9223372036854775807", Merge(op, "9223372036854775806", "1"));
+  ASSERT_EQ("-9223372036854775808", Merge(op, "9223372036854775807", "1"));
+  ASSERT_EQ("-9223372036854775808", Merge(op, "-", "-9223372036854775808"));
+  ASSERT_EQ("error", Merge(op, "-", "9223372036854775808"));
+  ASSERT_EQ("error", Merge(op, "1x", "1"));
+  ASSERT_EQ("error", Merge(op, "-", "1 -"));
+  ASSERT_EQ("error", Merge(op, "", "1"));
+  delete op;
+}
+
+TEST(MergeOperatorTest, Int64Max) {
+  const MergeOperator* op = NewInt64MaxOperator();
+  ASSERT_EQ("7", Merge(op, "-", "3 7 -2"));
+  ASSERT_EQ("10", Merge(op, "10", "3"));
+  ASSERT_EQ("-1", Merge(op, "-3", "-1 -2"));
+  ASSERT_EQ("error", Merge(op, "a", "1"));
+  delete op;
+}
+
+TEST(MergeOperatorTest, Append) {
+  const MergeOperator* op = NewAppendOperator();
+  ASSERT_EQ("abc", Merge(op, "-", "a b c"));
+  ASSERT_EQ("xyz", Merge(op, "x", "y z"));
+  ASSERT_EQ("x", Merge(op, "x", ""));
+  delete op;
+}
+
+TEST(MergeOperatorTest, SetUnion) {
+  const MergeOperator* op = NewSetUnionOperator();
+  ASSERT_EQ("a,b,c", Merge(op, "-", "c,a b,a"));
+  ASSERT_EQ("a,b,d,e", Merge(op, "b,d", "e,,a d"));
+  ASSERT_EQ("b", Merge(op, "", "b"));
+  ASSERT_EQ("", Merge(op, "-", ""));
+  delete op;
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
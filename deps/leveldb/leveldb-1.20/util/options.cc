@@ -17,14 +17,38 @@ Options::Options()
       env(Env::Default()),
       info_log(NULL),
       write_buffer_size(4<<20),
+      max_write_buffer_number(2),
+      max_background_compactions(1),
+      max_subcompactions(1),
+      rate_limiter(NULL),
+      compaction_filter(NULL),
+      merge_operator(NULL),
       max_open_files(1000),
       block_cache(NULL),
       block_size(4096),
       block_restart_interval(16),
       max_file_size(2<<20),
+      level0_file_num_compaction_trigger(4),
+      level0_slowdown_writes_trigger(8),
+      level0_stop_writes_trigger(12),
+      max_mem_compaction_level(2),
+      max_bytes_for_level_base(10<<20),
+      max_bytes_for_level_multiplier(10),
+      level_compaction_dynamic_level_bytes(false),
+      compaction_style(kLevelCompaction),
+      tiered_size_ratio(1),
+      tiered_max_runs(6),
+      tombstone_compaction_percent(0),
       compression(kSnappyCompression),
+      compression_threads(1),
       reuse_logs(false),
-      filter_policy(NULL) {
+      filter_policy(NULL),
+      full_table_filter(false),
+      prefix_extractor(NULL),
+      wal_sync_interval_ms(0),
+      wal_sync_bytes(0),
+      enable_pipelined_write(false),
+      allow_concurrent_memtable_write(false) {
 }
 
 }  // namespace leveldb
@@ -0,0 +1,172 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/rate_limiter.h"
+
+#include "leveldb/env.h"
+#include "port/port.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+RateLimiter::~RateLimiter() {
+}
+
+namespace {
+
+class TokenBucketRateLimiter : public RateLimiter {
+ public:
+  TokenBucketRateLimiter(Env* env, int64_t bytes_per_second, bool adaptive)
+      : env_(env),
+        max_bytes_per_second_(bytes_per_second > 0 ? bytes_per_second : 1),
+        adaptive_(adaptive),
+        bytes_per_second_(max_bytes_per_second_),
+        available_(0),
+        last_refill_(env->NowMicros()),
+        next_adjust_(last_refill_ + kAdjustMicros),
+        reads_(0),
+        read_micros_(0),
+        usual_read_micros_(0) {
+  }
+
+  virtual void Request(size_t bytes) {
+    MutexLock l(&mu_);
+    double needed = static_cast<double>(bytes);
+    while (true) {
+      Refill();
+      if (available_ >= needed) {
+        available_ -= needed;
+        return;
+      }
+      // Take what there is and wait for the rest
+      needed -= available_;
+      available_ = 0;
+      uint64_t wait = static_cast<uint64_t>(needed * 1e6 / bytes_per_second_);
+      if (wait > kRefillMicros) wait = kRefillMicros;
+      if (wait < 1) wait = 1;
+      mu_.Unlock();
+      env_->SleepForMicroseconds(static_cast<int>(wait));
+      mu_.Lock();
+    }
+  }
+
+  virtual bool IsAdaptive() const {
+    return adaptive_;
+  }
+
+  virtual void RecordForegroundRead(uint64_t micros) {
+    if (!adaptive_) return;
+    MutexLock l(&mu_);
+    reads_++;
+    read_micros_ += micros;
+  }
+
+  virtual int64_t GetBytesPerSecond() {
+    MutexLock l(&mu_);
+    Refill();
+    return bytes_per_second_;
+  }
+
+ private:
+  // Tokens are added continuously, but no more than kRefillMicros worth
+  // of them are saved up while nobody asks for them.
+  static const uint64_t kRefillMicros = 100000;
+
+  // Period over which adaptive limiters average foreground reads
+  static const uint64_t kAdjustMicros = 1000000;
+
+  void Refill() {
+    mu_.AssertHeld();
+    const uint64_t now = env_->NowMicros();
+    if (now > last_refill_) {
+      available_ += (now - last_refill_) * 1e-6 * bytes_per_second_;
+      const double burst = kRefillMicros * 1e-6 * bytes_per_second_;
+      if (available_ > burst) {
+        available_ = burst;
+      }
+      last_refill_ = now;
+    }
+    if (adaptive_ && now >= next_adjust_) {
+      Adjust();
+      next_adjust_ = now + kAdjustMicros;
+    }
+  }
+
+  // Halve the rate if foreground reads were more than twice as slow as
+  // usual over the last period, else raise it back step by step.
+  void Adjust() {
+    mu_.AssertHeld();
+    bool slow = false;
+    if (reads_ > 0) {
+      const double average = static_cast<double>(read_micros_) / reads_;
+      if (usual_read_micros_ == 0 || average < usual_read_micros_) {
+        usual_read_micros_ = average;
+      } else {
+        slow = (average > 2 * usual_read_micros_);
+        // Follow lasting changes of the workload, slowly
+        usual_read_micros_ += (average - usual_read_micros_) / 16;
+      }
+      reads_ = 0;
+      read_micros_ = 0;
+    }
+    const int64_t min_rate = max_bytes_per_second_ / 16 + 1;
+    if (slow) {
+      bytes_per_second_ /= 2;
+      if (bytes_per_second_ < min_rate) bytes_per_second_ = min_rate;
+    } else {
+      bytes_per_second_ += max_bytes_per_second_ / 8 + 1;
+      if (bytes_per_second_ > max_bytes_per_second_) {
+        bytes_per_second_ = max_bytes_per_second_;
+      }
+    }
+  }
+
+  Env* const env_;
+  const int64_t max_bytes_per_second_;
+  const bool adaptive_;
+
+  port::Mutex mu_;
+  int64_t bytes_per_second_;
+  double available_;
+  uint64_t last_refill_;
+
+  // State of adaptive limiters
+  uint64_t next_adjust_;
+  uint64_t reads_;              // Foreground reads in the current period
+  uint64_t read_micros_;        // and the time they took
+  double usual_read_micros_;    // Typical average read time, 0 if unknown
+};
+
+class RateLimitedWritableFile : public WritableFile {
+ public:
+  RateLimitedWritableFile(WritableFile* base, RateLimiter* limiter)
+      : base_(base), limiter_(limiter) { }
+  virtual ~RateLimitedWritableFile() { delete base_; }
+
+  virtual Status Append(const Slice& data) {
+    limiter_->Request(data.size());
+    return base_->Append(data);
+  }
+  virtual Status Close() { return base_->Close(); }
+  virtual Status Flush() { return base_->Flush(); }
+  virtual Status Sync() { return base_->Sync(); }
+
+ private:
+  WritableFile* base_;
+  RateLimiter* limiter_;
+};
+
+}  // namespace
+
+RateLimiter* NewRateLimiter(Env* env, int64_t bytes_per_second,
+                            bool adaptive) {
+  return new TokenBucketRateLimiter(env, bytes_per_second, adaptive);
+}
+
+WritableFile* NewRateLimitedWritableFile(WritableFile* base,
+                                         RateLimiter* limiter) {
+  return new RateLimitedWritableFile(base, limiter);
+}
+
+}  // namespace leveldb
@@ -0,0 +1,114 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/rate_limiter.h"
+
+#include "leveldb/env.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+// An Env whose clock only moves when somebody sleeps
+class FakeClockEnv : public EnvWrapper {
+ public:
+  uint64_t now_micros_;
+
+  FakeClockEnv() : EnvWrapper(Env::Default()), now_micros_(1000000) { }
+
+  virtual uint64_t NowMicros() {
+    return now_micros_;
+  }
+
+  virtual void SleepForMicroseconds(int micros) {
+    now_micros_ += micros;
+  }
+};
+
+class RateLimiterTest {
+ public:
+  FakeClockEnv env_;
+};
+
+TEST(RateLimiterTest, LimitsRate) {
+  RateLimiter* limiter = NewRateLimiter(&env_, 1000000, false);
+  ASSERT_TRUE(!limiter->IsAdaptive());
+
+  // Nothing is saved up while the limiter is idle beyond 100ms worth
+  env_.SleepForMicroseconds(5000000);
+  const uint64_t start = env_.NowMicros();
+  for (int i = 0; i < 1000; i++) {
+    limiter->Request(4000);
+  }
+  // 4MB at 1MB/s, less the 100KB that was saved up
+  const uint64_t elapsed = env_.NowMicros() - start;
+  ASSERT_GE(elapsed, static_cast<uint64_t>(3800000));
+  ASSERT_LE(elapsed, static_cast<uint64_t>(4000000));
+
+  // Requests larger than a burst go through piece by piece
+  limiter->Request(1000000);
+  ASSERT_GE(env_.NowMicros() - start, elapsed + 1000000);
+  delete limiter;
+}
+
+TEST(RateLimiterTest, AdaptsToForegroundReads) {
+  RateLimiter* limiter = NewRateLimiter(&env_, 1000000, true);
+  ASSERT_TRUE(limiter->IsAdaptive());
+
+  // Learn the usual read time
+  for (int i = 0; i < 10; i++) {
+    limiter->RecordForegroundRead(100);
+  }
+  env_.SleepForMicroseconds(1000000);
+  ASSERT_EQ(1000000, limiter->GetBytesPerSecond());
+
+  // Slow reads halve the rate each second, down to a sixteenth
+  int64_t last = 1000000;
+  for (int i = 0; i < 6; i++) {
+    limiter->RecordForegroundRead(1000);
+    env_.SleepForMicroseconds(1000000);
+    const int64_t rate = limiter->GetBytesPerSecond();
+    ASSERT_LE(rate, last);
+    ASSERT_GE(rate, 1000000 / 16);
+    last = rate;
+  }
+  ASSERT_LT(last, 1000000 / 8);
+
+  // Without slow reads it is raised back
+  for (int i = 0; i < 10; i++) {
+    env_.SleepForMicroseconds(1000000);
+    limiter->GetBytesPerSecond();
+  }
+  ASSERT_EQ(1000000, limiter->GetBytesPerSecond());
+  delete limiter;
+}
+
+TEST(RateLimiterTest, RateLimitedWritableFile) {
+  class CountingFile : public WritableFile {
+   public:
+    std::string contents;
+    virtual Status Append(const Slice& data) {
+      contents.append(data.data(), data.size());
+      return Status::OK();
+    }
+    virtual Status Close() { return Status::OK(); }
+    virtual Status Flush() { return Status::OK(); }
+    virtual Status Sync() { return Status::OK(); }
+  };
+
+  RateLimiter* limiter = NewRateLimiter(&env_, 100000, false);
+  CountingFile* base = new CountingFile;
+  WritableFile* file = NewRateLimitedWritableFile(base, limiter);
+  const uint64_t start = env_.NowMicros();
+  ASSERT_OK(file->Append(std::string(200000, 'x')));
+  ASSERT_EQ(static_cast<size_t>(200000), base->contents.size());
+  ASSERT_GE(env_.NowMicros() - start, static_cast<uint64_t>(1900000));
+  delete file;  // Deletes base
+  delete limiter;
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
@@ -0,0 +1,91 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/slice_transform.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+namespace leveldb {
+
+SliceTransform::~SliceTransform() { }
+
+namespace {
+
+class FixedPrefixTransform : public SliceTransform {
+ public:
+  explicit FixedPrefixTransform(size_t length) : length_(length) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "leveldb.FixedPrefix.%llu",
+             static_cast<unsigned long long>(length));
+    name_ = buf;
+  }
+
+  virtual const char* Name() const { return name_.c_str(); }
+
+  virtual bool InDomain(const Slice& key) const {
+    return key.size() >= length_;
+  }
+
+  virtual Slice Transform(const Slice& key) const {
+    return Slice(key.data(), length_);
+  }
+
+ private:
+  const size_t length_;
+  std::string name_;
+};
+
+class DelimiterPrefixTransform : public SliceTransform {
+ public:
+  DelimiterPrefixTransform(char delimiter, int count)
+      : delimiter_(delimiter), count_(count) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "leveldb.DelimiterPrefix.%d.%d",
+             static_cast<unsigned char>(delimiter), count);
+    name_ = buf;
+  }
+
+  virtual const char* Name() const { return name_.c_str(); }
+
+  virtual bool InDomain(const Slice& key) const {
+    return PrefixLength(key) != 0;
+  }
+
+  virtual Slice Transform(const Slice& key) const {
+    return Slice(key.data(), PrefixLength(key));
+  }
+
+ private:
+  // The length of the prefix of "key", 0 if it has none
+  size_t PrefixLength(const Slice& key) const {
+    const char* p = key.data();
+    const char* limit = p + key.size();
+    for (int i = 0; i < count_; i++) {
+      p = static_cast<const char*>(memchr(p, delimiter_, limit - p));
+      if (p == NULL) {
+        return 0;
+      }
+      p++;
+    }
+    return p - key.data();
+  }
+
+  const char delimiter_;
+  const int count_;
+  std::string name_;
+};
+
+}  // namespace
+
+const SliceTransform* NewFixedPrefixTransform(size_t length) {
+  return new FixedPrefixTransform(length);
+}
+
+const SliceTransform* NewDelimiterPrefixTransform(char delimiter, int count) {
+  return new DelimiterPrefixTransform(delimiter, count);
+}
+
+}  // namespace leveldb
@@ -0,0 +1,76 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "util/thread_pool.h"
+
+#include <assert.h>
+#include "leveldb/env.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+ThreadPool::ThreadPool(Env* env, int max_threads)
+    : env_(env),
+      max_threads_(max_threads < 1 ? 1 : max_threads),
+      work_cv_(&mu_),
+      exit_cv_(&mu_),
+      threads_(0),
+      idle_threads_(0),
+      stopping_(false) {
+}
+
+ThreadPool::~ThreadPool() {
+  MutexLock l(&mu_);
+  stopping_ = true;
+  work_cv_.SignalAll();
+  while (threads_ > 0) {
+    exit_cv_.Wait();
+  }
+  assert(queue_.empty());
+}
+
+void ThreadPool::Schedule(void (*function)(void* arg), void* arg) {
+  MutexLock l(&mu_);
+  assert(!stopping_);
+  Work work;
+  work.function = function;
+  work.arg = arg;
+  queue_.push_back(work);
+  if (queue_.size() > static_cast<size_t>(idle_threads_) &&
+      threads_ < max_threads_) {
+    threads_++;
+    env_->StartThread(&ThreadPool::Worker, this);
+  } else {
+    work_cv_.Signal();
+  }
+}
+
+int ThreadPool::NumThreads() {
+  MutexLock l(&mu_);
+  return threads_;
+}
+
+void ThreadPool::Worker(void* arg) {
+  ThreadPool* pool = reinterpret_cast<ThreadPool*>(arg);
+  MutexLock l(&pool->mu_);
+  while (true) {
+    while (pool->queue_.empty() && !pool->stopping_) {
+      pool->idle_threads_++;
+      pool->work_cv_.Wait();
+      pool->idle_threads_--;
+    }
+    if (pool->queue_.empty()) {
+      break;
+    }
+    Work work = pool->queue_.front();
+    pool->queue_.pop_front();
+    pool->mu_.Unlock();
+    (*work.function)(work.arg);
+    pool->mu_.Lock();
+  }
+  pool->threads_--;
+  pool->exit_cv_.SignalAll();
+}
+
+}  // namespace leveldb
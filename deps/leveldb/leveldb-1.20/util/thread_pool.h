@@ -0,0 +1,65 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A pool of threads that run scheduled functions.  The threads are
+// started as the work needs them, up to a bound, and are reused until
+// the pool is deleted, so that short-lived parallel work does not start
+// a thread each time.
+
+#ifndef STORAGE_LEVELDB_UTIL_THREAD_POOL_H_
+#define STORAGE_LEVELDB_UTIL_THREAD_POOL_H_
+
+#include <deque>
+#include "port/port.h"
+
+namespace leveldb {
+
+class Env;
+
+class ThreadPool {
+ public:
+  // Runs the scheduled functions on at most "max_threads" threads
+  // started with env->StartThread().
+  ThreadPool(Env* env, int max_threads);
+
+  // Waits for the scheduled functions to return and the threads to exit.
+  ~ThreadPool();
+
+  // Arrange to run "(*function)(arg)" once on a thread of the pool.
+  // Functions run in the order they are scheduled, but may run
+  // concurrently.  A function must not wait for another function of
+  // the same pool, which may be queued behind it.
+  void Schedule(void (*function)(void* arg), void* arg);
+
+  // Number of threads started so far.
+  int NumThreads();
+
+ private:
+  struct Work {
+    void (*function)(void*);
+    void* arg;
+  };
+
+  static void Worker(void* arg);
+
+  Env* const env_;
+  const int max_threads_;
+
+  // State below is protected by mu_
+  port::Mutex mu_;
+  port::CondVar work_cv_;  // Signalled when work is queued or stopping
+  port::CondVar exit_cv_;  // Signalled when a thread exits
+  std::deque<Work> queue_;
+  int threads_;
+  int idle_threads_;
+  bool stopping_;
+
+  // No copying allowed
+  ThreadPool(const ThreadPool&);
+  void operator=(const ThreadPool&);
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_THREAD_POOL_H_
@@ -0,0 +1,127 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "util/thread_pool.h"
+
+#include "leveldb/env.h"
+#include "port/port.h"
+#include "util/mutexlock.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+// An Env that counts the threads it starts
+class CountingEnv : public EnvWrapper {
+ public:
+  port::Mutex mu_;
+  int started_;
+
+  CountingEnv() : EnvWrapper(Env::Default()), started_(0) { }
+
+  virtual void StartThread(void (*function)(void* arg), void* arg) {
+    {
+      MutexLock l(&mu_);
+      started_++;
+    }
+    target()->StartThread(function, arg);
+  }
+
+  int Started() {
+    MutexLock l(&mu_);
+    return started_;
+  }
+};
+
+// Work that blocks until released, to hold threads of the pool busy
+struct Gate {
+  port::Mutex mu;
+  port::CondVar cv;
+  bool open;
+  int waiting;
+  int done;
+
+  Gate() : cv(&mu), open(false), waiting(0), done(0) { }
+
+  static void Run(void* arg) {
+    Gate* gate = reinterpret_cast<Gate*>(arg);
+    MutexLock l(&gate->mu);
+    gate->waiting++;
+    gate->cv.SignalAll();
+    while (!gate->open) {
+      gate->cv.Wait();
+    }
+    gate->done++;
+    gate->cv.SignalAll();
+  }
+
+  void WaitFor(int* count, int n) {
+    MutexLock l(&mu);
+    while (*count < n) {
+      cv.Wait();
+    }
+  }
+
+  void Open() {
+    MutexLock l(&mu);
+    open = true;
+    cv.SignalAll();
+  }
+};
+
+class ThreadPoolTest {
+ public:
+  CountingEnv env_;
+};
+
+TEST(ThreadPoolTest, ReusesThreads) {
+  ThreadPool* pool = new ThreadPool(&env_, 4);
+  ASSERT_EQ(0, pool->NumThreads());
+  for (int round = 0; round < 100; round++) {
+    Gate gate;
+    gate.open = true;
+    pool->Schedule(&Gate::Run, &gate);
+    gate.WaitFor(&gate.done, 1);
+  }
+  // The threads that finished their work ran the next
+  ASSERT_GE(pool->NumThreads(), 1);
+  ASSERT_LE(env_.Started(), 4);
+  delete pool;
+}
+
+TEST(ThreadPoolTest, BoundsThreads) {
+  ThreadPool* pool = new ThreadPool(&env_, 3);
+  Gate gate;
+  for (int i = 0; i < 10; i++) {
+    pool->Schedule(&Gate::Run, &gate);
+  }
+  // Three run at once, the others wait for a thread
+  gate.WaitFor(&gate.waiting, 3);
+  ASSERT_EQ(3, pool->NumThreads());
+  env_.SleepForMicroseconds(10000);
+  {
+    MutexLock l(&gate.mu);
+    ASSERT_EQ(3, gate.waiting);
+  }
+  gate.Open();
+  gate.WaitFor(&gate.done, 10);
+  ASSERT_EQ(3, env_.Started());
+  delete pool;
+}
+
+TEST(ThreadPoolTest, DeleteRunsQueuedWork) {
+  ThreadPool* pool = new ThreadPool(&env_, 1);
+  Gate gate;
+  gate.open = true;
+  for (int i = 0; i < 100; i++) {
+    pool->Schedule(&Gate::Run, &gate);
+  }
+  delete pool;
+  ASSERT_EQ(100, gate.done);
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
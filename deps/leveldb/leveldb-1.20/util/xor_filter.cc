@@ -0,0 +1,242 @@
+// Copyright (c) 2012 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A static xor filter (Graf and Lemire, "Xor Filters: Faster and Smaller
+// Than Bloom and Cuckoo Filters", 2019).  Every key maps to one slot in
+// each third of an array of about 1.23 * n r-bit fingerprints, whose xor
+// is the fingerprint of the key.  The false positive rate is 2^-r, so
+// the filter needs about 1.23 * r bits per key where a bloom filter needs
+// about 1.44 * r.  The array also has 32 spare slots, which make the
+// filters of less than a few hundred keys larger than bloom filters: the
+// policy suits the full-table filters (see Options::full_table_filter).
+//
+// Filter layout:
+//     [fingerprints]              : 3 * segment_length r-bit values,
+//                                   packed little-endian
+//     [seed]                      : fixed32
+//     [segment_length]            : fixed32
+//     [r]                         : 1 byte (0 if every key matches)
+
+#include "leveldb/filter_policy.h"
+
+#include <algorithm>
+#include <vector>
+#include "leveldb/slice.h"
+#include "util/coding.h"
+
+namespace leveldb {
+
+namespace {
+
+static const size_t kMaxFingerprintBits = 16;
+static const size_t kTrailerSize = 9;
+static const int kMaxAttempts = 64;
+
+// MurmurHash64A
+static uint64_t XorKeyHash(const Slice& key) {
+  const uint64_t m = 0xc6a4a7935bd1e995ULL;
+  const int r = 47;
+  const char* data = key.data();
+  const size_t n = key.size();
+  uint64_t h = 0x2fc9a1e0d7b3c58dULL ^ (n * m);
+  const char* limit = data + (n & ~static_cast<size_t>(7));
+  for (; data != limit; data += 8) {
+    uint64_t w = DecodeFixed64(data);
+    w *= m;
+    w ^= w >> r;
+    w *= m;
+    h ^= w;
+    h *= m;
+  }
+  if (n & 7) {
+    uint64_t w = 0;
+    for (size_t i = n & 7; i-- > 0; ) {
+      w = (w << 8) | static_cast<unsigned char>(data[i]);
+    }
+    h ^= w;
+    h *= m;
+  }
+  h ^= h >> r;
+  h *= m;
+  h ^= h >> r;
+  return h;
+}
+
+// Rehashes a key hash for one construction attempt
+static uint64_t Mix(uint64_t h, uint32_t seed) {
+  h += seed * 0x9e3779b97f4a7c15ULL;
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+  return h ^ (h >> 31);
+}
+
+static uint32_t Slot(uint64_t h, int i, uint32_t segment_length) {
+  const uint64_t r = (h << (21 * i)) | (h >> ((64 - 21 * i) & 63));
+  // Maps the hash onto [0, segment_length) without a division
+  return static_cast<uint32_t>(
+      (static_cast<uint64_t>(static_cast<uint32_t>(r)) * segment_length) >> 32)
+      + i * segment_length;
+}
+
+static uint32_t Fingerprint(uint64_t h, size_t bits) {
+  return static_cast<uint32_t>(h ^ (h >> 32)) & ((1u << bits) - 1);
+}
+
+// The bits of a value may straddle three bytes; the trailer always
+// follows the fingerprints, so the reads stay within the filter.
+static uint32_t GetFingerprint(const char* array, uint32_t i, size_t bits) {
+  const uint64_t bit = static_cast<uint64_t>(i) * bits;
+  const unsigned char* p =
+      reinterpret_cast<const unsigned char*>(array) + bit / 8;
+  const uint32_t word = p[0] | (p[1] << 8) | (p[2] << 16);
+  return (word >> (bit % 8)) & ((1u << bits) - 1);
+}
+
+static void PutFingerprint(char* array, uint32_t i, size_t bits,
+                           uint32_t value) {
+  const uint64_t bit = static_cast<uint64_t>(i) * bits;
+  unsigned char* p = reinterpret_cast<unsigned char*>(array) + bit / 8;
+  const uint32_t word = value << (bit % 8);
+  p[0] |= word & 0xff;
+  p[1] |= (word >> 8) & 0xff;
+  p[2] |= (word >> 16) & 0xff;
+}
+
+class XorFilterPolicy : public FilterPolicy {
+ private:
+  size_t fingerprint_bits_;
+
+  // Orders the keys so that each one is the only key left in one of its
+  // slots once the keys after it are removed.  Returns false if the
+  // keys form a cycle for this seed.
+  static bool Peel(const std::vector<uint64_t>& hashes, uint32_t seed,
+                   uint32_t segment_length,
+                   std::vector<std::pair<uint64_t, uint32_t> >* order) {
+    const uint32_t size = 3 * segment_length;
+    std::vector<uint64_t> xors(size, 0);
+    std::vector<uint32_t> counts(size, 0);
+    for (size_t k = 0; k < hashes.size(); k++) {
+      const uint64_t h = Mix(hashes[k], seed);
+      for (int i = 0; i < 3; i++) {
+        const uint32_t slot = Slot(h, i, segment_length);
+        xors[slot] ^= h;
+        counts[slot]++;
+      }
+    }
+
+    std::vector<uint32_t> alone;
+    for (uint32_t slot = 0; slot < size; slot++) {
+      if (counts[slot] == 1) alone.push_back(slot);
+    }
+    order->clear();
+    while (!alone.empty()) {
+      const uint32_t slot = alone.back();
+      alone.pop_back();
+      if (counts[slot] != 1) continue;
+      const uint64_t h = xors[slot];
+      order->push_back(std::make_pair(h, slot));
+      for (int i = 0; i < 3; i++) {
+        const uint32_t other = Slot(h, i, segment_length);
+        xors[other] ^= h;
+        if (--counts[other] == 1) alone.push_back(other);
+      }
+    }
+    return order->size() == hashes.size();
+  }
+
+ public:
+  explicit XorFilterPolicy(int bits_per_key) {
+    // 1.23 slots per key
+    fingerprint_bits_ = bits_per_key < 1 ? 1 : bits_per_key * 100 / 123;
+    if (fingerprint_bits_ < 1) fingerprint_bits_ = 1;
+    if (fingerprint_bits_ > kMaxFingerprintBits) {
+      fingerprint_bits_ = kMaxFingerprintBits;
+    }
+  }
+
+  virtual const char* Name() const {
+    return "leveldb.XorFilter";
+  }
+
+  virtual void CreateFilter(const Slice* keys, int n, std::string* dst) const {
+    // Equal keys would never be peeled
+    std::vector<uint64_t> hashes(n);
+    for (int i = 0; i < n; i++) {
+      hashes[i] = XorKeyHash(keys[i]);
+    }
+    std::sort(hashes.begin(), hashes.end());
+    hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+
+    const uint32_t segment_length = hashes.empty() ? 0 :
+        (32 + static_cast<uint32_t>(1.23 * hashes.size())) / 3;
+    std::vector<std::pair<uint64_t, uint32_t> > order;
+    uint32_t seed = 0;
+    size_t bits = fingerprint_bits_;
+    for (int attempt = 0; !hashes.empty(); attempt++) {
+      if (attempt == kMaxAttempts) {
+        bits = 0;  // Give up: a filter that matches every key
+        break;
+      }
+      seed = attempt;
+      if (Peel(hashes, seed, segment_length, &order)) break;
+    }
+
+    const size_t init_size = dst->size();
+    const size_t bytes = bits == 0 ? 0 :
+        (static_cast<uint64_t>(3) * segment_length * bits + 7) / 8;
+    dst->resize(init_size + bytes, 0);
+    PutFixed32(dst, seed);
+    PutFixed32(dst, bits == 0 ? 0 : segment_length);
+    dst->push_back(static_cast<char>(bits));
+    if (bits == 0) return;
+
+    // Fill the slots in the reverse order of the peeling: the slot of a
+    // key is the last of its three slots to be set
+    char* array = &(*dst)[init_size];
+    for (size_t k = order.size(); k-- > 0; ) {
+      const uint64_t h = order[k].first;
+      uint32_t value = Fingerprint(h, bits);
+      for (int i = 0; i < 3; i++) {
+        value ^= GetFingerprint(array, Slot(h, i, segment_length), bits);
+      }
+      PutFingerprint(array, order[k].second, bits, value);
+    }
+  }
+
+  virtual bool KeyMayMatch(const Slice& key, const Slice& filter) const {
+    const size_t len = filter.size();
+    if (len < kTrailerSize) return false;
+
+    const char* array = filter.data();
+    const size_t bits = static_cast<unsigned char>(array[len-1]);
+    const uint32_t segment_length = DecodeFixed32(array + len - 5);
+    const uint32_t seed = DecodeFixed32(array + len - kTrailerSize);
+    if (bits == 0 || bits > kMaxFingerprintBits) {
+      // Unbuildable set of keys, or reserved for potentially new
+      // encodings.  Consider it a match.
+      return true;
+    }
+    if (segment_length == 0) {
+      return false;  // No keys
+    }
+    if ((static_cast<uint64_t>(3) * segment_length * bits + 7) / 8 !=
+        len - kTrailerSize) {
+      return true;  // Errors are treated as potential matches
+    }
+
+    const uint64_t h = Mix(XorKeyHash(key), seed);
+    return Fingerprint(h, bits) ==
+           (GetFingerprint(array, Slot(h, 0, segment_length), bits) ^
+            GetFingerprint(array, Slot(h, 1, segment_length), bits) ^
+            GetFingerprint(array, Slot(h, 2, segment_length), bits));
+  }
+};
+
+}  // namespace
+
+const FilterPolicy* NewXorFilterPolicy(int bits_per_key) {
+  return new XorFilterPolicy(bits_per_key);
+}
+
+}  // namespace leveldb
@@ -0,0 +1,118 @@
+// Copyright (c) 2012 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/filter_policy.h"
+
+#include "util/filter_testutil.h"
+#include "util/logging.h"
+#include "util/testharness.h"
+#include "util/testutil.h"
+
+namespace leveldb {
+
+typedef test::FilterTest<NewXorFilterPolicy> XorFilterTest;
+
+TEST(XorFilterTest, EmptyFilter) {
+  ASSERT_TRUE(! Matches("hello"));
+  Build();
+  ASSERT_EQ(static_cast<size_t>(9), FilterSize());
+  ASSERT_TRUE(! Matches("hello"));
+  ASSERT_TRUE(! Matches("world"));
+}
+
+TEST(XorFilterTest, Small) {
+  Add("hello");
+  Add("world");
+  ASSERT_TRUE(Matches("hello"));
+  ASSERT_TRUE(Matches("world"));
+  ASSERT_TRUE(! Matches("x"));
+  ASSERT_TRUE(! Matches("foo"));
+}
+
+TEST(XorFilterTest, Duplicates) {
+  for (int i = 0; i < 3; i++) {
+    Add("hello");
+    Add("world");
+  }
+  ASSERT_TRUE(Matches("hello"));
+  ASSERT_TRUE(Matches("world"));
+  ASSERT_TRUE(! Matches("x"));
+}
+
+TEST(XorFilterTest, VaryingLengths) {
+  char buffer[sizeof(int)];
+
+  // Count number of filters that significantly exceed the false positive rate
+  int mediocre_filters = 0;
+  int good_filters = 0;
+
+  for (int length = 1; length <= 10000; length = NextLength(length)) {
+    Reset();
+    for (int i = 0; i < length; i++) {
+      Add(Key(i, buffer));
+    }
+    Build();
+
+    // One byte per slot with the 8-bit fingerprints of 10 bits per key:
+    // 1.23 slots per key, 32 spare slots and the trailer.  The spare slots
+    // make small filters larger than bloom filters.
+    ASSERT_LE(FilterSize(), static_cast<size_t>(length * 123 / 100 + 32 + 9))
+        << length;
+
+    // All added keys must match
+    for (int i = 0; i < length; i++) {
+      ASSERT_TRUE(Matches(Key(i, buffer)))
+          << "Length " << length << "; key " << i;
+    }
+
+    // Check false positive rate
+    double rate = FalsePositiveRate();
+    if (kVerbose >= 1) {
+      fprintf(stderr, "False positives: %5.2f%% @ length = %6d ; bytes = %6d\n",
+              rate*100.0, length, static_cast<int>(FilterSize()));
+    }
+    ASSERT_LE(rate, 0.02);   // Must not be over 2%
+    if (rate > 0.0125) mediocre_filters++;  // Allowed, but not too often
+    else good_filters++;
+  }
+  if (kVerbose >= 1) {
+    fprintf(stderr, "Filters: %d good, %d mediocre\n",
+            good_filters, mediocre_filters);
+  }
+  ASSERT_LE(mediocre_filters, good_filters/5);
+}
+
+TEST(XorFilterTest, BitsPerKey) {
+  char buffer[sizeof(int)];
+  // From one fingerprint bit up to the widest fingerprints
+  const int bits[] = { 2, 4, 9, 12, 16, 20, 40 };
+  double last_rate = 1.0;
+  for (size_t b = 0; b < sizeof(bits) / sizeof(bits[0]); b++) {
+    SetBitsPerKey(bits[b]);
+    for (int i = 0; i < 5000; i++) {
+      Add(Key(i, buffer));
+    }
+    Build();
+    if (bits[b] < 20) {
+      // Plus 32 spare slots and the trailer
+      ASSERT_LE(FilterSize() * 8, static_cast<size_t>(5000 * bits[b] + 1000));
+    }
+    for (int i = 0; i < 5000; i++) {
+      ASSERT_TRUE(Matches(Key(i, buffer))) << bits[b] << "; key " << i;
+    }
+    const double rate = FalsePositiveRate();
+    if (kVerbose >= 1) {
+      fprintf(stderr, "False positives: %5.2f%% @ bits per key = %d\n",
+              rate*100.0, bits[b]);
+    }
+    ASSERT_LE(rate, last_rate);
+    last_rate = rate;
+  }
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  return leveldb::test::RunAllTests();
+}
@@ -166,6 +166,8 @@
       , 'leveldb-<(ldbversion)/db/log_writer.h'
       , 'leveldb-<(ldbversion)/db/memtable.cc'
       , 'leveldb-<(ldbversion)/db/memtable.h'
+      , 'leveldb-<(ldbversion)/db/merge_helper.cc'
+      , 'leveldb-<(ldbversion)/db/merge_helper.h'
       , 'leveldb-<(ldbversion)/db/repair.cc'
       , 'leveldb-<(ldbversion)/db/skiplist.h'
       , 'leveldb-<(ldbversion)/db/snapshot.h'
@@ -177,21 +179,27 @@
       , 'leveldb-<(ldbversion)/db/version_set.h'
       , 'leveldb-<(ldbversion)/db/write_batch.cc'
       , 'leveldb-<(ldbversion)/db/write_batch_internal.h'
+      , 'leveldb-<(ldbversion)/db/write_batch_with_index.cc'
       , 'leveldb-<(ldbversion)/helpers/memenv/memenv.cc'
       , 'leveldb-<(ldbversion)/helpers/memenv/memenv.h'
       , 'leveldb-<(ldbversion)/include/leveldb/cache.h'
+      , 'leveldb-<(ldbversion)/include/leveldb/compaction_filter.h'
       , 'leveldb-<(ldbversion)/include/leveldb/comparator.h'
       , 'leveldb-<(ldbversion)/include/leveldb/db.h'
       , 'leveldb-<(ldbversion)/include/leveldb/dumpfile.h'
       , 'leveldb-<(ldbversion)/include/leveldb/env.h'
       , 'leveldb-<(ldbversion)/include/leveldb/filter_policy.h'
       , 'leveldb-<(ldbversion)/include/leveldb/iterator.h'
+      , 'leveldb-<(ldbversion)/include/leveldb/merge_operator.h'
       , 'leveldb-<(ldbversion)/include/leveldb/options.h'
+      , 'leveldb-<(ldbversion)/include/leveldb/rate_limiter.h'
       , 'leveldb-<(ldbversion)/include/leveldb/slice.h'
+      , 'leveldb-<(ldbversion)/include/leveldb/slice_transform.h'
       , 'leveldb-<(ldbversion)/include/leveldb/status.h'
       , 'leveldb-<(ldbversion)/include/leveldb/table.h'
       , 'leveldb-<(ldbversion)/include/leveldb/table_builder.h'
       , 'leveldb-<(ldbversion)/include/leveldb/write_batch.h'
+      , 'leveldb-<(ldbversion)/include/leveldb/write_batch_with_index.h'
       , 'leveldb-<(ldbversion)/port/port.h'
       , 'leveldb-<(ldbversion)/port/port_posix_sse.cc'
       , 'leveldb-<(ldbversion)/table/block.cc'
@@ -212,10 +220,13 @@
       , 'leveldb-<(ldbversion)/table/two_level_iterator.h'
       , 'leveldb-<(ldbversion)/util/arena.cc'
       , 'leveldb-<(ldbversion)/util/arena.h'
+      , 'leveldb-<(ldbversion)/util/blocked_bloom.cc'
+      , 'leveldb-<(ldbversion)/util/blocked_bloom.h'
       , 'leveldb-<(ldbversion)/util/bloom.cc'
       , 'leveldb-<(ldbversion)/util/cache.cc'
       , 'leveldb-<(ldbversion)/util/coding.cc'
       , 'leveldb-<(ldbversion)/util/coding.h'
+      , 'leveldb-<(ldbversion)/util/compaction_filter.cc'
       , 'leveldb-<(ldbversion)/util/comparator.cc'
       , 'leveldb-<(ldbversion)/util/crc32c.cc'
       , 'leveldb-<(ldbversion)/util/crc32c.h'
@@ -225,9 +236,15 @@
       , 'leveldb-<(ldbversion)/util/hash.h'
       , 'leveldb-<(ldbversion)/util/logging.cc'
       , 'leveldb-<(ldbversion)/util/logging.h'
+      , 'leveldb-<(ldbversion)/util/merge_operator.cc'
       , 'leveldb-<(ldbversion)/util/mutexlock.h'
       , 'leveldb-<(ldbversion)/util/options.cc'
       , 'leveldb-<(ldbversion)/util/random.h'
+      , 'leveldb-<(ldbversion)/util/rate_limiter.cc'
+      , 'leveldb-<(ldbversion)/util/slice_transform.cc'
       , 'leveldb-<(ldbversion)/util/status.cc'
+      , 'leveldb-<(ldbversion)/util/thread_pool.cc'
+      , 'leveldb-<(ldbversion)/util/thread_pool.h'
+      , 'leveldb-<(ldbversion)/util/xor_filter.cc'
     ]
 }]}
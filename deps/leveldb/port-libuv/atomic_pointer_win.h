@@ -42,6 +42,12 @@ class AtomicPointer {
     inline void NoBarrier_Store(void* v) {
         rep_ = reinterpret_cast<void*>(v);
     }
+
+    // Atomically replace the stored pointer by v iff it is expected.
+    // Returns true on success.  Acts as a full memory barrier.
+    inline bool CompareAndSwap(void* expected, void* v) {
+        return InterlockedCompareExchangePointer(&rep_, v, expected) == expected;
+    }
 };
 
 } // namespace port
@@ -551,6 +551,10 @@ class WinEnv : public Env {
 
   virtual void Schedule(void (*function)(void*), void* arg);
 
+  virtual void Schedule(void (*function)(void*), void* arg, Priority pri);
+
+  virtual void IncBackgroundThreadsIfNeeded(int number, Priority pri);
+
   virtual void StartThread(void (*function)(void* arg), void* arg);
 
   virtual Status GetTestDirectory(std::string* result) {
@@ -591,65 +595,112 @@ class WinEnv : public Env {
 private:
   LARGE_INTEGER freq_;
 
-  // BGThread() is the body of the background thread
-  void BGThread();
+  // BGThread() is the body of the background threads of priority "pri"
+  void BGThread(Priority pri);
 
+  struct BGThreadArg { WinEnv* env; Priority pri; };
   static unsigned __stdcall BGThreadWrapper(void* arg) {
-    (reinterpret_cast<WinEnv*>(arg))->BGThread();
+    BGThreadArg* bg = reinterpret_cast<BGThreadArg*>(arg);
+    WinEnv* env = bg->env;
+    Priority pri = bg->pri;
+    delete bg;
+    env->BGThread(pri);
     _endthreadex(0);
     return 0;
   }
 
+  // Start the missing threads of priority "pri".  REQUIRES: mu_ held.
+  void StartBGThreads(Priority pri);
+
   leveldb::port::Mutex mu_;
-  leveldb::port::CondVar bgsignal_;
-  HANDLE  bgthread_;
 
   // Entry per Schedule() call
   struct BGItem { void* arg; void (*function)(void*); };
   typedef std::deque<BGItem> BGQueue;
-  BGQueue queue_;
+
+  // Work items and threads of one priority
+  struct BGPool {
+    leveldb::port::CondVar bgsignal;
+    int started_threads;
+    int max_threads;
+    BGQueue queue;
+
+    explicit BGPool(leveldb::port::Mutex* mu)
+      : bgsignal(mu), started_threads(0), max_threads(1) { }
+  };
+  BGPool* pools_[HIGH + 1];
 };
 
 
-WinEnv::WinEnv() : bgthread_(NULL), bgsignal_(&mu_) {
+WinEnv::WinEnv() {
   QueryPerformanceFrequency(&freq_);
+  for (int pri = LOW; pri <= HIGH; pri++) {
+    pools_[pri] = new BGPool(&mu_);
+  }
 }
 
 void WinEnv::Schedule(void (*function)(void*), void* arg) {
+  Schedule(function, arg, LOW);
+}
+
+void WinEnv::Schedule(void (*function)(void*), void* arg, Priority pri) {
   mu_.Lock();
+  BGPool* pool = pools_[pri];
 
-  // Start background thread if necessary
-  if (NULL == bgthread_) {
-    bgthread_ = (HANDLE)_beginthreadex(NULL, 0, &WinEnv::BGThreadWrapper, this, 0, NULL);
-  }
+  // Start background threads if necessary
+  StartBGThreads(pri);
 
   // Add to priority queue
-  queue_.push_back(BGItem());
-  queue_.back().function = function;
-  queue_.back().arg = arg;
+  pool->queue.push_back(BGItem());
+  pool->queue.back().function = function;
+  pool->queue.back().arg = arg;
 
   mu_.Unlock();
 
-  bgsignal_.Signal();
+  pool->bgsignal.Signal();
+}
+
+void WinEnv::IncBackgroundThreadsIfNeeded(int number, Priority pri) {
+  mu_.Lock();
+  BGPool* pool = pools_[pri];
+  if (number > pool->max_threads) {
+    pool->max_threads = number;
+    if (pool->started_threads > 0) {
+      StartBGThreads(pri);
+    }
+  }
+  mu_.Unlock();
+}
+
+void WinEnv::StartBGThreads(Priority pri) {
+  BGPool* pool = pools_[pri];
+  while (pool->started_threads < pool->max_threads) {
+    BGThreadArg* bg = new BGThreadArg;
+    bg->env = this;
+    bg->pri = pri;
+    HANDLE t = (HANDLE)_beginthreadex(NULL, 0, &WinEnv::BGThreadWrapper, bg, 0, NULL);
+    CloseHandle(t);
+    pool->started_threads++;
+  }
 }
 
-void WinEnv::BGThread() {
+void WinEnv::BGThread(Priority pri) {
+  BGPool* pool = pools_[pri];
   while (true) {
     // Wait until there is an item that is ready to run
     mu_.Lock();
 
-    while (queue_.empty()) {
-      bgsignal_.Wait();
+    while (pool->queue.empty()) {
+      pool->bgsignal.Wait();
     }
 
-    void (*function)(void*) = queue_.front().function;
-    void* arg = queue_.front().arg;
-    queue_.pop_front();
+    void (*function)(void*) = pool->queue.front().function;
+    void* arg = pool->queue.front().arg;
+    pool->queue.pop_front();
 
     mu_.Unlock();
     (*function)(arg);
   }
-  // TODO: CloseHandle(bgthread_) ??
 }
 
 namespace {
@@ -26,6 +26,10 @@ CondVar::~CondVar() { uv_cond_destroy(&cv_); }
 
 void CondVar::Wait() { uv_cond_wait(&cv_, &mu_->mu_); }
 
+bool CondVar::TimedWait(uint64_t micros) {
+  return uv_cond_timedwait(&cv_, &mu_->mu_, micros * 1000) == UV_ETIMEDOUT;
+}
+
 void CondVar::Signal() { uv_cond_signal(&cv_); }
 
 void CondVar::SignalAll() { uv_cond_broadcast(&cv_); }
@@ -3,10 +3,12 @@ const util             = require('util')
     , fastFuture       = require('fast-future')
 
 
-function Iterator (db, options) {
+function Iterator (db, options, batch) {
   AbstractIterator.call(this, db, options)
 
-  this.binding    = db.binding.iterator(this.options)
+  this.binding    = batch
+    ? db.binding.iterator(this.options, batch.binding)
+    : db.binding.iterator(this.options)
   this.cache      = null
   this.finished   = false
   this.fastFuture = fastFuture()
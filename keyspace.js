@@ -0,0 +1,133 @@
+const ChainedBatch = require('./chained-batch')
+    , Transaction  = require('./transaction')
+
+
+// a named keyspace declared with the `keyspaces` open option: the
+// operations of the database, limited to the keys of the keyspace
+function Keyspace (db, name) {
+  this.db   = db
+  this.name = name
+}
+
+
+Keyspace.prototype._options = function (options) {
+  var result = {}
+  if (options && typeof options == 'object') {
+    for (var k in options) result[k] = options[k]
+  }
+  result.keyspace = this.name
+  return result
+}
+
+
+Keyspace.prototype._operations = function (operations) {
+  var name = this.name
+  // the database reports the missing array
+  if (!Array.isArray(operations)) return operations
+  return operations.map(function (op) {
+    if (op == null || op.keyspace != null) return op
+    var result = {}
+    for (var k in op) result[k] = op[k]
+    result.keyspace = name
+    return result
+  })
+}
+
+
+Keyspace.prototype.getSync = function (key, options) {
+  return this.db.getSync(key, this._options(options))
+}
+
+
+Keyspace.prototype.get = function (key, options, callback) {
+  if (typeof options == 'function') {
+    callback = options
+    options = {}
+  }
+  return this.db.get(key, this._options(options), callback)
+}
+
+
+Keyspace.prototype.putSync = function (key, value, options) {
+  return this.db.putSync(key, value, this._options(options))
+}
+
+
+Keyspace.prototype.put = function (key, value, options, callback) {
+  if (typeof options == 'function') {
+    callback = options
+    options = {}
+  }
+  return this.db.put(key, value, this._options(options), callback)
+}
+
+
+Keyspace.prototype.delSync = function (key, options) {
+  return this.db.delSync(key, this._options(options))
+}
+
+
+Keyspace.prototype.del = function (key, options, callback) {
+  if (typeof options == 'function') {
+    callback = options
+    options = {}
+  }
+  return this.db.del(key, this._options(options), callback)
+}
+
+
+// operations without a `keyspace` go to this keyspace, and without
+// operations it returns a chained batch of the keys of this keyspace
+Keyspace.prototype.batchSync = function (operations, options) {
+  if (!arguments.length) return new ChainedBatch(this.db, this.name)
+  return this.db.batchSync(this._operations(operations), options)
+}
+
+
+Keyspace.prototype.batch = function (operations, options, callback) {
+  if (!arguments.length) return new ChainedBatch(this.db, this.name)
+  return this.db.batch(this._operations(operations), options, callback)
+}
+
+
+Keyspace.prototype.isExistsSync = function (key, options) {
+  return this.db.isExistsSync(key, this._options(options))
+}
+
+
+Keyspace.prototype.mGetSync = function (keys, options) {
+  return this.db.mGetSync(keys, this._options(options))
+}
+
+
+Keyspace.prototype.getBufferSync = function (key, destBuffer, options) {
+  return this.db.getBufferSync(key, destBuffer, this._options(options))
+}
+
+
+Keyspace.prototype.mergeSync = function (key, value, options) {
+  return this.db.mergeSync(key, value, this._options(options))
+}
+
+
+Keyspace.prototype.incrSync = function (key, delta, options) {
+  return this.db.incrSync(key, delta, this._options(options))
+}
+
+
+Keyspace.prototype.casSync = function (key, expected, value, options) {
+  return this.db.casSync(key, expected, value, this._options(options))
+}
+
+
+Keyspace.prototype.beginTransaction = function () {
+  return new Transaction(this.db, this.name)
+}
+
+
+Keyspace.prototype.iterator = function (options) {
+  return this.db.iterator(this._options(options))
+}
+
+
+module.exports = Keyspace
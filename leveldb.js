@@ -1,6 +1,6 @@
 // Generated by CoffeeScript 1.12.7
 (function() {
-  var AbstractNoSQL, ChainedBatch, Errors, InvalidArgumentError, Iterator, LevelDB, binding, inherits;
+  var AbstractNoSQL, ChainedBatch, Errors, InvalidArgumentError, Iterator, Keyspace, LevelDB, Transaction, binding, inherits;
 
   inherits = require('inherits-ex');
 
@@ -14,6 +14,10 @@
 
   Iterator = require('./iterator');
 
+  Keyspace = require('./keyspace');
+
+  Transaction = require('./transaction');
+
   InvalidArgumentError = Errors.InvalidArgumentError;
 
   LevelDB = (function() {
@@ -133,6 +137,171 @@
       }
     };
 
+    LevelDB.prototype.syncWalSync = function() {
+      return this.binding.syncWalSync();
+    };
+
+    LevelDB.prototype.syncWalAsync = function(callback) {
+      var that;
+      that = this;
+      return setImmediate(function() {
+        var err, result;
+        result = void 0;
+        try {
+          result = that.syncWalSync();
+        } catch (error) {
+          err = error;
+          callback(err);
+          return;
+        }
+        callback(null, result);
+      });
+    };
+
+    LevelDB.prototype.syncWal = function(callback) {
+      if (typeof callback !== 'function') {
+        return this.syncWalSync();
+      } else {
+        return this.syncWalAsync(callback);
+      }
+    };
+
+    LevelDB.prototype.flushSync = function() {
+      return this.binding.flushSync();
+    };
+
+    LevelDB.prototype.flushAsync = function(callback) {
+      var that;
+      that = this;
+      return setImmediate(function() {
+        var err, result;
+        result = void 0;
+        try {
+          result = that.flushSync();
+        } catch (error) {
+          err = error;
+          callback(err);
+          return;
+        }
+        callback(null, result);
+      });
+    };
+
+    LevelDB.prototype.flush = function(callback) {
+      if (typeof callback !== 'function') {
+        return this.flushSync();
+      } else {
+        return this.flushAsync(callback);
+      }
+    };
+
+    LevelDB.prototype.mergeSync = function(key, value, options) {
+      return this.binding.mergeSync(key, value, options);
+    };
+
+    LevelDB.prototype.mergeAsync = function(key, value, options, callback) {
+      var that;
+      that = this;
+      return setImmediate(function() {
+        var err, result;
+        result = void 0;
+        try {
+          result = that.mergeSync(key, value, options);
+        } catch (error) {
+          err = error;
+          callback(err);
+          return;
+        }
+        callback(null, result);
+      });
+    };
+
+    LevelDB.prototype.merge = function(key, value, options, callback) {
+      if (typeof options === 'function') {
+        callback = options;
+        options = {};
+      }
+      if (typeof callback !== 'function') {
+        return this.mergeSync(key, value, options);
+      } else {
+        return this.mergeAsync(key, value, options, callback);
+      }
+    };
+
+    LevelDB.prototype.incrSync = function(key, delta, options) {
+      return this.binding.incrSync(key, delta, options);
+    };
+
+    LevelDB.prototype.incrAsync = function(key, delta, options, callback) {
+      var that;
+      that = this;
+      return setImmediate(function() {
+        var err, result;
+        result = void 0;
+        try {
+          result = that.incrSync(key, delta, options);
+        } catch (error) {
+          err = error;
+          callback(err);
+          return;
+        }
+        callback(null, result);
+      });
+    };
+
+    LevelDB.prototype.incr = function(key, delta, options, callback) {
+      if (typeof options === 'function') {
+        callback = options;
+        options = {};
+      }
+      if (typeof callback !== 'function') {
+        return this.incrSync(key, delta, options);
+      } else {
+        return this.incrAsync(key, delta, options, callback);
+      }
+    };
+
+    LevelDB.prototype.casSync = function(key, expected, value, options) {
+      return this.binding.casSync(key, expected, value, options);
+    };
+
+    LevelDB.prototype.casAsync = function(key, expected, value, options, callback) {
+      var that;
+      that = this;
+      return setImmediate(function() {
+        var err, result;
+        result = void 0;
+        try {
+          result = that.casSync(key, expected, value, options);
+        } catch (error) {
+          err = error;
+          callback(err);
+          return;
+        }
+        callback(null, result);
+      });
+    };
+
+    LevelDB.prototype.cas = function(key, expected, value, options, callback) {
+      if (typeof options === 'function') {
+        callback = options;
+        options = {};
+      }
+      if (typeof callback !== 'function') {
+        return this.casSync(key, expected, value, options);
+      } else {
+        return this.casAsync(key, expected, value, options, callback);
+      }
+    };
+
+    LevelDB.prototype.beginTransaction = function() {
+      return new Transaction(this);
+    };
+
+    LevelDB.prototype.keyspace = function(name) {
+      return new Keyspace(this, name);
+    };
+
     LevelDB.prototype._chainedBatch = function() {
       return new ChainedBatch(this);
     };
@@ -13,7 +13,7 @@ static Nan::Persistent<v8::FunctionTemplate> batch_constructor;
 Batch::Batch (leveldown::Database* database, bool sync) : database(database) {
   options = new leveldb::WriteOptions();
   options->sync = sync;
-  batch = new leveldb::WriteBatch();
+  batch = new leveldb::WriteBatchWithIndex(database->KeyComparator());
   hasData = false;
 }
 
@@ -23,7 +23,11 @@ Batch::~Batch () {
 }
 
 leveldb::Status Batch::Write () {
-  return database->WriteBatchToDatabase(options, batch);
+  return database->WriteBatchToDatabase(options, batch->GetWriteBatch());
+}
+
+leveldb::Iterator* Batch::NewIteratorWithBase (leveldb::Iterator* base) {
+  return batch->NewIteratorWithBase(base);
 }
 
 void Batch::Init () {
@@ -34,6 +38,7 @@ void Batch::Init () {
   Nan::SetPrototypeMethod(tpl, "put", Batch::Put);
   Nan::SetPrototypeMethod(tpl, "del", Batch::Del);
   Nan::SetPrototypeMethod(tpl, "clear", Batch::Clear);
+  Nan::SetPrototypeMethod(tpl, "getSync", Batch::GetSync);
   Nan::SetPrototypeMethod(tpl, "writeSync", Batch::WriteSync);
 }
 
@@ -85,18 +90,31 @@ NAN_METHOD(Batch::Put) {
   Batch* batch = ObjectWrap::Unwrap<Batch>(info.Holder());
   v8::Local<v8::Function> callback; // purely for the error macros
 
+  v8::Local<v8::Object> optionsObj;
+  if (info.Length() > 2 && info[2]->IsObject()) {
+    optionsObj = v8::Local<v8::Object>::Cast(info[2]);
+  }
+
   v8::Local<v8::Value> keyBuffer = info[0];
   v8::Local<v8::Value> valueBuffer = info[1];
   LD_STRING_OR_BUFFER_TO_SLICE(key, keyBuffer, key)
   LD_STRING_OR_BUFFER_TO_SLICE(value, valueBuffer, value)
 
-  batch->batch->Put(key, value);
-  if (!batch->hasData)
-    batch->hasData = true;
+  // put(key, value, {keyspace: 'name'})
+  std::string keyInKeyspace;
+  leveldb::Slice storedKey;
+  leveldb::Status status = batch->database->KeyInKeyspace(optionsObj, key, &keyInKeyspace, &storedKey);
+  if (status.ok()) {
+    batch->batch->Put(storedKey, value);
+    if (!batch->hasData)
+      batch->hasData = true;
+  }
 
   DisposeStringOrBufferFromSlice(keyBuffer, key);
   DisposeStringOrBufferFromSlice(valueBuffer, value);
 
+  LD_METHOD_CHECK_DB_ERROR(put)
+
   info.GetReturnValue().Set(info.Holder());
 }
 
@@ -105,15 +123,28 @@ NAN_METHOD(Batch::Del) {
 
   v8::Local<v8::Function> callback; // purely for the error macros
 
+  v8::Local<v8::Object> optionsObj;
+  if (info.Length() > 1 && info[1]->IsObject()) {
+    optionsObj = v8::Local<v8::Object>::Cast(info[1]);
+  }
+
   v8::Local<v8::Value> keyBuffer = info[0];
   LD_STRING_OR_BUFFER_TO_SLICE(key, keyBuffer, key)
 
-  batch->batch->Delete(key);
-  if (!batch->hasData)
-    batch->hasData = true;
+  // del(key, {keyspace: 'name'})
+  std::string keyInKeyspace;
+  leveldb::Slice storedKey;
+  leveldb::Status status = batch->database->KeyInKeyspace(optionsObj, key, &keyInKeyspace, &storedKey);
+  if (status.ok()) {
+    batch->batch->Delete(storedKey);
+    if (!batch->hasData)
+      batch->hasData = true;
+  }
 
   DisposeStringOrBufferFromSlice(keyBuffer, key);
 
+  LD_METHOD_CHECK_DB_ERROR(del)
+
   info.GetReturnValue().Set(info.Holder());
 }
 
@@ -126,6 +157,41 @@ NAN_METHOD(Batch::Clear) {
   info.GetReturnValue().Set(info.Holder());
 }
 
+//getSync(key, {fillCache:true, keyspace:'name'}): read the key as if the batch was written
+NAN_METHOD(Batch::GetSync) {
+  Batch* batch = ObjectWrap::Unwrap<Batch>(info.Holder());
+  if (info.Length() < 1)
+    return Nan::ThrowError(Nan::ErrnoException(kInvalidArgument, "getSync", "getSync() miss arguments"));
+  v8::Local<v8::Object> optionsObj;
+  if (info.Length() > 1 && info[1]->IsObject()) {
+    optionsObj = v8::Local<v8::Object>::Cast(info[1]);
+  }
+
+  v8::Local<v8::Value> keyBuffer = info[0];
+  LD_STRING_OR_BUFFER_TO_SLICE(key, keyBuffer, key)
+  std::string value;
+
+  std::string keyInKeyspace;
+  leveldb::Slice storedKey;
+  leveldb::Status status = batch->database->KeyInKeyspace(optionsObj, key, &keyInKeyspace, &storedKey);
+  bool deleted;
+  if (!status.ok()) {
+    // an undeclared keyspace or a reserved key
+  } else if (batch->batch->GetFromBatch(storedKey, &value, &deleted)) {
+    if (deleted)
+      status = leveldb::Status::NotFound(leveldb::Slice());
+  } else {
+    leveldb::ReadOptions options = leveldb::ReadOptions();
+    options.fill_cache = BooleanOptionValue(optionsObj, "fillCache", true);
+    status = batch->database->GetFromDatabase(&options, storedKey, value);
+  }
+  DisposeStringOrBufferFromSlice(keyBuffer, key);
+
+  LD_METHOD_CHECK_DB_ERROR(getSync)
+
+  info.GetReturnValue().Set(Nan::New<v8::String>((char*)value.data(), value.size()).ToLocalChecked());
+}
+
   NAN_METHOD(Batch::WriteSync) {
   Batch* batch = ObjectWrap::Unwrap<Batch>(info.Holder());
   bool result = batch->hasData;
@@ -5,6 +5,7 @@
 #include <node.h>
 
 #include <leveldb/write_batch.h>
+#include <leveldb/write_batch_with_index.h>
 
 #include "database.h"
 
@@ -21,17 +22,20 @@ public:
   Batch  (leveldown::Database* database, bool sync);
   ~Batch ();
   leveldb::Status Write ();
+  // Return an iterator over `base` with the pending operations applied.
+  leveldb::Iterator* NewIteratorWithBase (leveldb::Iterator* base);
 
 private:
   leveldown::Database* database;
   leveldb::WriteOptions* options;
-  leveldb::WriteBatch* batch;
+  leveldb::WriteBatchWithIndex* batch;
   bool hasData; // keep track of whether we're writing data or not
 
   static NAN_METHOD(New);
   static NAN_METHOD(Put);
   static NAN_METHOD(Del);
   static NAN_METHOD(Clear);
+  static NAN_METHOD(GetSync);
   static NAN_METHOD(WriteSync);
 };
 
@@ -6,6 +6,7 @@
 #ifndef LD_COMMON_H
 #define LD_COMMON_H
 
+#include <string>
 #include <nan.h>
 
 namespace leveldown {
@@ -33,6 +34,18 @@ NAN_INLINE uint32_t UInt32OptionValue(v8::Local<v8::Object> options,
     : def;
 }
 
+NAN_INLINE std::string StringOptionValue(v8::Local<v8::Object> options,
+                                         const char* _key,
+                                         const char* def) {
+  Nan::HandleScope scope;
+  v8::Local<v8::String> key = Nan::New(_key).ToLocalChecked();
+  return !options.IsEmpty()
+    && options->Has(key)
+    && options->Get(key)->IsString()
+    ? std::string(*Nan::Utf8String(options->Get(key)))
+    : std::string(def);
+}
+
 } // namespace leveldown
 
 #endif
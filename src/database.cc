@@ -6,13 +6,21 @@
 #include <node.h>
 #include <node_buffer.h>
 
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include <leveldb/db.h>
+#include <leveldb/env.h>
 #include <leveldb/write_batch.h>
 
 #include "leveldown.h"
 #include "database.h"
 #include "batch.h"
 #include "iterator.h"
+#include "keyspace.h"
+#include "transaction.h"
 #include "common.h"
 
 namespace leveldown {
@@ -24,7 +32,13 @@ Database::Database (const v8::Local<v8::Value>& from)
   , db(NULL)
   , currentIteratorId(0)
   , blockCache(NULL)
-  , filterPolicy(NULL) {};
+  , filterPolicy(NULL)
+  , rateLimiter(NULL)
+  , compactionFilter(NULL)
+  , prefixExtractor(NULL)
+  , mergeOperator(NULL)
+  , comparator(leveldb::BytewiseComparator())
+  , writeBuffer(NULL) {};
 
 Database::~Database () {
   CloseDatabase();
@@ -45,7 +59,16 @@ leveldb::Status Database::PutToDatabase (
         leveldb::WriteOptions* options
       , leveldb::Slice key
       , leveldb::Slice value
+      , uint64_t expiry
     ) {
+  if (writeBuffer) {
+    leveldb::Status status = writeBuffer->Put(key, value, expiry);
+    if (status.ok() && options->sync)
+      status = writeBuffer->Flush(true);
+    return status;
+  }
+  if (expiry)
+    return db->PutWithExpiry(*options, key, value, expiry);
   return db->Put(*options, key, value);
 }
 
@@ -54,6 +77,12 @@ leveldb::Status Database::GetFromDatabase (
       , leveldb::Slice key
       , std::string& value
     ) {
+  leveldb::Status status;
+  // the buffered writes are newer than any snapshot
+  if (writeBuffer && options->snapshot == NULL
+      && writeBuffer->Get(key, &value, &status)) {
+    return status;
+  }
   return db->Get(*options, key, &value);
 }
 
@@ -61,13 +90,105 @@ leveldb::Status Database::DeleteFromDatabase (
         leveldb::WriteOptions* options
       , leveldb::Slice key
     ) {
+  if (writeBuffer) {
+    leveldb::Status status = writeBuffer->Delete(key);
+    if (status.ok() && options->sync)
+      status = writeBuffer->Flush(true);
+    return status;
+  }
   return db->Delete(*options, key);
 }
 
+leveldb::Status Database::MergeToDatabase (
+        leveldb::WriteOptions* options
+      , leveldb::Slice key
+      , leveldb::Slice value
+    ) {
+  // the operand applies to the buffered writes of the key
+  if (writeBuffer && mergeOperator) {
+    leveldb::Status status = writeBuffer->Merge(key, value);
+    if (status.ok() && options->sync)
+      status = writeBuffer->Flush(true);
+    return status;
+  }
+  return db->Merge(*options, key, value);
+}
+
+// Parse a signed decimal integer that makes up all of `s`.
+static bool ParseInt64 (const std::string& s, int64_t* result) {
+  if (s.empty() || (s[0] != '-' && (s[0] < '0' || s[0] > '9'))) return false;
+  char* end;
+  errno = 0;
+  long long v = strtoll(s.c_str(), &end, 10);
+  if (errno != 0 || end != s.c_str() + s.size()) return false;
+  *result = v;
+  return true;
+}
+
+leveldb::Status Database::IncrementInDatabase (
+        leveldb::WriteOptions* options
+      , leveldb::Slice key
+      , int64_t delta
+      , int64_t* result
+    ) {
+  KeyLock lock(&keyLocks, key);
+  leveldb::ReadOptions readOptions;
+  std::string value;
+  int64_t current = 0;
+  leveldb::Status status = GetFromDatabase(&readOptions, key, value);
+  if (status.ok()) {
+    if (!ParseInt64(value, &current))
+      return leveldb::Status::InvalidArgument("value is not an integer", key);
+  } else if (!status.IsNotFound()) {
+    return status;
+  }
+  // wrap around instead of overflowing, like the int64Add merge operator
+  *result = static_cast<int64_t>(
+    static_cast<uint64_t>(current) + static_cast<uint64_t>(delta)
+  );
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(*result));
+  return PutToDatabase(options, key, leveldb::Slice(buf));
+}
+
+leveldb::Status Database::CompareAndSwapInDatabase (
+        leveldb::WriteOptions* options
+      , leveldb::Slice key
+      , const leveldb::Slice* expected
+      , leveldb::Slice value
+      , bool* swapped
+    ) {
+  KeyLock lock(&keyLocks, key);
+  leveldb::ReadOptions readOptions;
+  std::string current;
+  leveldb::Status status = GetFromDatabase(&readOptions, key, current);
+  if (!status.ok() && !status.IsNotFound()) return status;
+  *swapped = expected == NULL
+    ? status.IsNotFound()
+    : status.ok() && leveldb::Slice(current) == *expected;
+  if (!*swapped) return leveldb::Status::OK();
+  return PutToDatabase(options, key, value);
+}
+
+leveldb::Status Database::CommitToDatabase (
+        leveldb::WriteOptions* options
+      , const leveldb::Snapshot* snapshot
+      , const std::vector<leveldb::Slice>& keys
+      , leveldb::WriteBatch* batch
+    ) {
+  // the buffered writes must be checked for conflicts too
+  leveldb::Status status = FlushToDatabase();
+  if (!status.ok()) return status;
+  return db->WriteIfUnchanged(*options, snapshot, keys, batch);
+}
+
 leveldb::Status Database::WriteBatchToDatabase (
         leveldb::WriteOptions* options
       , leveldb::WriteBatch* batch
     ) {
+  // keep the order with the buffered writes
+  leveldb::Status status = FlushToDatabase();
+  if (!status.ok()) return status;
   return db->Write(*options, batch);
 }
 
@@ -78,9 +199,23 @@ uint64_t Database::ApproximateSizeFromDatabase (const leveldb::Range* range) {
   return size;
 }
 
-void Database::CompactRangeFromDatabase (const leveldb::Slice* start,
-                                         const leveldb::Slice* end) {
+leveldb::Status Database::CompactRangeFromDatabase (const leveldb::Slice* start,
+                                                    const leveldb::Slice* end) {
+  leveldb::Status status = FlushToDatabase();
+  if (!status.ok()) return status;
   db->CompactRange(start, end);
+  return status;
+}
+
+leveldb::Status Database::SyncWALToDatabase () {
+  leveldb::Status status = FlushToDatabase();
+  if (!status.ok()) return status;
+  return db->SyncWAL();
+}
+
+leveldb::Status Database::FlushToDatabase () {
+  if (writeBuffer) return writeBuffer->Flush();
+  return leveldb::Status::OK();
 }
 
 void Database::GetPropertyFromDatabase (
@@ -94,6 +229,50 @@ leveldb::Iterator* Database::NewIterator (leveldb::ReadOptions* options) {
   return db->NewIterator(*options);
 }
 
+leveldb::Status Database::KeyspaceRange (
+    v8::Local<v8::Object> optionsObj
+  , std::string* prefix
+  , std::string* limit
+) {
+  std::string name = StringOptionValue(optionsObj, "keyspace", "");
+  prefix->clear();
+  limit->clear();
+  if (name.empty()) {
+    // keep the default keyspace out of the declared ones
+    if (!keyspaces.empty())
+      limit->assign(1, kKeyspaceMarker);
+    return leveldb::Status::OK();
+  }
+  if (keyspaces.find(name) == keyspaces.end())
+    return leveldb::Status::InvalidArgument("keyspace not declared", name);
+  *prefix = KeyspacePrefix(name);
+  *limit = KeyspaceLimit(name);
+  return leveldb::Status::OK();
+}
+
+leveldb::Status Database::KeyInKeyspace (
+    v8::Local<v8::Object> optionsObj
+  , const leveldb::Slice& key
+  , std::string* buf
+  , leveldb::Slice* stored
+) {
+  *stored = key;
+  if (optionsObj.IsEmpty() && keyspaces.empty())
+    return leveldb::Status::OK();
+  std::string limit;
+  leveldb::Status status = KeyspaceRange(optionsObj, buf, &limit);
+  if (!status.ok())
+    return status;
+  if (buf->empty()) {
+    if (!key.empty() && key[0] == kKeyspaceMarker)
+      return leveldb::Status::InvalidArgument("key in the keyspace range");
+    return status;
+  }
+  buf->append(key.data(), key.size());
+  *stored = *buf;
+  return status;
+}
+
 const leveldb::Snapshot* Database::NewSnapshot () {
   return db->GetSnapshot();
 }
@@ -102,6 +281,14 @@ void Database::ReleaseSnapshot (const leveldb::Snapshot* snapshot) {
   return db->ReleaseSnapshot(snapshot);
 }
 
+void Database::AddTransaction (Transaction* transaction) {
+  transactions.insert(transaction);
+}
+
+void Database::ReleaseTransaction (Transaction* transaction) {
+  transactions.erase(transaction);
+}
+
 void Database::ReleaseIterator (uint32_t id) {
   // called each time an Iterator is End()ed, in the main thread
   // we have to remove our reference to it and if it's the last iterator
@@ -138,10 +325,17 @@ void Database::CloseIterators () {
   }
 }
 
-void Database::CloseDatabase () {
+leveldb::Status Database::CloseDatabase () {
   CloseIterators();
+  // the snapshots of open transactions must go before the database
+  while (!transactions.empty())
+    (*transactions.begin())->Release();
   // printf("\nClosedIterators\n");
 
+  // the database is closed even if the pending writes fail
+  leveldb::Status status = FlushToDatabase();
+  delete writeBuffer;
+  writeBuffer = NULL;
   delete db;
   db = NULL;
   // printf("\ndestroy dbIterator:%d\n", dbIterator);
@@ -153,6 +347,23 @@ void Database::CloseDatabase () {
     delete filterPolicy;
     filterPolicy = NULL;
   }
+  if (rateLimiter) {
+    delete rateLimiter;
+    rateLimiter = NULL;
+  }
+  if (compactionFilter) {
+    delete compactionFilter;
+    compactionFilter = NULL;
+  }
+  if (mergeOperator) {
+    delete mergeOperator;
+    mergeOperator = NULL;
+  }
+  if (prefixExtractor) {
+    delete prefixExtractor;
+    prefixExtractor = NULL;
+  }
+  return status;
 }
 
 /* V8 exposed functions *****************************/
@@ -175,11 +386,17 @@ void Database::Init () {
   Nan::SetPrototypeMethod(tpl, "getSync", Database::GetSync);
   Nan::SetPrototypeMethod(tpl, "putSync", Database::PutSync);
   Nan::SetPrototypeMethod(tpl, "delSync", Database::DeleteSync);
+  Nan::SetPrototypeMethod(tpl, "mergeSync", Database::MergeSync);
+  Nan::SetPrototypeMethod(tpl, "incrSync", Database::IncrSync);
+  Nan::SetPrototypeMethod(tpl, "casSync", Database::CasSync);
   Nan::SetPrototypeMethod(tpl, "batchSync", Database::BatchSync);
+  Nan::SetPrototypeMethod(tpl, "beginTransaction", Database::BeginTransaction);
   Nan::SetPrototypeMethod(tpl, "isExistsSync", Database::IsExistsSync);
   Nan::SetPrototypeMethod(tpl, "mGetSync", Database::MultiGetSync);
   Nan::SetPrototypeMethod(tpl, "getBufferSync", Database::GetBufferSync);
   Nan::SetPrototypeMethod(tpl, "compactRangeSync", Database::CompactRangeSync);
+  Nan::SetPrototypeMethod(tpl, "syncWalSync", Database::SyncWalSync);
+  Nan::SetPrototypeMethod(tpl, "flushSync", Database::FlushSync);
 }
 
 NAN_METHOD(Database::New) {
@@ -218,12 +435,32 @@ NAN_METHOD(Database::OpenSync) {
   bool createIfMissing = BooleanOptionValue(optionsObj, "createIfMissing", true);
   bool errorIfExists = BooleanOptionValue(optionsObj, "errorIfExists");
   bool compression = BooleanOptionValue(optionsObj, "compression", true);
+  uint32_t compressionThreads = UInt32OptionValue(
+      optionsObj
+    , "compressionThreads"
+    , 1
+  );
   uint32_t cacheSize = UInt32OptionValue(optionsObj, "cacheSize", 8 << 20);
   uint32_t writeBufferSize = UInt32OptionValue(
       optionsObj
     , "writeBufferSize"
     , 4 << 20
   );
+  uint32_t maxWriteBufferNumber = UInt32OptionValue(
+      optionsObj
+    , "maxWriteBufferNumber"
+    , 2
+  );
+  uint32_t maxBackgroundCompactions = UInt32OptionValue(
+      optionsObj
+    , "maxBackgroundCompactions"
+    , 1
+  );
+  uint32_t maxSubcompactions = UInt32OptionValue(
+      optionsObj
+    , "maxSubcompactions"
+    , 1
+  );
   uint32_t blockSize = UInt32OptionValue(optionsObj, "blockSize", 4096);
   uint32_t maxOpenFiles = UInt32OptionValue(optionsObj, "maxOpenFiles", 1000);
   uint32_t blockRestartInterval = UInt32OptionValue(
@@ -232,38 +469,311 @@ NAN_METHOD(Database::OpenSync) {
     , 16
   );
   uint32_t maxFileSize = UInt32OptionValue(optionsObj, "maxFileSize", 2 << 20);
+  uint32_t level0FileNumCompactionTrigger = UInt32OptionValue(
+      optionsObj
+    , "level0FileNumCompactionTrigger"
+    , 4
+  );
+  uint32_t level0SlowdownWritesTrigger = UInt32OptionValue(
+      optionsObj
+    , "level0SlowdownWritesTrigger"
+    , 8
+  );
+  uint32_t level0StopWritesTrigger = UInt32OptionValue(
+      optionsObj
+    , "level0StopWritesTrigger"
+    , 12
+  );
+  uint32_t maxMemCompactionLevel = UInt32OptionValue(
+      optionsObj
+    , "maxMemCompactionLevel"
+    , 2
+  );
+  uint32_t maxBytesForLevelBase = UInt32OptionValue(
+      optionsObj
+    , "maxBytesForLevelBase"
+    , 10 << 20
+  );
+  uint32_t maxBytesForLevelMultiplier = UInt32OptionValue(
+      optionsObj
+    , "maxBytesForLevelMultiplier"
+    , 10
+  );
+  bool levelCompactionDynamicLevelBytes = BooleanOptionValue(
+      optionsObj
+    , "levelCompactionDynamicLevelBytes"
+    , false
+  );
+  std::string compactionStyle = StringOptionValue(
+      optionsObj
+    , "compactionStyle"
+    , "level"
+  );
+  uint32_t tieredSizeRatio = UInt32OptionValue(optionsObj, "tieredSizeRatio", 1);
+  uint32_t tieredMaxRuns = UInt32OptionValue(optionsObj, "tieredMaxRuns", 6);
+  uint32_t tombstoneCompactionPercent = UInt32OptionValue(
+      optionsObj
+    , "tombstoneCompactionPercent"
+    , 0
+  );
+  std::string compactionFilter = StringOptionValue(
+      optionsObj
+    , "compactionFilter"
+    , ""
+  );
+  std::string compactionFilterPrefix = StringOptionValue(
+      optionsObj
+    , "compactionFilterPrefix"
+    , ""
+  );
+  std::string mergeOperator = StringOptionValue(
+      optionsObj
+    , "mergeOperator"
+    , ""
+  );
+  std::string comparator = StringOptionValue(
+      optionsObj
+    , "comparator"
+    , "bytewise"
+  );
+  std::string prefixExtractor = StringOptionValue(
+      optionsObj
+    , "prefixExtractor"
+    , ""
+  );
+  uint32_t prefixLength = UInt32OptionValue(optionsObj, "prefixLength", 0);
+  std::string prefixDelimiter = StringOptionValue(
+      optionsObj
+    , "prefixDelimiter"
+    , "/"
+  );
+  uint32_t prefixDelimiterCount = UInt32OptionValue(
+      optionsObj
+    , "prefixDelimiterCount"
+    , 1
+  );
+  std::string filterPolicy = StringOptionValue(
+      optionsObj
+    , "filterPolicy"
+    , "bloom"
+  );
+  uint32_t bitsPerKey = UInt32OptionValue(
+      optionsObj
+    , "bitsPerKey"
+    , UInt32OptionValue(optionsObj, "bloomBitsPerKey", 10)
+  );
+  // xor filters of the few keys of 2KB of blocks are larger than bloom ones
+  bool fullTableFilter = BooleanOptionValue(
+      optionsObj
+    , "fullTableFilter"
+    , filterPolicy == "xor"
+  );
+  uint32_t walSyncIntervalMs = UInt32OptionValue(
+      optionsObj
+    , "walSyncIntervalMs"
+    , 0
+  );
+  uint32_t walSyncBytes = UInt32OptionValue(optionsObj, "walSyncBytes", 0);
+  uint32_t compactionRateLimitBytesPerSec = UInt32OptionValue(
+      optionsObj
+    , "compactionRateLimitBytesPerSec"
+    , 0
+  );
+  bool compactionRateLimitAdaptive = BooleanOptionValue(
+      optionsObj
+    , "compactionRateLimitAdaptive"
+  );
+  uint32_t writeBehindSize = UInt32OptionValue(optionsObj, "writeBehindSize", 0);
+  uint32_t writeBehindIntervalMs = UInt32OptionValue(
+      optionsObj
+    , "writeBehindIntervalMs"
+    , 100
+  );
+
+  // keyspaces: ['users', 'posts'], the named keyspaces of the database
+  std::set<std::string> keyspaces;
+  v8::Local<v8::String> keyspacesKey = Nan::New("keyspaces").ToLocalChecked();
+  if (!optionsObj.IsEmpty() && optionsObj->Has(keyspacesKey)
+      && optionsObj->Get(keyspacesKey)->IsArray()) {
+    v8::Local<v8::Array> names = optionsObj->Get(keyspacesKey).As<v8::Array>();
+    for (unsigned int i = 0; i < names->Length(); i++) {
+      Nan::Utf8String name(names->Get(i));
+      if (name.length() == 0 || memchr(*name, '\0', name.length()) != NULL)
+        return Nan::ThrowError(Nan::ErrnoException(kInvalidArgument, "openSync"
+          , "keyspace names must be non-empty strings without NUL"));
+      keyspaces.insert(std::string(*name, name.length()));
+    }
+  }
+  const leveldb::Comparator* keyComparator;
+  if (comparator == "bytewise") {
+    keyComparator = leveldb::BytewiseComparator();
+  } else if (comparator == "reverse") {
+    keyComparator = leveldb::ReverseBytewiseComparator();
+  } else if (comparator == "uint64be") {
+    keyComparator = leveldb::Uint64BigEndianComparator();
+  } else if (comparator == "tuple") {
+    keyComparator = leveldb::TupleComparator();
+  } else {
+    return Nan::ThrowError(Nan::ErrnoException(kInvalidArgument, "openSync"
+      , "comparator must be 'bytewise', 'reverse', 'uint64be' or 'tuple'"));
+  }
+  // the keys of keyspaces are ranges of byte-wise ordered prefixes
+  if (!keyspaces.empty() && keyComparator != leveldb::BytewiseComparator())
+    return Nan::ThrowError(Nan::ErrnoException(kInvalidArgument, "openSync"
+      , "keyspaces need the 'bytewise' comparator"));
+  // the keys of a prefix must be adjacent and sort after it
+  if (!prefixExtractor.empty() && keyComparator != leveldb::BytewiseComparator())
+    return Nan::ThrowError(Nan::ErrnoException(kInvalidArgument, "openSync"
+      , "prefixExtractor needs the 'bytewise' comparator"));
+  if (prefixExtractor == "fixed") {
+    if (prefixLength == 0)
+      return Nan::ThrowError(Nan::ErrnoException(kInvalidArgument, "openSync"
+        , "prefixLength must be positive"));
+  } else if (prefixExtractor == "delimiter") {
+    if (prefixDelimiter.size() != 1 || prefixDelimiterCount == 0)
+      return Nan::ThrowError(Nan::ErrnoException(kInvalidArgument, "openSync"
+        , "prefixDelimiter must be one byte and prefixDelimiterCount positive"));
+  } else if (!prefixExtractor.empty()) {
+    return Nan::ThrowError(Nan::ErrnoException(kInvalidArgument, "openSync"
+      , "prefixExtractor must be 'fixed' or 'delimiter'"));
+  }
+  if (filterPolicy != "bloom" && filterPolicy != "blockedBloom"
+      && filterPolicy != "xor" && filterPolicy != "none")
+    return Nan::ThrowError(Nan::ErrnoException(kInvalidArgument, "openSync"
+      , "filterPolicy must be 'bloom', 'blockedBloom', 'xor' or 'none'"));
+  if (bitsPerKey == 0)
+    return Nan::ThrowError(Nan::ErrnoException(kInvalidArgument, "openSync"
+      , "bitsPerKey must be positive"));
+  if (filterPolicy == "xor" && !fullTableFilter)
+    return Nan::ThrowError(Nan::ErrnoException(kInvalidArgument, "openSync"
+      , "filterPolicy 'xor' needs fullTableFilter"));
+  if (compactionStyle != "level" && compactionStyle != "tiered")
+    return Nan::ThrowError(Nan::ErrnoException(kInvalidArgument, "openSync"
+      , "compactionStyle must be 'level' or 'tiered'"));
+  if (compactionFilter == "removeKeyPrefix"
+      || compactionFilter == "stripValuePrefix") {
+    // an empty prefix would match every record
+    if (compactionFilterPrefix.empty())
+      return Nan::ThrowError(Nan::ErrnoException(kInvalidArgument, "openSync"
+        , "compactionFilter needs a non-empty compactionFilterPrefix"));
+  } else if (!compactionFilter.empty()) {
+    return Nan::ThrowError(Nan::ErrnoException(kInvalidArgument, "openSync"
+      , "compactionFilter must be 'removeKeyPrefix' or 'stripValuePrefix'"));
+  }
+  // the merge records of the database can only be read with an operator
+  if (!mergeOperator.empty() && mergeOperator != "int64Add"
+      && mergeOperator != "int64Max" && mergeOperator != "append"
+      && mergeOperator != "setUnion")
+    return Nan::ThrowError(Nan::ErrnoException(kInvalidArgument, "openSync"
+      , "mergeOperator must be 'int64Add', 'int64Max', 'append' or 'setUnion'"));
+  database->comparator = keyComparator;
+  database->keyspaces.swap(keyspaces);
 
   database->blockCache = leveldb::NewLRUCache(cacheSize);
-  database->filterPolicy = leveldb::NewBloomFilterPolicy(10);
+  if (filterPolicy == "bloom") {
+    database->filterPolicy = leveldb::NewBloomFilterPolicy(bitsPerKey);
+  } else if (filterPolicy == "blockedBloom") {
+    database->filterPolicy = leveldb::NewBlockedBloomFilterPolicy(bitsPerKey);
+  } else if (filterPolicy == "xor") {
+    database->filterPolicy = leveldb::NewXorFilterPolicy(bitsPerKey);
+  }
+  if (compactionRateLimitBytesPerSec > 0) {
+    database->rateLimiter = leveldb::NewRateLimiter(
+        leveldb::Env::Default()
+      , compactionRateLimitBytesPerSec
+      , compactionRateLimitAdaptive
+    );
+  }
+  if (prefixExtractor == "fixed") {
+    database->prefixExtractor = leveldb::NewFixedPrefixTransform(prefixLength);
+  } else if (prefixExtractor == "delimiter") {
+    database->prefixExtractor = leveldb::NewDelimiterPrefixTransform(
+        prefixDelimiter[0]
+      , static_cast<int>(prefixDelimiterCount)
+    );
+  }
+  if (compactionFilter == "removeKeyPrefix") {
+    database->compactionFilter =
+        leveldb::NewKeyPrefixRemovingFilter(compactionFilterPrefix);
+  } else if (compactionFilter == "stripValuePrefix") {
+    database->compactionFilter =
+        leveldb::NewValuePrefixStrippingFilter(compactionFilterPrefix);
+  }
+  if (mergeOperator == "int64Add") {
+    database->mergeOperator = leveldb::NewInt64AddOperator();
+  } else if (mergeOperator == "int64Max") {
+    database->mergeOperator = leveldb::NewInt64MaxOperator();
+  } else if (mergeOperator == "append") {
+    database->mergeOperator = leveldb::NewAppendOperator();
+  } else if (mergeOperator == "setUnion") {
+    database->mergeOperator = leveldb::NewSetUnionOperator();
+  }
 
   leveldb::Options options = leveldb::Options();
   options.block_cache            = database->blockCache;
   options.filter_policy          = database->filterPolicy;
+  options.full_table_filter      = fullTableFilter;
+  options.rate_limiter           = database->rateLimiter;
+  options.compaction_filter      = database->compactionFilter;
+  options.merge_operator         = database->mergeOperator;
+  options.comparator             = database->comparator;
+  options.prefix_extractor       = database->prefixExtractor;
   options.create_if_missing      = createIfMissing;
   options.error_if_exists        = errorIfExists;
   options.compression            = compression
       ? leveldb::kSnappyCompression
       : leveldb::kNoCompression;
+  options.compression_threads    = compressionThreads;
   options.write_buffer_size      = writeBufferSize;
+  options.max_write_buffer_number = maxWriteBufferNumber;
+  options.max_background_compactions = maxBackgroundCompactions;
+  options.max_subcompactions = maxSubcompactions;
   options.block_size             = blockSize;
   options.max_open_files         = maxOpenFiles;
   options.block_restart_interval = blockRestartInterval;
   options.max_file_size          = maxFileSize;
+  options.level0_file_num_compaction_trigger = level0FileNumCompactionTrigger;
+  options.level0_slowdown_writes_trigger = level0SlowdownWritesTrigger;
+  options.level0_stop_writes_trigger = level0StopWritesTrigger;
+  options.max_mem_compaction_level = maxMemCompactionLevel;
+  options.max_bytes_for_level_base = maxBytesForLevelBase;
+  options.max_bytes_for_level_multiplier = maxBytesForLevelMultiplier;
+  options.level_compaction_dynamic_level_bytes =
+      levelCompactionDynamicLevelBytes;
+  options.compaction_style       = compactionStyle == "tiered"
+      ? leveldb::kTieredCompaction
+      : leveldb::kLevelCompaction;
+  options.tiered_size_ratio      = tieredSizeRatio;
+  options.tiered_max_runs        = tieredMaxRuns;
+  options.tombstone_compaction_percent = tombstoneCompactionPercent;
+  options.wal_sync_interval_ms   = walSyncIntervalMs;
+  options.wal_sync_bytes         = walSyncBytes;
   leveldb::Status status = database->OpenDatabase(&options);
 
   LD_METHOD_CHECK_DB_ERROR(openSync)
 
+  if (writeBehindSize > 0) {
+    database->writeBuffer = new WriteBuffer(
+        database->db
+      , database->mergeOperator
+      , writeBehindSize
+      , writeBehindIntervalMs
+    );
+  }
+
   info.GetReturnValue().Set(true);
 }
 
 NAN_METHOD(Database::CloseSync) {
   leveldown::Database* database = Nan::ObjectWrap::Unwrap<leveldown::Database>(info.This());
 
-  database->CloseDatabase();
+  leveldb::Status status = database->CloseDatabase();
+  LD_METHOD_CHECK_DB_ERROR(closeSync)
+
   info.GetReturnValue().Set(true);
 }
 
-//PutSync(key, value, {sync:false})
+//PutSync(key, value, {sync:false, ttl:0})
 NAN_METHOD(Database::PutSync) {
   LD_METHOD_SETUP_SIMPLE(putSync, 1, 2)
 
@@ -273,11 +783,20 @@ NAN_METHOD(Database::PutSync) {
   LD_STRING_OR_BUFFER_TO_SLICE(value, valueHandle, value);
 
   bool sync = BooleanOptionValue(optionsObj, "sync");
+  // milliseconds until the value expires, 0 to keep it forever
+  uint32_t ttl = UInt32OptionValue(optionsObj, "ttl", 0);
+  uint64_t expiry = 0;
+  if (ttl > 0)
+    expiry = leveldb::Env::Default()->NowMicros() + static_cast<uint64_t>(ttl) * 1000;
 
   leveldb::WriteOptions options = leveldb::WriteOptions();
   options.sync = sync;
+  std::string keyInKeyspace;
+  leveldb::Slice storedKey;
+  leveldb::Status status = database->KeyInKeyspace(optionsObj, key, &keyInKeyspace, &storedKey);
   // leveldb::Status status = database->db->Put(options, *key, *value);
-  leveldb::Status status = database->PutToDatabase(&options, key, value);
+  if (status.ok())
+    status = database->PutToDatabase(&options, storedKey, value, expiry);
   DisposeStringOrBufferFromSlice(keyHandle, key);
   DisposeStringOrBufferFromSlice(valueHandle, value);
 
@@ -299,7 +818,11 @@ NAN_METHOD(Database::GetSync) {
 
   leveldb::ReadOptions options = leveldb::ReadOptions();
   options.fill_cache = fillCache;
-  leveldb::Status status = database->GetFromDatabase(&options, key, value);
+  std::string keyInKeyspace;
+  leveldb::Slice storedKey;
+  leveldb::Status status = database->KeyInKeyspace(optionsObj, key, &keyInKeyspace, &storedKey);
+  if (status.ok())
+    status = database->GetFromDatabase(&options, storedKey, value);
   DisposeStringOrBufferFromSlice(keyHandle, key);
 
   LD_METHOD_CHECK_DB_ERROR(getSync)
@@ -319,7 +842,11 @@ NAN_METHOD(Database::DeleteSync) {
 
   leveldb::WriteOptions options = leveldb::WriteOptions();
   options.sync = sync;
-  leveldb::Status status = database->DeleteFromDatabase(&options, key);
+  std::string keyInKeyspace;
+  leveldb::Slice storedKey;
+  leveldb::Status status = database->KeyInKeyspace(optionsObj, key, &keyInKeyspace, &storedKey);
+  if (status.ok())
+    status = database->DeleteFromDatabase(&options, storedKey);
   DisposeStringOrBufferFromSlice(keyHandle, key);
 
   LD_METHOD_CHECK_DB_ERROR(delSync)
@@ -327,7 +854,107 @@ NAN_METHOD(Database::DeleteSync) {
   info.GetReturnValue().Set(true);
 }
 
+//MergeSync(key, value, {sync:false})
+NAN_METHOD(Database::MergeSync) {
+  LD_METHOD_SETUP_SIMPLE(mergeSync, 1, 2)
+
+  v8::Local<v8::Object> keyHandle = Nan::To<v8::Object>(info[0]).ToLocalChecked();
+  v8::Local<v8::Object> valueHandle = Nan::To<v8::Object>(info[1]).ToLocalChecked();
+  LD_STRING_OR_BUFFER_TO_SLICE(key, keyHandle, key);
+  LD_STRING_OR_BUFFER_TO_SLICE(value, valueHandle, value);
+
+  bool sync = BooleanOptionValue(optionsObj, "sync");
+
+  leveldb::WriteOptions options = leveldb::WriteOptions();
+  options.sync = sync;
+  std::string keyInKeyspace;
+  leveldb::Slice storedKey;
+  leveldb::Status status = database->KeyInKeyspace(optionsObj, key, &keyInKeyspace, &storedKey);
+  if (status.ok())
+    status = database->MergeToDatabase(&options, storedKey, value);
+  DisposeStringOrBufferFromSlice(keyHandle, key);
+  DisposeStringOrBufferFromSlice(valueHandle, value);
+
+  LD_METHOD_CHECK_DB_ERROR(mergeSync)
+
+  info.GetReturnValue().Set(true);
+}
+
+//IncrSync(key, delta, {sync:false})
+NAN_METHOD(Database::IncrSync) {
+  LD_METHOD_SETUP_SIMPLE(incrSync, 1, 2)
+
+  v8::Local<v8::Object> keyHandle = Nan::To<v8::Object>(info[0]).ToLocalChecked();
+  int64_t delta = Nan::To<int64_t>(info[1]).FromMaybe(0);
+  LD_STRING_OR_BUFFER_TO_SLICE(key, keyHandle, key);
+
+  bool sync = BooleanOptionValue(optionsObj, "sync");
+
+  leveldb::WriteOptions options = leveldb::WriteOptions();
+  options.sync = sync;
+  int64_t result = 0;
+  std::string keyInKeyspace;
+  leveldb::Slice storedKey;
+  leveldb::Status status = database->KeyInKeyspace(optionsObj, key, &keyInKeyspace, &storedKey);
+  if (status.ok())
+    status = database->IncrementInDatabase(&options, storedKey, delta, &result);
+  DisposeStringOrBufferFromSlice(keyHandle, key);
+
+  LD_METHOD_CHECK_DB_ERROR(incrSync)
+
+  info.GetReturnValue().Set(Nan::New<v8::Number>(static_cast<double>(result)));
+}
+
+//CasSync(key, expected, value, {sync:false}), expected is null if the key should be missing
+NAN_METHOD(Database::CasSync) {
+  LD_METHOD_SETUP_SIMPLE(casSync, 2, 3)
+
+  v8::Local<v8::Object> keyHandle = Nan::To<v8::Object>(info[0]).ToLocalChecked();
+  bool expectMissing = info[1]->IsNull() || info[1]->IsUndefined();
+  v8::Local<v8::Value> expectedHandle = info[1];
+  v8::Local<v8::Object> valueHandle = Nan::To<v8::Object>(info[2]).ToLocalChecked();
+  LD_STRING_OR_BUFFER_TO_SLICE(key, keyHandle, key);
+  LD_STRING_OR_BUFFER_TO_SLICE(expected, expectedHandle, expected);
+  LD_STRING_OR_BUFFER_TO_SLICE(value, valueHandle, value);
+
+  bool sync = BooleanOptionValue(optionsObj, "sync");
+
+  leveldb::WriteOptions options = leveldb::WriteOptions();
+  options.sync = sync;
+  bool swapped = false;
+  std::string keyInKeyspace;
+  leveldb::Slice storedKey;
+  leveldb::Status status = database->KeyInKeyspace(optionsObj, key, &keyInKeyspace, &storedKey);
+  if (status.ok()) {
+    status = database->CompareAndSwapInDatabase(
+        &options
+      , storedKey
+      , expectMissing ? NULL : &expected
+      , value
+      , &swapped
+    );
+  }
+  DisposeStringOrBufferFromSlice(keyHandle, key);
+  DisposeStringOrBufferFromSlice(expectedHandle, expected);
+  DisposeStringOrBufferFromSlice(valueHandle, value);
+
+  LD_METHOD_CHECK_DB_ERROR(casSync)
+
+  info.GetReturnValue().Set(swapped);
+}
+
 //BatchSync(operations, {sync:true})
+//beginTransaction(): start an optimistic transaction at a new snapshot
+NAN_METHOD(Database::BeginTransaction) {
+  Database* database = Nan::ObjectWrap::Unwrap<Database>(info.This());
+
+  // the snapshot should see the buffered writes too
+  leveldb::Status status = database->FlushToDatabase();
+  LD_METHOD_CHECK_DB_ERROR(beginTransaction)
+
+  info.GetReturnValue().Set(Transaction::NewInstance(info.This()));
+}
+
 NAN_METHOD(Database::BatchSync) {
   if ((info.Length() == 0 || info.Length() == 1) && !info[0]->IsArray()) {
     v8::Local<v8::Object> optionsObj;
@@ -347,6 +974,7 @@ NAN_METHOD(Database::BatchSync) {
   leveldb::WriteBatch batch = leveldb::WriteBatch();
 
   bool hasData = false;
+  std::string keyInKeyspace;
 
   for (unsigned int i = 0; i < array->Length(); i++) {
     if (!array->Get(i)->IsObject())
@@ -359,22 +987,33 @@ NAN_METHOD(Database::BatchSync) {
     if (type->StrictEquals(Nan::New("del").ToLocalChecked())) {
       LD_STRING_OR_BUFFER_TO_SLICE(key, keyBuffer, key)
 
-      batch.Delete(key);
-      if (!hasData)
-        hasData = true;
+      // {type: 'del', key: key, keyspace: 'name'}
+      leveldb::Slice storedKey;
+      leveldb::Status status = database->KeyInKeyspace(obj, key, &keyInKeyspace, &storedKey);
+      if (status.ok()) {
+        batch.Delete(storedKey);
+        if (!hasData)
+          hasData = true;
+      }
 
       DisposeStringOrBufferFromSlice(keyBuffer, key);
+      LD_METHOD_CHECK_DB_ERROR(batchSync)
     } else if (type->StrictEquals(Nan::New("put").ToLocalChecked())) {
       v8::Local<v8::Value> valueBuffer = obj->Get(Nan::New("value").ToLocalChecked());
 
       LD_STRING_OR_BUFFER_TO_SLICE(key, keyBuffer, key)
       LD_STRING_OR_BUFFER_TO_SLICE(value, valueBuffer, value)
-      batch.Put(key, value);
-      if (!hasData)
-        hasData = true;
+      leveldb::Slice storedKey;
+      leveldb::Status status = database->KeyInKeyspace(obj, key, &keyInKeyspace, &storedKey);
+      if (status.ok()) {
+        batch.Put(storedKey, value);
+        if (!hasData)
+          hasData = true;
+      }
 
       DisposeStringOrBufferFromSlice(keyBuffer, key);
       DisposeStringOrBufferFromSlice(valueBuffer, value);
+      LD_METHOD_CHECK_DB_ERROR(batchSync)
     }
   }
 
@@ -415,11 +1054,35 @@ NAN_METHOD(Database::CompactRangeSync) {
   LD_STRING_OR_BUFFER_TO_SLICE(start, startHandle, start)
   LD_STRING_OR_BUFFER_TO_SLICE(end, endHandle, end)
 
-  database->CompactRangeFromDatabase(&start, &end);
+  leveldb::Status status = database->CompactRangeFromDatabase(&start, &end);
 
   DisposeStringOrBufferFromSlice(startHandle, start);
   DisposeStringOrBufferFromSlice(endHandle, end);
 
+  LD_METHOD_CHECK_DB_ERROR(compactRangeSync)
+
+  info.GetReturnValue().Set(true);
+}
+
+//SyncWalSync()
+NAN_METHOD(Database::SyncWalSync) {
+  LD_METHOD_SETUP_SIMPLE(syncWalSync, -1, -1)
+
+  leveldb::Status status = database->SyncWALToDatabase();
+
+  LD_METHOD_CHECK_DB_ERROR(syncWalSync)
+
+  info.GetReturnValue().Set(true);
+}
+
+//FlushSync()
+NAN_METHOD(Database::FlushSync) {
+  LD_METHOD_SETUP_SIMPLE(flushSync, -1, -1)
+
+  leveldb::Status status = database->FlushToDatabase();
+
+  LD_METHOD_CHECK_DB_ERROR(flushSync)
+
   info.GetReturnValue().Set(true);
 }
 
@@ -450,6 +1113,14 @@ NAN_METHOD(Database::Iterator) {
     optionsObj = v8::Local<v8::Object>::Cast(info[0]);
   }
 
+  std::string keyspacePrefix, keyspaceLimit;
+  leveldb::Status status = database->KeyspaceRange(optionsObj, &keyspacePrefix, &keyspaceLimit);
+  LD_METHOD_CHECK_DB_ERROR(iterator)
+
+  // the snapshot of the iterator should see the buffered writes too
+  status = database->FlushToDatabase();
+  LD_METHOD_CHECK_DB_ERROR(iterator)
+
   // each iterator gets a unique id for this Database, so we can
   // easily store & lookup on our `iterators` map
   uint32_t id = database->currentIteratorId++;
@@ -466,6 +1137,12 @@ NAN_METHOD(Database::Iterator) {
 
   leveldown::Iterator *iterator =
       Nan::ObjectWrap::Unwrap<leveldown::Iterator>(iteratorHandle);
+  // iterator(options, batch) iterates over the database with the
+  // pending operations of the chained batch applied
+  if (info.Length() > 1 && info[1]->IsObject())
+    iterator->SetBatch(info[1].As<v8::Object>());
+  if (!keyspaceLimit.empty())
+    iterator->SetKeyspace(keyspacePrefix, keyspaceLimit);
 
   database->iterators[id] = iterator;
 
@@ -506,11 +1183,20 @@ NAN_METHOD(Database::MultiGetSync) {
   size_t arraySize = keys->Length();
   v8::Local<v8::Array> returnArray = Nan::New<v8::Array>();
   int j = 0;
+  std::string keyInKeyspace;
   for (unsigned int i = 0; i < arraySize; i++) {
     v = keys->Get(i);
     leveldb::Slice key = StringOrBufferToSlice(v);
     std::string value;
-    leveldb::Status status = database->GetFromDatabase(&options, key, value);
+    leveldb::Slice storedKey;
+    leveldb::Status status = database->KeyInKeyspace(optionsObj, key, &keyInKeyspace, &storedKey);
+    if (status.ok()) {
+      status = database->GetFromDatabase(&options, storedKey, value);
+    } else {
+      // an undeclared keyspace or a reserved key is an error of the call
+      DisposeStringOrBufferFromSlice(v, key);
+      LD_METHOD_CHECK_DB_ERROR(mGetSync)
+    }
     DisposeStringOrBufferFromSlice(v, key);
 
     if (status.ok()) {
@@ -554,7 +1240,11 @@ NAN_METHOD(Database::IsExistsSync) {
 
   leveldb::ReadOptions options = leveldb::ReadOptions();
   options.fill_cache = fillCache;
-  leveldb::Status status = database->GetFromDatabase(&options, key, value);
+  std::string keyInKeyspace;
+  leveldb::Slice storedKey;
+  leveldb::Status status = database->KeyInKeyspace(optionsObj, key, &keyInKeyspace, &storedKey);
+  if (status.ok())
+    status = database->GetFromDatabase(&options, storedKey, value);
   DisposeStringOrBufferFromSlice(keyHandle, key);
 
   if (status.ok()) {
@@ -585,7 +1275,11 @@ NAN_METHOD(Database::GetBufferSync) {
 
   leveldb::ReadOptions options = leveldb::ReadOptions();
   options.fill_cache = fillCache;
-  leveldb::Status status = database->GetFromDatabase(&options, key, value);
+  std::string keyInKeyspace;
+  leveldb::Slice storedKey;
+  leveldb::Status status = database->KeyInKeyspace(optionsObj, key, &keyInKeyspace, &storedKey);
+  if (status.ok())
+    status = database->GetFromDatabase(&options, storedKey, value);
   DisposeStringOrBufferFromSlice(keyHandle, key);
 
   LD_METHOD_CHECK_DB_ERROR(getBufferSync)
@@ -7,20 +7,31 @@
 #define LD_DATABASE_H
 
 #include <map>
+#include <set>
+#include <string>
 #include <vector>
 #include <node.h>
 
 #include <leveldb/cache.h>
+#include <leveldb/comparator.h>
+#include <leveldb/compaction_filter.h>
 #include <leveldb/db.h>
 #include <leveldb/filter_policy.h>
+#include <leveldb/merge_operator.h>
+#include <leveldb/rate_limiter.h>
+#include <leveldb/slice_transform.h>
 #include <nan.h>
 
 #include "leveldb_status.h"
 #include "leveldown.h"
 #include "iterator.h"
+#include "key_locks.h"
+#include "write_buffer.h"
 
 namespace leveldown {
 
+class Transaction;
+
 const int kOk = 0;
 const int kNotFound = 1;
 const int kCorruption = 2;
@@ -62,6 +73,7 @@ public:
       leveldb::WriteOptions* options
     , leveldb::Slice key
     , leveldb::Slice value
+    , uint64_t expiry = 0
   );
   leveldb::Status GetFromDatabase (
       leveldb::ReadOptions* options
@@ -72,19 +84,74 @@ public:
       leveldb::WriteOptions* options
     , leveldb::Slice key
   );
+  leveldb::Status MergeToDatabase (
+      leveldb::WriteOptions* options
+    , leveldb::Slice key
+    , leveldb::Slice value
+  );
+  // Add `delta` to the decimal integer value of the key, a missing key
+  // counting as 0, and set *result to the new value.
+  leveldb::Status IncrementInDatabase (
+      leveldb::WriteOptions* options
+    , leveldb::Slice key
+    , int64_t delta
+    , int64_t* result
+  );
+  // Store `value` only if the key holds `*expected`, or is missing when
+  // `expected` is NULL, and set *swapped to whether it did.
+  leveldb::Status CompareAndSwapInDatabase (
+      leveldb::WriteOptions* options
+    , leveldb::Slice key
+    , const leveldb::Slice* expected
+    , leveldb::Slice value
+    , bool* swapped
+  );
+  // Write `batch` only if none of `keys` changed since `snapshot`, else
+  // return a Busy status.
+  leveldb::Status CommitToDatabase (
+      leveldb::WriteOptions* options
+    , const leveldb::Snapshot* snapshot
+    , const std::vector<leveldb::Slice>& keys
+    , leveldb::WriteBatch* batch
+  );
   leveldb::Status WriteBatchToDatabase (
       leveldb::WriteOptions* options
     , leveldb::WriteBatch* batch
   );
   uint64_t ApproximateSizeFromDatabase (const leveldb::Range* range);
-  void CompactRangeFromDatabase (const leveldb::Slice* start, const leveldb::Slice* end);
+  leveldb::Status CompactRangeFromDatabase (const leveldb::Slice* start, const leveldb::Slice* end);
+  leveldb::Status SyncWALToDatabase ();
+  leveldb::Status FlushToDatabase ();
   void GetPropertyFromDatabase (const leveldb::Slice& property, std::string* value);
   leveldb::Iterator* NewIterator (leveldb::ReadOptions* options);
+  // The order of the keys, set when opening.
+  const leveldb::Comparator* KeyComparator () const { return comparator; }
+  // The prefix extractor of the prefix seeks, NULL if none.
+  const leveldb::SliceTransform* PrefixExtractor () const { return prefixExtractor; }
+  // Set the key range of the keyspace named by the `keyspace` option:
+  // keys start with *prefix and sort before *limit, an empty *limit
+  // meaning the whole database.
+  leveldb::Status KeyspaceRange (
+      v8::Local<v8::Object> optionsObj
+    , std::string* prefix
+    , std::string* limit
+  );
+  // Set *stored to `key` as stored for the keyspace named by the
+  // `keyspace` option, using *buf to hold the prefixed key.
+  leveldb::Status KeyInKeyspace (
+      v8::Local<v8::Object> optionsObj
+    , const leveldb::Slice& key
+    , std::string* buf
+    , leveldb::Slice* stored
+  );
+  // Callers flush the buffered writes first for the snapshot to see them.
   const leveldb::Snapshot* NewSnapshot ();
   void ReleaseSnapshot (const leveldb::Snapshot* snapshot);
   void CloseIterators ();
-  void CloseDatabase ();
+  leveldb::Status CloseDatabase ();
   void ReleaseIterator (uint32_t id);
+  void AddTransaction (Transaction* transaction);
+  void ReleaseTransaction (Transaction* transaction);
 
   Database (const v8::Local<v8::Value>& from);
   ~Database ();
@@ -95,8 +162,17 @@ private:
   uint32_t currentIteratorId;
   leveldb::Cache* blockCache;
   const leveldb::FilterPolicy* filterPolicy;
+  leveldb::RateLimiter* rateLimiter;
+  const leveldb::CompactionFilter* compactionFilter;
+  const leveldb::SliceTransform* prefixExtractor;
+  const leveldb::MergeOperator* mergeOperator;
+  const leveldb::Comparator* comparator; // builtin, never deleted
+  WriteBuffer* writeBuffer;
+  KeyLocks keyLocks;       // serializes incr and cas of the same key
+  std::set<std::string> keyspaces; // declared when opening
 
   std::map< uint32_t, leveldown::Iterator * > iterators;
+  std::set< leveldown::Transaction * > transactions;
 
   static void WriteDoing(uv_work_t *req);
   static void WriteAfter(uv_work_t *req);
@@ -109,13 +185,19 @@ private:
   static NAN_METHOD(OpenSync);
   static NAN_METHOD(PutSync);
   static NAN_METHOD(DeleteSync);
+  static NAN_METHOD(MergeSync);
+  static NAN_METHOD(IncrSync);
+  static NAN_METHOD(CasSync);
   static NAN_METHOD(BatchSync);
+  static NAN_METHOD(BeginTransaction);
   static NAN_METHOD(GetSync);
   static NAN_METHOD(IsExistsSync);
   static NAN_METHOD(MultiGetSync);
   static NAN_METHOD(CloseSync);
   static NAN_METHOD(GetBufferSync);
   static NAN_METHOD(CompactRangeSync);
+  static NAN_METHOD(SyncWalSync);
+  static NAN_METHOD(FlushSync);
 };
 
 } // namespace leveldown
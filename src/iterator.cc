@@ -6,8 +6,10 @@
 #include <node.h>
 #include <node_buffer.h>
 
+#include "batch.h"
 #include "database.h"
 #include "iterator.h"
+#include "keyspace.h"
 #include "common.h"
 
 namespace leveldown {
@@ -28,10 +30,12 @@ Iterator::Iterator (
   , std::string* gt
   , std::string* gte
   , bool fillCache
+  , bool prefixSeek
   , bool keyAsBuffer
   , bool valueAsBuffer
   , size_t highWaterMark
 ) : database(database)
+  , batch(NULL)
   , id(id)
   , start(start)
   , end(end)
@@ -49,10 +53,20 @@ Iterator::Iterator (
 {
   Nan::HandleScope scope;
 
+  comparator = database->KeyComparator();
   options    = new leveldb::ReadOptions();
   options->fill_cache = fillCache;
   // get a snapshot of the current state
   options->snapshot = database->NewSnapshot();
+  // only iterate over the keys with the prefix of the first key, and
+  // skip the tables whose filters show they hold none
+  const leveldb::SliceTransform* prefixExtractor = database->PrefixExtractor();
+  if (prefixSeek && prefixExtractor != NULL && start != NULL
+      && prefixExtractor->InDomain(*start)) {
+    seekPrefix = prefixExtractor->Transform(*start).ToString();
+    seekPrefixSlice = seekPrefix;
+    options->prefix = &seekPrefixSlice;
+  }
   dbIterator = NULL;
   count      = 0;
   target     = NULL;
@@ -72,6 +86,7 @@ Iterator::~Iterator () {
   // printf("\ndestroy Iterator:free snapshot ok\n");
 
   delete options;
+  batchHandle.Reset();
   ReleaseTarget();
   if (start != NULL) {
     // Special case for `start` option: it won't be
@@ -135,6 +150,22 @@ void Iterator::Close () {
   // endLocker.unlock();
 }
 
+void Iterator::SetBatch (v8::Local<v8::Object> batchHandle) {
+  // keep the batch alive until the iterator is gone
+  this->batchHandle.Reset(batchHandle);
+  batch = Nan::ObjectWrap::Unwrap<Batch>(batchHandle);
+}
+
+void Iterator::SetKeyspace (const std::string& prefix, const std::string& limit) {
+  keyspacePrefix = prefix;
+  keyspaceLimit = limit;
+  // the prefixes are extracted from the stored keys
+  if (!prefix.empty()) {
+    seekPrefix.clear();
+    options->prefix = NULL;
+  }
+}
+
 inline bool Iterator::TryLockEnd () {
   return !ended ;//&& endLocker.try_lock();
 }
@@ -146,6 +177,10 @@ inline void Iterator::UnlockEnd () {
 bool Iterator::GetIterator () {
   if (dbIterator == NULL) {
     dbIterator = database->NewIterator(options);
+    if (batch != NULL)
+      dbIterator = batch->NewIteratorWithBase(dbIterator);
+    if (!keyspaceLimit.empty())
+      dbIterator = NewKeyspaceIterator(dbIterator, keyspacePrefix, keyspaceLimit);
 
     if (start != NULL) {
       dbIterator->Seek(*start);
@@ -158,24 +193,24 @@ bool Iterator::GetIterator () {
           std::string key_ = dbIterator->key().ToString();
 
           if (lt != NULL) {
-            if (lt->compare(key_) <= 0)
+            if (comparator->Compare(*lt, key_) <= 0)
               dbIterator->Prev();
           } else if (lte != NULL) {
-            if (lte->compare(key_) < 0)
+            if (comparator->Compare(*lte, key_) < 0)
               dbIterator->Prev();
           } else if (start != NULL) {
-            if (start->compare(key_))
+            if (comparator->Compare(*start, key_))
               dbIterator->Prev();
           }
         }
 
         if (dbIterator->Valid() && lt != NULL) {
-          if (lt->compare(dbIterator->key().ToString()) <= 0)
+          if (comparator->Compare(*lt, dbIterator->key().ToString()) <= 0)
             dbIterator->Prev();
         }
       } else {
         if (dbIterator->Valid() && gt != NULL
-            && gt->compare(dbIterator->key().ToString()) == 0)
+            && comparator->Compare(*gt, dbIterator->key().ToString()) == 0)
           dbIterator->Next();
       }
     } else if (reverse) {
@@ -203,17 +238,18 @@ bool Iterator::Read (std::string& key, std::string& value) {
   // now check if this is the end or not, if not then return the key & value
   if (dbIterator->Valid()) {
     std::string key_ = dbIterator->key().ToString();
-    int isEnd = end == NULL ? 1 : end->compare(key_);
+    int isEnd = end == NULL ? 1 : comparator->Compare(*end, key_);
 
     if ((limit < 0 || ++count <= limit)
+      && (seekPrefix.empty() || dbIterator->key().starts_with(seekPrefix))
       && (end == NULL
           || (reverse && (isEnd <= 0))
           || (!reverse && (isEnd >= 0)))
-      && ( lt  != NULL ? (lt->compare(key_) > 0)
-         : lte != NULL ? (lte->compare(key_) >= 0)
+      && ( lt  != NULL ? (comparator->Compare(*lt, key_) > 0)
+         : lte != NULL ? (comparator->Compare(*lte, key_) >= 0)
          : true )
-      && ( gt  != NULL ? (gt->compare(key_) < 0)
-         : gte != NULL ? (gte->compare(key_) <= 0)
+      && ( gt  != NULL ? (comparator->Compare(*gt, key_) < 0)
+         : gte != NULL ? (comparator->Compare(*gte, key_) <= 0)
          : true )
     ) {
       if (keys)
@@ -259,30 +295,30 @@ bool Iterator::Read (std::string& key, std::string& value) {
 
 bool Iterator::OutOfRange (leveldb::Slice* target) {
   if (lt != NULL) {
-    if (target->compare(*lt) >= 0)
+    if (comparator->Compare(*target, *lt) >= 0)
       return true;
   } else if (lte != NULL) {
-    if (target->compare(*lte) > 0)
+    if (comparator->Compare(*target, *lte) > 0)
       return true;
   } else if (start != NULL && reverse) {
-    if (target->compare(*start) > 0)
+    if (comparator->Compare(*target, *start) > 0)
       return true;
   }
 
   if (end != NULL) {
-    int d = target->compare(*end);
+    int d = comparator->Compare(*target, *end);
     if (reverse ? d < 0 : d > 0)
       return true;
   }
 
   if (gt != NULL) {
-    if (target->compare(*gt) <= 0)
+    if (comparator->Compare(*target, *gt) <= 0)
       return true;
   } else if (gte != NULL) {
-    if (target->compare(*gte) < 0)
+    if (comparator->Compare(*target, *gte) < 0)
       return true;
   } else if (start != NULL && !reverse) {
-    if (target->compare(*start) < 0)
+    if (comparator->Compare(*target, *start) < 0)
       return true;
   }
 
@@ -421,7 +457,7 @@ NAN_METHOD(Iterator::Seek) {
   }
   else {
     if (dbIterator->Valid()) {
-      int cmp = dbIterator->key().compare(*iterator->target);
+      int cmp = iterator->comparator->Compare(dbIterator->key(), *iterator->target);
       if (cmp > 0 && iterator->reverse) {
         dbIterator->Prev();
       } else if (cmp < 0 && !iterator->reverse) {
@@ -434,7 +470,7 @@ NAN_METHOD(Iterator::Seek) {
         dbIterator->SeekToFirst();
       }
       if (dbIterator->Valid()) {
-        int cmp = dbIterator->key().compare(*iterator->target);
+        int cmp = iterator->comparator->Compare(dbIterator->key(), *iterator->target);
         if (cmp > 0 && iterator->reverse) {
           dbIterator->SeekToFirst();
           dbIterator->Prev();
@@ -658,6 +694,7 @@ NAN_METHOD(Iterator::New) {
   bool keyAsBuffer = BooleanOptionValue(optionsObj, "keyAsBuffer", true);
   bool valueAsBuffer = BooleanOptionValue(optionsObj, "valueAsBuffer", true);
   bool fillCache = BooleanOptionValue(optionsObj, "fillCache");
+  bool prefixSeek = BooleanOptionValue(optionsObj, "prefixSeek");
 
   Iterator* iterator = new Iterator(
       database
@@ -673,6 +710,7 @@ NAN_METHOD(Iterator::New) {
     , gt
     , gte
     , fillCache
+    , prefixSeek
     , keyAsBuffer
     , valueAsBuffer
     , highWaterMark
@@ -16,6 +16,7 @@
 
 namespace leveldown {
 
+class Batch;
 class Database;
 
 class Iterator : public Nan::ObjectWrap {
@@ -43,6 +44,7 @@ public:
     , std::string* gt
     , std::string* gte
     , bool fillCache
+    , bool prefixSeek
     , bool keyAsBuffer
     , bool valueAsBuffer
     , size_t highWaterMark
@@ -58,13 +60,24 @@ public:
   bool TryLockEnd ();
   void UnlockEnd ();
   void Close ();
+  // Apply the pending operations of a chained batch to the entries.
+  void SetBatch (v8::Local<v8::Object> batchHandle);
+  // Only iterate over the keys in [prefix, limit), stripped of prefix.
+  void SetKeyspace (const std::string& prefix, const std::string& limit);
 
 private:
   Database* database;
+  Batch* batch;
+  Nan::Persistent<v8::Object> batchHandle;
+  std::string keyspacePrefix;
+  std::string keyspaceLimit;
+  std::string seekPrefix;           // prefix of the prefix seek, if any
+  leveldb::Slice seekPrefixSlice;   // options->prefix
 public:
   uint32_t id;
 private:
   leveldb::Iterator* dbIterator;
+  const leveldb::Comparator* comparator;
   leveldb::ReadOptions* options;
   leveldb::Slice* start;
   leveldb::Slice* target;
@@ -0,0 +1,35 @@
+#include <stdint.h>
+
+#include "key_locks.h"
+
+namespace leveldown {
+
+KeyLocks::KeyLocks () {
+  for (size_t i = 0; i < kStripes; i++)
+    uv_mutex_init(&stripes[i]);
+}
+
+KeyLocks::~KeyLocks () {
+  for (size_t i = 0; i < kStripes; i++)
+    uv_mutex_destroy(&stripes[i]);
+}
+
+void KeyLocks::Lock (const leveldb::Slice& key) {
+  uv_mutex_lock(StripeFor(key));
+}
+
+void KeyLocks::Unlock (const leveldb::Slice& key) {
+  uv_mutex_unlock(StripeFor(key));
+}
+
+uv_mutex_t* KeyLocks::StripeFor (const leveldb::Slice& key) {
+  // FNV-1a
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < key.size(); i++) {
+    h ^= static_cast<unsigned char>(key[i]);
+    h *= 16777619u;
+  }
+  return &stripes[h % kStripes];
+}
+
+} // namespace leveldown
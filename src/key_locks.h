@@ -0,0 +1,56 @@
+#ifndef LD_KEY_LOCKS_H
+#define LD_KEY_LOCKS_H
+
+#include <uv.h>
+
+#include <leveldb/slice.h>
+
+namespace leveldown {
+
+/* Striped key locks: a fixed set of mutexes picked by the hash of the
+ * key, so read-modify-write operations on the same key are serialized
+ * while operations on other keys mostly proceed in parallel.
+ */
+class KeyLocks {
+public:
+  KeyLocks ();
+  ~KeyLocks ();
+
+  void Lock (const leveldb::Slice& key);
+  void Unlock (const leveldb::Slice& key);
+
+private:
+  static const size_t kStripes = 64;
+
+  uv_mutex_t* StripeFor (const leveldb::Slice& key);
+
+  uv_mutex_t stripes[kStripes];
+
+  // No copying allowed
+  KeyLocks (const KeyLocks&);
+  void operator= (const KeyLocks&);
+};
+
+// Holds the lock of a key for the lifetime of the object.
+class KeyLock {
+public:
+  KeyLock (KeyLocks* locks, const leveldb::Slice& key)
+    : locks(locks), key(key) {
+    locks->Lock(key);
+  }
+  ~KeyLock () {
+    locks->Unlock(key);
+  }
+
+private:
+  KeyLocks* const locks;
+  const leveldb::Slice key;
+
+  // No copying allowed
+  KeyLock (const KeyLock&);
+  void operator= (const KeyLock&);
+};
+
+} // namespace leveldown
+
+#endif
@@ -0,0 +1,100 @@
+#include "keyspace.h"
+
+namespace leveldown {
+
+std::string KeyspacePrefix (const std::string& name) {
+  std::string prefix(1, kKeyspaceMarker);
+  prefix.append(name);
+  prefix.push_back('\0');
+  return prefix;
+}
+
+std::string KeyspaceLimit (const std::string& name) {
+  // names hold no NUL, so every key of the keyspace sorts before this
+  std::string limit(1, kKeyspaceMarker);
+  limit.append(name);
+  limit.push_back('\1');
+  return limit;
+}
+
+namespace {
+
+class KeyspaceIterator : public leveldb::Iterator {
+public:
+  KeyspaceIterator (
+      leveldb::Iterator* base
+    , const std::string& prefix
+    , const std::string& limit
+  ) : base(base), prefix(prefix), limit(limit) {}
+
+  virtual ~KeyspaceIterator () {
+    delete base;
+  }
+
+  virtual bool Valid () const {
+    if (!base->Valid())
+      return false;
+    leveldb::Slice key = base->key();
+    return key.starts_with(prefix) && key.compare(limit) < 0;
+  }
+
+  virtual void SeekToFirst () {
+    if (prefix.empty())
+      base->SeekToFirst();
+    else
+      base->Seek(prefix);
+  }
+
+  virtual void SeekToLast () {
+    base->Seek(limit);
+    if (base->Valid())
+      base->Prev();
+    else
+      base->SeekToLast();
+  }
+
+  virtual void Seek (const leveldb::Slice& target) {
+    std::string key(prefix);
+    key.append(target.data(), target.size());
+    base->Seek(key);
+  }
+
+  virtual void Next () {
+    base->Next();
+  }
+
+  virtual void Prev () {
+    base->Prev();
+  }
+
+  virtual leveldb::Slice key () const {
+    leveldb::Slice key = base->key();
+    key.remove_prefix(prefix.size());
+    return key;
+  }
+
+  virtual leveldb::Slice value () const {
+    return base->value();
+  }
+
+  virtual leveldb::Status status () const {
+    return base->status();
+  }
+
+private:
+  leveldb::Iterator* const base;
+  const std::string prefix;
+  const std::string limit;
+};
+
+} // namespace
+
+leveldb::Iterator* NewKeyspaceIterator (
+    leveldb::Iterator* base
+  , const std::string& prefix
+  , const std::string& limit
+) {
+  return new KeyspaceIterator(base, prefix, limit);
+}
+
+} // namespace leveldown
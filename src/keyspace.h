@@ -0,0 +1,33 @@
+#ifndef LD_KEYSPACE_H
+#define LD_KEYSPACE_H
+
+#include <string>
+
+#include <leveldb/iterator.h>
+#include <leveldb/slice.h>
+
+namespace leveldown {
+
+/* Named keyspaces share the database, its log and its cache: the keys
+ * of keyspace `name` are stored as "\xff" name "\0" key. Keys of the
+ * default keyspace must not start with "\xff", which never occurs in a
+ * UTF-8 string.
+ */
+const char kKeyspaceMarker = '\xff';
+
+// The prefix of the keys stored in keyspace `name`.
+std::string KeyspacePrefix (const std::string& name);
+// The smallest key after all the keys of keyspace `name`.
+std::string KeyspaceLimit (const std::string& name);
+
+// Return an iterator over the entries of `base` in [prefix, limit), with
+// `prefix` stripped from the keys. Takes ownership of `base`.
+leveldb::Iterator* NewKeyspaceIterator (
+    leveldb::Iterator* base
+  , const std::string& prefix
+  , const std::string& limit
+);
+
+} // namespace leveldown
+
+#endif
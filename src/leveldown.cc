@@ -10,6 +10,7 @@
 #include "database.h"
 #include "iterator.h"
 #include "batch.h"
+#include "transaction.h"
 
 namespace leveldown {
 
@@ -49,6 +50,7 @@ void Init (v8::Local<v8::Object> target) {
   Database::Init();
   leveldown::Iterator::Init();
   leveldown::Batch::Init();
+  leveldown::Transaction::Init();
 
   v8::Local<v8::Function> leveldown =
       Nan::New<v8::FunctionTemplate>(LevelDOWN)->GetFunction();
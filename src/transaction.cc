@@ -0,0 +1,211 @@
+#include <node.h>
+#include <node_buffer.h>
+#include <nan.h>
+
+#include "database.h"
+#include "transaction.h"
+#include "common.h"
+
+namespace leveldown {
+
+static Nan::Persistent<v8::FunctionTemplate> transaction_constructor;
+
+Transaction::Transaction (leveldown::Database* database) : database(database) {
+  snapshot = database->NewSnapshot();
+  batch = new leveldb::WriteBatchWithIndex(database->KeyComparator());
+  database->AddTransaction(this);
+}
+
+Transaction::~Transaction () {
+  Release();
+}
+
+void Transaction::Release () {
+  if (snapshot) {
+    database->ReleaseSnapshot(snapshot);
+    snapshot = NULL;
+    delete batch;
+    batch = NULL;
+    keys.clear();
+    database->ReleaseTransaction(this);
+  }
+}
+
+void Transaction::Init () {
+  v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>(Transaction::New);
+  transaction_constructor.Reset(tpl);
+  tpl->SetClassName(Nan::New("Transaction").ToLocalChecked());
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+  Nan::SetPrototypeMethod(tpl, "getSync", Transaction::GetSync);
+  Nan::SetPrototypeMethod(tpl, "putSync", Transaction::PutSync);
+  Nan::SetPrototypeMethod(tpl, "delSync", Transaction::DelSync);
+  Nan::SetPrototypeMethod(tpl, "commitSync", Transaction::CommitSync);
+  Nan::SetPrototypeMethod(tpl, "rollbackSync", Transaction::RollbackSync);
+}
+
+NAN_METHOD(Transaction::New) {
+  Database* database = Nan::ObjectWrap::Unwrap<Database>(info[0]->ToObject());
+
+  Transaction* transaction = new Transaction(database);
+  transaction->Wrap(info.This());
+
+  info.GetReturnValue().Set(info.This());
+}
+
+v8::Local<v8::Value> Transaction::NewInstance (v8::Local<v8::Object> database) {
+  Nan::EscapableHandleScope scope;
+
+  Nan::MaybeLocal<v8::Object> maybeInstance;
+  v8::Local<v8::Object> instance;
+
+  v8::Local<v8::FunctionTemplate> constructorHandle =
+      Nan::New<v8::FunctionTemplate>(transaction_constructor);
+
+  v8::Local<v8::Value> argv[1] = { database };
+  maybeInstance = Nan::NewInstance(constructorHandle->GetFunction(), 1, argv);
+
+  if (maybeInstance.IsEmpty())
+      Nan::ThrowError("Could not create new Transaction instance");
+  else
+    instance = maybeInstance.ToLocalChecked();
+  return scope.Escape(instance);
+}
+
+#define LD_TRANSACTION_SETUP(name, minPos)                                    \
+  Transaction* transaction = ObjectWrap::Unwrap<Transaction>(info.Holder());  \
+  if (transaction->snapshot == NULL)                                          \
+    return Nan::ThrowError(#name "() after the transaction has ended");      \
+  if (info.Length() <= minPos)                                                \
+    return Nan::ThrowError(Nan::ErrnoException(kInvalidArgument, #name, #name "() miss arguments"));
+
+//getSync(key, {fillCache:true, keyspace:'name'}): read the key at the snapshot of the transaction
+NAN_METHOD(Transaction::GetSync) {
+  LD_TRANSACTION_SETUP(getSync, 0)
+  v8::Local<v8::Object> optionsObj;
+  if (info.Length() > 1 && info[1]->IsObject()) {
+    optionsObj = v8::Local<v8::Object>::Cast(info[1]);
+  }
+
+  v8::Local<v8::Value> keyBuffer = info[0];
+  LD_STRING_OR_BUFFER_TO_SLICE(key, keyBuffer, key)
+  std::string value;
+
+  std::string keyInKeyspace;
+  leveldb::Slice storedKey;
+  leveldb::Status status = transaction->database->KeyInKeyspace(optionsObj, key, &keyInKeyspace, &storedKey);
+  bool deleted;
+  if (!status.ok()) {
+    // an undeclared keyspace or a reserved key
+  } else if (transaction->batch->GetFromBatch(storedKey, &value, &deleted)) {
+    if (deleted)
+      status = leveldb::Status::NotFound(leveldb::Slice());
+  } else {
+    leveldb::ReadOptions options = leveldb::ReadOptions();
+    options.fill_cache = BooleanOptionValue(optionsObj, "fillCache", true);
+    options.snapshot = transaction->snapshot;
+    status = transaction->database->GetFromDatabase(&options, storedKey, value);
+    transaction->keys.insert(storedKey.ToString());
+  }
+  DisposeStringOrBufferFromSlice(keyBuffer, key);
+
+  LD_METHOD_CHECK_DB_ERROR(getSync)
+
+  info.GetReturnValue().Set(Nan::New<v8::String>((char*)value.data(), value.size()).ToLocalChecked());
+}
+
+//putSync(key, value, {keyspace:'name'})
+NAN_METHOD(Transaction::PutSync) {
+  LD_TRANSACTION_SETUP(putSync, 1)
+  v8::Local<v8::Object> optionsObj;
+  if (info.Length() > 2 && info[2]->IsObject()) {
+    optionsObj = v8::Local<v8::Object>::Cast(info[2]);
+  }
+
+  v8::Local<v8::Value> keyBuffer = info[0];
+  v8::Local<v8::Value> valueBuffer = info[1];
+  LD_STRING_OR_BUFFER_TO_SLICE(key, keyBuffer, key)
+  LD_STRING_OR_BUFFER_TO_SLICE(value, valueBuffer, value)
+
+  std::string keyInKeyspace;
+  leveldb::Slice storedKey;
+  leveldb::Status status = transaction->database->KeyInKeyspace(optionsObj, key, &keyInKeyspace, &storedKey);
+  if (status.ok()) {
+    transaction->batch->Put(storedKey, value);
+    transaction->keys.insert(storedKey.ToString());
+  }
+
+  DisposeStringOrBufferFromSlice(keyBuffer, key);
+  DisposeStringOrBufferFromSlice(valueBuffer, value);
+
+  LD_METHOD_CHECK_DB_ERROR(putSync)
+
+  info.GetReturnValue().Set(info.Holder());
+}
+
+//delSync(key, {keyspace:'name'})
+NAN_METHOD(Transaction::DelSync) {
+  LD_TRANSACTION_SETUP(delSync, 0)
+  v8::Local<v8::Object> optionsObj;
+  if (info.Length() > 1 && info[1]->IsObject()) {
+    optionsObj = v8::Local<v8::Object>::Cast(info[1]);
+  }
+
+  v8::Local<v8::Value> keyBuffer = info[0];
+  LD_STRING_OR_BUFFER_TO_SLICE(key, keyBuffer, key)
+
+  std::string keyInKeyspace;
+  leveldb::Slice storedKey;
+  leveldb::Status status = transaction->database->KeyInKeyspace(optionsObj, key, &keyInKeyspace, &storedKey);
+  if (status.ok()) {
+    transaction->batch->Delete(storedKey);
+    transaction->keys.insert(storedKey.ToString());
+  }
+
+  DisposeStringOrBufferFromSlice(keyBuffer, key);
+
+  LD_METHOD_CHECK_DB_ERROR(delSync)
+
+  info.GetReturnValue().Set(info.Holder());
+}
+
+//commitSync({sync:false}): return false if another write conflicted
+NAN_METHOD(Transaction::CommitSync) {
+  LD_TRANSACTION_SETUP(commitSync, -1)
+  v8::Local<v8::Object> optionsObj;
+  if (info.Length() > 0 && info[0]->IsObject()) {
+    optionsObj = v8::Local<v8::Object>::Cast(info[0]);
+  }
+
+  leveldb::WriteOptions options = leveldb::WriteOptions();
+  options.sync = BooleanOptionValue(optionsObj, "sync");
+
+  std::vector<leveldb::Slice> keys(
+      transaction->keys.begin()
+    , transaction->keys.end()
+  );
+  leveldb::Status status = transaction->database->CommitToDatabase(
+      &options
+    , transaction->snapshot
+    , keys
+    , transaction->batch->GetWriteBatch()
+  );
+  transaction->Release();
+
+  if (status.IsBusy()) {
+    info.GetReturnValue().Set(false);
+    return;
+  }
+  LD_METHOD_CHECK_DB_ERROR(commitSync)
+
+  info.GetReturnValue().Set(true);
+}
+
+NAN_METHOD(Transaction::RollbackSync) {
+  Transaction* transaction = ObjectWrap::Unwrap<Transaction>(info.Holder());
+
+  transaction->Release();
+
+  info.GetReturnValue().Set(true);
+}
+
+} // namespace leveldown
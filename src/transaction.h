@@ -0,0 +1,45 @@
+#ifndef LD_TRANSACTION_H
+#define LD_TRANSACTION_H
+
+#include <set>
+#include <string>
+#include <node.h>
+
+#include <leveldb/write_batch_with_index.h>
+
+#include "database.h"
+
+namespace leveldown {
+
+/* Optimistic transaction: reads at a snapshot taken when it begins,
+ * buffers its writes in an indexed batch and, at commit, writes them
+ * only if none of the keys it read or wrote has changed since.
+ */
+class Transaction : public Nan::ObjectWrap {
+public:
+  static void Init();
+  static v8::Local<v8::Value> NewInstance (v8::Local<v8::Object> database);
+
+  Transaction  (leveldown::Database* database);
+  ~Transaction ();
+
+  // Drop the pending writes and the snapshot.
+  void Release ();
+
+private:
+  leveldown::Database* database;
+  const leveldb::Snapshot* snapshot;
+  leveldb::WriteBatchWithIndex* batch;
+  std::set<std::string> keys; // read or written, checked at commit
+
+  static NAN_METHOD(New);
+  static NAN_METHOD(GetSync);
+  static NAN_METHOD(PutSync);
+  static NAN_METHOD(DelSync);
+  static NAN_METHOD(CommitSync);
+  static NAN_METHOD(RollbackSync);
+};
+
+} // namespace leveldown
+
+#endif
@@ -0,0 +1,263 @@
+#include <leveldb/env.h>
+#include <leveldb/write_batch.h>
+
+#include "write_buffer.h"
+
+namespace leveldown {
+
+WriteBuffer::WriteBuffer (
+    leveldb::DB* db
+  , const leveldb::MergeOperator* mergeOperator
+  , size_t maxSize
+  , uint32_t intervalMs
+)
+  : db(db)
+  , mergeOperator(mergeOperator)
+  , maxSize(maxSize)
+  , intervalMs(intervalMs)
+  , pendingSize(0)
+  , stopping(false) {
+  uv_mutex_init(&mutex);
+  uv_cond_init(&cond);
+  uv_mutex_init(&flushMutex);
+  uv_thread_create(&thread, WriteBuffer::Run, this);
+}
+
+WriteBuffer::~WriteBuffer () {
+  uv_mutex_lock(&mutex);
+  stopping = true;
+  uv_cond_signal(&cond);
+  uv_mutex_unlock(&mutex);
+  uv_thread_join(&thread);
+
+  Flush();
+
+  uv_mutex_destroy(&flushMutex);
+  uv_cond_destroy(&cond);
+  uv_mutex_destroy(&mutex);
+}
+
+leveldb::Status WriteBuffer::Put (
+    const leveldb::Slice& key
+  , const leveldb::Slice& value
+  , uint64_t expiry
+) {
+  return Add(key, &value, expiry, NULL);
+}
+
+leveldb::Status WriteBuffer::Delete (const leveldb::Slice& key) {
+  return Add(key, NULL, 0, NULL);
+}
+
+leveldb::Status WriteBuffer::Merge (
+    const leveldb::Slice& key
+  , const leveldb::Slice& operand
+) {
+  return Add(key, NULL, 0, &operand);
+}
+
+static size_t EntrySize (const std::string& value, const std::vector<std::string>& operands) {
+  size_t size = value.size();
+  for (size_t i = 0; i < operands.size(); i++) size += operands[i].size();
+  return size;
+}
+
+leveldb::Status WriteBuffer::Add (
+    const leveldb::Slice& key
+  , const leveldb::Slice* value
+  , uint64_t expiry
+  , const leveldb::Slice* operand
+) {
+  uv_mutex_lock(&mutex);
+  if (!bgError.ok()) {
+    leveldb::Status s = bgError;
+    uv_mutex_unlock(&mutex);
+    return s;
+  }
+
+  std::pair<EntryMap::iterator, bool> r = pending.insert(
+    std::make_pair(key.ToString(), Entry())
+  );
+  Entry& entry = r.first->second;
+  if (r.second) {
+    pendingSize += key.size();
+    entry.base = false;
+    entry.deleted = false;
+    entry.expiry = 0;
+  } else {
+    pendingSize -= EntrySize(entry.value, entry.operands);
+  }
+  if (operand != NULL) {
+    // applies to the pending put or del of the key, if any
+    entry.operands.push_back(operand->ToString());
+  } else {
+    entry.base = true;
+    entry.deleted = value == NULL;
+    entry.expiry = expiry;
+    if (value != NULL) {
+      entry.value.assign(value->data(), value->size());
+    } else {
+      entry.value.clear();
+    }
+    entry.operands.clear();
+  }
+  pendingSize += EntrySize(entry.value, entry.operands);
+
+  // hand it over to the flush thread; if it can not keep up with us,
+  // write the pending operations in this thread instead.
+  bool full = pendingSize >= maxSize;
+  bool overflow = pendingSize >= 4 * maxSize;
+  if (full) uv_cond_signal(&cond);
+  uv_mutex_unlock(&mutex);
+
+  if (overflow) return Flush();
+  return leveldb::Status::OK();
+}
+
+// Copy the pending operations of `key` to *entry, with the merge
+// operands that apply to the operations being flushed.
+bool WriteBuffer::Find (const std::string& key, Entry* entry) {
+  bool found = true;
+
+  uv_mutex_lock(&mutex);
+  EntryMap::const_iterator it = pending.find(key);
+  EntryMap::const_iterator older = flushing.find(key);
+  if (it == pending.end()) {
+    if (older == flushing.end()) {
+      found = false;
+    } else {
+      *entry = older->second;
+    }
+  } else if (!it->second.base && older != flushing.end()) {
+    *entry = older->second;
+    entry->operands.insert(
+        entry->operands.end()
+      , it->second.operands.begin()
+      , it->second.operands.end()
+    );
+  } else {
+    *entry = it->second;
+  }
+  uv_mutex_unlock(&mutex);
+
+  return found;
+}
+
+bool WriteBuffer::Get (const leveldb::Slice& key, std::string* value, leveldb::Status* s) {
+  std::string k = key.ToString();
+  Entry entry;
+  if (!Find(k, &entry)) return false;
+
+  if (!entry.base) {
+    // Only merge operands: apply them to the value in the database,
+    // which no flush may change meanwhile.
+    uv_mutex_lock(&flushMutex);
+    bool found = Find(k, &entry);
+    if (found && !entry.base) {
+      *s = db->Get(leveldb::ReadOptions(), key, &entry.value);
+      entry.deleted = s->IsNotFound();
+      if (!s->ok() && !entry.deleted) {
+        uv_mutex_unlock(&flushMutex);
+        return true;
+      }
+    }
+    uv_mutex_unlock(&flushMutex);
+    if (!found) return false;
+  }
+
+  bool deleted = entry.deleted
+    || (entry.expiry && entry.expiry <= leveldb::Env::Default()->NowMicros());
+  if (entry.operands.empty()) {
+    if (deleted) {
+      *s = leveldb::Status::NotFound(leveldb::Slice());
+    } else {
+      *s = leveldb::Status::OK();
+      value->swap(entry.value);
+    }
+    return true;
+  }
+
+  std::vector<leveldb::Slice> operands(entry.operands.begin(), entry.operands.end());
+  leveldb::Slice existing(entry.value);
+  std::string merged;
+  if (mergeOperator->Merge(key, deleted ? NULL : &existing, operands, &merged)) {
+    *s = leveldb::Status::OK();
+    value->swap(merged);
+  } else {
+    *s = leveldb::Status::Corruption("merge operands can not be applied to", key);
+  }
+  return true;
+}
+
+leveldb::Status WriteBuffer::Flush (bool sync) {
+  leveldb::Status s;
+
+  uv_mutex_lock(&flushMutex);
+
+  uv_mutex_lock(&mutex);
+  flushing.swap(pending);
+  pendingSize = 0;
+  uv_mutex_unlock(&mutex);
+
+  // `flushing` is only changed while both locks are held, so it can be
+  // read here without `mutex`.
+  if (!flushing.empty()) {
+    leveldb::WriteBatch batch;
+    for (EntryMap::const_iterator it = flushing.begin(); it != flushing.end(); ++it) {
+      if (!it->second.base) {
+        // only merge operands
+      } else if (it->second.deleted) {
+        batch.Delete(it->first);
+      } else if (it->second.expiry) {
+        batch.PutWithExpiry(it->first, it->second.value, it->second.expiry);
+      } else {
+        batch.Put(it->first, it->second.value);
+      }
+      for (size_t i = 0; i < it->second.operands.size(); i++) {
+        batch.Merge(it->first, it->second.operands[i]);
+      }
+    }
+    leveldb::WriteOptions options;
+    options.sync = sync;
+    s = db->Write(options, &batch);
+  }
+
+  uv_mutex_lock(&mutex);
+  flushing.clear();
+  // the operations are lost, make sure later writes fail too.
+  if (!s.ok() && bgError.ok()) bgError = s;
+  s = bgError;
+  uv_mutex_unlock(&mutex);
+
+  uv_mutex_unlock(&flushMutex);
+
+  return s;
+}
+
+void WriteBuffer::Run (void* arg) {
+  WriteBuffer* self = static_cast<WriteBuffer*>(arg);
+
+  uv_mutex_lock(&self->mutex);
+  while (!self->stopping) {
+    if (self->pendingSize < self->maxSize || !self->bgError.ok()) {
+      if (self->intervalMs > 0) {
+        uv_cond_timedwait(
+            &self->cond
+          , &self->mutex
+          , static_cast<uint64_t>(self->intervalMs) * 1000000
+        );
+      } else {
+        uv_cond_wait(&self->cond, &self->mutex);
+      }
+    }
+    if (self->stopping || self->pending.empty() || !self->bgError.ok())
+      continue;
+
+    uv_mutex_unlock(&self->mutex);
+    self->Flush();
+    uv_mutex_lock(&self->mutex);
+  }
+  uv_mutex_unlock(&self->mutex);
+}
+
+} // namespace leveldown
@@ -0,0 +1,94 @@
+#ifndef LD_WRITE_BUFFER_H
+#define LD_WRITE_BUFFER_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <uv.h>
+
+#include <leveldb/db.h>
+#include <leveldb/merge_operator.h>
+
+namespace leveldown {
+
+/* Write-behind buffer: coalesces puts and dels by key and writes them
+ * to the database as one WriteBatch, either when `maxSize` bytes are
+ * pending or every `intervalMs` milliseconds, from a native thread.
+ * Merge operands are queued after the put or del of their key.
+ * Pending operations are visible to Get() until they are written.
+ */
+class WriteBuffer {
+public:
+  // `mergeOperator` is the one of `db`, NULL if it has none.
+  WriteBuffer (
+      leveldb::DB* db
+    , const leveldb::MergeOperator* mergeOperator
+    , size_t maxSize
+    , uint32_t intervalMs
+  );
+  ~WriteBuffer ();
+
+  // A non-zero `expiry` (Env::NowMicros() time) writes the value with
+  // DB::PutWithExpiry(), and Get() hides it once it has expired.
+  leveldb::Status Put (
+      const leveldb::Slice& key
+    , const leveldb::Slice& value
+    , uint64_t expiry = 0
+  );
+  leveldb::Status Delete (const leveldb::Slice& key);
+  // Needs a merge operator.
+  leveldb::Status Merge (const leveldb::Slice& key, const leveldb::Slice& operand);
+
+  // Return true if the key has a pending operation, and set *s to the
+  // result of reading the key: NotFound if it is deleted, else OK with
+  // its value in *value.  Pending merge operands are applied to the
+  // pending value, or to the value in the database if there is none.
+  bool Get (const leveldb::Slice& key, std::string* value, leveldb::Status* s);
+
+  // Write all pending operations to the database now.  A failed flush
+  // drops its operations and makes every later Put() and Delete() fail.
+  leveldb::Status Flush (bool sync = false);
+
+private:
+  struct Entry {
+    bool base;             // false if only merge operands are pending
+    bool deleted;
+    std::string value;
+    uint64_t expiry;       // 0 if the value never expires
+    std::vector<std::string> operands;  // oldest first
+  };
+  typedef std::map<std::string, Entry> EntryMap;
+
+  leveldb::Status Add (
+      const leveldb::Slice& key
+    , const leveldb::Slice* value
+    , uint64_t expiry
+    , const leveldb::Slice* operand
+  );
+  bool Find (const std::string& key, Entry* entry);
+  static void Run (void* arg);
+
+  leveldb::DB* db;
+  const leveldb::MergeOperator* mergeOperator;
+  const size_t maxSize;
+  const uint32_t intervalMs;
+
+  uv_mutex_t mutex;        // protects the state below
+  uv_cond_t cond;          // wakes up the flush thread
+  EntryMap pending;        // operations not yet handed to a flush
+  EntryMap flushing;       // operations being written by a flush
+  size_t pendingSize;
+  bool stopping;
+  leveldb::Status bgError; // error of the first failed flush
+
+  uv_mutex_t flushMutex;   // serializes flushes to keep them in order
+  uv_thread_t thread;
+
+  // No copying allowed
+  WriteBuffer (const WriteBuffer&);
+  void operator= (const WriteBuffer&);
+};
+
+} // namespace leveldown
+
+#endif
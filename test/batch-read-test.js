@@ -0,0 +1,50 @@
+const test       = require('tap').test
+    , testCommon = require('abstract-nosql/testCommon')
+    , leveldown  = require('../')
+
+var db
+
+test('setUp common', testCommon.setUp)
+
+test('setUp db', function (t) {
+  db = leveldown(testCommon.location())
+  db.open(function (err) {
+    t.error(err)
+    db.putSync('a', 'db-a')
+    db.putSync('b', 'db-b')
+    db.putSync('c', 'db-c')
+    t.end()
+  })
+})
+
+test('test batch.getSync reads the pending operations', function (t) {
+  var batch = db.batch()
+  batch.put('b', 'v1').put('b', 'v2').del('c').put('d', 'v3')
+  t.equal(batch.getSync('a'), 'db-a')
+  t.equal(batch.getSync('b'), 'v2')
+  t.throws(function () { batch.getSync('c') })
+  t.equal(batch.getSync('d'), 'v3')
+  t.equal(db.getSync('b'), 'db-b')
+  t.end()
+})
+
+test('test batch.iterator merges the pending operations', function (t) {
+  var batch = db.batch()
+  batch.put('b', 'v2').del('c').put('d', 'v3')
+  var it = batch.iterator()
+    , entries = []
+    , entry
+  while ((entry = it.nextSync()))
+    entries.push(entry[0] + '=' + entry[1])
+  it.endSync()
+  t.deepEqual(entries, ['a=db-a', 'b=v2', 'd=v3'])
+
+  batch.writeSync()
+  t.equal(db.getSync('b'), 'v2')
+  t.equal(db.isExistsSync('c'), false)
+  t.end()
+})
+
+test('tearDown', function (t) {
+  db.close(testCommon.tearDown.bind(null, t))
+})
@@ -0,0 +1,43 @@
+const test       = require('tap').test
+    , testCommon = require('abstract-nosql/testCommon')
+    , leveldown  = require('../')
+
+var db
+
+test('setUp common', testCommon.setUp)
+
+test('setUp db', function (t) {
+  db = leveldown(testCommon.location())
+  // flush the memtable to level 0, which compactRange() compacts
+  db.open({
+      maxMemCompactionLevel: 0
+    , compactionFilter: 'removeKeyPrefix'
+    , compactionFilterPrefix: 'tmp:'
+  }, t.end.bind(t))
+})
+
+test('test compactions remove the filtered keys', function (t) {
+  var i
+  for (i = 0; i < 100; i++) {
+    db.putSync('tmp:' + i, 'value')
+    db.putSync('key:' + i, 'value')
+  }
+  t.equal(db.getSync('tmp:1'), 'value')
+  db.compactRangeSync('key:', 'tmp:~')
+  for (i = 0; i < 100; i += 10) {
+    t.equal(db.isExistsSync('tmp:' + i), false)
+    t.equal(db.getSync('key:' + i), 'value')
+  }
+  t.end()
+})
+
+test('test invalid compaction filter options', function (t) {
+  var db = leveldown(testCommon.location())
+  t.throws(function () { db.openSync({compactionFilter: 'removeKeys', compactionFilterPrefix: 'tmp:'}) })
+  t.throws(function () { db.openSync({compactionFilter: 'removeKeyPrefix'}) })
+  t.end()
+})
+
+test('tearDown', function (t) {
+  db.close(testCommon.tearDown.bind(null, t))
+})
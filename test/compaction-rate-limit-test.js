@@ -0,0 +1,34 @@
+const test       = require('tap').test
+    , testCommon = require('abstract-nosql/testCommon')
+    , leveldown  = require('../')
+
+var db
+
+test('setUp common', testCommon.setUp)
+
+test('setUp db', function (t) {
+  db = leveldown(testCommon.location())
+  db.open({
+      writeBufferSize: 64 * 1024
+    , compactionRateLimitBytesPerSec: 4 * 1024 * 1024
+    , compactionRateLimitAdaptive: true
+  }, t.end.bind(t))
+})
+
+test('test writes and reads with rate limited compactions', function (t) {
+  var value = Buffer(1024).fill(1)
+  for (var i = 0; i < 2000; i++) {
+    db.putSync('key' + i, value)
+  }
+  db.compactRange('key0', 'key999', function (err) {
+    t.error(err)
+    for (i = 0; i < 2000; i += 100) {
+      t.deepEqual(db.getSync('key' + i, { asBuffer: true }), value)
+    }
+    t.end()
+  })
+})
+
+test('tearDown', function (t) {
+  db.close(testCommon.tearDown.bind(null, t))
+})
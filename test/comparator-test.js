@@ -0,0 +1,76 @@
+const test       = require('tap').test
+    , testCommon = require('abstract-nosql/testCommon')
+    , leveldown  = require('../')
+
+function keys (iterator) {
+  var result = []
+    , entry
+  while ((entry = iterator.nextSync())) {
+    result.push(entry[0])
+  }
+  iterator.endSync()
+  return result
+}
+
+test('setUp common', testCommon.setUp)
+
+test('test reverse comparator', function (t) {
+  var location = testCommon.location()
+    , db = leveldown(location)
+  db.openSync({comparator: 'reverse'})
+  db.putSync('a', '1')
+  db.putSync('c', '3')
+  db.putSync('b', '2')
+  t.same(keys(db.iterator({keyAsBuffer: false})), ['c', 'b', 'a'])
+  t.same(keys(db.iterator({keyAsBuffer: false, gt: 'c', lte: 'a'})), ['b', 'a'])
+  db.closeSync()
+  // the comparator is checked against the one the database was created with
+  t.throws(function () { db.openSync() })
+  t.end()
+})
+
+test('test uint64be comparator', function (t) {
+  var db = leveldown(testCommon.location())
+  db.openSync({comparator: 'uint64be'})
+  db.putSync(new Buffer([1, 0]), '256')
+  db.putSync(new Buffer([2]), '2')
+  db.putSync(new Buffer([0x10]), '16')
+  var values = []
+    , iterator = db.iterator({keys: false, valueAsBuffer: false})
+    , entry
+  while ((entry = iterator.nextSync())) {
+    values.push(entry[1])
+  }
+  iterator.endSync()
+  t.same(values, ['2', '16', '256'])
+  db.closeSync()
+  t.end()
+})
+
+test('test tuple comparator', function (t) {
+  var db = leveldown(testCommon.location())
+  db.openSync({comparator: 'tuple'})
+  // ('a', 'z') sorts before ('ab')
+  db.putSync(new Buffer([2, 0x61, 0x62]), 'ab')
+  db.putSync(new Buffer([1, 0x61, 1, 0x7a]), 'a,z')
+  db.putSync(new Buffer([1, 0x61]), 'a')
+  var values = []
+    , iterator = db.iterator({keys: false, valueAsBuffer: false})
+    , entry
+  while ((entry = iterator.nextSync())) {
+    values.push(entry[1])
+  }
+  iterator.endSync()
+  t.same(values, ['a', 'a,z', 'ab'])
+  db.closeSync()
+  t.end()
+})
+
+test('test unknown comparator', function (t) {
+  var db = leveldown(testCommon.location())
+  t.throws(function () { db.openSync({comparator: 'numeric'}) })
+  t.throws(function () { db.openSync({comparator: 'reverse', keyspaces: ['a']}) })
+  t.end()
+})
+
+test('tearDown', testCommon.tearDown)
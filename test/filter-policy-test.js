@@ -0,0 +1,46 @@
+const test       = require('tap').test
+    , testCommon = require('abstract-nosql/testCommon')
+    , leveldown  = require('../')
+
+test('setUp common', testCommon.setUp)
+
+test('test filter policies', function (t) {
+  var location = testCommon.location()
+    , db = leveldown(location)
+  db.openSync({filterPolicy: 'blockedBloom', bloomBitsPerKey: 16})
+  for (var i = 0; i < 100; i++) db.putSync('key' + i, String(i))
+  db.compactRangeSync('key', 'key~')
+  t.equal(db.getSync('key42'), '42')
+  t.throws(function () { db.getSync('key100') })
+  db.closeSync()
+
+  // the tables of another policy are read without filter
+  db.openSync({filterPolicy: 'bloom'})
+  t.equal(db.getSync('key7'), '7')
+  t.throws(function () { db.getSync('key100') })
+  db.closeSync()
+
+  db.openSync({filterPolicy: 'xor', bitsPerKey: 9})
+  for (i = 100; i < 200; i++) db.putSync('key' + i, String(i))
+  db.compactRangeSync('key', 'key~')
+  t.equal(db.getSync('key150'), '150')
+  t.equal(db.getSync('key42'), '42')
+  t.throws(function () { db.getSync('key200') })
+  db.closeSync()
+
+  db.openSync({filterPolicy: 'none'})
+  t.equal(db.getSync('key99'), '99')
+  db.closeSync()
+  t.end()
+})
+
+test('test invalid filter policy options', function (t) {
+  var db = leveldown(testCommon.location())
+  t.throws(function () { db.openSync({filterPolicy: 'cuckoo'}) })
+  t.throws(function () { db.openSync({bitsPerKey: 0}) })
+  t.throws(function () { db.openSync({filterPolicy: 'xor', bloomBitsPerKey: 0}) })
+  t.throws(function () { db.openSync({filterPolicy: 'xor', fullTableFilter: false}) })
+  t.end()
+})
+
+test('tearDown', testCommon.tearDown)
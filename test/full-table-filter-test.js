@@ -0,0 +1,29 @@
+const test       = require('tap').test
+    , testCommon = require('abstract-nosql/testCommon')
+    , leveldown  = require('../')
+
+test('setUp common', testCommon.setUp)
+
+test('test tables with either filter format can be read', function (t) {
+  var location = testCommon.location()
+    , db = leveldown(location)
+  db.openSync({fullTableFilter: true})
+  db.putSync('a', '1')
+  db.putSync('c', '3')
+  db.compactRangeSync('a', 'z')
+  t.equal(db.getSync('a'), '1')
+  t.throws(function () { db.getSync('b') })
+  db.closeSync()
+
+  db.openSync({fullTableFilter: false})
+  db.putSync('b', '2')
+  db.compactRangeSync('b', 'b')
+  t.equal(db.getSync('a'), '1')
+  t.equal(db.getSync('b'), '2')
+  t.equal(db.getSync('c'), '3')
+  t.throws(function () { db.getSync('d') })
+  db.closeSync()
+  t.end()
+})
+
+test('tearDown', testCommon.tearDown)
@@ -52,6 +52,21 @@ test('test invalid getProperty("leveldb.sstables")', function (t) {
   t.end()
 })
 
+test('test getProperty("leveldb.tombstones")', function (t) {
+  t.equal(db.getProperty('leveldb.tombstones'), '', 'no sstables yet')
+  for (var i = 0; i < 10; i++)
+    db.putSync('key' + i, 'value')
+  for (i = 0; i < 4; i++)
+    db.delSync('key' + i)
+  db.compactRangeSync('key', 'key~')
+  var lines = db.getProperty('leveldb.tombstones').split('\n')
+  t.equal(lines.pop(), '', 'one line per sstable')
+  lines.forEach(function (line) {
+    t.ok(/^\d \d+ \d+ \d+$/.test(line), 'level, file number, entries and deletions')
+  })
+  t.end()
+})
+
 test('tearDown', function (t) {
   db.close(testCommon.tearDown.bind(null, t))
 })
@@ -0,0 +1,58 @@
+const test       = require('tap').test
+    , testCommon = require('abstract-nosql/testCommon')
+    , leveldown  = require('../')
+
+var db
+
+test('setUp common', testCommon.setUp)
+
+test('setUp db', function (t) {
+  db = leveldown(testCommon.location())
+  db.open(t.end.bind(t))
+})
+
+test('test incr starts a missing counter at 0', function (t) {
+  t.equal(db.incrSync('counter', 5), 5)
+  t.equal(db.incrSync('counter', -2), 3)
+  t.equal(db.getSync('counter'), '3')
+  t.end()
+})
+
+test('test incr with callback', function (t) {
+  var pending = 10
+  for (var i = 0; i < 10; i++) {
+    db.incr('hits', 1, function (err, value) {
+      t.error(err)
+      if (--pending === 0) {
+        t.equal(db.getSync('hits'), '10')
+        t.end()
+      }
+    })
+  }
+})
+
+test('test incr fails on a value that is not an integer', function (t) {
+  db.putSync('name', 'leveldb')
+  t.throws(function () { db.incrSync('name', 1) })
+  t.equal(db.getSync('name'), 'leveldb')
+  t.end()
+})
+
+test('test cas', function (t) {
+  t.equal(db.casSync('owner', null, 'a'), true)
+  t.equal(db.casSync('owner', null, 'b'), false)
+  t.equal(db.casSync('owner', 'b', 'c'), false)
+  t.equal(db.getSync('owner'), 'a')
+  t.equal(db.casSync('owner', 'a', 'c'), true)
+  t.equal(db.getSync('owner'), 'c')
+  db.cas('owner', 'c', 'd', function (err, swapped) {
+    t.error(err)
+    t.equal(swapped, true)
+    t.equal(db.getSync('owner'), 'd')
+    t.end()
+  })
+})
+
+test('tearDown', function (t) {
+  db.close(testCommon.tearDown.bind(null, t))
+})
@@ -0,0 +1,133 @@
+const test       = require('tap').test
+    , testCommon = require('abstract-nosql/testCommon')
+    , leveldown  = require('../')
+
+var db
+
+function keys (iterator) {
+  var result = []
+    , entry
+  while ((entry = iterator.nextSync())) {
+    result.push(String(entry[0]))
+  }
+  iterator.endSync()
+  return result
+}
+
+test('setUp common', testCommon.setUp)
+
+test('setUp db', function (t) {
+  db = leveldown(testCommon.location())
+  db.open({keyspaces: ['users', 'posts']}, t.end.bind(t))
+})
+
+test('test keyspaces hold separate keys', function (t) {
+  var users = db.keyspace('users')
+    , posts = db.keyspace('posts')
+  db.putSync('a', 'default')
+  users.putSync('a', 'user')
+  posts.putSync('a', 'post')
+  t.equal(db.getSync('a'), 'default')
+  t.equal(users.getSync('a'), 'user')
+  t.equal(db.getSync('a', {keyspace: 'posts'}), 'post')
+  posts.delSync('a')
+  t.throws(function () { posts.getSync('a') })
+  t.equal(users.getSync('a'), 'user')
+  t.end()
+})
+
+test('test batch spans keyspaces', function (t) {
+  db.batchSync([
+    {type: 'put', keyspace: 'users', key: 'b', value: 'user-b'},
+    {type: 'put', keyspace: 'posts', key: 'b', value: 'post-b'},
+    {type: 'put', key: 'b', value: 'default-b'}
+  ])
+  t.equal(db.keyspace('users').getSync('b'), 'user-b')
+  t.equal(db.keyspace('posts').getSync('b'), 'post-b')
+  t.equal(db.getSync('b'), 'default-b')
+  db.keyspace('users').batchSync([{type: 'del', key: 'b'}])
+  t.throws(function () { db.keyspace('users').getSync('b') })
+  t.end()
+})
+
+test('test iterators only see their keyspace', function (t) {
+  var users = db.keyspace('users')
+  users.putSync('c', 'user-c')
+  users.putSync('d', 'user-d')
+  t.same(keys(db.iterator()), ['a', 'b'])
+  t.same(keys(users.iterator()), ['a', 'c', 'd'])
+  t.same(keys(users.iterator({reverse: true})), ['d', 'c', 'a'])
+  t.same(keys(users.iterator({gt: 'a', lte: 'c'})), ['c'])
+  t.same(keys(db.keyspace('posts').iterator()), ['b'])
+  var iterator = users.iterator()
+  iterator.seek('b')
+  t.equal(String(iterator.nextSync()[0]), 'c')
+  iterator.endSync()
+  t.end()
+})
+
+test('test undeclared keyspace and reserved keys', function (t) {
+  t.throws(function () { db.putSync('a', 'x', {keyspace: 'comments'}) })
+  t.throws(function () { db.keyspace('comments').iterator() })
+  t.throws(function () { db.putSync(new Buffer([0xff, 0x61]), 'x') })
+  t.end()
+})
+
+test('test every key-taking method honors the keyspace', function (t) {
+  var users = db.keyspace('users')
+  users.putSync('e', 'user-e')
+  t.equal(users.isExistsSync('e'), true)
+  t.equal(db.isExistsSync('e'), false)
+  t.same(users.mGetSync(['a', 'e'], {keys: false}), ['user', 'user-e'])
+  var buffer = new Buffer(6)
+  t.equal(users.getBufferSync('e', buffer), 6)
+  t.equal(buffer.toString(), 'user-e')
+  t.equal(users.incrSync('count', 2), 2)
+  t.equal(users.getSync('count'), '2')
+  t.throws(function () { db.getSync('count') })
+  t.equal(users.casSync('count', '2', '5'), true)
+  t.equal(db.casSync('count', null, '7'), true)
+  t.equal(users.getSync('count'), '5')
+  t.equal(db.getSync('count'), '7')
+  t.end()
+})
+
+test('test chained batches and transactions of a keyspace', function (t) {
+  var posts = db.keyspace('posts')
+  posts.batch().put('f', 'post-f').del('b').write(function (err) {
+    t.error(err)
+    t.equal(posts.getSync('f'), 'post-f')
+    t.throws(function () { posts.getSync('b') })
+    t.throws(function () { db.getSync('f') })
+    t.equal(db.getSync('b'), 'default-b')
+
+    var transaction = posts.beginTransaction()
+    transaction.putSync('g', 'post-g')
+    t.equal(transaction.getSync('f'), 'post-f')
+    t.equal(transaction.commitSync(), true)
+    t.equal(posts.getSync('g'), 'post-g')
+    t.throws(function () { db.getSync('g') })
+
+    transaction = db.beginTransaction()
+    transaction.putSync('h', 'user-h', {keyspace: 'users'})
+    t.equal(transaction.commitSync(), true)
+    t.equal(db.keyspace('users').getSync('h'), 'user-h')
+    t.end()
+  })
+})
+
+test('test undeclared keyspace and reserved keys in other methods', function (t) {
+  var reserved = new Buffer([0xff, 0x61])
+  t.throws(function () { db.isExistsSync('a', {keyspace: 'comments'}) })
+  t.throws(function () { db.mGetSync(['a'], {keyspace: 'comments', raiseError: false}) })
+  t.throws(function () { db.incrSync(reserved, 1) })
+  t.throws(function () { db.casSync(reserved, null, 'x') })
+  t.throws(function () { db.batch().put(reserved, 'x') })
+  t.throws(function () { db.beginTransaction().putSync(reserved, 'x') })
+  t.throws(function () { db.keyspace('comments').batch().put('a', 'x') })
+  t.end()
+})
+
+test('tearDown', function (t) {
+  db.close(testCommon.tearDown.bind(null, t))
+})
@@ -0,0 +1,40 @@
+const test       = require('tap').test
+    , testCommon = require('abstract-nosql/testCommon')
+    , leveldown  = require('../')
+
+var db
+
+test('setUp common', testCommon.setUp)
+
+test('setUp db', function (t) {
+  db = leveldown(testCommon.location())
+  db.open({ writeBufferSize: 64 * 1024, maxWriteBufferNumber: 4 }, t.end.bind(t))
+})
+
+test('test write burst over several write buffers', function (t) {
+  var value = Buffer(1024).fill(1)
+  for (var i = 0; i < 1000; i++) {
+    db.putSync('key' + i, value)
+  }
+  for (i = 0; i < 1000; i += 100) {
+    t.deepEqual(db.getSync('key' + i, { asBuffer: true }), value)
+  }
+  t.end()
+})
+
+test('test writes survive close and reopen', function (t) {
+  var location = db.location
+  db.close(function (err) {
+    t.error(err)
+    db = leveldown(location)
+    db.open({ maxWriteBufferNumber: 4 }, function (err) {
+      t.error(err)
+      t.equal(db.getSync('key999'), Buffer(1024).fill(1).toString())
+      t.end()
+    })
+  })
+})
+
+test('tearDown', function (t) {
+  db.close(testCommon.tearDown.bind(null, t))
+})
@@ -0,0 +1,47 @@
+const test       = require('tap').test
+    , testCommon = require('abstract-nosql/testCommon')
+    , leveldown  = require('../')
+
+var db
+
+test('setUp common', testCommon.setUp)
+
+test('setUp db', function (t) {
+  db = leveldown(testCommon.location())
+  db.open({ maxMemCompactionLevel: 0, mergeOperator: 'int64Add' }, t.end.bind(t))
+})
+
+test('test merge adds to a missing counter', function (t) {
+  db.mergeSync('counter', '1')
+  db.mergeSync('counter', '41')
+  t.equal(db.getSync('counter'), '42')
+  t.end()
+})
+
+test('test merge adds to a stored value', function (t) {
+  db.putSync('visits', '10')
+  for (var i = 0; i < 10; i++)
+    db.mergeSync('visits', '-2')
+  t.equal(db.getSync('visits'), '-10')
+  db.compactRangeSync('a', 'z')
+  t.equal(db.getSync('visits'), '-10')
+  t.end()
+})
+
+test('test merge with callback', function (t) {
+  db.merge('counter', '8', function (err) {
+    t.error(err)
+    t.equal(db.getSync('counter'), '50')
+    t.end()
+  })
+})
+
+test('test invalid merge operator', function (t) {
+  var db = leveldown(testCommon.location())
+  t.throws(function () { db.openSync({mergeOperator: 'int64Sum'}) })
+  t.end()
+})
+
+test('tearDown', function (t) {
+  db.close(testCommon.tearDown.bind(null, t))
+})
@@ -0,0 +1,60 @@
+const test       = require('tap').test
+    , testCommon = require('abstract-nosql/testCommon')
+    , leveldown  = require('../')
+
+function keys (iterator) {
+  var result = []
+    , entry
+  while ((entry = iterator.nextSync())) {
+    result.push(entry[0])
+  }
+  iterator.endSync()
+  return result
+}
+
+test('setUp common', testCommon.setUp)
+
+test('test prefix seek with the delimiter extractor', function (t) {
+  var db = leveldown(testCommon.location())
+  db.openSync({prefixExtractor: 'delimiter', prefixDelimiter: ':'})
+  db.putSync('post:1', 'a')
+  db.putSync('post:2', 'b')
+  db.putSync('user:1', 'c')
+  db.putSync('user:2', 'd')
+  t.same(keys(db.iterator({keyAsBuffer: false, gte: 'post:'})),
+    ['post:1', 'post:2', 'user:1', 'user:2'])
+  t.same(keys(db.iterator({keyAsBuffer: false, gte: 'post:', prefixSeek: true})),
+    ['post:1', 'post:2'])
+  t.same(keys(db.iterator({keyAsBuffer: false, lte: 'user:~', reverse: true, prefixSeek: true})),
+    ['user:2', 'user:1'])
+  t.same(keys(db.iterator({keyAsBuffer: false, gte: 'tag:', prefixSeek: true})), [])
+  // no prefix: a plain iterator
+  t.same(keys(db.iterator({keyAsBuffer: false, gte: 'user', prefixSeek: true})),
+    ['user:1', 'user:2'])
+  db.closeSync()
+  t.end()
+})
+
+test('test prefix seek with the fixed extractor', function (t) {
+  var db = leveldown(testCommon.location())
+  db.openSync({prefixExtractor: 'fixed', prefixLength: 2})
+  db.putSync('aa1', '1')
+  db.putSync('ab1', '2')
+  db.putSync('ab2', '3')
+  db.compactRangeSync('a', 'z')
+  t.same(keys(db.iterator({keyAsBuffer: false, gte: 'ab', prefixSeek: true})),
+    ['ab1', 'ab2'])
+  db.closeSync()
+  t.end()
+})
+
+test('test invalid prefix extractor options', function (t) {
+  var db = leveldown(testCommon.location())
+  t.throws(function () { db.openSync({prefixExtractor: 'capped'}) })
+  t.throws(function () { db.openSync({prefixExtractor: 'fixed'}) })
+  t.throws(function () { db.openSync({prefixExtractor: 'delimiter', prefixDelimiter: '::'}) })
+  t.throws(function () { db.openSync({prefixExtractor: 'fixed', prefixLength: 2, comparator: 'reverse'}) })
+  t.end()
+})
+
+test('tearDown', testCommon.tearDown)
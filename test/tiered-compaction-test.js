@@ -0,0 +1,47 @@
+const test       = require('tap').test
+    , testCommon = require('abstract-nosql/testCommon')
+    , leveldown  = require('../')
+
+var db
+
+test('setUp common', testCommon.setUp)
+
+test('setUp db', function (t) {
+  db = leveldown(testCommon.location())
+  db.open({
+      writeBufferSize: 64 * 1024
+    , compactionStyle: 'tiered'
+    , level0FileNumCompactionTrigger: 2
+    , tieredSizeRatio: 10
+    , tieredMaxRuns: 4
+  }, t.end.bind(t))
+})
+
+test('test overwrites and deletes with tiered compaction', function (t) {
+  var value = Buffer(512).fill(1)
+  var i
+  for (var pass = 0; pass < 3; pass++) {
+    for (i = 0; i < 1000; i++) {
+      db.putSync('key' + i, value)
+    }
+  }
+  for (i = 0; i < 1000; i += 2) {
+    db.delSync('key' + i)
+  }
+  for (i = 0; i < 1000; i += 50) {
+    t.equal(db.isExistsSync('key' + i), false)
+    t.deepEqual(db.getSync('key' + (i + 1), { asBuffer: true }), value)
+  }
+  t.equal(db.getProperty('leveldb.num-files-at-level1'), '0')
+  t.end()
+})
+
+test('test invalid compaction style', function (t) {
+  var db = leveldown(testCommon.location())
+  t.throws(function () { db.openSync({compactionStyle: 'leveled'}) })
+  t.end()
+})
+
+test('tearDown', function (t) {
+  db.close(testCommon.tearDown.bind(null, t))
+})
@@ -0,0 +1,66 @@
+const test       = require('tap').test
+    , testCommon = require('abstract-nosql/testCommon')
+    , leveldown  = require('../')
+
+var db
+
+test('setUp common', testCommon.setUp)
+
+test('setUp db', function (t) {
+  db = leveldown(testCommon.location())
+  db.open(t.end.bind(t))
+})
+
+test('test transaction reads its snapshot and its own writes', function (t) {
+  db.putSync('a', '1')
+  var txn = db.beginTransaction()
+  db.putSync('b', '2')
+  t.equal(txn.getSync('a'), '1')
+  t.throws(function () { txn.getSync('b') })
+  txn.putSync('a', '10')
+  t.equal(txn.getSync('a'), '10')
+  t.equal(db.getSync('a'), '1')
+  t.equal(txn.commitSync(), true)
+  t.equal(db.getSync('a'), '10')
+  t.end()
+})
+
+test('test conflicting transaction does not commit', function (t) {
+  var txn1 = db.beginTransaction()
+    , txn2 = db.beginTransaction()
+  txn1.putSync('counter', String(Number(txn1.getSync('a')) + 1))
+  txn2.putSync('counter', String(Number(txn2.getSync('a')) + 2))
+  db.putSync('a', '20')
+  t.equal(txn1.commitSync(), false)
+  t.equal(db.isExistsSync('counter'), false)
+  // txn2 read 'a' too, so it conflicts as well
+  t.equal(txn2.commitSync(), false)
+  t.end()
+})
+
+test('test independent transactions commit', function (t) {
+  var txn1 = db.beginTransaction()
+    , txn2 = db.beginTransaction()
+  txn1.putSync('x', 'x1')
+  txn2.putSync('y', 'y1')
+  t.equal(txn1.commitSync(), true)
+  txn2.commit(function (err, committed) {
+    t.error(err)
+    t.equal(committed, true)
+    t.equal(db.getSync('y'), 'y1')
+    t.end()
+  })
+})
+
+test('test rollback', function (t) {
+  var txn = db.beginTransaction()
+  txn.putSync('z', 'z1')
+  txn.rollbackSync()
+  t.equal(db.isExistsSync('z'), false)
+  t.throws(function () { txn.commitSync() })
+  t.end()
+})
+
+test('tearDown', function (t) {
+  db.close(testCommon.tearDown.bind(null, t))
+})
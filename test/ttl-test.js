@@ -0,0 +1,52 @@
+const test       = require('tap').test
+    , testCommon = require('abstract-nosql/testCommon')
+    , leveldown  = require('../')
+
+var db
+
+test('setUp common', testCommon.setUp)
+
+test('setUp db', function (t) {
+  db = leveldown(testCommon.location())
+  db.open(t.end.bind(t))
+})
+
+test('test putSync() with ttl', function (t) {
+  db.putSync('old', 'value')
+  db.putSync('old', 'short', { ttl: 50 })
+  db.putSync('short', 'value', { ttl: 50 })
+  db.putSync('long', 'value', { ttl: 3600 * 1000 })
+  t.equal(db.getSync('short'), 'value')
+  t.equal(db.getSync('old'), 'short')
+  setTimeout(function () {
+    t.equal(db.isExistsSync('short'), false)
+    t.equal(db.isExistsSync('old'), false)
+    t.equal(db.getSync('long'), 'value')
+    db.compactRangeSync('a', 'z')
+    t.equal(db.isExistsSync('short'), false)
+    t.equal(db.isExistsSync('old'), false)
+    t.equal(db.getSync('long'), 'value')
+    t.end()
+  }, 100)
+})
+
+test('test iterator skips expired entries', function (t) {
+  var keys = []
+  var iterator = db.iterator({ keyAsBuffer: false })
+  function next () {
+    iterator.next(function (err, key) {
+      t.error(err)
+      if (key === undefined) {
+        t.deepEqual(keys, [ 'long' ])
+        return iterator.end(t.end.bind(t))
+      }
+      keys.push(key)
+      next()
+    })
+  }
+  next()
+})
+
+test('tearDown', function (t) {
+  db.close(testCommon.tearDown.bind(null, t))
+})
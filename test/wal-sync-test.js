@@ -0,0 +1,48 @@
+const test       = require('tap').test
+    , testCommon = require('abstract-nosql/testCommon')
+    , leveldown  = require('../')
+
+var db
+
+test('setUp common', testCommon.setUp)
+
+test('setUp db', function (t) {
+  db = leveldown(testCommon.location())
+  db.open({ walSyncIntervalMs: 10, walSyncBytes: 4096 }, t.end.bind(t))
+})
+
+test('test syncWalSync() without pending writes', function (t) {
+  t.equal(db.syncWalSync(), true, 'syncWalSync() returns true')
+  t.end()
+})
+
+test('test syncWal() after writes', function (t) {
+  db.putSync('foo', 'bar')
+  db.putSync('baz', Buffer(8192).fill(1))
+  t.equal(db.syncWal(), true, 'syncWal() without callback is synchronous')
+  db.putSync('foo', 'bar2')
+  db.syncWal(function (err) {
+    t.error(err)
+    t.equal(db.getSync('foo'), 'bar2')
+    t.end()
+  })
+})
+
+test('test writes survive close and reopen', function (t) {
+  var location = db.location
+  db.putSync('qux', 'quux')
+  db.close(function (err) {
+    t.error(err)
+    db = leveldown(location)
+    db.open({ walSyncIntervalMs: 10 }, function (err) {
+      t.error(err)
+      t.equal(db.getSync('qux'), 'quux')
+      t.equal(db.getSync('foo'), 'bar2')
+      t.end()
+    })
+  })
+})
+
+test('tearDown', function (t) {
+  db.close(testCommon.tearDown.bind(null, t))
+})
@@ -0,0 +1,101 @@
+const test       = require('tap').test
+    , testCommon = require('abstract-nosql/testCommon')
+    , leveldown  = require('../')
+
+var db
+
+test('setUp common', testCommon.setUp)
+
+test('setUp db', function (t) {
+  db = leveldown(testCommon.location())
+  db.open({ writeBehindSize: 1024 * 1024, writeBehindIntervalMs: 0 }, t.end.bind(t))
+})
+
+test('test buffered writes are readable', function (t) {
+  db.putSync('foo', 'bar')
+  db.putSync('foo', 'bar2')
+  db.putSync('baz', 'qux')
+  db.delSync('baz')
+  t.equal(db.getSync('foo'), 'bar2')
+  t.equal(db.isExistsSync('foo'), true)
+  t.equal(db.isExistsSync('baz'), false)
+  t.throws(db.getSync.bind(db, 'baz'), { message: /NotFound/ }, 'deleted key is not found')
+  t.end()
+})
+
+test('test flushSync() writes the buffer', function (t) {
+  t.equal(db.flushSync(), true)
+  t.equal(db.getSync('foo'), 'bar2')
+  db.flush(function (err) {
+    t.error(err)
+    t.end()
+  })
+})
+
+test('test iterator sees buffered writes', function (t) {
+  db.putSync('a', '1')
+  db.putSync('b', '2')
+  var it = db.iterator({ keyAsBuffer: false, valueAsBuffer: false })
+  var keys = []
+  it.next(function next (err, key, value) {
+    t.error(err)
+    if (key === undefined) {
+      it.end(function () {
+        t.deepEqual(keys, ['a', 'b', 'foo'])
+        t.end()
+      })
+      return
+    }
+    keys.push(key)
+    it.next(next)
+  })
+})
+
+test('test batch keeps order with buffered writes', function (t) {
+  db.putSync('order', 'buffered')
+  db.batchSync([{ type: 'put', key: 'order', value: 'batch' }])
+  t.equal(db.getSync('order'), 'batch')
+  t.end()
+})
+
+test('test buffered writes survive close and reopen', function (t) {
+  var location = db.location
+  db.putSync('last', 'write')
+  db.close(function (err) {
+    t.error(err)
+    db = leveldown(location)
+    db.open(function (err) {
+      t.error(err)
+      t.equal(db.getSync('last'), 'write')
+      t.equal(db.getSync('foo'), 'bar2')
+      t.end()
+    })
+  })
+})
+
+test('test merges are buffered after the writes of their key', function (t) {
+  var location = testCommon.location()
+    , merged = leveldown(location)
+  merged.openSync({ writeBehindSize: 1024 * 1024, writeBehindIntervalMs: 0, mergeOperator: 'int64Add' })
+  merged.putSync('count', '10')
+  merged.flushSync()
+  merged.mergeSync('count', '5')
+  merged.mergeSync('fresh', '3')
+  merged.putSync('reset', '1')
+  merged.mergeSync('reset', '2')
+  t.equal(merged.getSync('count'), '15')
+  t.equal(merged.getSync('fresh'), '3')
+  t.equal(merged.getSync('reset'), '3')
+  merged.delSync('reset')
+  merged.mergeSync('reset', '7')
+  t.equal(merged.getSync('reset'), '7')
+  merged.flushSync()
+  t.equal(merged.getSync('count'), '15')
+  t.equal(merged.getSync('reset'), '7')
+  merged.closeSync()
+  t.end()
+})
+
+test('tearDown', function (t) {
+  db.close(testCommon.tearDown.bind(null, t))
+})
@@ -0,0 +1,67 @@
+// keyspace: the keyspace of the keys of the transaction, see keyspace.js
+function Transaction (db, keyspace) {
+  this.binding  = db.binding.beginTransaction()
+  this.keyspace = keyspace
+}
+
+
+Transaction.prototype._options = function (options) {
+  if (this.keyspace == null) return options
+  var result = {}
+  if (options && typeof options == 'object') {
+    for (var k in options) result[k] = options[k]
+  }
+  result.keyspace = this.keyspace
+  return result
+}
+
+
+// read the key at the snapshot of the transaction, or its pending write
+Transaction.prototype.getSync = function (key, options) {
+  return this.binding.getSync(key, this._options(options))
+}
+
+
+Transaction.prototype.putSync = function (key, value, options) {
+  this.binding.putSync(key, value, this._options(options))
+  return this
+}
+
+
+Transaction.prototype.delSync = function (key, options) {
+  this.binding.delSync(key, this._options(options))
+  return this
+}
+
+
+// return false if a key read or written by the transaction has changed
+Transaction.prototype.commitSync = function (options) {
+  return this.binding.commitSync(options)
+}
+
+
+Transaction.prototype.commit = function (options, callback) {
+  var that = this
+  if (typeof options == 'function') {
+    callback = options
+    options = {}
+  }
+  setImmediate(function () {
+    var result
+    try {
+      result = that.commitSync(options)
+    } catch (err) {
+      callback(err)
+      return
+    }
+    callback(null, result)
+  })
+}
+
+
+Transaction.prototype.rollbackSync = function () {
+  return this.binding.rollbackSync()
+}
+
+
+module.exports = Transaction